@@ -258,6 +258,15 @@ BASE_EXPORT void RecommitSystemPages(
 BASE_EXPORT void DiscardSystemPages(uintptr_t address, size_t length);
 BASE_EXPORT void DiscardSystemPages(void* address, size_t length);
 
+// Hints that the system pages starting at |address| and continuing for
+// |length| bytes should be backed by huge pages, e.g. transparent huge pages on
+// Linux, to reduce TLB misses. Only the huge pages entirely within the range
+// can be used. |address| and |length| must be multiples of |SystemPageSize()|.
+//
+// Returns false if huge pages are not supported by the platform, or not
+// available in the system.
+BASE_EXPORT bool AdviseHugePages(uintptr_t address, size_t length);
+
 // Rounds up |address| to the next multiple of |SystemPageSize()|. Returns
 // 0 for an |address| of 0.
 PAGE_ALLOCATOR_CONSTANTS_DECLARE_CONSTEXPR ALWAYS_INLINE uintptr_t
@@ -318,6 +327,7 @@ namespace base {
 
 // TODO(https://crbug.com/1288247): Remove these 'using' declarations once
 // the migration to the new namespaces gets done.
+using ::partition_alloc::AdviseHugePages;
 using ::partition_alloc::AllocPages;
 using ::partition_alloc::AllocPagesWithAlignOffset;
 using ::partition_alloc::DecommitAndZeroSystemPages;
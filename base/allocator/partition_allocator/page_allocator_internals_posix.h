@@ -16,6 +16,7 @@
 #include "base/allocator/partition_allocator/page_allocator.h"
 #include "base/allocator/partition_allocator/partition_alloc_base/posix/eintr_wrapper.h"
 #include "base/allocator/partition_allocator/partition_alloc_check.h"
+#include "base/allocator/partition_allocator/partition_alloc_config.h"
 #include "base/dcheck_is_on.h"
 #include "build/build_config.h"
 
@@ -370,6 +371,14 @@ void DiscardSystemPagesInternal(uintptr_t address, size_t length) {
 #endif
 }
 
+#if defined(PA_HAS_TRANSPARENT_HUGE_PAGES)
+bool AdviseHugePagesInternal(uintptr_t address, size_t length) {
+  // Fails with EINVAL when the kernel is built without transparent huge pages,
+  // which is not an error for a hint.
+  return madvise(reinterpret_cast<void*>(address), length, MADV_HUGEPAGE) == 0;
+}
+#endif  // defined(PA_HAS_TRANSPARENT_HUGE_PAGES)
+
 }  // namespace partition_alloc::internal
 
 #endif  // BASE_ALLOCATOR_PARTITION_ALLOCATOR_PAGE_ALLOCATOR_INTERNALS_POSIX_H_
@@ -70,6 +70,13 @@ static_assert(sizeof(void*) != 8, "");
 #define PA_HAS_LINUX_KERNEL
 #endif
 
+// Transparent huge pages can back the super pages of a partition, see
+// PartitionOptions::HugePages. They are 2 MiB, the size of a super page, when
+// the system page size is 4 KiB.
+#if defined(PA_HAS_LINUX_KERNEL) && defined(PA_HAS_64_BITS_POINTERS)
+#define PA_HAS_TRANSPARENT_HUGE_PAGES
+#endif
+
 // On some platforms, we implement locking by spinning in userspace, then going
 // into the kernel only if there is contention. This requires platform support,
 // namely:
@@ -157,6 +164,13 @@ static_assert(sizeof(void*) != 8, "");
 #define PA_THREAD_LOCAL_TLS
 #endif
 
+// Per-CPU caches find the current CPU with restartable sequences, which are
+// Linux-specific, through a thread_local registration area.
+#if (BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)) && \
+    defined(PA_THREAD_LOCAL_TLS) && defined(PA_HAS_64_BITS_POINTERS)
+#define PA_HAS_PER_CPU_CACHE
+#endif
+
 // When PartitionAlloc is malloc(), detect malloc() becoming re-entrant by
 // calling malloc() again.
 //
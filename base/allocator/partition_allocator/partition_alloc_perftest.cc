@@ -11,9 +11,11 @@
 #include "base/allocator/partition_allocator/partition_alloc.h"
 #include "base/allocator/partition_allocator/partition_alloc_base/logging.h"
 #include "base/allocator/partition_allocator/partition_alloc_check.h"
+#include "base/allocator/partition_allocator/partition_alloc_config.h"
 #include "base/allocator/partition_allocator/thread_cache.h"
 #include "base/bind.h"
 #include "base/callback.h"
+#include "base/rand_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/threading/platform_thread.h"
 #include "base/time/time.h"
@@ -72,7 +74,10 @@ perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
 enum class AllocatorType {
   kSystem,
   kPartitionAlloc,
-  kPartitionAllocWithThreadCache
+  kPartitionAllocWithThreadCache,
+#if defined(PA_HAS_PER_CPU_CACHE)
+  kPartitionAllocWithPerCpuCache,
+#endif
 };
 
 class Allocator {
@@ -93,7 +98,18 @@ class SystemAllocator : public Allocator {
 
 class PartitionAllocator : public Allocator {
  public:
-  PartitionAllocator() = default;
+  explicit PartitionAllocator(
+      PartitionOptions::HugePages huge_pages =
+          PartitionOptions::HugePages::kDisabled)
+      : alloc_({
+            PartitionOptions::AlignedAlloc::kDisallowed,
+            PartitionOptions::ThreadCache::kDisabled,
+            PartitionOptions::Quarantine::kDisallowed,
+            PartitionOptions::Cookie::kAllowed,
+            PartitionOptions::BackupRefPtr::kDisabled,
+            PartitionOptions::UseConfigurablePool::kNo,
+            huge_pages,
+        }) {}
   ~PartitionAllocator() override { alloc_.DestructForTesting(); }
 
   void* Alloc(size_t size) override {
@@ -102,14 +118,7 @@ class PartitionAllocator : public Allocator {
   void Free(void* data) override { ThreadSafePartitionRoot::FreeNoHooks(data); }
 
  private:
-  ThreadSafePartitionRoot alloc_{{
-      PartitionOptions::AlignedAlloc::kDisallowed,
-      PartitionOptions::ThreadCache::kDisabled,
-      PartitionOptions::Quarantine::kDisallowed,
-      PartitionOptions::Cookie::kAllowed,
-      PartitionOptions::BackupRefPtr::kDisabled,
-      PartitionOptions::UseConfigurablePool::kNo,
-  }};
+  ThreadSafePartitionRoot alloc_;
 };
 
 // Only one partition with a thread cache.
@@ -142,6 +151,37 @@ class PartitionAllocatorWithThreadCache : public Allocator {
   void Free(void* data) override { ThreadSafePartitionRoot::FreeNoHooks(data); }
 };
 
+#if defined(PA_HAS_PER_CPU_CACHE)
+// Contrary to the thread cache, any number of partitions can have per-CPU
+// caches.
+class PartitionAllocatorWithPerCpuCache : public Allocator {
+ public:
+  explicit PartitionAllocatorWithPerCpuCache(bool use_alternate_bucket_dist)
+      : alloc_({
+            PartitionOptions::AlignedAlloc::kDisallowed,
+            PartitionOptions::ThreadCache::kPerCpu,
+            PartitionOptions::Quarantine::kDisallowed,
+            PartitionOptions::Cookie::kAllowed,
+            PartitionOptions::BackupRefPtr::kDisabled,
+            PartitionOptions::UseConfigurablePool::kNo,
+        }) {
+    if (!use_alternate_bucket_dist)
+      alloc_.SwitchToDenserBucketDistribution();
+  }
+  ~PartitionAllocatorWithPerCpuCache() override {
+    alloc_.DestructForTesting();
+  }
+
+  void* Alloc(size_t size) override {
+    return alloc_.AllocWithFlagsNoHooks(0, size, PartitionPageSize());
+  }
+  void Free(void* data) override { ThreadSafePartitionRoot::FreeNoHooks(data); }
+
+ private:
+  ThreadSafePartitionRoot alloc_;
+};
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
+
 class TestLoopThread : public base::PlatformThread::Delegate {
  public:
   explicit TestLoopThread(base::OnceCallback<float()> test_fn)
@@ -318,6 +358,43 @@ float DirectMapped(Allocator* allocator) {
   return timer.LapsPerSecond();
 }
 
+#if !defined(MEMORY_CONSTRAINED)
+// Allocates 256 MiB of small objects, and visits them in a random order, so
+// that most accesses miss the data TLB unless the memory is backed by huge
+// pages. Each lap is one access.
+float RandomAccess(Allocator* allocator) {
+  constexpr size_t kObjectSize = 256;
+  constexpr size_t kObjectCount = (256 << 20) / kObjectSize;
+  constexpr int kAccessesPerLap = 1000;
+
+  std::vector<MemoryAllocationPerfNode*> nodes(kObjectCount);
+  for (auto*& node : nodes) {
+    node = reinterpret_cast<MemoryAllocationPerfNode*>(
+        allocator->Alloc(kObjectSize));
+    CHECK_NE(node, nullptr);
+  }
+  std::vector<MemoryAllocationPerfNode*> order = nodes;
+  ::base::RandomShuffle(order.begin(), order.end());
+  for (size_t i = 0; i < kObjectCount; ++i)
+    order[i]->SetNext(order[(i + 1) % kObjectCount]);
+
+  base::LapTimer timer(kWarmupRuns / kAccessesPerLap, kTimeLimit,
+                       kTimeCheckInterval / kAccessesPerLap);
+  MemoryAllocationPerfNode* cur = order[0];
+  do {
+    for (int i = 0; i < kAccessesPerLap; ++i)
+      cur = cur->GetNext();
+    timer.NextLap();
+  } while (!timer.HasTimeLimitExpired());
+  // Keeps the loop from being optimized out.
+  CHECK_NE(cur, nullptr);
+
+  for (auto* node : nodes)
+    allocator->Free(node);
+  return timer.LapsPerSecond() * kAccessesPerLap;
+}
+#endif  // !defined(MEMORY_CONSTRAINED)
+
 std::unique_ptr<Allocator> CreateAllocator(AllocatorType type,
                                            bool use_alternate_bucket_dist) {
   switch (type) {
@@ -328,6 +405,11 @@ std::unique_ptr<Allocator> CreateAllocator(AllocatorType type,
     case AllocatorType::kPartitionAllocWithThreadCache:
       return std::make_unique<PartitionAllocatorWithThreadCache>(
           use_alternate_bucket_dist);
+#if defined(PA_HAS_PER_CPU_CACHE)
+    case AllocatorType::kPartitionAllocWithPerCpuCache:
+      return std::make_unique<PartitionAllocatorWithPerCpuCache>(
+          use_alternate_bucket_dist);
+#endif
   }
 }
 
@@ -382,6 +464,11 @@ void RunTest(int thread_count,
     case AllocatorType::kPartitionAllocWithThreadCache:
       alloc_type_str = "PartitionAllocWithThreadCache";
       break;
+#if defined(PA_HAS_PER_CPU_CACHE)
+    case AllocatorType::kPartitionAllocWithPerCpuCache:
+      alloc_type_str = "PartitionAllocWithPerCpuCache";
+      break;
+#endif
   }
 
   std::string name =
@@ -407,7 +494,12 @@ INSTANTIATE_TEST_SUITE_P(
         ::testing::Values(false, true),
         ::testing::Values(AllocatorType::kSystem,
                           AllocatorType::kPartitionAlloc,
-                          AllocatorType::kPartitionAllocWithThreadCache)));
+                          AllocatorType::kPartitionAllocWithThreadCache
+#if defined(PA_HAS_PER_CPU_CACHE)
+                          ,
+                          AllocatorType::kPartitionAllocWithPerCpuCache
+#endif
+                          )));
 
 // This test (and the other one below) allocates a large amount of memory, which
 // can cause issues on Android.
@@ -459,6 +551,21 @@ TEST_P(PartitionAllocMemoryAllocationPerfTest,
 }
 #endif  // !defined(MEMORY_CONSTRAINED)
 
+#if !defined(MEMORY_CONSTRAINED)
+TEST(PartitionAllocHugePagesPerfTest, RandomAccess) {
+  for (auto huge_pages : {PartitionOptions::HugePages::kDisabled,
+                          PartitionOptions::HugePages::kEnabled}) {
+    PartitionAllocator allocator(huge_pages);
+    const bool enabled = huge_pages == PartitionOptions::HugePages::kEnabled;
+    DisplayResults(
+        base::StringPrintf("%sRandomAccess_%s", kMetricPrefixMemoryAllocation,
+                           enabled ? "PartitionAllocWithHugePages"
+                                   : "PartitionAlloc"),
+        RandomAccess(&allocator));
+  }
+}
+#endif  // !defined(MEMORY_CONSTRAINED)
+
 }  // namespace
 
 }  // namespace partition_alloc::internal
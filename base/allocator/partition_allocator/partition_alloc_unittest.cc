@@ -4379,6 +4379,50 @@ TEST_P(PartitionAllocTest, EmptySlotSpanSizeIsCapped) {
     root.Free(ptr);
 }
 
+TEST_P(PartitionAllocTest, HugePages) {
+  PartitionRoot<ThreadSafe> root;
+  root.Init({
+      PartitionOptions::AlignedAlloc::kDisallowed,
+      PartitionOptions::ThreadCache::kDisabled,
+      PartitionOptions::Quarantine::kDisallowed,
+      PartitionOptions::Cookie::kAllowed,
+      PartitionOptions::BackupRefPtr::kDisabled,
+      PartitionOptions::UseConfigurablePool::kNo,
+      PartitionOptions::HugePages::kEnabled,
+  });
+#if defined(PA_HAS_TRANSPARENT_HUGE_PAGES)
+  EXPECT_EQ(SystemPageSize() == (size_t{1} << 12), root.use_huge_pages);
+#else
+  EXPECT_FALSE(root.use_huge_pages);
+#endif
+
+  // Fill more than a super page, then free everything, decommit and discard.
+  // The memory must be usable again afterwards.
+  const size_t size = SystemPageSize();
+  const size_t count = 2 * kSuperPageSize / size;
+  for (int round = 0; round < 2; ++round) {
+    std::vector<void*> allocated_memory;
+    for (size_t i = 0; i < count; i++) {
+      void* ptr = root.Alloc(size, "");
+      ASSERT_TRUE(ptr);
+      memset(ptr, 'A', size);
+      allocated_memory.push_back(ptr);
+    }
+    if (root.use_huge_pages) {
+      // The whole super page is accessible, including its guard pages.
+      uintptr_t super_page =
+          UnmaskPtr(reinterpret_cast<uintptr_t>(allocated_memory[0])) &
+          kSuperPageBaseMask;
+      EXPECT_EQ(0, *reinterpret_cast<volatile char*>(super_page));
+    }
+    for (void* ptr : allocated_memory)
+      root.Free(ptr);
+    root.PurgeMemory(PurgeFlags::kDecommitEmptySlotSpans |
+                     PurgeFlags::kDiscardUnusedSystemPages);
+    EXPECT_EQ(TS_UNCHECKED_READ(root.empty_slot_spans_dirty_bytes), 0u);
+  }
+}
+
 TEST_P(PartitionAllocTest, IncreaseEmptySlotSpanRingSize) {
   PartitionRoot<ThreadSafe> root({
       PartitionOptions::AlignedAlloc::kDisallowed,
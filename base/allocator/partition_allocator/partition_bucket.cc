@@ -632,9 +632,8 @@ PartitionBucket<thread_safe>::AllocNewSlotSpan(PartitionRoot<thread_safe>* root,
     PA_DEBUG_DATA_ON_STACK("spansize", slot_span_reservation_size);
     PA_DEBUG_DATA_ON_STACK("spancmt", slot_span_committed_size);
 
-    root->RecommitSystemPagesForData(
-        slot_span_start, slot_span_committed_size,
-        PageAccessibilityDisposition::kRequireUpdate);
+    root->RecommitSystemPagesForData(slot_span_start, slot_span_committed_size,
+                                     root->GetDataRecommitDisposition());
   }
 
   PA_CHECK(get_slots_per_span() <=
@@ -718,7 +717,18 @@ ALWAYS_INLINE uintptr_t PartitionBucket<thread_safe>::AllocNewSuperPage(
   // Keep the first partition page in the super page inaccessible to serve as a
   // guard page, except an "island" in the middle where we put page metadata and
   // also a tiny amount of extent metadata.
-  {
+  //
+  // With huge pages, make the whole super page accessible instead, so that it
+  // is a single mapping which the kernel can back with a huge page. Its data
+  // pages then stay accessible when slot spans are decommitted, and are
+  // recommitted without updating their accessibility.
+  if (root->use_huge_pages) {
+    ScopedSyscallTimer timer{root};
+    RecommitSystemPages(super_page, kSuperPageSize,
+                        PageAccessibilityConfiguration::kReadWriteTagged,
+                        PageAccessibilityDisposition::kRequireUpdate);
+    AdviseHugePages(super_page, kSuperPageSize);
+  } else {
     ScopedSyscallTimer timer{root};
     RecommitSystemPages(
         super_page + SystemPageSize(),
@@ -874,12 +884,11 @@ PartitionBucket<thread_safe>::ProvisionMoreSlotsAndAllocOne(
   // in an initially decommitted state, commit them here.
   // Note, we can't use PageAccessibilityDisposition::kAllowKeepForPerf, because
   // we have no knowledge which pages have been committed before (it doesn't
-  // matter on Windows anyway).
+  // matter on Windows anyway), unless the data pages always stay accessible.
   if (kUseLazyCommit) {
     // TODO(lizeb): Handle commit failure.
-    root->RecommitSystemPagesForData(
-        commit_start, commit_end - commit_start,
-        PageAccessibilityDisposition::kRequireUpdate);
+    root->RecommitSystemPagesForData(commit_start, commit_end - commit_start,
+                                     root->GetDataRecommitDisposition());
   }
 
   if (LIKELY(size <= kMaxMemoryTaggingSize)) {
@@ -157,6 +157,12 @@ namespace {
 void LockRoot(PartitionRoot<internal::ThreadSafe>* root,
               bool) NO_THREAD_SAFETY_ANALYSIS {
   PA_DCHECK(root);
+#if defined(PA_HAS_PER_CPU_CACHE)
+  // Per-CPU caches take the root lock while holding theirs, so are locked
+  // first.
+  for (uint32_t cpu = 0; cpu < root->per_cpu_cache_count; cpu++)
+    root->per_cpu_caches[cpu].AcquireLockBeforeFork();
+#endif
   root->lock_.Acquire();
 }
 
@@ -186,6 +192,10 @@ void UnlockOrReinit(T& lock, bool in_child) NO_THREAD_SAFETY_ANALYSIS {
 void UnlockOrReinitRoot(PartitionRoot<internal::ThreadSafe>* root,
                         bool in_child) NO_THREAD_SAFETY_ANALYSIS {
   UnlockOrReinit(root->lock_, in_child);
+#if defined(PA_HAS_PER_CPU_CACHE)
+  for (uint32_t cpu = 0; cpu < root->per_cpu_cache_count; cpu++)
+    root->per_cpu_caches[cpu].ReleaseLockAfterFork(in_child);
+#endif
 }
 
 void ReleaseLocks(bool in_child) NO_THREAD_SAFETY_ANALYSIS {
@@ -632,6 +642,14 @@ void PartitionRoot<thread_safe>::DestructForTesting() {
   // pages below, which we currently are not doing. So, we should only call
   // this function on PartitionRoots without a thread cache.
   PA_CHECK(!with_thread_cache);
+#if defined(PA_HAS_PER_CPU_CACHE)
+  // Per-CPU caches hold slots from the super pages, release them first.
+  if (per_cpu_caches) {
+    PerCpuCache::DestroyAll(per_cpu_caches, per_cpu_cache_count);
+    per_cpu_caches = nullptr;
+    per_cpu_cache_count = 0;
+  }
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
   auto pool_handle = ChoosePool();
   auto* curr = first_extent;
   while (curr != nullptr) {
@@ -693,6 +711,13 @@ void PartitionRoot<thread_safe>::Init(PartitionOptions opts) {
     // BRP requires objects to be in a different Pool.
     PA_CHECK(!(use_configurable_pool && brp_enabled()));
 
+#if defined(PA_HAS_TRANSPARENT_HUGE_PAGES)
+    // A super page can only be a huge page when it is the size of one.
+    use_huge_pages =
+        opts.huge_pages == PartitionOptions::HugePages::kEnabled &&
+        internal::SystemPageSize() == (size_t{1} << 12);
+#endif
+
     // Ref-count messes up alignment needed for AlignedAlloc, making this
     // option incompatible. However, except in the
     // PUT_REF_COUNT_IN_PREVIOUS_SLOT case.
@@ -770,6 +795,11 @@ void PartitionRoot<thread_safe>::Init(PartitionOptions opts) {
       ThreadCache::Init(this);
 #endif  // !defined(PA_THREAD_CACHE_SUPPORTED)
 
+#if defined(PA_HAS_PER_CPU_CACHE)
+    if (opts.thread_cache == PartitionOptions::ThreadCache::kPerCpu)
+      per_cpu_caches = PerCpuCache::CreateAll(this, &per_cpu_cache_count);
+#endif
+
 #if defined(PA_USE_PARTITION_ROOT_ENUMERATOR)
     internal::PartitionRootEnumerator::Instance().Register(this);
 #endif
@@ -794,6 +824,11 @@ PartitionRoot<thread_safe>::~PartitionRoot() {
   if (initialized)
     internal::PartitionRootEnumerator::Instance().Unregister(this);
 #endif  // defined(PA_USE_PARTITION_ALLOC_ENUMERATOR)
+
+#if defined(PA_HAS_PER_CPU_CACHE)
+  if (per_cpu_caches)
+    PerCpuCache::DestroyAll(per_cpu_caches, per_cpu_cache_count);
+#endif
 }
 
 template <bool thread_safe>
@@ -801,6 +836,10 @@ void PartitionRoot<thread_safe>::EnableThreadCacheIfSupported() {
 #if defined(PA_THREAD_CACHE_SUPPORTED)
   ::partition_alloc::internal::ScopedGuard guard{lock_};
   PA_CHECK(!with_thread_cache);
+#if defined(PA_HAS_PER_CPU_CACHE)
+  // The two kinds of caches are exclusive.
+  PA_CHECK(!per_cpu_caches);
+#endif
   // By the time we get there, there may be multiple threads created in the
   // process. Since `with_thread_cache` is accessed without a lock, it can
   // become visible to another thread before the effects of
@@ -1067,6 +1106,14 @@ void* PartitionRoot<thread_safe>::ReallocWithFlags(int flags,
 
 template <bool thread_safe>
 void PartitionRoot<thread_safe>::PurgeMemory(int flags) {
+#if defined(PA_HAS_PER_CPU_CACHE)
+  // Per-CPU caches are purged without the lock, as they take it. Only the
+  // idle ones are emptied, the others are likely to be used again soon.
+  if (per_cpu_caches && (flags & PurgeFlags::kDecommitEmptySlotSpans)) {
+    for (uint32_t cpu = 0; cpu < per_cpu_cache_count; cpu++)
+      per_cpu_caches[cpu].PurgeIfIdle();
+  }
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
   {
     ::partition_alloc::internal::ScopedGuard guard{lock_};
     // Avoid purging if there is PCScan task currently scheduled. Since pcscan
@@ -1083,7 +1130,9 @@ void PartitionRoot<thread_safe>::PurgeMemory(int flags) {
         if (bucket.slot_size == internal::kInvalidBucketSize)
           continue;
 
-        if (bucket.slot_size >= internal::SystemPageSize())
+        // Discarding the unused system pages of slot spans would split huge
+        // pages into small ones, for little gain.
+        if (bucket.slot_size >= internal::SystemPageSize() && !use_huge_pages)
           internal::PartitionPurgeBucket(&bucket);
         else
           bucket.SortSlotSpanFreelists();
@@ -1211,6 +1260,16 @@ void PartitionRoot<thread_safe>::DumpStats(const char* partition_name,
       ThreadCacheRegistry::Instance().DumpStats(false,
                                                 &stats.all_thread_caches_stats);
     }
+#if defined(PA_HAS_PER_CPU_CACHE)
+    // Per-CPU caches are reported as thread caches, without a current one.
+    // Their locks are not taken, so the values are approximate.
+    if (per_cpu_caches) {
+      stats.has_thread_cache = true;
+      for (uint32_t cpu = 0; cpu < per_cpu_cache_count; cpu++) {
+        per_cpu_caches[cpu].AccumulateStats(&stats.all_thread_caches_stats);
+      }
+    }
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
   }
 
   // Do not hold the lock when calling |dumper|, as it may allocate.
@@ -58,6 +58,7 @@
 #include "base/allocator/partition_allocator/partition_page.h"
 #include "base/allocator/partition_allocator/partition_ref_count.h"
 #include "base/allocator/partition_allocator/partition_tag.h"
+#include "base/allocator/partition_allocator/per_cpu_cache.h"
 #include "base/allocator/partition_allocator/reservation_offset_table.h"
 #include "base/allocator/partition_allocator/starscan/pcscan.h"
 #include "base/allocator/partition_allocator/starscan/state_bitmap.h"
@@ -151,6 +152,10 @@ struct PartitionOptions {
   enum class ThreadCache : uint8_t {
     kDisabled,
     kEnabled,
+    // Uses caches shared by the threads running on each CPU instead of
+    // per-thread ones, see PerCpuCache. Any number of partitions can use them.
+    // Falls back to no cache where restartable sequences are not available.
+    kPerCpu,
   };
 
   enum class Quarantine : uint8_t {
@@ -173,19 +178,31 @@ struct PartitionOptions {
     kIfAvailable,
   };
 
+  // Whether to back the super pages of normal buckets with transparent huge
+  // pages where supported, to reduce TLB misses in allocation-heavy processes.
+  // This makes a whole super page accessible at once, at the cost of its guard
+  // pages, and makes memory be faulted in 2 MiB at a time. Unused system pages
+  // are not discarded, so as not to split the huge pages.
+  enum class HugePages : uint8_t {
+    kDisabled,
+    kEnabled,
+  };
+
   // Constructor to suppress aggregate initialization.
   constexpr PartitionOptions(AlignedAlloc aligned_alloc,
                              ThreadCache thread_cache,
                              Quarantine quarantine,
                              Cookie cookie,
                              BackupRefPtr backup_ref_ptr,
-                             UseConfigurablePool use_configurable_pool)
+                             UseConfigurablePool use_configurable_pool,
+                             HugePages huge_pages = HugePages::kDisabled)
       : aligned_alloc(aligned_alloc),
         thread_cache(thread_cache),
         quarantine(quarantine),
         cookie(cookie),
         backup_ref_ptr(backup_ref_ptr),
-        use_configurable_pool(use_configurable_pool) {}
+        use_configurable_pool(use_configurable_pool),
+        huge_pages(huge_pages) {}
 
   AlignedAlloc aligned_alloc;
   ThreadCache thread_cache;
@@ -193,6 +210,7 @@ struct PartitionOptions {
   Cookie cookie;
   BackupRefPtr backup_ref_ptr;
   UseConfigurablePool use_configurable_pool;
+  HugePages huge_pages;
 };
 
 // Never instantiate a PartitionRoot directly, instead use
@@ -255,6 +273,13 @@ struct ALIGNAS(64) BASE_EXPORT PartitionRoot {
 #endif
       bool use_configurable_pool;
 
+#if defined(PA_HAS_PER_CPU_CACHE)
+      // One cache per possible CPU, or nullptr if the partition doesn't use
+      // them.
+      PerCpuCache* per_cpu_caches = nullptr;
+      uint32_t per_cpu_cache_count = 0;
+#endif
+
 #if defined(PA_EXTRAS_REQUIRED)
       uint32_t extras_size;
       uint32_t extras_offset;
@@ -278,6 +303,10 @@ struct ALIGNAS(64) BASE_EXPORT PartitionRoot {
   // All fields below this comment are not accessed on the fast path.
   bool initialized = false;
 
+  // Whether normal bucket super pages are backed by transparent huge pages.
+  // See PartitionOptions::HugePages.
+  bool use_huge_pages = false;
+
   // Bookkeeping.
   // - total_size_of_super_pages - total virtual address space for normal bucket
   //     super pages
@@ -398,6 +427,15 @@ struct ALIGNAS(64) BASE_EXPORT PartitionRoot {
       EXCLUSIVE_LOCKS_REQUIRED(lock_);
   ALWAYS_INLINE void IncreaseCommittedPages(size_t len);
   ALWAYS_INLINE void DecreaseCommittedPages(size_t len);
+
+  // Returns how the accessibility of the data pages of normal buckets must be
+  // updated when they are recommitted. They stay accessible when backed by
+  // huge pages, see PartitionOptions::HugePages.
+  PageAccessibilityDisposition GetDataRecommitDisposition() const {
+    return use_huge_pages ? PageAccessibilityDisposition::kAllowKeepForPerf
+                          : PageAccessibilityDisposition::kRequireUpdate;
+  }
+
   ALWAYS_INLINE void DecommitSystemPagesForData(
       uintptr_t address,
       size_t length,
@@ -550,6 +588,16 @@ struct ALIGNAS(64) BASE_EXPORT PartitionRoot {
   ThreadCache* thread_cache_for_testing() const {
     return with_thread_cache ? ThreadCache::Get() : nullptr;
   }
+#if defined(PA_HAS_PER_CPU_CACHE)
+  // Returns the cache of the CPU the calling thread runs on. Must only be
+  // called if |per_cpu_caches| is set.
+  ALWAYS_INLINE PerCpuCache* GetPerCpuCache() const {
+    uint32_t cpu = internal::GetCurrentCpu();
+    if (UNLIKELY(cpu >= per_cpu_cache_count))
+      cpu %= per_cpu_cache_count;
+    return &per_cpu_caches[cpu];
+  }
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
   size_t get_total_size_of_committed_pages() const {
     return total_size_of_committed_pages.load(std::memory_order_relaxed);
   }
@@ -828,6 +876,7 @@ struct ALIGNAS(64) BASE_EXPORT PartitionRoot {
 #endif  // defined(PA_USE_PARTITION_ROOT_ENUMERATOR)
 
   friend class ThreadCache;
+  friend class PerCpuCache;
 };
 
 namespace internal {
@@ -1375,6 +1424,14 @@ ALWAYS_INLINE void PartitionRoot<thread_safe>::RawFreeWithThreadCache(
       return;
     }
   }
+#if defined(PA_HAS_PER_CPU_CACHE)
+  // Exclusive with the thread cache.
+  if (per_cpu_caches && !IsDirectMappedBucket(slot_span->bucket)) {
+    size_t bucket_index = slot_span->bucket - this->buckets;
+    if (LIKELY(GetPerCpuCache()->MaybePutInCache(slot_start, bucket_index)))
+      return;
+  }
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
 
   RawFree(slot_start, slot_span);
 }
@@ -1731,6 +1788,19 @@ ALWAYS_INLINE void* PartitionRoot<thread_safe>::AllocWithFlagsNoHooks(
           RawAlloc(buckets + bucket_index, flags, raw_size, slot_span_alignment,
                    &usable_size, &is_already_zeroed);
     }
+#if defined(PA_HAS_PER_CPU_CACHE)
+  } else if (per_cpu_caches &&
+             slot_span_alignment <= internal::PartitionPageSize()) {
+    slot_start = GetPerCpuCache()->GetFromCache(bucket_index, &slot_size);
+    if (LIKELY(slot_start)) {
+      // Same as for the thread cache above.
+      usable_size = AdjustSizeForExtrasSubtract(slot_size);
+    } else {
+      slot_start =
+          RawAlloc(buckets + bucket_index, flags, raw_size, slot_span_alignment,
+                   &usable_size, &is_already_zeroed);
+    }
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
   } else {
     slot_start =
         RawAlloc(buckets + bucket_index, flags, raw_size, slot_span_alignment,
@@ -0,0 +1,278 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/partition_allocator/per_cpu_cache.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "base/allocator/partition_allocator/oom.h"
+#include "base/allocator/partition_allocator/page_allocator.h"
+#include "base/allocator/partition_allocator/page_allocator_constants.h"
+#include "base/allocator/partition_allocator/partition_alloc_base/bits.h"
+#include "base/allocator/partition_allocator/partition_alloc_base/cxx17_backports.h"
+#include "base/allocator/partition_allocator/partition_alloc_base/posix/eintr_wrapper.h"
+#include "base/allocator/partition_allocator/partition_alloc_check.h"
+#include "base/allocator/partition_allocator/partition_alloc_constants.h"
+#include "base/allocator/partition_allocator/partition_root.h"
+
+namespace partition_alloc {
+
+namespace internal {
+
+BASE_EXPORT thread_local RseqArea g_rseq_area = {
+    {0}, {kRseqCpuIdUninitialized}, 0, 0};
+
+namespace {
+
+// Arbitrary, must be the same for all registrations of a thread. This is the
+// value used by glibc, which makes it easier to recognize.
+constexpr uint32_t kRseqSignature = 0x53053053;
+
+bool RegisterRseq() {
+#if defined(__NR_rseq)
+  return !syscall(__NR_rseq, &g_rseq_area, sizeof(g_rseq_area), 0,
+                  kRseqSignature);
+#else
+  return false;
+#endif
+}
+
+// Returns the number of possible CPUs, that is the largest CPU number the
+// kernel can report, plus one. Reads sysfs directly, as sysconf() allocates,
+// which is not possible from within the allocator.
+uint32_t GetPossibleCpuCount() {
+  int fd = PA_HANDLE_EINTR(
+      open("/sys/devices/system/cpu/possible", O_RDONLY | O_CLOEXEC));
+  if (fd < 0)
+    return 1;
+  // E.g. "0-127\n", or "0\n".
+  char buffer[64];
+  ssize_t length = PA_HANDLE_EINTR(read(fd, buffer, sizeof(buffer) - 1));
+  close(fd);
+  if (length <= 0)
+    return 1;
+
+  uint32_t last_cpu = 0;
+  for (ssize_t i = 0; i < length; i++) {
+    char c = buffer[i];
+    if (c >= '0' && c <= '9')
+      last_cpu = last_cpu * 10 + (c - '0');
+    else if (c == '-' || c == ',')
+      last_cpu = 0;
+    else
+      break;
+  }
+  // Not worth caching more than that, CPU numbers are then wrapped around.
+  constexpr uint32_t kMaxCpuCount = 1024;
+  return std::min(last_cpu + 1, kMaxCpuCount);
+}
+
+}  // namespace
+
+uint32_t GetCurrentCpuSlow() {
+  if (g_rseq_area.cpu_id.load(std::memory_order_relaxed) ==
+      kRseqCpuIdUninitialized) {
+    if (RegisterRseq())
+      return g_rseq_area.cpu_id.load(std::memory_order_relaxed);
+    g_rseq_area.cpu_id.store(kRseqCpuIdRegistrationFailed,
+                             std::memory_order_relaxed);
+  }
+
+  // C libraries which register their own area, such as glibc >= 2.35, also
+  // use it to implement sched_getcpu(). Otherwise this is served by the vDSO.
+  int cpu = sched_getcpu();
+  return cpu < 0 ? 0 : static_cast<uint32_t>(cpu);
+}
+
+}  // namespace internal
+
+namespace {
+
+size_t CachesSize(uint32_t count) {
+  return internal::base::bits::AlignUp(count * sizeof(PerCpuCache),
+                                       internal::PageAllocationGranularity());
+}
+
+}  // namespace
+
+// static
+PerCpuCache* PerCpuCache::CreateAll(PartitionRoot<>* root, uint32_t* count) {
+  PA_CHECK(root);
+  PA_CHECK(root->buckets[kBucketCount - 1].slot_size ==
+           ThreadCacheLimits::kLargeSizeThreshold);
+
+  *count = internal::GetPossibleCpuCount();
+  size_t size = CachesSize(*count);
+  uintptr_t buffer =
+      AllocPages(size, internal::PageAllocationGranularity(),
+                 PageAccessibilityConfiguration::kReadWrite,
+                 PageTag::kPartitionAlloc);
+  if (!buffer)
+    OOM_CRASH(size);
+
+  auto* caches = reinterpret_cast<PerCpuCache*>(buffer);
+  for (uint32_t cpu = 0; cpu < *count; cpu++)
+    new (&caches[cpu]) PerCpuCache(root);
+  return caches;
+}
+
+// static
+void PerCpuCache::DestroyAll(PerCpuCache* caches, uint32_t count) {
+  for (uint32_t cpu = 0; cpu < count; cpu++)
+    caches[cpu].~PerCpuCache();
+  FreePages(reinterpret_cast<uintptr_t>(caches), CachesSize(count));
+}
+
+PerCpuCache::PerCpuCache(PartitionRoot<>* root) : root_(root) {
+  for (int index = 0; index < kBucketCount; index++) {
+    const auto& root_bucket = root->buckets[index];
+    Bucket& bucket = buckets_[index];
+    bucket.slot_size = root_bucket.slot_size;
+    // Invalid bucket.
+    if (!root_bucket.is_valid())
+      continue;
+
+    // Caches a bounded amount of memory per bucket, so that small objects,
+    // which are the most frequent and performance-sensitive ones, get deeper
+    // caches.
+    bucket.limit = static_cast<uint16_t>(internal::base::clamp(
+        kMaxCachedBytesPerBucket / root_bucket.slot_size,
+        size_t{kMinBucketLimit}, size_t{kMaxBucketLimit}));
+  }
+}
+
+PerCpuCache::~PerCpuCache() {
+  Purge();
+}
+
+void PerCpuCache::FillBucket(Bucket& bucket, size_t bucket_index) {
+  // See ThreadCache::FillBucket() for the rationale behind batching.
+  PA_INCREMENT_COUNTER(stats_.batch_fill_count);
+
+  int count = std::max(1, bucket.limit / kBatchFillRatio);
+
+  size_t usable_size;
+  bool is_already_zeroed;
+
+  PA_DCHECK(!root_->buckets[bucket_index].CanStoreRawSize());
+  PA_DCHECK(!root_->buckets[bucket_index].is_direct_mapped());
+
+  size_t allocated_slots = 0;
+  internal::ScopedGuard guard(root_->lock_);
+  for (int i = 0; i < count; i++) {
+    // Cache fill should not trigger expensive operations, so as not to hold
+    // the two locks for a long time.
+    uintptr_t slot_start = root_->AllocFromBucket(
+        &root_->buckets[bucket_index],
+        AllocFlags::kFastPathOrReturnNull | AllocFlags::kReturnNull,
+        root_->buckets[bucket_index].slot_size /* raw_size */,
+        internal::PartitionPageSize(), &usable_size, &is_already_zeroed);
+    if (!slot_start)
+      break;
+
+    allocated_slots++;
+    PutInBucket(bucket, slot_start);
+  }
+
+  cached_memory_ += allocated_slots * bucket.slot_size;
+}
+
+void PerCpuCache::ClearBucket(Bucket& bucket, size_t limit) {
+  if (!bucket.count || bucket.count <= limit)
+    return;
+
+  // Check the freelist before grabbing the partition lock, see
+  // ThreadCache::ClearBucketHelper().
+  bucket.freelist_head->CheckFreeListForThreadCache(bucket.slot_size);
+
+  // Free the *end* of the list, not the head, since the head contains the
+  // most recently touched memory.
+  internal::PartitionFreelistEntry* to_free;
+  if (limit == 0) {
+    to_free = bucket.freelist_head;
+    bucket.freelist_head = nullptr;
+  } else {
+    auto* head = bucket.freelist_head;
+    for (size_t items = 1; items < limit; items++)
+      head = head->GetNextForThreadCache<true>(bucket.slot_size);
+    to_free = head->GetNextForThreadCache<true>(bucket.slot_size);
+    head->SetNext(nullptr);
+  }
+
+  {
+    internal::ScopedGuard guard(root_->lock_);
+    while (to_free) {
+      uintptr_t slot_start = reinterpret_cast<uintptr_t>(to_free);
+      to_free = to_free->GetNextForThreadCache<true>(bucket.slot_size);
+      root_->RawFreeLocked(slot_start);
+    }
+  }
+
+  size_t freed_memory = (bucket.count - limit) * bucket.slot_size;
+  PA_DCHECK(cached_memory_ >= freed_memory);
+  cached_memory_ -= freed_memory;
+  bucket.count = limit;
+}
+
+void PerCpuCache::Purge() {
+  internal::ScopedGuard guard(lock_);
+  PurgeInternal();
+}
+
+void PerCpuCache::PurgeIfIdle() {
+  internal::ScopedGuard guard(lock_);
+  if (!used_)
+    PurgeInternal();
+  used_ = false;
+}
+
+void PerCpuCache::PurgeInternal() {
+  for (auto& bucket : buckets_)
+    ClearBucket(bucket, 0);
+  PA_DCHECK(cached_memory_ == 0);
+}
+
+size_t PerCpuCache::CachedMemory() const {
+  size_t total = 0;
+  for (const Bucket& bucket : buckets_)
+    total += bucket.count * static_cast<size_t>(bucket.slot_size);
+  return total;
+}
+
+void PerCpuCache::AccumulateStats(ThreadCacheStats* stats) const {
+  stats->alloc_count += stats_.alloc_count;
+  stats->alloc_hits += stats_.alloc_hits;
+  stats->alloc_misses += stats_.alloc_misses;
+
+  stats->alloc_miss_empty += stats_.alloc_miss_empty;
+  stats->alloc_miss_too_large += stats_.alloc_miss_too_large;
+
+  stats->cache_fill_count += stats_.cache_fill_count;
+  stats->cache_fill_hits += stats_.cache_fill_hits;
+  stats->cache_fill_misses += stats_.cache_fill_misses;
+
+  stats->batch_fill_count += stats_.batch_fill_count;
+
+  stats->bucket_total_memory += cached_memory_;
+  stats->metadata_overhead += sizeof(*this);
+}
+
+void PerCpuCache::AcquireLockBeforeFork() {
+  lock_.Acquire();
+}
+
+void PerCpuCache::ReleaseLockAfterFork(bool in_child) {
+  if (in_child)
+    lock_.Reinit();
+  else
+    lock_.Release();
+}
+
+}  // namespace partition_alloc
@@ -0,0 +1,244 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ALLOCATOR_PARTITION_ALLOCATOR_PER_CPU_CACHE_H_
+#define BASE_ALLOCATOR_PARTITION_ALLOCATOR_PER_CPU_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "base/allocator/partition_allocator/partition_alloc_base/gtest_prod_util.h"
+#include "base/allocator/partition_allocator/partition_alloc_config.h"
+#include "base/allocator/partition_allocator/partition_alloc_forward.h"
+#include "base/allocator/partition_allocator/partition_bucket_lookup.h"
+#include "base/allocator/partition_allocator/partition_freelist_entry.h"
+#include "base/allocator/partition_allocator/partition_lock.h"
+#include "base/allocator/partition_allocator/partition_stats.h"
+#include "base/allocator/partition_allocator/thread_cache.h"
+#include "base/base_export.h"
+#include "base/compiler_specific.h"
+#include "base/thread_annotations.h"
+
+#if defined(PA_HAS_PER_CPU_CACHE)
+
+namespace partition_alloc {
+
+namespace internal {
+
+// Registration area of a restartable sequence, with the same layout as
+// |struct rseq| from <linux/rseq.h>, which not all sysroots have. Once the
+// area is registered, the kernel keeps |cpu_id| up to date for the thread,
+// making the current CPU available with a single load.
+struct alignas(32) RseqArea {
+  std::atomic<uint32_t> cpu_id_start;
+  std::atomic<uint32_t> cpu_id;
+  uint64_t rseq_cs;
+  uint32_t flags;
+};
+
+// Values of |RseqArea::cpu_id| before registration, and after it failed.
+constexpr uint32_t kRseqCpuIdUninitialized = static_cast<uint32_t>(-1);
+constexpr uint32_t kRseqCpuIdRegistrationFailed = static_cast<uint32_t>(-2);
+
+extern BASE_EXPORT thread_local RseqArea g_rseq_area;
+
+// Registers |g_rseq_area| for the calling thread on first use, and falls back
+// to sched_getcpu() if that is not possible, e.g. because the C library
+// already registered its own area.
+BASE_EXPORT uint32_t GetCurrentCpuSlow();
+
+// Returns the CPU the calling thread runs on. The thread can be migrated at
+// any time, so the result may already be stale when it is used.
+ALWAYS_INLINE uint32_t GetCurrentCpu() {
+  uint32_t cpu = g_rseq_area.cpu_id.load(std::memory_order_relaxed);
+  // Both special values are negative when seen as signed integers.
+  if (LIKELY(static_cast<int32_t>(cpu) >= 0))
+    return cpu;
+  return GetCurrentCpuSlow();
+}
+
+}  // namespace internal
+
+// Cache of free slots shared by the threads running on a CPU. This is an
+// alternative to ThreadCache for processes with many more threads than cores,
+// see PartitionOptions::ThreadCache::kPerCpu: the memory held in caches scales
+// with the number of CPUs instead of the number of threads, and slots freed by
+// one thread can be reused by another one running on the same CPU without
+// going through the central allocator.
+//
+// Each cache has its own lock. As threads pick the cache of the CPU they are
+// running on, it is only contended when a thread is preempted or migrated
+// while holding it, and its cache line stays with the core. Cache fill and
+// clearing take the partition lock while holding this one, so the partition
+// lock must never be held when calling into a PerCpuCache.
+class ALIGNAS(64) BASE_EXPORT PerCpuCache {
+ public:
+  // Allocates the caches of |root|, one per possible CPU, and sets |count| to
+  // their number. Does not allocate from |root|, so can be called with its
+  // lock held.
+  static PerCpuCache* CreateAll(PartitionRoot<>* root, uint32_t* count);
+  // Purges the caches returned by CreateAll() and releases their memory.
+  static void DestroyAll(PerCpuCache* caches, uint32_t count);
+
+  // Force placement new.
+  void* operator new(size_t) = delete;
+  void* operator new(size_t, void* buffer) { return buffer; }
+  void operator delete(void* ptr) = delete;
+  PerCpuCache(const PerCpuCache&) = delete;
+  PerCpuCache& operator=(const PerCpuCache&) = delete;
+
+  // Same as ThreadCache::MaybePutInCache().
+  ALWAYS_INLINE bool MaybePutInCache(uintptr_t slot_start, size_t bucket_index);
+  // Same as ThreadCache::GetFromCache().
+  ALWAYS_INLINE uintptr_t GetFromCache(size_t bucket_index, size_t* slot_size);
+
+  // Empties the cache.
+  void Purge();
+  // Empties the cache if it was not used since the last call.
+  void PurgeIfIdle();
+
+  // Amount of cached memory, in bytes.
+  size_t CachedMemory() const;
+  // Can be called without the lock, the result is then approximate.
+  void AccumulateStats(ThreadCacheStats* stats) const;
+
+  // Used by the fork() handlers, which must hold all the locks of the
+  // allocator while fork() happens.
+  void AcquireLockBeforeFork() EXCLUSIVE_LOCK_FUNCTION(lock_);
+  void ReleaseLockAfterFork(bool in_child) UNLOCK_FUNCTION(lock_);
+
+  size_t bucket_count_for_testing(size_t index) const {
+    return buckets_[index].count;
+  }
+
+  // The maximum amount of memory cached per bucket. Caches are shared by all
+  // the threads of a CPU, so they are larger than thread caches.
+  static constexpr size_t kMaxCachedBytesPerBucket = 64 * 1024;
+  // Bounds on the number of slots cached per bucket.
+  static constexpr uint16_t kMinBucketLimit = 2;
+  static constexpr uint16_t kMaxBucketLimit = 256;
+  // Fill 1 / kBatchFillRatio * bucket.limit slots at a time.
+  static constexpr uint16_t kBatchFillRatio = 8;
+
+ private:
+  struct Bucket {
+    internal::PartitionFreelistEntry* freelist_head = nullptr;
+    uint16_t count = 0;
+    // 0 for the buckets which are not cached.
+    uint16_t limit = 0;
+    uint32_t slot_size = 0;
+  };
+  static_assert(sizeof(Bucket) <= 2 * sizeof(void*), "Keep Bucket small.");
+
+  // Same as in ThreadCache, allocations larger than that are not cached.
+  static constexpr uint16_t kBucketCount =
+      internal::BucketIndexLookup::GetIndex(
+          ThreadCacheLimits::kLargeSizeThreshold) +
+      1;
+
+  explicit PerCpuCache(PartitionRoot<>* root);
+  ~PerCpuCache();
+
+  void FillBucket(Bucket& bucket, size_t bucket_index)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Empties the |bucket| until there are at most |limit| objects in it.
+  void ClearBucket(Bucket& bucket, size_t limit)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  ALWAYS_INLINE void PutInBucket(Bucket& bucket, uintptr_t slot_start)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void PurgeInternal() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  internal::Lock lock_;
+  // Whether the cache was used since the last call to PurgeIfIdle().
+  bool used_ GUARDED_BY(lock_) = false;
+  size_t cached_memory_ = 0;
+  ThreadCacheStats stats_ = {};
+
+  Bucket buckets_[kBucketCount];
+
+  PartitionRoot<>* const root_;
+
+  PA_FRIEND_TEST_ALL_PREFIXES(PartitionAllocPerCpuCacheTest, Limits);
+};
+
+ALWAYS_INLINE bool PerCpuCache::MaybePutInCache(uintptr_t slot_start,
+                                                size_t bucket_index) {
+  internal::ScopedGuard guard(lock_);
+  PA_INCREMENT_COUNTER(stats_.cache_fill_count);
+
+  if (UNLIKELY(bucket_index >= kBucketCount || !buckets_[bucket_index].limit)) {
+    PA_INCREMENT_COUNTER(stats_.cache_fill_misses);
+    return false;
+  }
+
+  auto& bucket = buckets_[bucket_index];
+  PutInBucket(bucket, slot_start);
+  cached_memory_ += bucket.slot_size;
+  used_ = true;
+  PA_INCREMENT_COUNTER(stats_.cache_fill_hits);
+
+  // Batched deallocation, amortizing lock acquisitions.
+  if (UNLIKELY(bucket.count > bucket.limit))
+    ClearBucket(bucket, bucket.limit / 2);
+
+  return true;
+}
+
+ALWAYS_INLINE uintptr_t PerCpuCache::GetFromCache(size_t bucket_index,
+                                                  size_t* slot_size) {
+  internal::ScopedGuard guard(lock_);
+  PA_INCREMENT_COUNTER(stats_.alloc_count);
+
+  if (UNLIKELY(bucket_index >= kBucketCount || !buckets_[bucket_index].limit)) {
+    PA_INCREMENT_COUNTER(stats_.alloc_miss_too_large);
+    PA_INCREMENT_COUNTER(stats_.alloc_misses);
+    return 0;
+  }
+
+  auto& bucket = buckets_[bucket_index];
+  used_ = true;
+  if (LIKELY(bucket.freelist_head)) {
+    PA_INCREMENT_COUNTER(stats_.alloc_hits);
+  } else {
+    PA_DCHECK(bucket.count == 0);
+    PA_INCREMENT_COUNTER(stats_.alloc_miss_empty);
+    PA_INCREMENT_COUNTER(stats_.alloc_misses);
+
+    FillBucket(bucket, bucket_index);
+
+    // The central allocator is out of memory, or would need a slow path
+    // allocation. Let it deal with it.
+    if (UNLIKELY(!bucket.freelist_head))
+      return 0;
+  }
+
+  PA_DCHECK(bucket.count != 0);
+  internal::PartitionFreelistEntry* result = bucket.freelist_head;
+  internal::PartitionFreelistEntry* next =
+      result->GetNextForThreadCache<true>(bucket.slot_size);
+  PA_DCHECK(result != next);
+  bucket.count--;
+  PA_DCHECK(bucket.count != 0 || !next);
+  bucket.freelist_head = next;
+  *slot_size = bucket.slot_size;
+
+  PA_DCHECK(cached_memory_ >= bucket.slot_size);
+  cached_memory_ -= bucket.slot_size;
+  return reinterpret_cast<uintptr_t>(result);
+}
+
+ALWAYS_INLINE void PerCpuCache::PutInBucket(Bucket& bucket,
+                                            uintptr_t slot_start) {
+  auto* entry = internal::PartitionFreelistEntry::EmplaceAndInitForThreadCache(
+      slot_start, bucket.freelist_head);
+  bucket.freelist_head = entry;
+  bucket.count++;
+}
+
+}  // namespace partition_alloc
+
+#endif  // defined(PA_HAS_PER_CPU_CACHE)
+
+#endif  // BASE_ALLOCATOR_PARTITION_ALLOCATOR_PER_CPU_CACHE_H_
@@ -0,0 +1,213 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/partition_allocator/per_cpu_cache.h"
+
+#include <sched.h>
+
+#include <iterator>
+
+#include "base/allocator/partition_allocator/partition_address_space.h"
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/allocator/partition_allocator/partition_alloc_check.h"
+#include "base/allocator/partition_allocator/partition_alloc_config.h"
+#include "base/allocator/partition_allocator/partition_root.h"
+#include "base/allocator/partition_allocator/partition_stats.h"
+#include "base/callback.h"
+#include "base/test/bind.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// With *SAN, PartitionAlloc is replaced in partition_alloc.h by ASAN, so we
+// cannot test the caches.
+#if !defined(MEMORY_TOOL_REPLACES_ALLOCATOR) && \
+    defined(PA_HAS_PER_CPU_CACHE)
+
+namespace partition_alloc {
+
+namespace {
+
+constexpr size_t kSmallSize = 12;
+
+// Pins the calling thread to |cpu|, so that it keeps using the same cache.
+class ScopedPinToCpu {
+ public:
+  explicit ScopedPinToCpu(int cpu) {
+    PA_CHECK(!sched_getaffinity(0, sizeof(old_mask_), &old_mask_));
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    PA_CHECK(!sched_setaffinity(0, sizeof(mask), &mask));
+  }
+  ~ScopedPinToCpu() {
+    PA_CHECK(!sched_setaffinity(0, sizeof(old_mask_), &old_mask_));
+  }
+
+ private:
+  cpu_set_t old_mask_;
+};
+
+class LambdaThreadDelegate : public base::PlatformThread::Delegate {
+ public:
+  explicit LambdaThreadDelegate(base::RepeatingClosure f) : f_(std::move(f)) {}
+  void ThreadMain() override { f_.Run(); }
+
+ private:
+  base::RepeatingClosure f_;
+};
+
+void RunOnThread(base::RepeatingClosure f) {
+  LambdaThreadDelegate delegate(std::move(f));
+  base::PlatformThreadHandle thread_handle;
+  ASSERT_TRUE(base::PlatformThread::Create(0, &delegate, &thread_handle));
+  base::PlatformThread::Join(thread_handle);
+}
+
+}  // namespace
+
+class PartitionAllocPerCpuCacheTest : public ::testing::Test {
+ public:
+  PartitionAllocPerCpuCacheTest()
+      : root_({
+            PartitionOptions::AlignedAlloc::kDisallowed,
+            PartitionOptions::ThreadCache::kPerCpu,
+            PartitionOptions::Quarantine::kDisallowed,
+            PartitionOptions::Cookie::kDisallowed,
+            PartitionOptions::BackupRefPtr::kDisabled,
+            PartitionOptions::UseConfigurablePool::kNo,
+        }) {}
+  ~PartitionAllocPerCpuCacheTest() override { root_.DestructForTesting(); }
+
+ protected:
+  void SetUp() override {
+#if defined(PA_HAS_64_BITS_POINTERS)
+    // Another test can uninitialize the pools, so make sure they are
+    // initialized.
+    internal::PartitionAddressSpace::Init();
+#endif  // defined(PA_HAS_64_BITS_POINTERS)
+    ASSERT_TRUE(root_.per_cpu_caches);
+  }
+
+  size_t TotalCachedMemory() const {
+    size_t total = 0;
+    for (uint32_t cpu = 0; cpu < root_.per_cpu_cache_count; cpu++)
+      total += root_.per_cpu_caches[cpu].CachedMemory();
+    return total;
+  }
+
+  ThreadSafePartitionRoot root_;
+};
+
+TEST_F(PartitionAllocPerCpuCacheTest, CurrentCpu) {
+  ScopedPinToCpu pin(sched_getcpu());
+  uint32_t cpu = internal::GetCurrentCpu();
+  EXPECT_EQ(static_cast<uint32_t>(sched_getcpu()), cpu);
+  EXPECT_LT(cpu, root_.per_cpu_cache_count);
+  // Either the area is registered, or the fallback is used from now on.
+  EXPECT_NE(internal::kRseqCpuIdUninitialized,
+            internal::g_rseq_area.cpu_id.load(std::memory_order_relaxed));
+}
+
+TEST_F(PartitionAllocPerCpuCacheTest, Simple) {
+  ScopedPinToCpu pin(sched_getcpu());
+  size_t bucket_index =
+      ThreadSafePartitionRoot::SizeToBucketIndex(kSmallSize, false);
+  PerCpuCache* cache = root_.GetPerCpuCache();
+
+  void* ptr = root_.AllocWithFlags(0, kSmallSize, "");
+  ASSERT_TRUE(ptr);
+  // The batch fill left the remaining slots in the cache.
+  size_t count = cache->bucket_count_for_testing(bucket_index);
+  EXPECT_GT(count, 0u);
+
+  root_.Free(ptr);
+  EXPECT_EQ(count + 1, cache->bucket_count_for_testing(bucket_index));
+
+  void* ptr2 = root_.AllocWithFlags(0, kSmallSize, "");
+  EXPECT_EQ(ptr, ptr2);
+  EXPECT_EQ(count, cache->bucket_count_for_testing(bucket_index));
+  root_.Free(ptr2);
+}
+
+TEST_F(PartitionAllocPerCpuCacheTest, Limits) {
+  const PerCpuCache& cache = root_.per_cpu_caches[0];
+  size_t small_index =
+      ThreadSafePartitionRoot::SizeToBucketIndex(kSmallSize, false);
+  EXPECT_EQ(PerCpuCache::kMaxBucketLimit, cache.buckets_[small_index].limit);
+
+  size_t largest_index = ThreadSafePartitionRoot::SizeToBucketIndex(
+      ThreadCacheLimits::kLargeSizeThreshold, false);
+  EXPECT_EQ(PerCpuCache::kMinBucketLimit, cache.buckets_[largest_index].limit);
+  EXPECT_EQ(largest_index + 1, std::size(cache.buckets_));
+}
+
+TEST_F(PartitionAllocPerCpuCacheTest, LargeAllocationsAreNotCached) {
+  ScopedPinToCpu pin(sched_getcpu());
+  void* ptr = root_.AllocWithFlags(0, 100 * 1024, "");
+  ASSERT_TRUE(ptr);
+  root_.Free(ptr);
+  EXPECT_EQ(0u, root_.GetPerCpuCache()->CachedMemory());
+}
+
+// A slot freed by a thread can be allocated by another one running on the
+// same CPU.
+TEST_F(PartitionAllocPerCpuCacheTest, CrossThreadFree) {
+  const int cpu = sched_getcpu();
+  ScopedPinToCpu pin(cpu);
+  void* ptr = nullptr;
+  RunOnThread(base::BindLambdaForTesting([&]() {
+    ScopedPinToCpu thread_pin(cpu);
+    ptr = root_.AllocWithFlags(0, kSmallSize, "");
+  }));
+  ASSERT_TRUE(ptr);
+  root_.Free(ptr);
+
+  void* ptr2 = nullptr;
+  RunOnThread(base::BindLambdaForTesting([&]() {
+    ScopedPinToCpu thread_pin(cpu);
+    ptr2 = root_.AllocWithFlags(0, kSmallSize, "");
+  }));
+  EXPECT_EQ(ptr, ptr2);
+  root_.Free(ptr2);
+}
+
+TEST_F(PartitionAllocPerCpuCacheTest, PurgeIdleCaches) {
+  {
+    ScopedPinToCpu pin(sched_getcpu());
+    void* ptr = root_.AllocWithFlags(0, kSmallSize, "");
+    root_.Free(ptr);
+  }
+  EXPECT_GT(TotalCachedMemory(), 0u);
+
+  // The first purge only notices that the cache was used.
+  root_.PurgeMemory(PurgeFlags::kDecommitEmptySlotSpans);
+  EXPECT_GT(TotalCachedMemory(), 0u);
+  root_.PurgeMemory(PurgeFlags::kDecommitEmptySlotSpans);
+  EXPECT_EQ(0u, TotalCachedMemory());
+}
+
+TEST_F(PartitionAllocPerCpuCacheTest, Stats) {
+  {
+    ScopedPinToCpu pin(sched_getcpu());
+    void* ptr = root_.AllocWithFlags(0, kSmallSize, "");
+    root_.Free(ptr);
+  }
+
+  ThreadCacheStats stats = {};
+  for (uint32_t cpu = 0; cpu < root_.per_cpu_cache_count; cpu++)
+    root_.per_cpu_caches[cpu].AccumulateStats(&stats);
+  EXPECT_EQ(TotalCachedMemory(), stats.bucket_total_memory);
+  EXPECT_EQ(root_.per_cpu_cache_count * sizeof(PerCpuCache),
+            stats.metadata_overhead);
+#if defined(PA_THREAD_CACHE_ENABLE_STATISTICS)
+  EXPECT_EQ(1u, stats.alloc_count);
+  EXPECT_EQ(1u, stats.alloc_miss_empty);
+  EXPECT_EQ(1u, stats.cache_fill_hits);
+#endif  // defined(PA_THREAD_CACHE_ENABLE_STATISTICS)
+}
+
+}  // namespace partition_alloc
+
+#endif  // !defined(MEMORY_TOOL_REPLACES_ALLOCATOR) &&
+        // defined(PA_HAS_PER_CPU_CACHE)
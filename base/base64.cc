@@ -5,20 +5,288 @@
 #include "base/base64.h"
 
 #include <stddef.h>
+#include <string.h>
 
+#include <algorithm>
+
+#include "base/check_op.h"
+#include "build/build_config.h"
 #include "third_party/modp_b64/modp_b64.h"
 
+#if defined(ARCH_CPU_X86_FAMILY) && \
+    (!defined(COMPILER_MSVC) || defined(__clang__))
+#include <tmmintrin.h>
+
+#include "base/cpu.h"
+
+#define BASE64_SSSE3_SUPPORTED
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+
+#define BASE64_NEON_SUPPORTED
+#endif
+
 namespace base {
 
-std::string Base64Encode(span<const uint8_t> input) {
-  std::string output;
-  output.resize(modp_b64_encode_len(input.size()));  // makes room for null byte
+namespace {
+
+// The vectorized paths below only encode and decode whole blocks, and leave
+// the rest of the input, including the padding, to modp_b64. Their output is
+// the same as modp_b64's.
+
+#if defined(BASE64_SSSE3_SUPPORTED)
+
+// Chrome only requires SSE3, so the SSSE3 paths are chosen at runtime.
+bool HasSSSE3() {
+  static const bool has_ssse3 = CPU::GetInstanceNoAllocation().has_ssse3();
+  return has_ssse3;
+}
+
+// Encodes 12 bytes per iteration, but loads 16, as described in
+// http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html. Returns the
+// number of bytes encoded.
+__attribute__((target("ssse3"))) size_t EncodeBlocksSSSE3(const uint8_t* src,
+                                                          size_t len,
+                                                          char* dest) {
+  // Spreads the 3 bytes of each group over 4 bytes: [b1 b0 b2 b1].
+  const __m128i kSpread =
+      _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+  // Maps each 6-bit index to the offset added to it by its range: A-Z, a-z,
+  // 0-9, '+' and '/'.
+  const __m128i kOffsets =
+      _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                    '/' - 63, 'A', 0, 0);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 12, dest += 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    in = _mm_shuffle_epi8(in, kSpread);
+    // Moves the 4 6-bit indices of each group to the low bits of their byte.
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    // 0 for a-z, 1-10 for 0-9, 11 for '+', 12 for '/' and 13 for A-Z.
+    __m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    ranges = _mm_or_si128(ranges, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    const __m128i out =
+        _mm_add_epi8(indices, _mm_shuffle_epi8(kOffsets, ranges));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), out);
+  }
+  return i;
+}
+
+// Decodes 16 chars per iteration, as described in
+// http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html. Stops at the
+// first block with a char outside of the alphabet, including padding. Returns
+// the number of chars decoded.
+__attribute__((target("ssse3"))) size_t DecodeBlocksSSSE3(const char* src,
+                                                          size_t len,
+                                                          uint8_t* dest) {
+  // A char is valid if the bits found for its low and high nibbles in these
+  // tables don't intersect.
+  const __m128i kLowNibbleBits =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i kHighNibbleBits =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  // Maps the high nibble of each char to the offset which gives its 6-bit
+  // value. '/' shares its high nibble with '+', and is mapped by index 1.
+  const __m128i kOffsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0,
+                                         0, 0, 0, 0, 0, 0, 0);
+  const __m128i kNibbleMask = _mm_set1_epi8(0x0f);
+  const __m128i kPack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                      -1, -1, -1, -1);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16, dest += 12) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i high_nibbles =
+        _mm_and_si128(_mm_srli_epi32(in, 4), kNibbleMask);
+    const __m128i low_nibbles = _mm_and_si128(in, kNibbleMask);
+    const __m128i invalid =
+        _mm_and_si128(_mm_shuffle_epi8(kLowNibbleBits, low_nibbles),
+                      _mm_shuffle_epi8(kHighNibbleBits, high_nibbles));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) !=
+        0xffff) {
+      break;
+    }
+
+    const __m128i is_slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    const __m128i values = _mm_add_epi8(
+        in, _mm_shuffle_epi8(kOffsets, _mm_add_epi8(is_slash, high_nibbles)));
+    // Merges the 4 6-bit values of each group into 3 bytes, then packs the
+    // groups into the low 12 bytes in memory order.
+    const __m128i pairs =
+        _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    const __m128i out = _mm_shuffle_epi8(groups, kPack);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), out);
+    const int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+    memcpy(dest + 8, &last, sizeof(last));
+  }
+  return i;
+}
+
+#elif defined(BASE64_NEON_SUPPORTED)
+
+constexpr char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Encodes 48 bytes per iteration. Returns the number of bytes encoded.
+size_t EncodeBlocksNEON(const uint8_t* src, size_t len, char* dest) {
+  const uint8x16x4_t alphabet = {
+      vld1q_u8(reinterpret_cast<const uint8_t*>(kAlphabet)),
+      vld1q_u8(reinterpret_cast<const uint8_t*>(kAlphabet) + 16),
+      vld1q_u8(reinterpret_cast<const uint8_t*>(kAlphabet) + 32),
+      vld1q_u8(reinterpret_cast<const uint8_t*>(kAlphabet) + 48)};
+  const uint8x16_t mask = vdupq_n_u8(0x3f);
+  size_t i = 0;
+  for (; i + 48 <= len; i += 48, dest += 64) {
+    const uint8x16x3_t in = vld3q_u8(src + i);
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8(in.val[0], 2);
+    out.val[1] = vandq_u8(
+        vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+    out.val[2] = vandq_u8(
+        vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+    out.val[3] = vandq_u8(in.val[2], mask);
+    for (uint8x16_t& chars : out.val)
+      chars = vqtbl4q_u8(alphabet, chars);
+    vst4q_u8(reinterpret_cast<uint8_t*>(dest), out);
+  }
+  return i;
+}
+
+// Maps the chars below 0x80 to their 6-bit value, or 0xff if they are not in
+// the alphabet.
+struct DecodeTable {
+  constexpr DecodeTable() {
+    for (uint8_t& value : values)
+      value = 0xff;
+    for (uint8_t i = 0; i < 64; ++i)
+      values[static_cast<uint8_t>(kAlphabet[i])] = i;
+  }
+  uint8_t values[128] = {};
+};
+
+constexpr DecodeTable kDecodeTable;
+
+// Decodes 64 chars per iteration. Stops at the first block with a char
+// outside of the alphabet, including padding. Returns the number of chars
+// decoded.
+size_t DecodeBlocksNEON(const char* src, size_t len, uint8_t* dest) {
+  const uint8x16x4_t low_table = {vld1q_u8(kDecodeTable.values),
+                                  vld1q_u8(kDecodeTable.values + 16),
+                                  vld1q_u8(kDecodeTable.values + 32),
+                                  vld1q_u8(kDecodeTable.values + 48)};
+  const uint8x16x4_t high_table = {vld1q_u8(kDecodeTable.values + 64),
+                                   vld1q_u8(kDecodeTable.values + 80),
+                                   vld1q_u8(kDecodeTable.values + 96),
+                                   vld1q_u8(kDecodeTable.values + 112)};
+  const uint8x16_t offset = vdupq_n_u8(64);
+  const uint8x16_t ascii_max = vdupq_n_u8(0x7f);
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64, dest += 48) {
+    uint8x16x4_t values = vld4q_u8(reinterpret_cast<const uint8_t*>(src + i));
+    uint8x16_t invalid = vdupq_n_u8(0);
+    for (uint8x16_t& value : values.val) {
+      // Out of range indices map to 0, so chars above 0x7f are flagged
+      // separately.
+      const uint8x16_t chars = value;
+      value = vorrq_u8(vqtbl4q_u8(low_table, chars),
+                       vqtbl4q_u8(high_table, vsubq_u8(chars, offset)));
+      invalid = vorrq_u8(invalid, vorrq_u8(value, vcgtq_u8(chars, ascii_max)));
+    }
+    if (vmaxvq_u8(invalid) > 0x3f)
+      break;
+
+    uint8x16x3_t out;
+    out.val[0] =
+        vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+    out.val[1] =
+        vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+    vst3q_u8(dest, out);
+  }
+  return i;
+}
+
+#endif
+
+// Encodes the longest prefix of |src| handled by the vectorized path, if any.
+// Returns the number of bytes encoded, a multiple of 3.
+size_t EncodeBlocks(const uint8_t* src, size_t len, char* dest) {
+#if defined(BASE64_SSSE3_SUPPORTED)
+  if (HasSSSE3())
+    return EncodeBlocksSSSE3(src, len, dest);
+#elif defined(BASE64_NEON_SUPPORTED)
+  return EncodeBlocksNEON(src, len, dest);
+#endif
+  return 0;
+}
+
+// Decodes the longest valid prefix of |src| handled by the vectorized path, if
+// any. Returns the number of chars decoded, a multiple of 4.
+size_t DecodeBlocks(const char* src, size_t len, uint8_t* dest) {
+#if defined(BASE64_SSSE3_SUPPORTED)
+  if (HasSSSE3())
+    return DecodeBlocksSSSE3(src, len, dest);
+#elif defined(BASE64_NEON_SUPPORTED)
+  return DecodeBlocksNEON(src, len, dest);
+#endif
+  return 0;
+}
+
+// Writes exactly Base64EncodedLength(len) chars to |dest|.
+size_t EncodeImpl(const uint8_t* src, size_t len, char* dest) {
+  const size_t encoded = EncodeBlocks(src, len, dest);
+  char* out = dest + encoded / 3 * 4;
+  if (encoded == len)
+    return static_cast<size_t>(out - dest);
+
+  // modp_b64_encode() null-terminates its output, so the last group is encoded
+  // separately to not write past the end of |dest|.
+  const size_t last = (len - encoded - 1) % 3 + 1;
+  out += modp_b64_encode(out, reinterpret_cast<const char*>(src + encoded),
+                         len - encoded - last);
+  char buffer[modp_b64_encode_len(3)];
+  modp_b64_encode(buffer, reinterpret_cast<const char*>(src + len - last),
+                  last);
+  memcpy(out, buffer, 4);
+  return static_cast<size_t>(out + 4 - dest);
+}
+
+// Writes at most Base64DecodedMaxSize(len) bytes to |dest|. Returns
+// MODP_B64_ERROR if |src| is invalid.
+size_t DecodeImpl(const char* src, size_t len, uint8_t* dest) {
+  // The last 4 chars may be padded, so they are left to modp_b64.
+  const size_t decoded = DecodeBlocks(src, len >= 4 ? len - 4 : 0, dest);
+  const size_t size = modp_b64_decode(
+      reinterpret_cast<char*>(dest + decoded / 4 * 3), src + decoded,
+      len - decoded);
+  if (size == MODP_B64_ERROR)
+    return MODP_B64_ERROR;
+  return decoded / 4 * 3 + size;
+}
 
-  // modp_b64_encode_len() returns at least 1, so output[0] is safe to use.
-  const size_t output_size = modp_b64_encode(
-      &(output[0]), reinterpret_cast<const char*>(input.data()), input.size());
+// Like DecodeImpl(), but fails if |src| is padded.
+size_t DecodeUnpaddedImpl(const char* src, size_t len, uint8_t* dest) {
+  if (len > 0 && src[len - 1] == '=')
+    return MODP_B64_ERROR;
+  return DecodeImpl(src, len, dest);
+}
+
+}  // namespace
 
-  output.resize(output_size);
+std::string Base64Encode(span<const uint8_t> input) {
+  std::string output;
+  output.resize(Base64EncodedLength(input.size()));
+  output.resize(EncodeImpl(input.data(), input.size(), output.data()));
   return output;
 }
 
@@ -28,11 +296,11 @@ void Base64Encode(StringPiece input, std::string* output) {
 
 bool Base64Decode(StringPiece input, std::string* output) {
   std::string temp;
-  temp.resize(modp_b64_decode_len(input.size()));
+  temp.resize(Base64DecodedMaxSize(input.size()));
 
   // does not null terminate result since result is binary data!
-  size_t input_size = input.size();
-  size_t output_size = modp_b64_decode(&(temp[0]), input.data(), input_size);
+  size_t output_size = DecodeImpl(input.data(), input.size(),
+                              reinterpret_cast<uint8_t*>(temp.data()));
   if (output_size == MODP_B64_ERROR)
     return false;
 
@@ -42,11 +310,9 @@ bool Base64Decode(StringPiece input, std::string* output) {
 }
 
 absl::optional<std::vector<uint8_t>> Base64Decode(StringPiece input) {
-  std::vector<uint8_t> ret(modp_b64_decode_len(input.size()));
+  std::vector<uint8_t> ret(Base64DecodedMaxSize(input.size()));
 
-  size_t input_size = input.size();
-  size_t output_size = modp_b64_decode(reinterpret_cast<char*>(ret.data()),
-                                       input.data(), input_size);
+  size_t output_size = DecodeImpl(input.data(), input.size(), ret.data());
   if (output_size == MODP_B64_ERROR)
     return absl::nullopt;
 
@@ -54,4 +320,127 @@ absl::optional<std::vector<uint8_t>> Base64Decode(StringPiece input) {
   return ret;
 }
 
+size_t Base64EncodedLength(size_t input_size) {
+  return modp_b64_encode_strlen(input_size);
+}
+
+size_t Base64EncodeToSpan(span<const uint8_t> input, span<char> output) {
+  CHECK_GE(output.size(), Base64EncodedLength(input.size()));
+  return EncodeImpl(input.data(), input.size(), output.data());
+}
+
+size_t Base64DecodedMaxSize(size_t input_size) {
+  return input_size / 4 * 3;
+}
+
+absl::optional<size_t> Base64DecodeToSpan(StringPiece input,
+                                          span<uint8_t> output) {
+  CHECK_GE(output.size(), Base64DecodedMaxSize(input.size()));
+  const size_t output_size =
+      DecodeImpl(input.data(), input.size(), output.data());
+  if (output_size == MODP_B64_ERROR)
+    return absl::nullopt;
+  return output_size;
+}
+
+Base64StreamEncoder::Base64StreamEncoder() = default;
+
+Base64StreamEncoder::~Base64StreamEncoder() = default;
+
+size_t Base64StreamEncoder::Encode(span<const uint8_t> chunk,
+                                   span<char> output) {
+  CHECK_GE(output.size(), Base64EncodedLength(chunk.size()));
+  size_t written = 0;
+  if (num_pending_ > 0) {
+    if (num_pending_ + chunk.size() < 3) {
+      std::copy(chunk.begin(), chunk.end(), pending_ + num_pending_);
+      num_pending_ += chunk.size();
+      return 0;
+    }
+    uint8_t group[3];
+    std::copy(pending_, pending_ + num_pending_, group);
+    const size_t taken = 3 - num_pending_;
+    std::copy(chunk.begin(), chunk.begin() + taken, group + num_pending_);
+    chunk = chunk.subspan(taken);
+    written = EncodeImpl(group, 3, output.data());
+  }
+
+  const size_t whole_groups = chunk.size() / 3 * 3;
+  written += EncodeImpl(chunk.data(), whole_groups, output.data() + written);
+  num_pending_ = chunk.size() - whole_groups;
+  std::copy(chunk.begin() + whole_groups, chunk.end(), pending_);
+  return written;
+}
+
+size_t Base64StreamEncoder::Finish(span<char> output) {
+  CHECK_GE(output.size(), 4u);
+  const size_t written = EncodeImpl(pending_, num_pending_, output.data());
+  num_pending_ = 0;
+  return written;
+}
+
+// static
+size_t Base64StreamDecoder::MaxDecodedSize(size_t chunk_size) {
+  return (chunk_size + 3) / 4 * 3;
+}
+
+Base64StreamDecoder::Base64StreamDecoder() = default;
+
+Base64StreamDecoder::~Base64StreamDecoder() = default;
+
+absl::optional<size_t> Base64StreamDecoder::Decode(StringPiece chunk,
+                                                   span<uint8_t> output) {
+  CHECK_GE(output.size(), MaxDecodedSize(chunk.size()));
+  if (failed_)
+    return absl::nullopt;
+
+  // Holds back the last 1 to 4 chars, which are the end of the input if this
+  // is the last chunk.
+  const size_t total = num_pending_ + chunk.size();
+  if (total <= 4) {
+    std::copy(chunk.begin(), chunk.end(), pending_ + num_pending_);
+    num_pending_ = total;
+    return 0;
+  }
+  const size_t to_decode = (total - 1) / 4 * 4;
+
+  size_t written = 0;
+  if (num_pending_ > 0) {
+    const size_t taken = 4 - num_pending_;
+    std::copy(chunk.begin(), chunk.begin() + taken, pending_ + num_pending_);
+    chunk.remove_prefix(taken);
+    written = DecodeUnpaddedImpl(pending_, 4, output.data());
+    if (written == MODP_B64_ERROR) {
+      failed_ = true;
+      return absl::nullopt;
+    }
+  }
+
+  const size_t from_chunk = to_decode - (num_pending_ > 0 ? 4 : 0);
+  const size_t size =
+      DecodeUnpaddedImpl(chunk.data(), from_chunk, output.data() + written);
+  if (size == MODP_B64_ERROR) {
+    failed_ = true;
+    return absl::nullopt;
+  }
+  written += size;
+  chunk.remove_prefix(from_chunk);
+  std::copy(chunk.begin(), chunk.end(), pending_);
+  num_pending_ = chunk.size();
+  return written;
+}
+
+absl::optional<size_t> Base64StreamDecoder::Finish(span<uint8_t> output) {
+  CHECK_GE(output.size(), 3u);
+  if (failed_)
+    return absl::nullopt;
+  const size_t written = DecodeImpl(pending_, num_pending_, output.data());
+  num_pending_ = 0;
+  if (written == MODP_B64_ERROR) {
+    failed_ = true;
+    return absl::nullopt;
+  }
+  return written;
+}
+
 }  // namespace base
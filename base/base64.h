@@ -5,6 +5,7 @@
 #ifndef BASE_BASE64_H_
 #define BASE_BASE64_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <string>
@@ -32,6 +33,80 @@ BASE_EXPORT bool Base64Decode(StringPiece input, std::string* output);
 BASE_EXPORT absl::optional<std::vector<uint8_t>> Base64Decode(
     StringPiece input);
 
+// Returns the length of the base64 encoding of |input_size| bytes.
+BASE_EXPORT size_t Base64EncodedLength(size_t input_size);
+
+// Encodes |input| in base64 into |output|, which must hold at least
+// Base64EncodedLength(input.size()) chars. Returns the number of chars written.
+// Unlike Base64Encode(), nothing is allocated.
+BASE_EXPORT size_t Base64EncodeToSpan(span<const uint8_t> input,
+                                      span<char> output);
+
+// Returns the maximum size of the decoding of |input_size| base64 chars.
+BASE_EXPORT size_t Base64DecodedMaxSize(size_t input_size);
+
+// Decodes the base64 |input| into |output|, which must hold at least
+// Base64DecodedMaxSize(input.size()) bytes. Returns the number of bytes
+// written, or `absl::nullopt` if unsuccessful, in which case |output| may have
+// been modified.
+BASE_EXPORT absl::optional<size_t> Base64DecodeToSpan(StringPiece input,
+                                                      span<uint8_t> output);
+
+// Encodes data in base64 one chunk at a time, e.g. while it is read from a
+// file. The concatenated output is the same as Base64Encode() of the
+// concatenated chunks.
+class BASE_EXPORT Base64StreamEncoder {
+ public:
+  Base64StreamEncoder();
+  Base64StreamEncoder(const Base64StreamEncoder&) = delete;
+  Base64StreamEncoder& operator=(const Base64StreamEncoder&) = delete;
+  ~Base64StreamEncoder();
+
+  // Encodes |chunk| into |output|, which must hold at least
+  // Base64EncodedLength(chunk.size()) chars. Up to 2 bytes are held back until
+  // the next call. Returns the number of chars written.
+  size_t Encode(span<const uint8_t> chunk, span<char> output);
+
+  // Encodes the bytes held back, with padding, into |output|, which must hold
+  // at least 4 chars. Returns the number of chars written.
+  size_t Finish(span<char> output);
+
+ private:
+  uint8_t pending_[2];
+  size_t num_pending_ = 0;
+};
+
+// Decodes base64 data one chunk at a time. Succeeds if and only if
+// Base64Decode() of the concatenated chunks would, with the same output.
+class BASE_EXPORT Base64StreamDecoder {
+ public:
+  // Returns the maximum number of bytes written by Decode() for a chunk of
+  // |chunk_size| chars.
+  static size_t MaxDecodedSize(size_t chunk_size);
+
+  Base64StreamDecoder();
+  Base64StreamDecoder(const Base64StreamDecoder&) = delete;
+  Base64StreamDecoder& operator=(const Base64StreamDecoder&) = delete;
+  ~Base64StreamDecoder();
+
+  // Decodes |chunk| into |output|, which must hold at least
+  // MaxDecodedSize(chunk.size()) bytes. Up to 4 chars are held back until the
+  // next call, since the last 4 chars of the input may be padded. Returns the
+  // number of bytes written, or `absl::nullopt` if the input is invalid, after
+  // which all calls fail.
+  absl::optional<size_t> Decode(StringPiece chunk, span<uint8_t> output);
+
+  // Decodes the chars held back into |output|, which must hold at least 3
+  // bytes. Returns the number of bytes written, or `absl::nullopt` if the
+  // input is invalid.
+  absl::optional<size_t> Finish(span<uint8_t> output);
+
+ private:
+  char pending_[4];
+  size_t num_pending_ = 0;
+  bool failed_ = false;
+};
+
 }  // namespace base
 
 #endif  // BASE_BASE64_H_
@@ -3,13 +3,49 @@
 // found in the LICENSE file.
 
 #include <string>
+#include <vector>
 
 #include "base/base64.h"
+#include "base/check_op.h"
 #include "base/strings/string_piece.h"
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   std::string decode_output;
   base::StringPiece data_piece(reinterpret_cast<const char*>(data), size);
-  base::Base64Decode(data_piece, &decode_output);
+  const bool success = base::Base64Decode(data_piece, &decode_output);
+
+  // The span variant must give the same results.
+  std::vector<uint8_t> span_output(base::Base64DecodedMaxSize(size));
+  absl::optional<size_t> span_size =
+      base::Base64DecodeToSpan(data_piece, span_output);
+  CHECK_EQ(success, span_size.has_value());
+  if (success) {
+    CHECK_EQ(decode_output,
+             base::StringPiece(reinterpret_cast<char*>(span_output.data()),
+                               *span_size));
+  }
+
+  // So must the stream decoder, fed in two chunks split by the first byte.
+  const size_t split = size > 0 ? data[0] % (size + 1) : 0;
+  base::Base64StreamDecoder decoder;
+  std::string stream_output;
+  for (base::StringPiece chunk :
+       {data_piece.substr(0, split), data_piece.substr(split)}) {
+    std::vector<uint8_t> buffer(
+        base::Base64StreamDecoder::MaxDecodedSize(chunk.size()));
+    absl::optional<size_t> chunk_size = decoder.Decode(chunk, buffer);
+    if (!chunk_size) {
+      CHECK(!success);
+      return 0;
+    }
+    stream_output.append(reinterpret_cast<char*>(buffer.data()), *chunk_size);
+  }
+  uint8_t last[3];
+  absl::optional<size_t> last_size = decoder.Finish(last);
+  CHECK_EQ(success, last_size.has_value());
+  if (success) {
+    stream_output.append(reinterpret_cast<char*>(last), *last_size);
+    CHECK_EQ(decode_output, stream_output);
+  }
   return 0;
 }
@@ -23,5 +23,11 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   base::Base64Encode(data_piece, &string_piece_encode_output);
   CHECK_EQ(encode_output, string_piece_encode_output);
 
+  // And the span variant.
+  std::string span_encode_output(base::Base64EncodedLength(size), '\0');
+  CHECK_EQ(encode_output.size(),
+           base::Base64EncodeToSpan(data_span, span_encode_output));
+  CHECK_EQ(encode_output, span_encode_output);
+
   return 0;
 }
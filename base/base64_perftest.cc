@@ -0,0 +1,63 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/base64.h"
+
+#include <string>
+
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "Base64.";
+constexpr char kEncodeThroughput[] = "encode_throughput";
+constexpr char kDecodeThroughput[] = "decode_throughput";
+
+void MeasureBase64(size_t size, const std::string& story_name) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>(i * 131);
+  // Processes 1 GiB of data in total.
+  const int iterations = static_cast<int>((size_t{1} << 30) / size);
+
+  std::string encoded;
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < iterations; ++i)
+    Base64Encode(data, &encoded);
+  const TimeDelta encode_time = TimeTicks::Now() - start;
+
+  std::string decoded;
+  start = TimeTicks::Now();
+  for (int i = 0; i < iterations; ++i)
+    ASSERT_TRUE(Base64Decode(encoded, &decoded));
+  const TimeDelta decode_time = TimeTicks::Now() - start;
+  EXPECT_EQ(data, decoded);
+
+  const double megabytes = static_cast<double>(size) * iterations / (1 << 20);
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story_name);
+  reporter.RegisterImportantMetric(kEncodeThroughput, "MB/s");
+  reporter.RegisterImportantMetric(kDecodeThroughput, "MB/s");
+  reporter.AddResult(kEncodeThroughput, megabytes / encode_time.InSecondsF());
+  reporter.AddResult(kDecodeThroughput, megabytes / decode_time.InSecondsF());
+}
+
+}  // namespace
+
+TEST(Base64PerfTest, Small) {
+  MeasureBase64(64, "64B");
+}
+
+TEST(Base64PerfTest, Medium) {
+  MeasureBase64(16 * 1024, "16KiB");
+}
+
+TEST(Base64PerfTest, Large) {
+  MeasureBase64(8 * 1024 * 1024, "8MiB");
+}
+
+}  // namespace base
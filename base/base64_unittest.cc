@@ -4,6 +4,9 @@
 
 #include "base/base64.h"
 
+#include <string>
+#include <vector>
+
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -56,4 +59,107 @@ TEST(Base64Test, InPlace) {
   EXPECT_EQ(text, kText);
 }
 
+// The vectorized paths handle blocks of up to 64 chars, and leave the rest to
+// the scalar path. Checks that all lengths and positions of invalid chars give
+// the same results as the scalar path would.
+TEST(Base64Test, LongInputs) {
+  std::string text;
+  for (size_t length = 0; length < 300; ++length) {
+    SCOPED_TRACE(length);
+    std::string encoded;
+    Base64Encode(text, &encoded);
+    ASSERT_EQ(Base64EncodedLength(length), encoded.size());
+    EXPECT_EQ(0u, encoded.size() % 4);
+    std::string decoded;
+    ASSERT_TRUE(Base64Decode(encoded, &decoded));
+    EXPECT_EQ(text, decoded);
+
+    for (size_t i = 0; i < encoded.size(); ++i) {
+      std::string invalid = encoded;
+      invalid[i] = '*';
+      EXPECT_FALSE(Base64Decode(invalid, &decoded));
+      // Padding is only allowed at the end.
+      invalid[i] = '=';
+      const bool is_padding =
+          i + 2 >= encoded.size() && (i + 1 == encoded.size() ||
+                                      encoded[i + 1] == '=');
+      if (!is_padding)
+        EXPECT_FALSE(Base64Decode(invalid, &decoded));
+    }
+    text.push_back(static_cast<char>(length * 7));
+  }
+}
+
+TEST(Base64Test, Span) {
+  const std::string kText = "hello world";
+  const std::string kBase64Text = "aGVsbG8gd29ybGQ=";
+
+  std::string encoded(Base64EncodedLength(kText.size()), '\0');
+  EXPECT_EQ(kBase64Text.size(),
+            Base64EncodeToSpan(as_bytes(make_span(kText)), encoded));
+  EXPECT_EQ(kBase64Text, encoded);
+
+  std::vector<uint8_t> decoded(Base64DecodedMaxSize(encoded.size()));
+  EXPECT_EQ(kText.size(), Base64DecodeToSpan(encoded, decoded));
+  decoded.resize(kText.size());
+  EXPECT_THAT(decoded, testing::ElementsAreArray(kText));
+
+  EXPECT_FALSE(Base64DecodeToSpan("invalid base64!", decoded));
+}
+
+TEST(Base64Test, Stream) {
+  std::string text;
+  for (int i = 0; i < 1000; ++i)
+    text.push_back(static_cast<char>(i));
+  std::string expected;
+  Base64Encode(text, &expected);
+
+  for (size_t chunk_size : {1, 2, 3, 5, 64, 1000}) {
+    SCOPED_TRACE(chunk_size);
+    Base64StreamEncoder encoder;
+    std::string encoded;
+    for (size_t i = 0; i < text.size(); i += chunk_size) {
+      const StringPiece chunk = StringPiece(text).substr(i, chunk_size);
+      char buffer[1336];
+      encoded.append(buffer, encoder.Encode(as_bytes(make_span(chunk)),
+                                            make_span(buffer)));
+    }
+    char buffer[4];
+    encoded.append(buffer, encoder.Finish(buffer));
+    EXPECT_EQ(expected, encoded);
+
+    Base64StreamDecoder decoder;
+    std::string decoded;
+    for (size_t i = 0; i < encoded.size(); i += chunk_size) {
+      const StringPiece chunk = StringPiece(encoded).substr(i, chunk_size);
+      uint8_t buffer[1000];
+      absl::optional<size_t> size = decoder.Decode(chunk, buffer);
+      ASSERT_TRUE(size);
+      decoded.append(reinterpret_cast<char*>(buffer), *size);
+    }
+    uint8_t last[3];
+    absl::optional<size_t> size = decoder.Finish(last);
+    ASSERT_TRUE(size);
+    decoded.append(reinterpret_cast<char*>(last), *size);
+    EXPECT_EQ(text, decoded);
+  }
+}
+
+TEST(Base64Test, StreamDecodeErrors) {
+  const char* const kInvalid[] = {"aGVsbG8", "aG=sbG8=", "aGVs*G8=",
+                                  "aGVsbG8=aGVs"};
+  for (const char* input : kInvalid) {
+    SCOPED_TRACE(input);
+    std::string decoded;
+    ASSERT_FALSE(Base64Decode(input, &decoded));
+
+    Base64StreamDecoder decoder;
+    uint8_t buffer[16];
+    absl::optional<size_t> size = decoder.Decode(input, buffer);
+    if (size)
+      size = decoder.Finish(buffer);
+    EXPECT_FALSE(size);
+  }
+}
+
 }  // namespace base
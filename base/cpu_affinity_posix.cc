@@ -6,6 +6,7 @@
 
 #include <sched.h>
 
+#include "base/check.h"
 #include "base/cpu.h"
 #include "base/process/internal_linux.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
@@ -204,6 +205,19 @@ bool SetThreadCpuAffinityMode(PlatformThreadId thread_id,
   return result == 0;
 }
 
+bool SetThreadCpuAffinity(PlatformThreadId thread_id,
+                          const std::vector<int>& cpus) {
+  DCHECK(!cpus.empty());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+      return false;
+    CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(thread_id, sizeof(set), &set) == 0;
+}
+
 bool SetProcessCpuAffinityMode(ProcessHandle process_handle,
                                CpuAffinityMode affinity) {
   bool any_threads = false;
@@ -5,6 +5,8 @@
 #ifndef BASE_CPU_AFFINITY_POSIX_H_
 #define BASE_CPU_AFFINITY_POSIX_H_
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/process/process_handle.h"
 #include "base/threading/platform_thread.h"
@@ -37,6 +39,11 @@ BASE_EXPORT bool SetThreadCpuAffinityMode(PlatformThreadId thread_id,
 BASE_EXPORT bool SetProcessCpuAffinityMode(ProcessHandle process_handle,
                                            CpuAffinityMode affinity);
 
+// Restricts execution of the specified thread to the CPUs in |cpus|, which must
+// not be empty. Returns false if updating the affinity failed.
+BASE_EXPORT bool SetThreadCpuAffinity(PlatformThreadId thread_id,
+                                      const std::vector<int>& cpus);
+
 // Return true if the current architecture has big or bigger cores.
 BASE_EXPORT bool HasBigCpuCores();
 
@@ -133,4 +133,34 @@ TEST(CpuAffinityTest, MAYBE_SetThreadCpuAffinityMode) {
   ASSERT_FALSE(thread.IsRunning());
 }
 
+TEST(CpuAffinityTest, SetThreadCpuAffinity) {
+  TestThread thread;
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &thread, &handle));
+  thread.WaitForTerminationReady();
+  ASSERT_TRUE(thread.IsRunning());
+
+  PlatformThreadId thread_id = thread.thread_id();
+  cpu_set_t initial_set;
+  ASSERT_EQ(sched_getaffinity(thread_id, sizeof(initial_set), &initial_set),
+            0);
+  // Pick a CPU the thread is already allowed to run on, since the test process
+  // may itself be restricted to a subset of CPUs.
+  int allowed_cpu = 0;
+  while (!CPU_ISSET(allowed_cpu, &initial_set))
+    ++allowed_cpu;
+
+  EXPECT_TRUE(SetThreadCpuAffinity(thread_id, {allowed_cpu}));
+  cpu_set_t set;
+  EXPECT_EQ(sched_getaffinity(thread_id, sizeof(set), &set), 0);
+  EXPECT_EQ(CPU_COUNT(&set), 1);
+  EXPECT_TRUE(CPU_ISSET(allowed_cpu, &set));
+
+  EXPECT_FALSE(SetThreadCpuAffinity(thread_id, {-1}));
+
+  thread.MarkForTermination();
+  PlatformThread::Join(handle);
+  ASSERT_FALSE(thread.IsRunning());
+}
+
 }  // namespace base
@@ -8,6 +8,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/bits.h"
 #include "base/check_op.h"
 #include "base/json/json_reader.h"
 #include "base/metrics/histogram_functions.h"
@@ -21,8 +22,15 @@
 #include "base/strings/utf_string_conversion_utils.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/third_party/icu/icu_utf.h"
+#include "build/build_config.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
 namespace base {
 namespace internal {
 
@@ -32,6 +40,56 @@ namespace {
 static_assert(JSONParser::JSON_PARSE_ERROR_COUNT < 1000,
               "JSONParser error out of bounds");
 
+// Returns whether ConsumeStringRaw() can copy |c| verbatim, without decoding,
+// unescaping or line tracking: printable ASCII other than '"' and '\\'.
+inline bool IsPlainStringChar(char c) {
+  return c >= 0x20 && c != '"' && c != '\\' && !(c & 0x80);
+}
+
+// Returns the number of leading characters of [|begin|, |end|) for which
+// IsPlainStringChar() is true. Strings in typical JSON documents are mostly
+// made of such characters, so they are scanned 16 bytes at a time when the
+// CPU allows it.
+size_t CountPlainStringChars(const char* begin, const char* end) {
+  const char* pos = begin;
+#if defined(ARCH_CPU_X86_FAMILY)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(0x20);
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    // The comparison is signed, so bytes >= 0x80 are also less than |space|.
+    const __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, backslash)),
+        _mm_cmplt_epi8(chunk, space));
+    const int mask = _mm_movemask_epi8(special);
+    if (mask)
+      return static_cast<size_t>(pos - begin) +
+             bits::CountTrailingZeroBits(static_cast<uint32_t>(mask));
+  }
+#elif defined(ARCH_CPU_ARM64)
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  const uint8x16_t non_ascii = vdupq_n_u8(0x80);
+  for (; end - pos >= 16; pos += 16) {
+    const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(pos));
+    const uint8x16_t special =
+        vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)),
+                 vorrq_u8(vcltq_u8(chunk, space), vcgeq_u8(chunk, non_ascii)));
+    // The position of the first special character is found by the scalar loop
+    // below.
+    if (vmaxvq_u8(special))
+      break;
+  }
+#endif
+  while (pos < end && IsPlainStringChar(*pos))
+    ++pos;
+  return static_cast<size_t>(pos - begin);
+}
+
 std::string ErrorCodeToString(JSONParser::JsonParseError error_code) {
   switch (error_code) {
     case JSONParser::JSON_NO_ERROR:
@@ -219,6 +277,15 @@ void JSONParser::StringBuilder::Append(uint32_t point) {
   }
 }
 
+void JSONParser::StringBuilder::AppendPlainChars(StringPiece chars) {
+  if (!string_) {
+    DCHECK_EQ(chars.data(), pos_ + length_);
+    length_ += chars.length();
+  } else {
+    string_->append(chars.data(), chars.length());
+  }
+}
+
 void JSONParser::StringBuilder::Convert() {
   if (string_)
     return;
@@ -538,6 +605,18 @@ bool JSONParser::ConsumeStringRaw(StringBuilder* out) {
   StringBuilder string(pos());
 
   while (PeekChar()) {
+    // Copy runs of characters which need no special handling in bulk, and only
+    // go through the slower path below for the character ending the run.
+    const char* run_start = input_.data() + index_;
+    const size_t run_length =
+        CountPlainStringChars(run_start, input_.data() + input_.length());
+    if (run_length) {
+      string.AppendPlainChars(StringPiece(run_start, run_length));
+      index_ += static_cast<int>(run_length);
+      if (!PeekChar())
+        break;
+    }
+
     uint32_t next_char = 0;
     if (!ReadUnicodeCharacter(input_.data(),
                               static_cast<int32_t>(input_.length()), &index_,
@@ -64,6 +64,42 @@ TEST_F(JSONParserTest, ConsumeString) {
   EXPECT_EQ("test", value->GetString());
 }
 
+// Long strings are scanned in blocks: special characters must be handled at
+// any offset, including across block boundaries.
+TEST_F(JSONParserTest, ConsumeLongString) {
+  const std::string plain(40, 'a');
+  for (size_t i = 0; i < plain.length(); ++i) {
+    SCOPED_TRACE(i);
+    const std::string prefix = plain.substr(0, i);
+    const std::string suffix = plain.substr(i);
+
+    std::unique_ptr<JSONParser> parser(
+        NewTestParser("\"" + prefix + "\\n" + suffix + "\",|"));
+    absl::optional<Value> value(parser->ConsumeString());
+    TestLastThree(parser.get());
+    ASSERT_TRUE(value);
+    EXPECT_EQ(prefix + "\n" + suffix, value->GetString());
+
+    parser.reset(NewTestParser("\"" + prefix + "\xc3\xa9" + suffix + "\",|"));
+    value = parser->ConsumeString();
+    TestLastThree(parser.get());
+    ASSERT_TRUE(value);
+    EXPECT_EQ(prefix + "\xc3\xa9" + suffix, value->GetString());
+
+    JSONParser control_char_parser(JSON_PARSE_RFC);
+    EXPECT_FALSE(
+        control_char_parser.Parse("\"" + prefix + "\t" + suffix + "\""));
+    EXPECT_EQ(JSONParser::JSON_UNSUPPORTED_ENCODING,
+              control_char_parser.error_code());
+    EXPECT_EQ(1, control_char_parser.error_line());
+    EXPECT_EQ(static_cast<int>(i) + 1, control_char_parser.error_column());
+
+    JSONParser unterminated_parser(JSON_PARSE_RFC);
+    EXPECT_FALSE(unterminated_parser.Parse("\"" + prefix));
+    EXPECT_EQ(JSONParser::JSON_SYNTAX_ERROR, unterminated_parser.error_code());
+  }
+}
+
 TEST_F(JSONParserTest, ConsumeList) {
   std::string input("[true, false],|");
   std::unique_ptr<JSONParser> parser(NewTestParser(input));
@@ -61,21 +61,32 @@ Value GenerateLayeredDict(int breadth, int depth) {
   return root;
 }
 
+// Generates a list of |count| strings of |length| characters, like the
+// descriptions or encoded blobs found in large configuration files.
+Value GenerateStringList(int count, size_t length) {
+  Value list(Value::Type::LIST);
+  for (int i = 0; i < count; ++i)
+    list.Append(std::string(length, static_cast<char>('a' + i % 26)));
+  return list;
+}
+
 }  // namespace
 
 class JSONPerfTest : public testing::Test {
  public:
   void TestWriteAndRead(int breadth, int depth) {
-    std::string description = "Breadth: " + base::NumberToString(breadth) +
-                              ", Depth: " + base::NumberToString(depth);
-    Value dict = GenerateLayeredDict(breadth, depth);
+    TestWriteAndRead(GenerateLayeredDict(breadth, depth),
+                     "breadth_" + base::NumberToString(breadth) + "_depth_" +
+                         base::NumberToString(depth));
+  }
+
+  void TestWriteAndRead(const Value& value, const std::string& story_name) {
     std::string json;
 
     TimeTicks start_write = TimeTicks::Now();
-    JSONWriter::Write(dict, &json);
+    JSONWriter::Write(value, &json);
     TimeTicks end_write = TimeTicks::Now();
-    auto reporter = SetUpReporter("breadth_" + base::NumberToString(breadth) +
-                                  "_depth_" + base::NumberToString(depth));
+    auto reporter = SetUpReporter(story_name);
     reporter.AddResult(kMetricWriteTime, end_write - start_write);
 
     TimeTicks start_read = TimeTicks::Now();
@@ -97,4 +108,14 @@ TEST_F(JSONPerfTest, StressTest) {
   }
 }
 
+TEST_F(JSONPerfTest, LongStrings) {
+  // About 16 MiB of string data for each length.
+  constexpr size_t kTotalLength = 16 * 1024 * 1024;
+  for (size_t length : {16, 256, 4096}) {
+    TestWriteAndRead(
+        GenerateStringList(static_cast<int>(kTotalLength / length), length),
+        "strings_length_" + base::NumberToString(length));
+  }
+}
+
 }  // namespace base
@@ -0,0 +1,347 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_reader.h"
+
+#include <memory>
+#include <utility>
+
+#include "base/check_op.h"
+#include "base/files/file.h"
+#include "base/json/json_reader.h"
+#include "base/notreached.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace base {
+
+namespace {
+
+const char kSyntaxError[] = "Syntax error.";
+const char kUnexpectedToken[] = "Unexpected token.";
+const char kTrailingComma[] = "Trailing comma not allowed.";
+const char kTooMuchNesting[] = "Too much nesting.";
+const char kUnexpectedDataAfterRoot[] = "Unexpected data after root element.";
+const char kUnquotedDictionaryKey[] = "Dictionary keys must be quoted.";
+const char kFileReadError[] = "Error reading the file.";
+
+bool IsNumberChar(char c) {
+  return IsAsciiDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' ||
+         c == 'E';
+}
+
+}  // namespace
+
+JSONStreamReader::JSONStreamReader(Delegate* delegate, size_t max_depth)
+    : delegate_(delegate), max_depth_(max_depth) {
+  DCHECK(delegate_);
+  CHECK_LE(max_depth, internal::kAbsoluteMaxDepth);
+}
+
+JSONStreamReader::~JSONStreamReader() = default;
+
+bool JSONStreamReader::Feed(StringPiece chunk) {
+  if (stopped_)
+    return false;
+
+  size_t pos = 0;
+  while (pos < chunk.length()) {
+    if (token_type_ != TokenType::kNone) {
+      const StringPiece rest = chunk.substr(pos);
+      bool complete = false;
+      const size_t length = ScanToken(rest, &complete);
+      offset_ += length;
+      pos += length;
+      if (!complete) {
+        // Only the current token is kept across chunks.
+        token_.append(rest.data(), length);
+        return true;
+      }
+
+      const TokenType type = token_type_;
+      token_type_ = TokenType::kNone;
+      token_length_ = 0;
+      token_escape_ = false;
+      last_char_was_cr_ = false;
+      bool result;
+      if (token_.empty()) {
+        result = HandleToken(type, rest.substr(0, length));
+      } else {
+        token_.append(rest.data(), length);
+        result = HandleToken(type, token_);
+        token_.clear();
+      }
+      if (!result)
+        return false;
+      continue;
+    }
+
+    const char c = chunk[pos];
+    switch (c) {
+      case '\r':
+        ++line_;
+        line_start_offset_ = offset_ + 1;
+        break;
+      case '\n':
+        // Don't increment |line_| twice for "\r\n".
+        if (!last_char_was_cr_)
+          ++line_;
+        line_start_offset_ = offset_ + 1;
+        break;
+      case ' ':
+      case '\t':
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        if (!HandleStructuralChar(c))
+          return false;
+        break;
+      case '"':
+        if (!StartToken(TokenType::kString))
+          return false;
+        continue;
+      case '-':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+        if (!StartToken(TokenType::kNumber))
+          return false;
+        continue;
+      case 't':
+      case 'f':
+      case 'n':
+        if (!StartToken(TokenType::kLiteral))
+          return false;
+        continue;
+      default:
+        return ReportError(expect_ == Expect::kKey ||
+                                   expect_ == Expect::kKeyOrDictEnd
+                               ? kUnquotedDictionaryKey
+                               : kUnexpectedToken,
+                           offset_);
+    }
+    last_char_was_cr_ = c == '\r';
+    ++offset_;
+    ++pos;
+  }
+  return true;
+}
+
+bool JSONStreamReader::Finish() {
+  if (stopped_)
+    return false;
+
+  if (token_type_ == TokenType::kString)
+    return ReportError(kSyntaxError, token_offset_);
+  if (token_type_ != TokenType::kNone) {
+    // Numbers and literals end with the document.
+    const TokenType type = token_type_;
+    token_type_ = TokenType::kNone;
+    const std::string token = std::move(token_);
+    token_.clear();
+    if (!HandleToken(type, token))
+      return false;
+  }
+
+  if (expect_ != Expect::kEndOfInput)
+    return ReportError(kSyntaxError, offset_);
+  return true;
+}
+
+bool JSONStreamReader::ReadFile(File* file) {
+  DCHECK(file);
+  auto buffer = std::make_unique<char[]>(kFileChunkSize);
+  for (;;) {
+    const int bytes_read =
+        file->ReadAtCurrentPos(buffer.get(), static_cast<int>(kFileChunkSize));
+    if (bytes_read < 0)
+      return ReportError(kFileReadError, offset_);
+    if (bytes_read == 0)
+      break;
+    if (!Feed(StringPiece(buffer.get(), static_cast<size_t>(bytes_read))))
+      return false;
+  }
+  return Finish();
+}
+
+std::string JSONStreamReader::GetErrorMessage() const {
+  if (error_message_.empty())
+    return std::string();
+  return StringPrintf("Line: %i, column: %i, %s", error_line_, error_column_,
+                      error_message_.c_str());
+}
+
+bool JSONStreamReader::HandleStructuralChar(char c) {
+  switch (c) {
+    case '{':
+    case '[': {
+      if (expect_ != Expect::kValue && expect_ != Expect::kValueOrListEnd) {
+        return ReportError(expect_ == Expect::kEndOfInput
+                               ? kUnexpectedDataAfterRoot
+                               : kUnexpectedToken,
+                           offset_);
+      }
+      // Same limit as JSONParser.
+      if (stack_.size() + 1 >= max_depth_)
+        return ReportError(kTooMuchNesting, offset_);
+      const bool is_dict = c == '{';
+      stack_.push_back(is_dict);
+      expect_ = is_dict ? Expect::kKeyOrDictEnd : Expect::kValueOrListEnd;
+      return Notify(is_dict ? delegate_->OnDictBegin()
+                            : delegate_->OnListBegin());
+    }
+    case '}':
+      if (expect_ == Expect::kKey)
+        return ReportError(kTrailingComma, offset_);
+      if (expect_ != Expect::kKeyOrDictEnd &&
+          expect_ != Expect::kCommaOrDictEnd) {
+        return ReportError(kUnexpectedToken, offset_);
+      }
+      stack_.pop_back();
+      OnValueEnd();
+      return Notify(delegate_->OnDictEnd());
+    case ']':
+      // In a list, a value is only expected after a comma.
+      if (expect_ == Expect::kValue && !stack_.empty() && !stack_.back())
+        return ReportError(kTrailingComma, offset_);
+      if (expect_ != Expect::kValueOrListEnd &&
+          expect_ != Expect::kCommaOrListEnd) {
+        return ReportError(kUnexpectedToken, offset_);
+      }
+      stack_.pop_back();
+      OnValueEnd();
+      return Notify(delegate_->OnListEnd());
+    case ':':
+      if (expect_ != Expect::kColon)
+        return ReportError(kUnexpectedToken, offset_);
+      expect_ = Expect::kValue;
+      return true;
+    case ',':
+      if (expect_ == Expect::kCommaOrListEnd) {
+        expect_ = Expect::kValue;
+        return true;
+      }
+      if (expect_ == Expect::kCommaOrDictEnd) {
+        expect_ = Expect::kKey;
+        return true;
+      }
+      return ReportError(kUnexpectedToken, offset_);
+  }
+  NOTREACHED();
+  return false;
+}
+
+bool JSONStreamReader::StartToken(TokenType type) {
+  switch (expect_) {
+    case Expect::kValue:
+    case Expect::kValueOrListEnd:
+      break;
+    case Expect::kKey:
+    case Expect::kKeyOrDictEnd:
+      if (type != TokenType::kString)
+        return ReportError(kUnquotedDictionaryKey, offset_);
+      break;
+    case Expect::kEndOfInput:
+      return ReportError(kUnexpectedDataAfterRoot, offset_);
+    case Expect::kCommaOrListEnd:
+    case Expect::kColon:
+    case Expect::kCommaOrDictEnd:
+      return ReportError(kUnexpectedToken, offset_);
+  }
+  DCHECK(token_.empty());
+  token_type_ = type;
+  token_length_ = 0;
+  token_offset_ = offset_;
+  return true;
+}
+
+size_t JSONStreamReader::ScanToken(StringPiece input, bool* complete) {
+  *complete = false;
+  for (size_t i = 0; i < input.length(); ++i) {
+    const char c = input[i];
+    switch (token_type_) {
+      case TokenType::kString:
+        // Skip the opening quote.
+        if (token_length_ + i == 0)
+          break;
+        if (token_escape_) {
+          token_escape_ = false;
+        } else if (c == '\\') {
+          token_escape_ = true;
+        } else if (c == '"') {
+          *complete = true;
+          return i + 1;
+        }
+        break;
+      case TokenType::kNumber:
+        if (!IsNumberChar(c)) {
+          *complete = true;
+          return i;
+        }
+        break;
+      case TokenType::kLiteral:
+        if (!IsAsciiLower(c)) {
+          *complete = true;
+          return i;
+        }
+        break;
+      case TokenType::kNone:
+        NOTREACHED();
+        return 0;
+    }
+  }
+  token_length_ += input.length();
+  return input.length();
+}
+
+bool JSONStreamReader::HandleToken(TokenType type, StringPiece token) {
+  absl::optional<Value> value = JSONReader::Read(token, JSON_PARSE_RFC);
+  if (!value)
+    return ReportError(kSyntaxError, token_offset_);
+  DCHECK(!value->is_dict() && !value->is_list());
+
+  if (expect_ == Expect::kKey || expect_ == Expect::kKeyOrDictEnd) {
+    DCHECK_EQ(type, TokenType::kString);
+    expect_ = Expect::kColon;
+    return Notify(delegate_->OnKey(value->GetString()));
+  }
+  OnValueEnd();
+  return Notify(delegate_->OnValue(std::move(*value)));
+}
+
+void JSONStreamReader::OnValueEnd() {
+  if (stack_.empty()) {
+    expect_ = Expect::kEndOfInput;
+    return;
+  }
+  expect_ = stack_.back() ? Expect::kCommaOrDictEnd : Expect::kCommaOrListEnd;
+}
+
+bool JSONStreamReader::Notify(bool keep_going) {
+  if (!keep_going)
+    stopped_ = true;
+  return keep_going;
+}
+
+bool JSONStreamReader::ReportError(const char* message, size_t offset) {
+  stopped_ = true;
+  error_message_ = message;
+  error_line_ = line_;
+  error_column_ = static_cast<int>(offset - line_start_offset_ + 1);
+  return false;
+}
+
+}  // namespace base
@@ -0,0 +1,175 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_JSON_JSON_STREAM_READER_H_
+#define BASE_JSON_JSON_STREAM_READER_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/json/json_common.h"
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+class File;
+
+// An event-based JSON parser which consumes its input in chunks of any size,
+// e.g. as they are read from a File or a data pipe, and reports the structure
+// of the document to a Delegate instead of building a Value tree. Its memory
+// usage is bounded by the nesting depth and the length of the longest string
+// or number in the document, not by the size of the document.
+//
+// The input must follow RFC 8259, like JSONReader::Read() with JSON_PARSE_RFC:
+// comments, trailing commas and the other Chromium extensions are rejected.
+// Strings and numbers are decoded by JSONReader, with the same semantics.
+//
+// Usage:
+//   MyDelegate delegate;
+//   JSONStreamReader reader(&delegate);
+//   while (ReadNextChunk(&chunk)) {
+//     if (!reader.Feed(chunk))
+//       return Fail(reader.GetErrorMessage());
+//   }
+//   if (!reader.Finish())
+//     return Fail(reader.GetErrorMessage());
+class BASE_EXPORT JSONStreamReader {
+ public:
+  // Receives the events of the document, in document order. Each method
+  // returns false to stop parsing, in which case Feed() or Finish() return
+  // false without an error message.
+  class Delegate {
+   public:
+    virtual ~Delegate() = default;
+
+    virtual bool OnDictBegin() = 0;
+    virtual bool OnDictEnd() = 0;
+    virtual bool OnListBegin() = 0;
+    virtual bool OnListEnd() = 0;
+
+    // Called with the key of the next dictionary entry, before its value.
+    virtual bool OnKey(StringPiece key) = 0;
+
+    // Called with a value which is neither a dictionary nor a list: none,
+    // bool, int, double or string.
+    virtual bool OnValue(Value value) = 0;
+  };
+
+  // The size of the chunks read by ReadFile().
+  static constexpr size_t kFileChunkSize = 64 * 1024;
+
+  // |delegate| must outlive this reader.
+  explicit JSONStreamReader(Delegate* delegate,
+                            size_t max_depth = internal::kAbsoluteMaxDepth);
+
+  JSONStreamReader(const JSONStreamReader&) = delete;
+  JSONStreamReader& operator=(const JSONStreamReader&) = delete;
+
+  ~JSONStreamReader();
+
+  // Parses the next |chunk| of the document. Returns false if the document
+  // is invalid or the delegate stopped parsing; the reader must not be used
+  // anymore in that case.
+  bool Feed(StringPiece chunk);
+
+  // Signals the end of the document. Returns false if the document is
+  // incomplete or invalid, or if the delegate stopped parsing.
+  bool Finish();
+
+  // Feeds the rest of |file| to this reader, then calls Finish().
+  bool ReadFile(File* file);
+
+  // Returns a human-readable message describing the error, or an empty string
+  // if there was none.
+  std::string GetErrorMessage() const;
+
+  // The position of the error, if any. Lines and columns start at 1.
+  int error_line() const { return error_line_; }
+  int error_column() const { return error_column_; }
+
+ private:
+  // What is allowed at the current position of the document.
+  enum class Expect {
+    kValue,
+    kValueOrListEnd,
+    kCommaOrListEnd,
+    kKeyOrDictEnd,
+    kKey,
+    kColon,
+    kCommaOrDictEnd,
+    kEndOfInput,
+  };
+
+  enum class TokenType {
+    kNone,
+    kString,
+    kNumber,
+    kLiteral,
+  };
+
+  // Handles the structural character |c|. Returns false on error.
+  bool HandleStructuralChar(char c);
+
+  // Starts scanning a token of |type| at the current position, if a token of
+  // this type is allowed there. Returns false on error.
+  bool StartToken(TokenType type);
+
+  // Scans |input| for the end of the current token, which may have started in
+  // a previous chunk. Returns the number of bytes of |input| which belong to
+  // the token and sets |complete| if the token ends in |input|.
+  size_t ScanToken(StringPiece input, bool* complete);
+
+  // Decodes the complete |token| and reports it to the delegate.
+  bool HandleToken(TokenType type, StringPiece token);
+
+  // Updates |expect_| after a complete value.
+  void OnValueEnd();
+
+  // Stops the reader if the delegate returned false. Returns |keep_going|.
+  bool Notify(bool keep_going);
+
+  // Records an error at |offset| in the document. Always returns false.
+  bool ReportError(const char* message, size_t offset);
+
+  const raw_ptr<Delegate> delegate_;
+  const size_t max_depth_;
+
+  Expect expect_ = Expect::kValue;
+
+  // For each open container, whether it is a dictionary.
+  std::vector<bool> stack_;
+
+  // The type of the token being scanned, if any, and the bytes already
+  // scanned if it started in a previous chunk.
+  TokenType token_type_ = TokenType::kNone;
+  std::string token_;
+  size_t token_length_ = 0;
+  size_t token_offset_ = 0;
+
+  // Whether the last character of the string being scanned is an unescaped
+  // backslash.
+  bool token_escape_ = false;
+
+  // The position in the document, for error reporting.
+  size_t offset_ = 0;
+  size_t line_start_offset_ = 0;
+  int line_ = 1;
+  bool last_char_was_cr_ = false;
+
+  // Set once the reader failed or the delegate stopped it.
+  bool stopped_ = false;
+
+  std::string error_message_;
+  int error_line_ = 0;
+  int error_column_ = 0;
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_STREAM_READER_H_
@@ -0,0 +1,211 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_reader.h"
+
+#include <string.h>
+
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_reader.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace base {
+
+namespace {
+
+// Builds the Value tree described by the events, like JSONReader::Read().
+class ValueBuilder : public JSONStreamReader::Delegate {
+ public:
+  ValueBuilder() = default;
+  ~ValueBuilder() override = default;
+
+  // JSONStreamReader::Delegate:
+  bool OnDictBegin() override {
+    stack_.emplace_back(Value::Type::DICTIONARY);
+    keys_.emplace_back();
+    return true;
+  }
+  bool OnDictEnd() override {
+    keys_.pop_back();
+    return PopContainer();
+  }
+  bool OnListBegin() override {
+    stack_.emplace_back(Value::Type::LIST);
+    return true;
+  }
+  bool OnListEnd() override { return PopContainer(); }
+  bool OnKey(StringPiece key) override {
+    keys_.back() = std::string(key);
+    return true;
+  }
+  bool OnValue(Value value) override {
+    ++num_values_;
+    return AddValue(std::move(value));
+  }
+
+  absl::optional<Value>& root() { return root_; }
+  int num_values() const { return num_values_; }
+
+  // OnValue() returns false after |count| values.
+  void set_max_values(int count) { max_values_ = count; }
+
+ private:
+  bool PopContainer() {
+    Value container = std::move(stack_.back());
+    stack_.pop_back();
+    return AddValue(std::move(container));
+  }
+
+  bool AddValue(Value value) {
+    if (stack_.empty()) {
+      EXPECT_FALSE(root_);
+      root_ = std::move(value);
+    } else if (stack_.back().is_dict()) {
+      stack_.back().GetDict().Set(keys_.back(), std::move(value));
+    } else {
+      stack_.back().GetList().Append(std::move(value));
+    }
+    return num_values_ < max_values_;
+  }
+
+  std::vector<Value> stack_;
+  std::vector<std::string> keys_;
+  absl::optional<Value> root_;
+  int num_values_ = 0;
+  int max_values_ = std::numeric_limits<int>::max();
+};
+
+// Parses |json| fed in chunks of |chunk_size| bytes.
+absl::optional<Value> ParseInChunks(StringPiece json,
+                                    size_t chunk_size,
+                                    std::string* error_message = nullptr) {
+  ValueBuilder builder;
+  JSONStreamReader reader(&builder);
+  bool result = true;
+  for (size_t i = 0; result && i < json.length(); i += chunk_size)
+    result = reader.Feed(json.substr(i, chunk_size));
+  if (result)
+    result = reader.Finish();
+  if (error_message)
+    *error_message = reader.GetErrorMessage();
+  if (!result)
+    return absl::nullopt;
+  return std::move(builder.root());
+}
+
+}  // namespace
+
+TEST(JSONStreamReaderTest, MatchesJSONReader) {
+  const char* const kDocuments[] = {
+      "null",
+      "  true ",
+      "-12.5e3",
+      "42",
+      "\"a\\\"b\\\\c\\u00e9\\ud83d\\ude00\"",
+      "[]",
+      "{}",
+      "[1, [2, [3, {}]], \"x\"]",
+      "{\"a\": {\"b\": [true, false, null]}, \"c\": 1.5,\r\n \"d\": \"\"}",
+  };
+  for (const char* document : kDocuments) {
+    SCOPED_TRACE(document);
+    absl::optional<Value> expected = JSONReader::Read(document, JSON_PARSE_RFC);
+    ASSERT_TRUE(expected);
+    const size_t length = strlen(document);
+    for (size_t chunk_size = 1; chunk_size <= length; ++chunk_size) {
+      SCOPED_TRACE(chunk_size);
+      absl::optional<Value> value = ParseInChunks(document, chunk_size);
+      ASSERT_TRUE(value);
+      EXPECT_EQ(*expected, *value);
+    }
+  }
+}
+
+TEST(JSONStreamReaderTest, Errors) {
+  const struct {
+    const char* json;
+    const char* error_message;
+  } kCases[] = {
+      {"", "Line: 1, column: 1, Syntax error."},
+      {"[1, 2", "Line: 1, column: 6, Syntax error."},
+      {"\"abc", "Line: 1, column: 1, Syntax error."},
+      {"[1,]", "Line: 1, column: 4, Trailing comma not allowed."},
+      {"{\"a\": 1,}", "Line: 1, column: 9, Trailing comma not allowed."},
+      {"{a: 1}", "Line: 1, column: 2, Dictionary keys must be quoted."},
+      {"{\"a\" 1}", "Line: 1, column: 6, Unexpected token."},
+      {"[1]\n[2]", "Line: 2, column: 1, Unexpected data after root element."},
+      {"[tru]", "Line: 1, column: 2, Syntax error."},
+      {"[01]", "Line: 1, column: 2, Syntax error."},
+      {"// comment\n1", "Line: 1, column: 1, Unexpected token."},
+      {"[\n  1\n  2]", "Line: 3, column: 3, Unexpected token."},
+  };
+  for (const auto& test_case : kCases) {
+    SCOPED_TRACE(test_case.json);
+    for (size_t chunk_size : {1, 1000}) {
+      std::string error_message;
+      EXPECT_FALSE(ParseInChunks(test_case.json, chunk_size, &error_message));
+      EXPECT_EQ(test_case.error_message, error_message);
+    }
+  }
+}
+
+TEST(JSONStreamReaderTest, TooMuchNesting) {
+  std::string json;
+  for (int i = 0; i < 200; ++i)
+    json = "[" + json + "]";
+  std::string error_message;
+  EXPECT_FALSE(ParseInChunks(json, 64, &error_message));
+  EXPECT_EQ("Line: 1, column: 200, Too much nesting.", error_message);
+
+  EXPECT_TRUE(ParseInChunks(json.substr(1, json.length() - 2), 64));
+}
+
+TEST(JSONStreamReaderTest, DelegateStopsParsing) {
+  ValueBuilder builder;
+  builder.set_max_values(2);
+  JSONStreamReader reader(&builder);
+  EXPECT_FALSE(reader.Feed("[1, 2, 3, 4]"));
+  EXPECT_EQ(2, builder.num_values());
+  EXPECT_TRUE(reader.GetErrorMessage().empty());
+  EXPECT_FALSE(reader.Feed("5"));
+  EXPECT_FALSE(reader.Finish());
+}
+
+TEST(JSONStreamReaderTest, ReadFile) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath path = temp_dir.GetPath().AppendASCII("test.json");
+
+  // Spans several chunks.
+  Value::List list;
+  const std::string long_string(JSONStreamReader::kFileChunkSize / 3, 'x');
+  for (int i = 0; i < 10; ++i)
+    list.Append(long_string);
+  std::string json = "[";
+  for (size_t i = 0; i < list.size(); ++i)
+    json += (i ? ",\"" : "\"") + long_string + "\"";
+  json += "]";
+  ASSERT_TRUE(WriteFile(path, json));
+
+  File file(path, File::FLAG_OPEN | File::FLAG_READ);
+  ASSERT_TRUE(file.IsValid());
+  ValueBuilder builder;
+  JSONStreamReader reader(&builder);
+  EXPECT_TRUE(reader.ReadFile(&file));
+  ASSERT_TRUE(builder.root());
+  EXPECT_EQ(Value(std::move(list)), *builder.root());
+}
+
+}  // namespace base
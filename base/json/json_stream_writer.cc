@@ -0,0 +1,175 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_writer.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/check_op.h"
+#include "base/containers/span.h"
+#include "base/files/file.h"
+#include "base/json/json_writer.h"
+#include "base/json/string_escape.h"
+#include "base/strings/string_number_conversions.h"
+
+namespace base {
+
+namespace {
+
+bool WriteToFile(File* file, StringPiece data) {
+  return file->WriteAtCurrentPosAndCheck(as_bytes(make_span(data)));
+}
+
+}  // namespace
+
+// static
+JSONStreamWriter::Sink JSONStreamWriter::FileSink(File* file) {
+  DCHECK(file);
+  return BindRepeating(&WriteToFile, Unretained(file));
+}
+
+JSONStreamWriter::JSONStreamWriter(Sink sink,
+                                   int options,
+                                   size_t buffer_size,
+                                   size_t max_depth)
+    : sink_(std::move(sink)),
+      options_(options),
+      buffer_size_(buffer_size),
+      max_depth_(max_depth) {
+  DCHECK(sink_);
+  DCHECK(!(options & JSONWriter::OPTIONS_PRETTY_PRINT));
+  CHECK_LE(max_depth, internal::kAbsoluteMaxDepth);
+  buffer_.reserve(buffer_size_);
+}
+
+JSONStreamWriter::~JSONStreamWriter() = default;
+
+void JSONStreamWriter::BeginDict() {
+  BeginValue();
+  // Same limit as JSONWriter.
+  if (stack_.size() + 1 >= max_depth_)
+    failed_ = true;
+  buffer_.push_back('{');
+  stack_.push_back(true);
+  has_element_ = false;
+}
+
+void JSONStreamWriter::EndDict() {
+  DCHECK(!stack_.empty());
+  DCHECK(stack_.back());
+  DCHECK(!expect_value_);
+  buffer_.push_back('}');
+  stack_.pop_back();
+  has_element_ = true;
+  MaybeFlush();
+}
+
+void JSONStreamWriter::BeginList() {
+  BeginValue();
+  if (stack_.size() + 1 >= max_depth_)
+    failed_ = true;
+  buffer_.push_back('[');
+  stack_.push_back(false);
+  has_element_ = false;
+}
+
+void JSONStreamWriter::EndList() {
+  DCHECK(!stack_.empty());
+  DCHECK(!stack_.back());
+  buffer_.push_back(']');
+  stack_.pop_back();
+  has_element_ = true;
+  MaybeFlush();
+}
+
+void JSONStreamWriter::AppendKey(StringPiece key) {
+  DCHECK(!stack_.empty());
+  DCHECK(stack_.back());
+  DCHECK(!expect_value_);
+  if (has_element_)
+    buffer_.push_back(',');
+  EscapeJSONString(key, true, &buffer_);
+  buffer_.push_back(':');
+  expect_value_ = true;
+}
+
+void JSONStreamWriter::AppendNull() {
+  BeginValue();
+  buffer_.append("null");
+  MaybeFlush();
+}
+
+void JSONStreamWriter::AppendBool(bool value) {
+  BeginValue();
+  buffer_.append(value ? "true" : "false");
+  MaybeFlush();
+}
+
+void JSONStreamWriter::AppendInt(int value) {
+  BeginValue();
+  buffer_.append(NumberToString(value));
+  MaybeFlush();
+}
+
+void JSONStreamWriter::AppendDouble(double value) {
+  // Doubles are formatted by JSONWriter, which takes care of the options.
+  AppendValue(value);
+}
+
+void JSONStreamWriter::AppendString(StringPiece value) {
+  BeginValue();
+  EscapeJSONString(value, true, &buffer_);
+  MaybeFlush();
+}
+
+void JSONStreamWriter::AppendValue(ValueView value) {
+  BeginValue();
+  if (failed_)
+    return;
+  // An omitted binary value leaves |value_json_| empty, which would make the
+  // document invalid.
+  if (!JSONWriter::WriteWithOptions(value, options_, &value_json_,
+                                    max_depth_ - stack_.size()) ||
+      value_json_.empty()) {
+    failed_ = true;
+    return;
+  }
+  buffer_.append(value_json_);
+  MaybeFlush();
+}
+
+bool JSONStreamWriter::Finish() {
+  const bool complete = has_root_ && stack_.empty();
+  Flush();
+  return complete && !failed_;
+}
+
+void JSONStreamWriter::BeginValue() {
+  if (stack_.empty()) {
+    DCHECK(!has_root_);
+    has_root_ = true;
+    return;
+  }
+  if (stack_.back()) {
+    DCHECK(expect_value_);
+    expect_value_ = false;
+  } else if (has_element_) {
+    buffer_.push_back(',');
+  }
+  has_element_ = true;
+}
+
+void JSONStreamWriter::MaybeFlush() {
+  if (buffer_.size() >= buffer_size_)
+    Flush();
+}
+
+void JSONStreamWriter::Flush() {
+  if (!failed_ && !buffer_.empty())
+    failed_ = !sink_.Run(buffer_);
+  buffer_.clear();
+}
+
+}  // namespace base
@@ -0,0 +1,128 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_JSON_JSON_STREAM_WRITER_H_
+#define BASE_JSON_JSON_STREAM_WRITER_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/callback.h"
+#include "base/json/json_common.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+class File;
+
+// Writes a JSON document incrementally, one element at a time, to a sink
+// which receives the output in chunks of about |buffer_size| bytes. Unlike
+// JSONWriter, neither the document nor its output need to be in memory at
+// once.
+//
+// The methods must be called in an order which produces a valid document;
+// this is DCHECKed. Whole Values can be written with AppendValue(), which
+// formats them like JSONWriter.
+//
+// Usage:
+//   JSONStreamWriter writer(JSONStreamWriter::FileSink(&file));
+//   writer.BeginDict();
+//   writer.AppendKey("entries");
+//   writer.BeginList();
+//   for (const Entry& entry : entries)
+//     writer.AppendValue(entry.ToValue());
+//   writer.EndList();
+//   writer.EndDict();
+//   if (!writer.Finish())
+//     return Fail();
+class BASE_EXPORT JSONStreamWriter {
+ public:
+  // Receives the next chunk of output. Returns false on failure, after which
+  // the output is dropped and Finish() returns false.
+  using Sink = RepeatingCallback<bool(StringPiece)>;
+
+  static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+  // Returns a Sink which writes to |file|, which must outlive the sink.
+  static Sink FileSink(File* file);
+
+  // |options| are JSONWriter::Options, except OPTIONS_PRETTY_PRINT which is
+  // not supported.
+  explicit JSONStreamWriter(Sink sink,
+                            int options = 0,
+                            size_t buffer_size = kDefaultBufferSize,
+                            size_t max_depth = internal::kAbsoluteMaxDepth);
+
+  JSONStreamWriter(const JSONStreamWriter&) = delete;
+  JSONStreamWriter& operator=(const JSONStreamWriter&) = delete;
+
+  // Output which was not flushed by Finish() is dropped.
+  ~JSONStreamWriter();
+
+  void BeginDict();
+  void EndDict();
+  void BeginList();
+  void EndList();
+
+  // Writes the key of the next dictionary entry, which must be followed by
+  // its value.
+  void AppendKey(StringPiece key);
+
+  void AppendNull();
+  void AppendBool(bool value);
+  void AppendInt(int value);
+  void AppendDouble(double value);
+  void AppendString(StringPiece value);
+
+  // Writes |value| and all of its children.
+  void AppendValue(ValueView value);
+
+  // Flushes the output to the sink. Returns false if the document is
+  // incomplete, if a value could not be written (see JSONWriter::Write()), or
+  // if the sink failed.
+  bool Finish();
+
+ private:
+  // Writes the separator needed before the next value, if any.
+  void BeginValue();
+
+  // Flushes the buffer if it is full.
+  void MaybeFlush();
+  void Flush();
+
+  const Sink sink_;
+  const int options_;
+  const size_t buffer_size_;
+  const size_t max_depth_;
+
+  // The output which was not flushed to |sink_| yet.
+  std::string buffer_;
+
+  // Scratch space for values formatted by JSONWriter.
+  std::string value_json_;
+
+  // For each open container, whether it is a dictionary.
+  std::vector<bool> stack_;
+
+  // Whether the innermost container has an element, i.e. the next one must be
+  // preceded by a comma.
+  bool has_element_ = false;
+
+  // Whether a key was written and its value was not.
+  bool expect_value_ = false;
+
+  // Whether the root value was written.
+  bool has_root_ = false;
+
+  // Whether a value could not be written, or |sink_| failed.
+  bool failed_ = false;
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_STREAM_WRITER_H_
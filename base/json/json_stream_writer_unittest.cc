@@ -0,0 +1,189 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_writer.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_writer.h"
+#include "base/strings/string_piece.h"
+#include "base/test/bind.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Returns a sink which appends its chunks to |chunks|.
+JSONStreamWriter::Sink VectorSink(std::vector<std::string>* chunks) {
+  return BindLambdaForTesting([chunks](StringPiece chunk) {
+    chunks->emplace_back(chunk);
+    return true;
+  });
+}
+
+std::string Join(const std::vector<std::string>& chunks) {
+  std::string result;
+  for (const std::string& chunk : chunks)
+    result += chunk;
+  return result;
+}
+
+}  // namespace
+
+TEST(JSONStreamWriterTest, MatchesJSONWriter) {
+  Value::Dict nested;
+  nested.Set("list", Value::List());
+  nested.Set("string", "a\"b\\c\n");
+
+  Value::List list;
+  list.Append(1);
+  list.Append(nested.Clone());
+  list.Append(Value::Dict());
+
+  Value::Dict dict;
+  dict.Set("bool", true);
+  dict.Set("double", 0.5);
+  dict.Set("int", 42);
+  dict.Set("integral_double", 2.0);
+  dict.Set("list", std::move(list));
+  dict.Set("null", Value());
+  dict.Set("string", "\xc3\xa9");
+  dict.Set("value", nested.Clone());
+  std::string expected;
+  ASSERT_TRUE(JSONWriter::Write(dict, &expected));
+
+  // Written in the same order as JSONWriter, which sorts keys.
+  std::vector<std::string> chunks;
+  JSONStreamWriter writer(VectorSink(&chunks));
+  writer.BeginDict();
+  writer.AppendKey("bool");
+  writer.AppendBool(true);
+  writer.AppendKey("double");
+  writer.AppendDouble(0.5);
+  writer.AppendKey("int");
+  writer.AppendInt(42);
+  writer.AppendKey("integral_double");
+  writer.AppendDouble(2.0);
+  writer.AppendKey("list");
+  writer.BeginList();
+  writer.AppendInt(1);
+  writer.BeginDict();
+  writer.AppendKey("list");
+  writer.BeginList();
+  writer.EndList();
+  writer.AppendKey("string");
+  writer.AppendString("a\"b\\c\n");
+  writer.EndDict();
+  writer.BeginDict();
+  writer.EndDict();
+  writer.EndList();
+  writer.AppendKey("null");
+  writer.AppendNull();
+  writer.AppendKey("string");
+  writer.AppendString("\xc3\xa9");
+  writer.AppendKey("value");
+  writer.AppendValue(nested);
+  writer.EndDict();
+
+  // Nothing is written before the buffer is full.
+  EXPECT_TRUE(chunks.empty());
+  EXPECT_TRUE(writer.Finish());
+  EXPECT_EQ(expected, Join(chunks));
+}
+
+TEST(JSONStreamWriterTest, FlushesWhenBufferIsFull) {
+  constexpr size_t kBufferSize = 16;
+  std::vector<std::string> chunks;
+  JSONStreamWriter writer(VectorSink(&chunks), /*options=*/0, kBufferSize);
+  writer.BeginList();
+  for (int i = 0; i < 100; ++i)
+    writer.AppendInt(i);
+  writer.EndList();
+  EXPECT_TRUE(writer.Finish());
+
+  EXPECT_GT(chunks.size(), 10u);
+  for (const std::string& chunk : chunks)
+    EXPECT_LT(chunk.size(), 2 * kBufferSize);
+
+  Value::List expected;
+  for (int i = 0; i < 100; ++i)
+    expected.Append(i);
+  std::string json;
+  ASSERT_TRUE(JSONWriter::Write(expected, &json));
+  EXPECT_EQ(json, Join(chunks));
+}
+
+TEST(JSONStreamWriterTest, Failures) {
+  std::vector<std::string> chunks;
+  {
+    // Incomplete document.
+    JSONStreamWriter writer(VectorSink(&chunks));
+    writer.BeginList();
+    EXPECT_FALSE(writer.Finish());
+  }
+  {
+    // Binary values can't be written, even when omitted by JSONWriter.
+    JSONStreamWriter writer(VectorSink(&chunks),
+                            JSONWriter::OPTIONS_OMIT_BINARY_VALUES);
+    writer.BeginList();
+    writer.AppendValue(Value(Value::BlobStorage({1, 2})));
+    writer.EndList();
+    EXPECT_FALSE(writer.Finish());
+  }
+  {
+    // Too much nesting.
+    JSONStreamWriter writer(VectorSink(&chunks), /*options=*/0,
+                            JSONStreamWriter::kDefaultBufferSize,
+                            /*max_depth=*/2);
+    writer.BeginList();
+    writer.BeginList();
+    writer.EndList();
+    writer.EndList();
+    EXPECT_FALSE(writer.Finish());
+  }
+  EXPECT_TRUE(chunks.empty());
+
+  // The sink fails.
+  int num_writes = 0;
+  JSONStreamWriter writer(BindLambdaForTesting([&](StringPiece chunk) {
+                            ++num_writes;
+                            return false;
+                          }),
+                          /*options=*/0, /*buffer_size=*/1);
+  writer.BeginList();
+  writer.AppendInt(1);
+  writer.EndList();
+  EXPECT_FALSE(writer.Finish());
+  EXPECT_EQ(1, num_writes);
+}
+
+TEST(JSONStreamWriterTest, FileSink) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath path = temp_dir.GetPath().AppendASCII("test.json");
+  File file(path, File::FLAG_CREATE | File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+
+  JSONStreamWriter writer(JSONStreamWriter::FileSink(&file));
+  writer.BeginDict();
+  writer.AppendKey("key");
+  writer.AppendString("value");
+  writer.EndDict();
+  EXPECT_TRUE(writer.Finish());
+  file.Close();
+
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(path, &contents));
+  EXPECT_EQ("{\"key\":\"value\"}", contents);
+}
+
+}  // namespace base
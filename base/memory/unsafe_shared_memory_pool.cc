@@ -4,25 +4,96 @@
 
 #include "base/memory/unsafe_shared_memory_pool.h"
 
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/bits.h"
+#include "base/callback_helpers.h"
 #include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "build/build_config.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 
-namespace {
-constexpr size_t kMaxStoredBuffers = 32;
-}  // namespace
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+#include <sched.h>
+
+#include "base/system/cpu_topology_linux.h"
+#endif
 
 namespace base {
 
-UnsafeSharedMemoryPool::UnsafeSharedMemoryPool() = default;
+namespace {
+
+constexpr int kMinPooledSizeLog2 = 12;
+constexpr int kMaxPooledSizeLog2 = 26;
+constexpr size_t kNumSizeClasses = kMaxPooledSizeLog2 - kMinPooledSizeLog2 + 1;
+static_assert(UnsafeSharedMemoryPool::kMinPooledSize ==
+                  size_t{1} << kMinPooledSizeLog2,
+              "");
+static_assert(UnsafeSharedMemoryPool::kMaxPooledSize ==
+                  size_t{1} << kMaxPooledSizeLog2,
+              "");
+
+// Regions which weren't reused for this long are freed on moderate memory
+// pressure.
+constexpr TimeDelta kModeratePressureMinIdleTime = Seconds(10);
+
+// Regions which weren't reused for this long are freed as other regions are
+// returned, at most once per this interval.
+constexpr TimeDelta kIdleTrimInterval = Seconds(30);
+
+// Returns the smallest size class which fits |size|, or nullopt if |size| is
+// too big to be pooled.
+absl::optional<size_t> GetSizeClass(size_t size) {
+  if (size > UnsafeSharedMemoryPool::kMaxPooledSize)
+    return absl::nullopt;
+  size = std::max(size, UnsafeSharedMemoryPool::kMinPooledSize);
+  return bits::Log2Ceiling(static_cast<uint32_t>(size)) - kMinPooledSizeLog2;
+}
+
+size_t GetSizeOfClass(size_t size_class) {
+  return UnsafeSharedMemoryPool::kMinPooledSize << size_class;
+}
+
+}  // namespace
 
-UnsafeSharedMemoryPool::~UnsafeSharedMemoryPool() = default;
+UnsafeSharedMemoryPool::UnsafeSharedMemoryPool()
+    : next_idle_trim_time_(TimeTicks::Now() + kIdleTrimInterval) {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  const absl::optional<CpuTopology>& topology = GetCpuTopology();
+  if (topology && topology->nodes.size() > 1) {
+    num_nodes_ = topology->nodes.size();
+    for (size_t node = 0; node < num_nodes_; node++) {
+      for (int cpu : topology->nodes[node]) {
+        if (static_cast<size_t>(cpu) >= node_of_cpu_.size())
+          node_of_cpu_.resize(cpu + 1);
+        node_of_cpu_[cpu] = node;
+      }
+    }
+  }
+#endif
+  free_lists_ = std::make_unique<FreeList[]>(num_nodes_ * kNumSizeClasses);
+  memory_pressure_listener_ = std::make_unique<MemoryPressureListener>(
+      FROM_HERE, DoNothing(),
+      BindRepeating(&UnsafeSharedMemoryPool::OnMemoryPressure,
+                    Unretained(this)));
+}
+
+UnsafeSharedMemoryPool::~UnsafeSharedMemoryPool() {
+  memory_pressure_listener_.reset();
+  for (size_t i = 0; i < num_nodes_ * kNumSizeClasses; i++)
+    TrimFreeList(free_lists_[i], TimeTicks::Max());
+}
 
 UnsafeSharedMemoryPool::Handle::Handle(
     PassKey<UnsafeSharedMemoryPool>,
     UnsafeSharedMemoryRegion region,
     WritableSharedMemoryMapping mapping,
+    size_t node,
     scoped_refptr<UnsafeSharedMemoryPool> pool)
     : region_(std::move(region)),
       mapping_(std::move(mapping)),
+      node_(node),
       pool_(std::move(pool)) {
   CHECK(pool_);
   DCHECK(region_.IsValid());
@@ -30,7 +101,7 @@ UnsafeSharedMemoryPool::Handle::Handle(
 }
 
 UnsafeSharedMemoryPool::Handle::~Handle() {
-  pool_->ReleaseBuffer(std::move(region_), std::move(mapping_));
+  pool_->ReleaseBuffer(std::move(region_), std::move(mapping_), node_);
 }
 
 const UnsafeSharedMemoryRegion& UnsafeSharedMemoryPool::Handle::GetRegion()
@@ -45,29 +116,30 @@ const WritableSharedMemoryMapping& UnsafeSharedMemoryPool::Handle::GetMapping()
 
 std::unique_ptr<UnsafeSharedMemoryPool::Handle>
 UnsafeSharedMemoryPool::MaybeAllocateBuffer(size_t region_size) {
-  AutoLock lock(lock_);
-
-  DCHECK_GE(region_size, 0u);
-  if (is_shutdown_)
+  if (is_shutdown_.load(std::memory_order_relaxed))
     return nullptr;
 
-  // Only change the configured size if bigger region is requested to avoid
-  // unncecessary reallocations.
-  if (region_size > region_size_) {
-    regions_.clear();
-    region_size_ = region_size;
-  }
-  if (!regions_.empty()) {
-    auto region = std::move(regions_.back());
-    regions_.pop_back();
-    DCHECK_GE(region.first.GetSize(), region_size_);
-    auto handle = std::make_unique<Handle>(PassKey<UnsafeSharedMemoryPool>(),
-                                           std::move(region.first),
-                                           std::move(region.second), this);
-    return handle;
+  const size_t node = GetCurrentNode();
+  const absl::optional<size_t> size_class = GetSizeClass(region_size);
+  if (size_class) {
+    region_size = GetSizeOfClass(*size_class);
+    // Prefer a region created on the current node, but a region from another
+    // node is still cheaper than creating one.
+    for (size_t i = 0; i < num_nodes_; i++) {
+      const size_t pooled_node = (node + i) % num_nodes_;
+      std::unique_ptr<PooledRegion> pooled =
+          TakeRegion(GetFreeList(pooled_node, *size_class));
+      if (!pooled)
+        continue;
+      DCHECK_EQ(pooled->region.GetSize(), region_size);
+      reused_count_.fetch_add(1, std::memory_order_relaxed);
+      return std::make_unique<Handle>(
+          PassKey<UnsafeSharedMemoryPool>(), std::move(pooled->region),
+          std::move(pooled->mapping), pooled_node, this);
+    }
   }
 
-  auto region = UnsafeSharedMemoryRegion::Create(region_size_);
+  auto region = UnsafeSharedMemoryRegion::Create(region_size);
   if (!region.IsValid())
     return nullptr;
 
@@ -75,33 +147,183 @@ UnsafeSharedMemoryPool::MaybeAllocateBuffer(size_t region_size) {
   if (!mapping.IsValid())
     return nullptr;
 
+  created_count_.fetch_add(1, std::memory_order_relaxed);
   return std::make_unique<Handle>(PassKey<UnsafeSharedMemoryPool>(),
-                                  std::move(region), std::move(mapping), this);
+                                  std::move(region), std::move(mapping), node,
+                                  this);
 }
 
 void UnsafeSharedMemoryPool::Shutdown() {
-  AutoLock lock(lock_);
-  DCHECK(!is_shutdown_);
-  is_shutdown_ = true;
-  regions_.clear();
+  const bool was_shutdown = is_shutdown_.exchange(true);
+  DCHECK(!was_shutdown);
+  for (size_t i = 0; i < num_nodes_ * kNumSizeClasses; i++)
+    TrimFreeList(free_lists_[i], TimeTicks::Max());
+}
+
+void UnsafeSharedMemoryPool::TrimIdleRegions(TimeDelta min_idle_time) {
+  const TimeTicks cutoff_time = TimeTicks::Now() - min_idle_time;
+  for (size_t i = 0; i < num_nodes_ * kNumSizeClasses; i++)
+    TrimFreeList(free_lists_[i], cutoff_time);
+}
+
+UnsafeSharedMemoryPool::Stats UnsafeSharedMemoryPool::GetStats() const {
+  Stats stats;
+  stats.reused_count = reused_count_.load(std::memory_order_relaxed);
+  stats.created_count = created_count_.load(std::memory_order_relaxed);
+  stats.returned_count = returned_count_.load(std::memory_order_relaxed);
+  stats.dropped_count = dropped_count_.load(std::memory_order_relaxed);
+  stats.trimmed_count = trimmed_count_.load(std::memory_order_relaxed);
+  stats.pooled_bytes = pooled_bytes_.load(std::memory_order_relaxed);
+  return stats;
 }
 
 void UnsafeSharedMemoryPool::ReleaseBuffer(
     UnsafeSharedMemoryRegion region,
-    WritableSharedMemoryMapping mapping) {
-  AutoLock lock(lock_);
-  // Only return regions which are at least as big as the current configuration.
-  if (is_shutdown_ || regions_.size() >= kMaxStoredBuffers ||
-      !region.IsValid() || region.GetSize() < region_size_) {
-    DLOG(WARNING) << "Not returning SharedMemoryRegion to the pool:"
-                  << " is_shutdown: " << (is_shutdown_ ? "true" : "false")
-                  << " stored regions: " << regions_.size()
-                  << " configured size: " << region_size_
-                  << " this region size: " << region.GetSize()
-                  << " valid: " << (region.IsValid() ? "true" : "false");
+    WritableSharedMemoryMapping mapping,
+    size_t node) {
+  const size_t region_size = region.GetSize();
+  const absl::optional<size_t> size_class = GetSizeClass(region_size);
+  // Only return regions which have the size of their class, which excludes
+  // the ones too big to be pooled.
+  if (is_shutdown_.load() || !region.IsValid() || !size_class ||
+      GetSizeOfClass(*size_class) != region_size) {
+    DVLOG(1) << "Not returning SharedMemoryRegion to the pool:"
+             << " is_shutdown: " << (is_shutdown_.load() ? "true" : "false")
+             << " this region size: " << region_size
+             << " valid: " << (region.IsValid() ? "true" : "false");
+    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto pooled = std::make_unique<PooledRegion>();
+  pooled->region = std::move(region);
+  pooled->mapping = std::move(mapping);
+  const TimeTicks now = TimeTicks::Now();
+  pooled->returned_time = now;
+  FreeList& free_list = GetFreeList(node, *size_class);
+  if (!AddToFreeList(free_list, std::move(pooled))) {
+    DVLOG(1) << "Not returning SharedMemoryRegion to the pool: size class of "
+             << region_size << " bytes or pool is full";
+    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    returned_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Shutdown() may have emptied the pool since |is_shutdown_| was checked.
+  if (is_shutdown_.load()) {
+    TrimFreeList(free_list, TimeTicks::Max());
+    return;
+  }
+  MaybeTrimIdleRegions(now);
+}
+
+size_t UnsafeSharedMemoryPool::GetCurrentNode() const {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (node_of_cpu_.empty())
+    return 0;
+  const int cpu = sched_getcpu();
+  if (cpu < 0 || static_cast<size_t>(cpu) >= node_of_cpu_.size())
+    return 0;
+  return node_of_cpu_[cpu];
+#else
+  return 0;
+#endif
+}
+
+UnsafeSharedMemoryPool::FreeList& UnsafeSharedMemoryPool::GetFreeList(
+    size_t node,
+    size_t size_class) {
+  DCHECK_LT(node, num_nodes_);
+  DCHECK_LT(size_class, kNumSizeClasses);
+  return free_lists_[node * kNumSizeClasses + size_class];
+}
+
+bool UnsafeSharedMemoryPool::AddToFreeList(
+    FreeList& free_list,
+    std::unique_ptr<PooledRegion> pooled) {
+  const size_t region_size = pooled->region.GetSize();
+  // Counted before the region can be taken, so that |pooled_bytes_| doesn't
+  // underflow. This also reserves room for the region under
+  // |kMaxPooledBytes|.
+  size_t pooled_bytes = pooled_bytes_.load(std::memory_order_relaxed);
+  do {
+    if (region_size > kMaxPooledBytes - pooled_bytes)
+      return false;
+  } while (!pooled_bytes_.compare_exchange_weak(pooled_bytes,
+                                                pooled_bytes + region_size,
+                                                std::memory_order_relaxed));
+  for (auto& slot : free_list.slots) {
+    if (slot.load(std::memory_order_relaxed))
+      continue;
+    PooledRegion* expected = nullptr;
+    if (slot.compare_exchange_strong(expected, pooled.get())) {
+      pooled.release();
+      return true;
+    }
+  }
+  pooled_bytes_.fetch_sub(region_size, std::memory_order_relaxed);
+  return false;
+}
+
+std::unique_ptr<UnsafeSharedMemoryPool::PooledRegion>
+UnsafeSharedMemoryPool::TakeRegion(FreeList& free_list) {
+  for (auto& slot : free_list.slots) {
+    if (!slot.load(std::memory_order_relaxed))
+      continue;
+    PooledRegion* pooled = slot.exchange(nullptr);
+    if (pooled) {
+      pooled_bytes_.fetch_sub(pooled->region.GetSize(),
+                              std::memory_order_relaxed);
+      return WrapUnique(pooled);
+    }
+  }
+  return nullptr;
+}
+
+void UnsafeSharedMemoryPool::TrimFreeList(FreeList& free_list,
+                                          TimeTicks cutoff_time) {
+  // Regions which aren't idle are put back. They can't be inspected in place,
+  // as another thread may take and free them meanwhile.
+  std::vector<std::unique_ptr<PooledRegion>> recent;
+  while (std::unique_ptr<PooledRegion> pooled = TakeRegion(free_list)) {
+    if (pooled->returned_time > cutoff_time) {
+      recent.push_back(std::move(pooled));
+      continue;
+    }
+    trimmed_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  for (auto& pooled : recent) {
+    if (!AddToFreeList(free_list, std::move(pooled)))
+      dropped_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void UnsafeSharedMemoryPool::MaybeTrimIdleRegions(TimeTicks now) {
+  TimeTicks next_idle_trim_time =
+      next_idle_trim_time_.load(std::memory_order_relaxed);
+  if (now < next_idle_trim_time)
+    return;
+  // Only one of the threads which get here trims the pool.
+  if (!next_idle_trim_time_.compare_exchange_strong(
+          next_idle_trim_time, now + kIdleTrimInterval,
+          std::memory_order_relaxed)) {
     return;
   }
-  regions_.emplace_back(std::move(region), std::move(mapping));
+  TrimIdleRegions(kIdleTrimInterval);
+}
+
+void UnsafeSharedMemoryPool::OnMemoryPressure(
+    MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  switch (memory_pressure_level) {
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE:
+      break;
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE:
+      TrimIdleRegions(kModeratePressureMinIdleTime);
+      break;
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL:
+      TrimIdleRegions(TimeDelta());
+      break;
+  }
 }
 
 }  // namespace base
@@ -5,24 +5,36 @@
 #ifndef BASE_MEMORY_UNSAFE_SHARED_MEMORY_POOL_H_
 #define BASE_MEMORY_UNSAFE_SHARED_MEMORY_POOL_H_
 
+#include <stddef.h>
+
+#include <array>
+#include <atomic>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "base/base_export.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/unsafe_shared_memory_region.h"
-#include "base/synchronization/lock.h"
+#include "base/time/time.h"
 #include "base/types/pass_key.h"
 
 namespace base {
 
 // UnsafeSharedMemoryPool manages allocation and pooling of
 // UnsafeSharedMemoryRegions. Using pool saves cost of repeated shared memory
-// allocations. Up-to 32 regions would be pooled. It is thread-safe. May return
-// bigger regions than requested. If a requested size is increased, all stored
-// regions are purged. Regions are returned to the buffer on destruction of
-// |SharedMemoryHandle| if they are of a correct size.
+// allocations. It is thread-safe. Requested sizes are rounded up to a power of
+// two size class, so regions of different sizes can be pooled together, and
+// bigger regions than requested are returned. Up-to 32 regions of each size
+// class would be pooled, and at most |kMaxPooledBytes| in total. Regions are
+// returned to the pool on destruction of |Handle|.
+//
+// Pooled regions are kept in lock-free free lists, one per size class and NUMA
+// node. A region is reused on the NUMA node where it was created if possible,
+// as its pages were likely first touched there. Pooled regions which aren't
+// reused are freed as other regions are returned to the pool, and on memory
+// pressure.
 class BASE_EXPORT UnsafeSharedMemoryPool
     : public RefCountedThreadSafe<UnsafeSharedMemoryPool> {
  public:
@@ -33,6 +45,7 @@ class BASE_EXPORT UnsafeSharedMemoryPool
     Handle(PassKey<UnsafeSharedMemoryPool>,
            UnsafeSharedMemoryRegion region,
            WritableSharedMemoryMapping mapping,
+           size_t node,
            scoped_refptr<UnsafeSharedMemoryPool> pool);
 
     ~Handle();
@@ -47,9 +60,38 @@ class BASE_EXPORT UnsafeSharedMemoryPool
    private:
     UnsafeSharedMemoryRegion region_;
     WritableSharedMemoryMapping mapping_;
+    // NUMA node on which the region was created.
+    size_t node_;
     scoped_refptr<UnsafeSharedMemoryPool> pool_;
   };
 
+  // Counts of the pool operations since its creation, to measure how often
+  // regions are reused.
+  struct Stats {
+    // Allocations served with a pooled region.
+    size_t reused_count = 0;
+    // Allocations which created a new region.
+    size_t created_count = 0;
+    // Regions returned to the pool.
+    size_t returned_count = 0;
+    // Regions freed when released, because the pool was full or shut down, or
+    // their size isn't pooled.
+    size_t dropped_count = 0;
+    // Pooled regions freed by TrimIdleRegions(), memory pressure or
+    // Shutdown().
+    size_t trimmed_count = 0;
+    // Size of the regions currently in the pool.
+    size_t pooled_bytes = 0;
+  };
+
+  // Smallest and biggest pooled size classes. Regions bigger than
+  // |kMaxPooledSize| are created with the requested size and never pooled.
+  static constexpr size_t kMinPooledSize = 4096;
+  static constexpr size_t kMaxPooledSize = 64 * 1024 * 1024;
+  // Limit on the total size of the pooled regions, across size classes and
+  // NUMA nodes. Returned regions which would exceed it are freed.
+  static constexpr size_t kMaxPooledBytes = 128 * 1024 * 1024;
+
   UnsafeSharedMemoryPool();
   // Disallow copy and assign.
   UnsafeSharedMemoryPool(const UnsafeSharedMemoryPool&) = delete;
@@ -63,21 +105,86 @@ class BASE_EXPORT UnsafeSharedMemoryPool
   // outstanding ones as they are returned.
   void Shutdown();
 
+  // Frees the pooled regions which were returned to the pool at least
+  // |min_idle_time| ago. This is done periodically as regions are returned,
+  // and on memory pressure, with a zero |min_idle_time| when it is critical.
+  void TrimIdleRegions(TimeDelta min_idle_time);
+
+  Stats GetStats() const;
+
  private:
   friend class RefCountedThreadSafe<UnsafeSharedMemoryPool>;
+
+  static constexpr size_t kMaxStoredBuffers = 32;
+
+  // A region in the pool.
+  struct PooledRegion {
+    UnsafeSharedMemoryRegion region;
+    WritableSharedMemoryMapping mapping;
+    TimeTicks returned_time;
+  };
+
+  // Pooled regions of one size class on one NUMA node. A region is stored in
+  // any empty slot and taken from any full slot with a single atomic
+  // operation, so neither needs a lock. Unlike a linked free list, this isn't
+  // subject to the ABA problem.
+  struct FreeList {
+    std::array<std::atomic<PooledRegion*>, kMaxStoredBuffers> slots = {};
+  };
+
   ~UnsafeSharedMemoryPool();
 
   void ReleaseBuffer(UnsafeSharedMemoryRegion region,
-                     WritableSharedMemoryMapping mapping);
-
-  Lock lock_;
-  // All shared memory regions cached internally are guaranteed to be
-  // at least `region_size_` bytes in size.
-  size_t region_size_ GUARDED_BY(lock_) = 0u;
-  // Cached unused regions and their mappings.
-  std::vector<std::pair<UnsafeSharedMemoryRegion, WritableSharedMemoryMapping>>
-      regions_ GUARDED_BY(lock_);
-  bool is_shutdown_ GUARDED_BY(lock_) = false;
+                     WritableSharedMemoryMapping mapping,
+                     size_t node);
+
+  // Returns the NUMA node of the CPU the current thread runs on.
+  size_t GetCurrentNode() const;
+
+  FreeList& GetFreeList(size_t node, size_t size_class);
+
+  // Stores |pooled| in an empty slot of |free_list|. Returns false and frees
+  // |pooled| if |free_list| is full, or if the pool would exceed
+  // |kMaxPooledBytes|.
+  bool AddToFreeList(FreeList& free_list,
+                     std::unique_ptr<PooledRegion> pooled);
+
+  // Takes a region out of |free_list|, or returns null if it is empty.
+  std::unique_ptr<PooledRegion> TakeRegion(FreeList& free_list);
+
+  // Frees the regions of |free_list| returned at or before |cutoff_time|.
+  void TrimFreeList(FreeList& free_list, TimeTicks cutoff_time);
+
+  // Calls TrimIdleRegions() if it wasn't done by this function for a while.
+  void MaybeTrimIdleRegions(TimeTicks now);
+
+  void OnMemoryPressure(
+      MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
+
+  // Index in |node_of_cpu_| is the CPU number. Empty if the NUMA topology is
+  // unknown, in which case there is a single node.
+  std::vector<size_t> node_of_cpu_;
+  size_t num_nodes_ = 1;
+
+  // |num_nodes_| free lists for each size class, grouped by node.
+  std::unique_ptr<FreeList[]> free_lists_;
+
+  std::atomic<bool> is_shutdown_{false};
+
+  std::atomic<size_t> reused_count_{0};
+  std::atomic<size_t> created_count_{0};
+  std::atomic<size_t> returned_count_{0};
+  std::atomic<size_t> dropped_count_{0};
+  std::atomic<size_t> trimmed_count_{0};
+  std::atomic<size_t> pooled_bytes_{0};
+
+  // When MaybeTrimIdleRegions() should trim the pool next.
+  std::atomic<TimeTicks> next_idle_trim_time_;
+
+  // Trims the pool synchronously on memory pressure, so that it works on
+  // threads without a task runner, and so that the callback doesn't outlive
+  // the pool.
+  std::unique_ptr<MemoryPressureListener> memory_pressure_listener_;
 };
 
 }  // namespace base
@@ -4,6 +4,13 @@
 
 #include "base/memory/unsafe_shared_memory_pool.h"
 
+#include <memory>
+#include <vector>
+
+#include "base/memory/memory_pressure_listener.h"
+#include "base/test/task_environment.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -47,4 +54,205 @@ TEST(UnsafeSharedMemoryPoolTest, RespectsSize) {
   ASSERT_TRUE(handle);
   EXPECT_GE(handle->GetRegion().GetSize(), 1100u);
 }
+
+TEST(UnsafeSharedMemoryPoolTest, ReusesRegionsOfSameSizeClass) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  auto handle = pool->MaybeAllocateBuffer(5000u);
+  ASSERT_TRUE(handle);
+  EXPECT_EQ(8192u, handle->GetRegion().GetSize());
+  auto id1 = handle->GetRegion().GetGUID();
+  handle.reset();
+
+  handle = pool->MaybeAllocateBuffer(8000u);
+  ASSERT_TRUE(handle);
+  EXPECT_EQ(id1, handle->GetRegion().GetGUID());
+  EXPECT_EQ(1u, pool->GetStats().reused_count);
+}
+
+TEST(UnsafeSharedMemoryPoolTest, PoolsSizeClassesSeparately) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  auto small_handle = pool->MaybeAllocateBuffer(1000u);
+  auto big_handle = pool->MaybeAllocateBuffer(100000u);
+  ASSERT_TRUE(small_handle);
+  ASSERT_TRUE(big_handle);
+  auto small_id = small_handle->GetRegion().GetGUID();
+  auto big_id = big_handle->GetRegion().GetGUID();
+  small_handle.reset();
+  big_handle.reset();
+  EXPECT_EQ(4096u + 131072u, pool->GetStats().pooled_bytes);
+
+  // Neither size purges the regions of the other.
+  big_handle = pool->MaybeAllocateBuffer(100000u);
+  small_handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(small_handle);
+  ASSERT_TRUE(big_handle);
+  EXPECT_EQ(small_id, small_handle->GetRegion().GetGUID());
+  EXPECT_EQ(big_id, big_handle->GetRegion().GetGUID());
+
+  UnsafeSharedMemoryPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(2u, stats.created_count);
+  EXPECT_EQ(2u, stats.reused_count);
+  EXPECT_EQ(2u, stats.returned_count);
+  EXPECT_EQ(0u, stats.pooled_bytes);
+}
+
+TEST(UnsafeSharedMemoryPoolTest, DoesNotPoolBigRegions) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  const size_t size = UnsafeSharedMemoryPool::kMaxPooledSize + 1;
+  auto handle = pool->MaybeAllocateBuffer(size);
+  ASSERT_TRUE(handle);
+  EXPECT_EQ(size, handle->GetRegion().GetSize());
+  handle.reset();
+
+  UnsafeSharedMemoryPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(1u, stats.dropped_count);
+  EXPECT_EQ(0u, stats.pooled_bytes);
+}
+
+TEST(UnsafeSharedMemoryPoolTest, CapsPooledBytes) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  const size_t size = UnsafeSharedMemoryPool::kMaxPooledSize;
+  const size_t max_pooled_regions =
+      UnsafeSharedMemoryPool::kMaxPooledBytes / size;
+  std::vector<std::unique_ptr<UnsafeSharedMemoryPool::Handle>> handles;
+  for (size_t i = 0; i < max_pooled_regions + 1; i++) {
+    handles.push_back(pool->MaybeAllocateBuffer(size));
+    ASSERT_TRUE(handles.back());
+  }
+  handles.clear();
+
+  UnsafeSharedMemoryPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(max_pooled_regions, stats.returned_count);
+  EXPECT_EQ(1u, stats.dropped_count);
+  EXPECT_EQ(max_pooled_regions * size, stats.pooled_bytes);
+}
+
+TEST(UnsafeSharedMemoryPoolTest, TrimsIdleRegions) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  auto handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(handle);
+  handle.reset();
+
+  // The region was just returned.
+  pool->TrimIdleRegions(Hours(1));
+  EXPECT_EQ(4096u, pool->GetStats().pooled_bytes);
+
+  pool->TrimIdleRegions(TimeDelta());
+  UnsafeSharedMemoryPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(1u, stats.trimmed_count);
+  EXPECT_EQ(0u, stats.pooled_bytes);
+}
+
+// Regions which aren't reused are freed as other regions are returned.
+TEST(UnsafeSharedMemoryPoolTest, TrimsIdleRegionsPeriodically) {
+  test::TaskEnvironment task_environment(
+      test::TaskEnvironment::TimeSource::MOCK_TIME);
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  auto idle_handle = pool->MaybeAllocateBuffer(1000u);
+  auto handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(idle_handle);
+  ASSERT_TRUE(handle);
+  idle_handle.reset();
+
+  task_environment.FastForwardBy(Minutes(1));
+  handle.reset();
+  UnsafeSharedMemoryPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(1u, stats.trimmed_count);
+  EXPECT_EQ(4096u, stats.pooled_bytes);
+
+  // Trimming happens at most once per interval.
+  handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(handle);
+  task_environment.FastForwardBy(Seconds(1));
+  handle.reset();
+  EXPECT_EQ(1u, pool->GetStats().trimmed_count);
+}
+
+TEST(UnsafeSharedMemoryPoolTest, TrimsOnCriticalMemoryPressure) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  auto handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(handle);
+  handle.reset();
+
+  MemoryPressureListener::SimulatePressureNotification(
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL);
+  EXPECT_EQ(1u, pool->GetStats().trimmed_count);
+
+  handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(handle);
+  EXPECT_EQ(2u, pool->GetStats().created_count);
+}
+
+TEST(UnsafeSharedMemoryPoolTest, Shutdown) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  auto pooled_handle = pool->MaybeAllocateBuffer(1000u);
+  auto handle = pool->MaybeAllocateBuffer(1000u);
+  ASSERT_TRUE(pooled_handle);
+  ASSERT_TRUE(handle);
+  pooled_handle.reset();
+
+  pool->Shutdown();
+  EXPECT_FALSE(pool->MaybeAllocateBuffer(1000u));
+  EXPECT_EQ(0u, pool->GetStats().pooled_bytes);
+
+  // Outstanding regions are freed when returned.
+  handle.reset();
+  EXPECT_EQ(1u, pool->GetStats().dropped_count);
+  EXPECT_EQ(0u, pool->GetStats().pooled_bytes);
+}
+
+namespace {
+
+constexpr int kAllocationsPerThread = 1000;
+
+// Allocates and releases regions of a few size classes.
+class AllocatingThread : public SimpleThread {
+ public:
+  explicit AllocatingThread(scoped_refptr<UnsafeSharedMemoryPool> pool)
+      : SimpleThread("AllocatingThread"), pool_(std::move(pool)) {}
+
+ private:
+  // SimpleThread:
+  void Run() override {
+    for (int i = 0; i < kAllocationsPerThread; i++) {
+      auto handle = pool_->MaybeAllocateBuffer(1000u << (i % 4));
+      ASSERT_TRUE(handle);
+      static_cast<char*>(handle->GetMapping().memory())[0] = 1;
+    }
+  }
+
+  const scoped_refptr<UnsafeSharedMemoryPool> pool_;
+};
+
+}  // namespace
+
+TEST(UnsafeSharedMemoryPoolTest, ConcurrentAllocations) {
+  scoped_refptr<UnsafeSharedMemoryPool> pool(
+      base::MakeRefCounted<UnsafeSharedMemoryPool>());
+  constexpr int kNumThreads = 4;
+  std::vector<std::unique_ptr<AllocatingThread>> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(std::make_unique<AllocatingThread>(pool));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+
+  UnsafeSharedMemoryPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kAllocationsPerThread),
+            stats.created_count + stats.reused_count);
+  // All the regions were released.
+  EXPECT_EQ(stats.created_count + stats.reused_count,
+            stats.returned_count + stats.dropped_count);
+  EXPECT_LT(stats.created_count, stats.reused_count);
+}
+
 }  // namespace base
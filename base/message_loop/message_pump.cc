@@ -41,6 +41,13 @@ bool MessagePump::IsMessagePumpForUIFactoryOveridden() {
   return message_pump_for_ui_factory_ != nullptr;
 }
 
+// static
+void MessagePump::InitializeFeatures() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  MessagePumpLibevent::InitializeFeatures();
+#endif
+}
+
 // static
 std::unique_ptr<MessagePump> MessagePump::Create(MessagePumpType type) {
   switch (type) {
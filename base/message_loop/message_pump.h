@@ -35,6 +35,10 @@ class BASE_EXPORT MessagePump {
   // Creates the default MessagePump based on |type|. Caller owns return value.
   static std::unique_ptr<MessagePump> Create(MessagePumpType type);
 
+  // Caches the state of the features which select a MessagePump
+  // implementation. Must be called after the FeatureList is initialized.
+  static void InitializeFeatures();
+
   // Please see the comments above the Run method for an illustration of how
   // these delegate methods are used.
   class BASE_EXPORT Delegate {
@@ -0,0 +1,330 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop/message_pump_epoll.h"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "base/auto_reset.h"
+#include "base/check_op.h"
+#include "base/logging.h"
+#include "base/notreached.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/ranges/algorithm.h"
+#include "base/trace_event/base_tracing.h"
+
+namespace base {
+
+const Feature kMessagePumpEpoll{"MessagePumpEpoll",
+                                FEATURE_DISABLED_BY_DEFAULT};
+
+MessagePumpEpoll::EpollEventEntry::EpollEventEntry() = default;
+
+MessagePumpEpoll::EpollEventEntry::~EpollEventEntry() = default;
+
+uint32_t MessagePumpEpoll::EpollEventEntry::ComputeActiveEvents() const {
+  uint32_t events = 0;
+  for (const scoped_refptr<EpollInterest>& interest : interests) {
+    if (!interest->active())
+      continue;
+    const EpollInterestParams& params = interest->params();
+    if (params.read)
+      events |= EPOLLIN;
+    if (params.write)
+      events |= EPOLLOUT;
+  }
+  return events;
+}
+
+MessagePumpEpoll::MessagePumpEpoll() {
+  epoll_.reset(epoll_create1(EPOLL_CLOEXEC));
+  PCHECK(epoll_.is_valid());
+
+  wake_event_.reset(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+  PCHECK(wake_event_.is_valid());
+
+  epoll_event wake{};
+  wake.events = EPOLLIN;
+  wake.data.fd = wake_event_.get();
+  PCHECK(epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, wake_event_.get(), &wake) == 0);
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() = default;
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           int mode,
+                                           FdWatchController* controller,
+                                           FdWatcher* watcher) {
+  DCHECK_GE(fd, 0);
+  DCHECK(controller);
+  DCHECK(watcher);
+  DCHECK(mode == WATCH_READ || mode == WATCH_WRITE || mode == WATCH_READ_WRITE);
+  // WatchFileDescriptor should be called on the pump thread. It is not
+  // threadsafe, and your watcher may never be registered.
+  DCHECK(watch_file_descriptor_caller_checker_.CalledOnValidThread());
+
+  EpollInterestParams params;
+  params.fd = fd;
+  params.read = (mode & WATCH_READ) != 0;
+  params.write = (mode & WATCH_WRITE) != 0;
+  params.one_shot = !persistent;
+
+  if (scoped_refptr<EpollInterest> old_interest =
+          controller->epoll_interest()) {
+    // Combine the old and new interests, like MessagePumpLibevent does with
+    // event masks.
+    const EpollInterestParams& old_params = old_interest->params();
+    // It's illegal to use this function to listen on 2 separate fds with the
+    // same `controller`.
+    if (old_params.fd != fd) {
+      NOTREACHED() << "FDs don't match" << old_params.fd << "!=" << fd;
+      return false;
+    }
+    params.read |= old_params.read;
+    params.write |= old_params.write;
+    params.one_shot &= old_params.one_shot;
+    UnregisterInterest(std::move(old_interest));
+    controller->set_epoll_interest(nullptr);
+  }
+
+  EpollEventEntry& entry = entries_[fd];
+  auto interest = MakeRefCounted<EpollInterest>(controller, params);
+  entry.interests.push_back(interest);
+  if (!UpdateEpollEvent(fd, entry)) {
+    UnregisterInterest(std::move(interest));
+    controller->set_epoll_pump(nullptr);
+    controller->set_watcher(nullptr);
+    return false;
+  }
+
+  controller->set_epoll_interest(std::move(interest));
+  controller->set_watcher(watcher);
+  controller->set_epoll_pump(this);
+  return true;
+}
+
+// Reentrant!
+void MessagePumpEpoll::Run(Delegate* delegate) {
+  RunState run_state(delegate);
+  AutoReset<RunState*> auto_reset_run_state(&run_state_, &run_state);
+
+  for (;;) {
+    // Do some work and see if the next task is ready right away.
+    Delegate::NextWorkInfo next_work_info = delegate->DoWork();
+    const bool immediate_work_available = next_work_info.is_immediate();
+
+    if (run_state.should_quit)
+      break;
+
+    // Process native events if any are ready. Do not block waiting for more.
+    bool attempt_more_work = WaitForEpollEvents(TimeDelta());
+    attempt_more_work |= immediate_work_available;
+
+    if (run_state.should_quit)
+      break;
+
+    if (attempt_more_work)
+      continue;
+
+    attempt_more_work = delegate->DoIdleWork();
+
+    if (run_state.should_quit)
+      break;
+
+    if (attempt_more_work)
+      continue;
+
+    // Block waiting for events and process all available upon waking up, or
+    // until the next delayed task is due. Unlike with libevent, the timeout is
+    // passed to epoll_wait() directly instead of arming a timer.
+    DCHECK(!next_work_info.delayed_run_time.is_null());
+    const TimeDelta timeout = next_work_info.delayed_run_time.is_max()
+                                  ? TimeDelta::Max()
+                                  : next_work_info.remaining_delay();
+    delegate->BeforeWait();
+    WaitForEpollEvents(timeout);
+
+    if (run_state.should_quit)
+      break;
+  }
+}
+
+void MessagePumpEpoll::Quit() {
+  DCHECK(run_state_) << "Quit was called outside of Run!";
+  // Tell both epoll_wait() and Run() that they should break out of their
+  // loops.
+  run_state_->should_quit = true;
+  ScheduleWork();
+}
+
+void MessagePumpEpoll::ScheduleWork() {
+  const uint64_t value = 1;
+  ssize_t nwrite =
+      HANDLE_EINTR(write(wake_event_.get(), &value, sizeof(value)));
+  // EAGAIN only happens if the counter would overflow, in which case a wake-up
+  // is already pending.
+  DPCHECK(nwrite == sizeof(value) || errno == EAGAIN) << "nwrite:" << nwrite;
+}
+
+void MessagePumpEpoll::ScheduleDelayedWork(
+    const Delegate::NextWorkInfo& next_work_info) {
+  // Like MessagePumpLibevent, this can only be called on the same thread as
+  // Run(), so Run() can't be blocked in epoll_wait() right now: it will wait
+  // with the correct timeout when it's out of immediate tasks.
+}
+
+void MessagePumpEpoll::UnregisterInterest(
+    scoped_refptr<EpollInterest> interest) {
+  DCHECK(interest);
+  const int fd = interest->params().fd;
+  interest->Detach();
+
+  auto it = entries_.find(fd);
+  DCHECK(it != entries_.end());
+  EpollEventEntry& entry = it->second;
+  auto interest_it = ranges::find(entry.interests, interest);
+  DCHECK(interest_it != entry.interests.end());
+  entry.interests.erase(interest_it);
+  UpdateEpollEvent(fd, entry);
+  if (entry.interests.empty())
+    entries_.erase(it);
+}
+
+bool MessagePumpEpoll::UpdateEpollEvent(int fd, EpollEventEntry& entry) {
+  const uint32_t events = entry.ComputeActiveEvents();
+  if (events == entry.registered_events)
+    return true;
+
+  if (events == 0) {
+    // epoll always reports errors and hang-ups, so a file descriptor without
+    // active interests must be removed. This fails if `fd` was already closed,
+    // which also removed it from the epoll set.
+    epoll_event unused{};
+    epoll_ctl(epoll_.get(), EPOLL_CTL_DEL, fd, &unused);
+    entry.registered_events = 0;
+    return true;
+  }
+
+  epoll_event event{};
+  event.events = events;
+  event.data.fd = fd;
+  const int op = entry.registered_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (epoll_ctl(epoll_.get(), op, fd, &event) != 0) {
+    DPLOG(ERROR) << "epoll_ctl failed(fd=" << fd << ")";
+    return false;
+  }
+  entry.registered_events = events;
+  return true;
+}
+
+bool MessagePumpEpoll::WaitForEpollEvents(TimeDelta timeout) {
+  // `timeout` has microsecond resolution, but epoll_wait() takes milliseconds.
+  // Round up so that a delayed task isn't woken up for early.
+  const int epoll_timeout =
+      timeout.is_max() ? -1
+                       : saturated_cast<int>(timeout.InMillisecondsRoundedUp());
+  epoll_event events[kMaxEventsPerWait];
+  const int epoll_result =
+      epoll_wait(epoll_.get(), events, kMaxEventsPerWait, epoll_timeout);
+  if (epoll_result < 0) {
+    DPCHECK(errno == EINTR);
+    return false;
+  }
+
+  for (int i = 0; i < epoll_result; ++i) {
+    const int fd = events[i].data.fd;
+    if (fd == wake_event_.get())
+      HandleWakeUp();
+    else
+      OnEpollEvent(fd, events[i].events);
+  }
+  return epoll_result > 0;
+}
+
+void MessagePumpEpoll::OnEpollEvent(int fd, uint32_t events) {
+  auto it = entries_.find(fd);
+  // A callback for a previous event of the batch may have stopped watching
+  // `fd`.
+  if (it == entries_.end())
+    return;
+
+  // Like libevent, report errors and hang-ups to both readers and writers so
+  // that they observe them on their next read() or write().
+  const bool readable = events & (EPOLLIN | EPOLLERR | EPOLLHUP);
+  const bool writable = events & (EPOLLOUT | EPOLLERR | EPOLLHUP);
+
+  // Callbacks may add or remove interests, so collect the triggered ones
+  // first. One-shot interests are deactivated before any callback runs, so
+  // that callbacks can watch the file descriptor again.
+  EpollEventEntry& entry = it->second;
+  decltype(entry.interests) triggered_interests;
+  bool deactivated_interest = false;
+  for (const scoped_refptr<EpollInterest>& interest : entry.interests) {
+    const EpollInterestParams& params = interest->params();
+    if (!interest->active() ||
+        !((readable && params.read) || (writable && params.write))) {
+      continue;
+    }
+    triggered_interests.push_back(interest);
+    if (params.one_shot) {
+      interest->set_active(false);
+      deactivated_interest = true;
+    }
+  }
+  if (deactivated_interest)
+    UpdateEpollEvent(fd, entry);
+
+  for (const scoped_refptr<EpollInterest>& interest : triggered_interests) {
+    // A previous callback may have stopped the interest, which detached it
+    // from its controller.
+    FdWatchController* controller = interest->controller();
+    if (!controller)
+      continue;
+    const EpollInterestParams& params = interest->params();
+    HandleEvent(fd, readable && params.read, writable && params.write,
+                controller);
+  }
+}
+
+void MessagePumpEpoll::HandleEvent(int fd,
+                                   bool can_read,
+                                   bool can_write,
+                                   FdWatchController* controller) {
+  TRACE_EVENT("toplevel", "EpollEvent", "fd", fd);
+
+  TRACE_HEAP_PROFILER_API_SCOPED_TASK_EXECUTION heap_profiler_scope(
+      controller->created_from_location().file_name());
+
+  // Make the MessagePumpDelegate aware of this other form of "DoWork". Skip if
+  // HandleEvent is called outside of Run() (e.g. in unit tests).
+  Delegate::ScopedDoWorkItem scoped_do_work_item;
+  if (run_state_)
+    scoped_do_work_item = run_state_->delegate->BeginWorkItem();
+
+  if (!can_write) {
+    controller->OnFdReadable();
+    return;
+  }
+
+  // Like MessagePumpLibevent, notify writes first. The write callback may
+  // stop watching or destroy `controller`, which detaches its interest.
+  scoped_refptr<EpollInterest> interest = controller->epoll_interest();
+  controller->OnFdWritable();
+  if (can_read && interest->controller())
+    controller->OnFdReadable();
+}
+
+void MessagePumpEpoll::HandleWakeUp() {
+  uint64_t value;
+  ssize_t nread = HANDLE_EINTR(read(wake_event_.get(), &value, sizeof(value)));
+  DPCHECK(nread == sizeof(value) || errno == EAGAIN) << "nread:" << nread;
+}
+
+}  // namespace base
@@ -0,0 +1,250 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop/message_pump_epoll.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/callback_helpers.h"
+#include "base/logging.h"
+#include "base/memory/raw_ptr.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/run_loop.h"
+#include "base/task/current_thread.h"
+#include "base/task/single_thread_task_executor.h"
+#include "base/test/bind.h"
+#include "base/test/gtest_util.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/threading/thread.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Runs callbacks when the watched file descriptor is ready.
+class CallbackWatcher : public MessagePumpEpoll::FdWatcher {
+ public:
+  CallbackWatcher(RepeatingClosure on_read, RepeatingClosure on_write)
+      : on_read_(std::move(on_read)), on_write_(std::move(on_write)) {}
+  ~CallbackWatcher() override = default;
+
+  // MessagePumpEpoll::FdWatcher:
+  void OnFileCanReadWithoutBlocking(int fd) override { on_read_.Run(); }
+  void OnFileCanWriteWithoutBlocking(int fd) override { on_write_.Run(); }
+
+ private:
+  RepeatingClosure on_read_;
+  RepeatingClosure on_write_;
+};
+
+void WriteByte(int fd) {
+  const char buf = 0;
+  ASSERT_EQ(1, HANDLE_EINTR(write(fd, &buf, 1)));
+}
+
+}  // namespace
+
+class MessagePumpEpollTest : public testing::Test {
+ protected:
+  MessagePumpEpollTest() {
+    auto pump = std::make_unique<MessagePumpEpoll>();
+    pump_ = pump.get();
+    executor_ = std::make_unique<SingleThreadTaskExecutor>(std::move(pump));
+  }
+
+  void SetUp() override {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets_));
+  }
+
+  void TearDown() override {
+    for (int fd : sockets_) {
+      if (IGNORE_EINTR(close(fd)) < 0)
+        PLOG(ERROR) << "close";
+    }
+  }
+
+  std::unique_ptr<SingleThreadTaskExecutor> executor_;
+  raw_ptr<MessagePumpEpoll> pump_;
+  int sockets_[2];
+};
+
+TEST_F(MessagePumpEpollTest, QuitOutsideOfRun) {
+  MessagePumpEpoll pump;
+  ASSERT_DCHECK_DEATH(pump.Quit());
+}
+
+// Watches are level-triggered: a persistent watch keeps firing until the
+// data is consumed.
+TEST_F(MessagePumpEpollTest, PersistentRead) {
+  RunLoop run_loop;
+  int num_reads = 0;
+  MessagePumpEpoll::FdWatchController controller(FROM_HERE);
+  CallbackWatcher watcher(BindLambdaForTesting([&] {
+                            if (++num_reads == 3)
+                              run_loop.Quit();
+                          }),
+                          DoNothing());
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/true,
+                                         MessagePumpEpoll::WATCH_READ,
+                                         &controller, &watcher));
+  WriteByte(sockets_[1]);
+  run_loop.Run();
+  EXPECT_EQ(3, num_reads);
+}
+
+TEST_F(MessagePumpEpollTest, OneShotRead) {
+  int num_reads = 0;
+  MessagePumpEpoll::FdWatchController controller(FROM_HERE);
+  CallbackWatcher watcher(BindLambdaForTesting([&] { ++num_reads; }),
+                          DoNothing());
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/false,
+                                         MessagePumpEpoll::WATCH_READ,
+                                         &controller, &watcher));
+  WriteByte(sockets_[1]);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, num_reads);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, num_reads);
+
+  // Watching again re-arms the watch.
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/false,
+                                         MessagePumpEpoll::WATCH_READ,
+                                         &controller, &watcher));
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(2, num_reads);
+}
+
+// Writes are notified before reads, and stopping the watch from the write
+// callback drops the read notification.
+TEST_F(MessagePumpEpollTest, StopWatchingFromWriteCallback) {
+  int num_reads = 0;
+  int num_writes = 0;
+  MessagePumpEpoll::FdWatchController controller(FROM_HERE);
+  CallbackWatcher watcher(BindLambdaForTesting([&] { ++num_reads; }),
+                          BindLambdaForTesting([&] {
+                            ++num_writes;
+                            controller.StopWatchingFileDescriptor();
+                          }));
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/true,
+                                         MessagePumpEpoll::WATCH_READ_WRITE,
+                                         &controller, &watcher));
+  WriteByte(sockets_[1]);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, num_writes);
+  EXPECT_EQ(0, num_reads);
+}
+
+TEST_F(MessagePumpEpollTest, DeleteControllerFromWriteCallback) {
+  int num_reads = 0;
+  auto controller =
+      std::make_unique<MessagePumpEpoll::FdWatchController>(FROM_HERE);
+  CallbackWatcher watcher(BindLambdaForTesting([&] { ++num_reads; }),
+                          BindLambdaForTesting([&] { controller.reset(); }));
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/true,
+                                         MessagePumpEpoll::WATCH_READ_WRITE,
+                                         controller.get(), &watcher));
+  WriteByte(sockets_[1]);
+  RunLoop().RunUntilIdle();
+  EXPECT_FALSE(controller);
+  EXPECT_EQ(0, num_reads);
+}
+
+// Several controllers can watch the same file descriptor for different
+// events, and stop independently.
+TEST_F(MessagePumpEpollTest, MultipleControllersOnSameFd) {
+  int num_reads = 0;
+  int num_writes = 0;
+  MessagePumpEpoll::FdWatchController read_controller(FROM_HERE);
+  MessagePumpEpoll::FdWatchController write_controller(FROM_HERE);
+  CallbackWatcher read_watcher(BindLambdaForTesting([&] { ++num_reads; }),
+                               DoNothing());
+  CallbackWatcher write_watcher(DoNothing(),
+                                BindLambdaForTesting([&] { ++num_writes; }));
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/false,
+                                         MessagePumpEpoll::WATCH_READ,
+                                         &read_controller, &read_watcher));
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/false,
+                                         MessagePumpEpoll::WATCH_WRITE,
+                                         &write_controller, &write_watcher));
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(0, num_reads);
+  EXPECT_EQ(1, num_writes);
+
+  WriteByte(sockets_[1]);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, num_reads);
+  EXPECT_EQ(1, num_writes);
+
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/false,
+                                         MessagePumpEpoll::WATCH_READ,
+                                         &read_controller, &read_watcher));
+  ASSERT_TRUE(pump_->WatchFileDescriptor(sockets_[0], /*persistent=*/false,
+                                         MessagePumpEpoll::WATCH_WRITE,
+                                         &write_controller, &write_watcher));
+  EXPECT_TRUE(read_controller.StopWatchingFileDescriptor());
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, num_reads);
+  EXPECT_EQ(2, num_writes);
+}
+
+// ScheduleWork() from another thread wakes up a pump blocked in epoll_wait().
+TEST_F(MessagePumpEpollTest, WakeUpFromOtherThread) {
+  RunLoop run_loop;
+  Thread thread("MessagePumpEpollTestThread");
+  ASSERT_TRUE(thread.Start());
+  thread.task_runner()->PostTask(
+      FROM_HERE, BindOnce(
+                     [](scoped_refptr<SingleThreadTaskRunner> task_runner,
+                        OnceClosure quit) {
+                       task_runner->PostTask(FROM_HERE, std::move(quit));
+                     },
+                     ThreadTaskRunnerHandle::Get(), run_loop.QuitClosure()));
+  run_loop.Run();
+}
+
+TEST_F(MessagePumpEpollTest, DelayedTask) {
+  constexpr TimeDelta kDelay = Milliseconds(10);
+  RunLoop run_loop;
+  const TimeTicks start = TimeTicks::Now();
+  ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, run_loop.QuitClosure(), kDelay);
+  run_loop.Run();
+  EXPECT_GE(TimeTicks::Now() - start, kDelay);
+}
+
+// MessagePumpType::IO pumps use MessagePumpEpoll when the feature is enabled.
+TEST(MessagePumpEpollFeatureTest, MessagePumpForIO) {
+  test::ScopedFeatureList feature_list(kMessagePumpEpoll);
+  MessagePumpLibevent::InitializeFeatures();
+
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+  {
+    SingleThreadTaskExecutor executor(MessagePumpType::IO);
+    RunLoop run_loop;
+    MessagePumpForIO::FdWatchController controller(FROM_HERE);
+    CallbackWatcher watcher(run_loop.QuitClosure(), DoNothing());
+    ASSERT_TRUE(CurrentIOThread::Get().WatchFileDescriptor(
+        sockets[0], /*persistent=*/false, MessagePumpForIO::WATCH_READ,
+        &controller, &watcher));
+    WriteByte(sockets[1]);
+    run_loop.Run();
+  }
+  for (int fd : sockets)
+    IGNORE_EINTR(close(fd));
+
+  feature_list.Reset();
+  MessagePumpLibevent::InitializeFeatures();
+}
+
+}  // namespace base
@@ -7,11 +7,13 @@
 #include <errno.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <memory>
 #include <utility>
 
 #include "base/auto_reset.h"
 #include "base/compiler_specific.h"
+#include "base/feature_list.h"
 #include "base/files/file_util.h"
 #include "base/logging.h"
 #include "base/notreached.h"
@@ -21,6 +23,10 @@
 #include "base/trace_event/base_tracing.h"
 #include "build/build_config.h"
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+#include "base/message_loop/message_pump_epoll.h"
+#endif
+
 // Lifecycle of struct event
 // Libevent uses two main data structures:
 // struct event_base (of which there is one per message pump), and
@@ -34,6 +40,21 @@
 
 namespace base {
 
+namespace {
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+std::atomic_bool g_use_epoll = false;
+#endif
+
+}  // namespace
+
+MessagePumpLibevent::EpollInterest::EpollInterest(
+    FdWatchController* controller,
+    const EpollInterestParams& params)
+    : controller_(controller), params_(params) {}
+
+MessagePumpLibevent::EpollInterest::~EpollInterest() = default;
+
 MessagePumpLibevent::FdWatchController::FdWatchController(
     const Location& from_here)
     : FdWatchControllerInterface(from_here) {}
@@ -42,6 +63,10 @@ MessagePumpLibevent::FdWatchController::~FdWatchController() {
   if (event_) {
     CHECK(StopWatchingFileDescriptor());
   }
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_)
+    CHECK(StopWatchingFileDescriptor());
+#endif
   if (was_destroyed_) {
     DCHECK(!*was_destroyed_);
     *was_destroyed_ = true;
@@ -49,6 +74,16 @@ MessagePumpLibevent::FdWatchController::~FdWatchController() {
 }
 
 bool MessagePumpLibevent::FdWatchController::StopWatchingFileDescriptor() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_) {
+    epoll_pump_->UnregisterInterest(epoll_interest_);
+    epoll_interest_ = nullptr;
+    epoll_pump_ = nullptr;
+    watcher_ = nullptr;
+    return true;
+  }
+#endif
+
   std::unique_ptr<event> e = ReleaseEvent();
   if (!e)
     return true;
@@ -88,7 +123,30 @@ void MessagePumpLibevent::FdWatchController::OnFileCanWriteWithoutBlocking(
   watcher_->OnFileCanWriteWithoutBlocking(fd);
 }
 
-MessagePumpLibevent::MessagePumpLibevent() : event_base_(event_base_new()) {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+void MessagePumpLibevent::FdWatchController::OnFdReadable() {
+  // Like OnFileCanReadWithoutBlocking(), the write callback may have stopped
+  // watching the file descriptor.
+  if (!watcher_)
+    return;
+  watcher_->OnFileCanReadWithoutBlocking(epoll_interest_->params().fd);
+}
+
+void MessagePumpLibevent::FdWatchController::OnFdWritable() {
+  DCHECK(watcher_);
+  watcher_->OnFileCanWriteWithoutBlocking(epoll_interest_->params().fd);
+}
+#endif
+
+MessagePumpLibevent::MessagePumpLibevent() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (g_use_epoll.load(std::memory_order_relaxed)) {
+    epoll_pump_ = std::make_unique<MessagePumpEpoll>();
+    return;
+  }
+#endif
+
+  event_base_ = event_base_new();
   if (!Init())
     NOTREACHED();
   DCHECK_NE(wakeup_pipe_in_, -1);
@@ -97,6 +155,11 @@ MessagePumpLibevent::MessagePumpLibevent() : event_base_(event_base_new()) {
 }
 
 MessagePumpLibevent::~MessagePumpLibevent() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_)
+    return;
+#endif
+
   DCHECK(wakeup_event_);
   DCHECK(event_base_);
   event_del(wakeup_event_);
@@ -112,6 +175,14 @@ MessagePumpLibevent::~MessagePumpLibevent() {
   event_base_free(event_base_);
 }
 
+// static
+void MessagePumpLibevent::InitializeFeatures() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  g_use_epoll.store(FeatureList::IsEnabled(kMessagePumpEpoll),
+                    std::memory_order_relaxed);
+#endif
+}
+
 bool MessagePumpLibevent::WatchFileDescriptor(int fd,
                                               bool persistent,
                                               int mode,
@@ -125,6 +196,13 @@ bool MessagePumpLibevent::WatchFileDescriptor(int fd,
   // threadsafe, and your watcher may never be registered.
   DCHECK(watch_file_descriptor_caller_checker_.CalledOnValidThread());
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_) {
+    return epoll_pump_->WatchFileDescriptor(fd, persistent, mode, controller,
+                                            delegate);
+  }
+#endif
+
   int event_mask = persistent ? EV_PERSIST : 0;
   if (mode & WATCH_READ) {
     event_mask |= EV_READ;
@@ -183,12 +261,23 @@ static void timer_callback(int fd, short events, void* context) {
 
 // Reentrant!
 void MessagePumpLibevent::Run(Delegate* delegate) {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_) {
+    epoll_pump_->Run(delegate);
+    return;
+  }
+#endif
+
   RunState run_state(delegate);
   AutoReset<RunState*> auto_reset_run_state(&run_state_, &run_state);
 
   // event_base_loopexit() + EVLOOP_ONCE is leaky, see http://crbug.com/25641.
   // Instead, make our own timer and reuse it on each call to event_base_loop().
   std::unique_ptr<event> timer_event(new event);
+  // The delayed run time |timer_event| is armed for, if it is pending. The
+  // timer is left armed across iterations and only re-armed when the delayed
+  // run time changes, since it usually doesn't between two waits.
+  TimeTicks timer_run_time;
 
   for (;;) {
     // Do some work and see if the next task is ready right away.
@@ -221,11 +310,17 @@ void MessagePumpLibevent::Run(Delegate* delegate) {
     if (attempt_more_work)
       continue;
 
-    bool did_set_timer = false;
-
-    // If there is delayed work.
+    // The timer fired, or was armed for a different delayed run time.
     DCHECK(!next_work_info.delayed_run_time.is_null());
-    if (!next_work_info.delayed_run_time.is_max()) {
+    if (!timer_run_time.is_null() &&
+        (timer_run_time != next_work_info.delayed_run_time ||
+         !event_pending(timer_event.get(), EV_TIMEOUT, nullptr))) {
+      event_del(timer_event.get());
+      timer_run_time = TimeTicks();
+    }
+
+    // If there is delayed work and the timer isn't already armed for it.
+    if (!next_work_info.delayed_run_time.is_max() && timer_run_time.is_null()) {
       const TimeDelta delay = next_work_info.remaining_delay();
 
       // Setup a timer to break out of the event loop at the right time.
@@ -236,7 +331,7 @@ void MessagePumpLibevent::Run(Delegate* delegate) {
       event_base_set(event_base_, timer_event.get());
       event_add(timer_event.get(), &poll_tv);
 
-      did_set_timer = true;
+      timer_run_time = next_work_info.delayed_run_time;
     }
 
     // Block waiting for events and process all available upon waking up. This
@@ -245,18 +340,23 @@ void MessagePumpLibevent::Run(Delegate* delegate) {
     delegate->BeforeWait();
     event_base_loop(event_base_, EVLOOP_ONCE);
 
-    // We previously setup a timer to break out the event loop to look for more
-    // work. Now that we're here delete the event.
-    if (did_set_timer) {
-      event_del(timer_event.get());
-    }
-
     if (run_state.should_quit)
       break;
   }
+
+  // Delete the timer, which may still be armed, before it goes away.
+  if (!timer_run_time.is_null())
+    event_del(timer_event.get());
 }
 
 void MessagePumpLibevent::Quit() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_) {
+    epoll_pump_->Quit();
+    return;
+  }
+#endif
+
   DCHECK(run_state_) << "Quit was called outside of Run!";
   // Tell both libevent and Run that they should break out of their loops.
   run_state_->should_quit = true;
@@ -264,6 +364,13 @@ void MessagePumpLibevent::Quit() {
 }
 
 void MessagePumpLibevent::ScheduleWork() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (epoll_pump_) {
+    epoll_pump_->ScheduleWork();
+    return;
+  }
+#endif
+
   // Tell libevent (in a threadsafe way) that it should break out of its loop.
   char buf = 0;
   int nwrite = HANDLE_EINTR(write(wakeup_pipe_in_, &buf, 1));
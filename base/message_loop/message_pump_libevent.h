@@ -6,13 +6,16 @@
 #define BASE_MESSAGE_LOOP_MESSAGE_PUMP_LIBEVENT_H_
 
 #include <memory>
+#include <utility>
 
 #include "base/base_export.h"
 #include "base/compiler_specific.h"
 #include "base/memory/raw_ptr.h"
+#include "base/memory/ref_counted.h"
 #include "base/message_loop/message_pump.h"
 #include "base/message_loop/watchable_io_message_pump_posix.h"
 #include "base/threading/thread_checker.h"
+#include "build/build_config.h"
 
 // Declare structs we need from libevent.h rather than including it
 struct event_base;
@@ -20,11 +23,64 @@ struct event;
 
 namespace base {
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+class MessagePumpEpoll;
+#endif
+
 // Class to monitor sockets and issue callbacks when sockets are ready for I/O
 // TODO(dkegel): add support for background file IO somehow
 class BASE_EXPORT MessagePumpLibevent : public MessagePump,
                                         public WatchableIOMessagePumpPosix {
  public:
+  class FdWatchController;
+
+  // Parameters used to construct and describe an EpollInterest.
+  struct EpollInterestParams {
+    // The file descriptor of interest.
+    int fd;
+
+    // Indicates an interest in being able to read() from `fd`.
+    bool read;
+
+    // Indicates an interest in being able to write() to `fd`.
+    bool write;
+
+    // Indicates whether this interest is a one-shot interest, meaning that it
+    // must be automatically deactivated every time it triggers an epoll event.
+    bool one_shot;
+  };
+
+  // Represents a single controller's interest in a file descriptor via epoll,
+  // and tracks whether that interest is currently active. Though an interest
+  // persists as long as its controller watches the file descriptor, one-shot
+  // interests are deactivated once they trigger an event. Only used when
+  // MessagePumpEpoll is in use.
+  class EpollInterest : public RefCounted<EpollInterest> {
+   public:
+    EpollInterest(FdWatchController* controller,
+                  const EpollInterestParams& params);
+    EpollInterest(const EpollInterest&) = delete;
+    EpollInterest& operator=(const EpollInterest&) = delete;
+
+    FdWatchController* controller() { return controller_; }
+    const EpollInterestParams& params() const { return params_; }
+
+    bool active() const { return active_; }
+    void set_active(bool active) { active_ = active; }
+
+    // Detaches the interest from its controller, so that events which are
+    // already harvested but not yet dispatched are dropped.
+    void Detach() { controller_ = nullptr; }
+
+   private:
+    friend class RefCounted<EpollInterest>;
+    ~EpollInterest();
+
+    raw_ptr<FdWatchController> controller_;
+    const EpollInterestParams params_;
+    bool active_ = true;
+  };
+
   class FdWatchController : public FdWatchControllerInterface {
    public:
     explicit FdWatchController(const Location& from_here);
@@ -41,6 +97,9 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump,
    private:
     friend class MessagePumpLibevent;
     friend class MessagePumpLibeventTest;
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+    friend class MessagePumpEpoll;
+#endif
 
     // Called by MessagePumpLibevent.
     void Init(std::unique_ptr<event> e);
@@ -56,8 +115,29 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump,
     void OnFileCanReadWithoutBlocking(int fd, MessagePumpLibevent* pump);
     void OnFileCanWriteWithoutBlocking(int fd, MessagePumpLibevent* pump);
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+    // Used by MessagePumpEpoll.
+    void set_epoll_pump(MessagePumpEpoll* pump) { epoll_pump_ = pump; }
+    const scoped_refptr<EpollInterest>& epoll_interest() const {
+      return epoll_interest_;
+    }
+    void set_epoll_interest(scoped_refptr<EpollInterest> interest) {
+      epoll_interest_ = std::move(interest);
+    }
+
+    // Called by MessagePumpEpoll when the watched file descriptor is ready.
+    void OnFdReadable();
+    void OnFdWritable();
+#endif
+
     std::unique_ptr<event> event_;
     raw_ptr<MessagePumpLibevent> pump_ = nullptr;
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+    // Set instead of `event_` and `pump_` when the file descriptor is watched
+    // by a MessagePumpEpoll.
+    scoped_refptr<EpollInterest> epoll_interest_;
+    raw_ptr<MessagePumpEpoll> epoll_pump_ = nullptr;
+#endif
     raw_ptr<FdWatcher> watcher_ = nullptr;
     // If this pointer is non-NULL, the pointee is set to true in the
     // destructor.
@@ -71,6 +151,11 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump,
 
   ~MessagePumpLibevent() override;
 
+  // Caches the state of the MessagePumpEpoll feature, which makes pumps
+  // constructed afterwards delegate to a MessagePumpEpoll instead of libevent.
+  // Must be called after the FeatureList is initialized.
+  static void InitializeFeatures();
+
   bool WatchFileDescriptor(int fd,
                            bool persistent,
                            int mode,
@@ -114,9 +199,15 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump,
   // This flag is set if libevent has processed I/O events.
   bool processed_io_events_ = false;
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  // If set, all the work of this pump is delegated to `epoll_pump_` and none of
+  // the libevent state below is initialized.
+  std::unique_ptr<MessagePumpEpoll> epoll_pump_;
+#endif
+
   // Libevent dispatcher.  Watches all sockets registered with it, and sends
   // readiness callbacks when a socket is ready for I/O.
-  const raw_ptr<event_base> event_base_;
+  raw_ptr<event_base> event_base_ = nullptr;
 
   // ... write end; ScheduleWork() writes a single byte to it
   int wakeup_pipe_in_ = -1;
@@ -25,6 +25,12 @@
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/perf/perf_result_reporter.h"
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+#include "base/message_loop/message_pump_epoll.h"
+#include "base/message_loop/message_pump_libevent.h"
+#include "base/test/scoped_feature_list.h"
+#endif
+
 #if BUILDFLAG(IS_ANDROID)
 #include "base/android/java_handler_thread.h"
 #endif
@@ -173,7 +179,7 @@ class ScheduleWorkTest : public testing::Test {
     std::string story_name = StringPrintf(
         "%s_pump_from_%d_threads",
         target_type == MessagePumpType::IO
-            ? "io"
+            ? io_pump_name_
             : (target_type == MessagePumpType::UI ? "ui" : "default"),
         num_scheduling_threads);
     auto reporter = SetUpReporter(story_name);
@@ -200,6 +206,10 @@ class ScheduleWorkTest : public testing::Test {
     return CurrentThread::Get()->GetCurrentSequenceManagerImpl();
   }
 
+ protected:
+  // Name of the MessagePumpType::IO pump in story names.
+  const char* io_pump_name_ = "io";
+
  private:
   std::unique_ptr<Thread> target_;
 #if BUILDFLAG(IS_ANDROID)
@@ -251,6 +261,41 @@ TEST_F(ScheduleWorkTest, ThreadTimeToDefaultFromFourThreads) {
   ScheduleWork(MessagePumpType::DEFAULT, 4);
 }
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+// Same as the IO tests above, with MessagePumpEpoll instead of libevent.
+class ScheduleWorkEpollTest : public ScheduleWorkTest {
+ public:
+  ScheduleWorkEpollTest() { io_pump_name_ = "io_epoll"; }
+
+  void SetUp() override {
+    ScheduleWorkTest::SetUp();
+    feature_list_.InitAndEnableFeature(kMessagePumpEpoll);
+    MessagePumpLibevent::InitializeFeatures();
+  }
+
+  void TearDown() override {
+    feature_list_.Reset();
+    MessagePumpLibevent::InitializeFeatures();
+    ScheduleWorkTest::TearDown();
+  }
+
+ private:
+  test::ScopedFeatureList feature_list_;
+};
+
+TEST_F(ScheduleWorkEpollTest, ThreadTimeToIOFromOneThread) {
+  ScheduleWork(MessagePumpType::IO, 1);
+}
+
+TEST_F(ScheduleWorkEpollTest, ThreadTimeToIOFromTwoThreads) {
+  ScheduleWork(MessagePumpType::IO, 2);
+}
+
+TEST_F(ScheduleWorkEpollTest, ThreadTimeToIOFromFourThreads) {
+  ScheduleWork(MessagePumpType::IO, 4);
+}
+#endif
+
 #if BUILDFLAG(IS_ANDROID)
 TEST_F(ScheduleWorkTest, ThreadTimeToJavaFromOneThread) {
   ScheduleWork(MessagePumpType::JAVA, 1);
@@ -90,8 +90,62 @@ bool ValidateRangeChecksum(const HistogramBase& histogram,
   return casted_histogram.bucket_ranges()->checksum() == range_checksum;
 }
 
+// The number of shards of histograms with kShardedSamples. Threads are spread
+// over the shards, so that few of them share each shard.
+constexpr size_t kNumShards = 16;
+
+size_t GetShardIndexForCurrentThread() {
+  static std::atomic<size_t> next_index{0};
+  thread_local const size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return index;
+}
+
 }  // namespace
 
+class Histogram::Shards {
+ public:
+  Shards(uint64_t id, const BucketRanges* ranges) {
+    for (auto& shard : shards_)
+      shard = std::make_unique<Shard>(id, ranges);
+  }
+
+  Shards(const Shards&) = delete;
+  Shards& operator=(const Shards&) = delete;
+
+  ~Shards() = default;
+
+  SampleVector* GetForCurrentThread() {
+    return &shards_[GetShardIndexForCurrentThread()]->samples;
+  }
+
+  void MergeInto(SampleVectorBase* samples) {
+    AutoLock auto_lock(lock_);
+    for (const auto& shard : shards_) {
+      if (!shard->samples.redundant_count())
+        continue;
+      // Only the samples which are moved are subtracted, so that samples
+      // recorded concurrently stay in the shard until the next merge.
+      SampleVector moved(samples->id(), samples->bucket_ranges());
+      moved.Add(shard->samples);
+      shard->samples.Subtract(moved);
+      samples->Add(moved);
+    }
+  }
+
+ private:
+  // Aligned so that threads using different shards don't share cache lines.
+  struct alignas(64) Shard {
+    Shard(uint64_t id, const BucketRanges* ranges) : samples(id, ranges) {}
+    SampleVector samples;
+  };
+
+  std::unique_ptr<Shard> shards_[kNumShards];
+
+  // Serializes merges.
+  Lock lock_;
+};
+
 typedef HistogramBase::Count Count;
 typedef HistogramBase::Sample Sample;
 
@@ -523,7 +577,10 @@ void Histogram::AddCount(int value, int count) {
     NOTREACHED();
     return;
   }
-  unlogged_samples_->Accumulate(value, count);
+  if (UNLIKELY(flags() & kShardedSamples))
+    GetOrCreateShards()->GetForCurrentThread()->Accumulate(value, count);
+  else
+    unlogged_samples_->Accumulate(value, count);
 
   if (UNLIKELY(StatisticsRecorder::have_active_callbacks()))
     FindAndRunCallbacks(value);
@@ -612,7 +669,9 @@ Histogram::Histogram(const char* name,
       unlogged_samples_->id(), ranges, logged_meta, logged_counts);
 }
 
-Histogram::~Histogram() = default;
+Histogram::~Histogram() {
+  delete shards_.load(std::memory_order_acquire);
+}
 
 const std::string Histogram::GetAsciiBucketRange(uint32_t i) const {
   return GetSimpleAsciiBucketRange(ranges(i));
@@ -654,7 +713,29 @@ std::unique_ptr<SampleVector> Histogram::SnapshotAllSamples() const {
   return samples;
 }
 
+Histogram::Shards* Histogram::GetOrCreateShards() {
+  Shards* shards = shards_.load(std::memory_order_acquire);
+  if (LIKELY(shards))
+    return shards;
+
+  auto new_shards =
+      std::make_unique<Shards>(unlogged_samples_->id(), bucket_ranges());
+  if (shards_.compare_exchange_strong(shards, new_shards.get(),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+    return new_shards.release();
+  }
+  // Another thread created them first.
+  return shards;
+}
+
+void Histogram::MergeShards() const {
+  if (Shards* shards = shards_.load(std::memory_order_acquire))
+    shards->MergeInto(unlogged_samples_.get());
+}
+
 std::unique_ptr<SampleVector> Histogram::SnapshotUnloggedSamples() const {
+  MergeShards();
   std::unique_ptr<SampleVector> samples(
       new SampleVector(unlogged_samples_->id(), bucket_ranges()));
   samples->Add(*unlogged_samples_);
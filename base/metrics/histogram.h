@@ -67,6 +67,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -266,11 +267,20 @@ class BASE_EXPORT Histogram : public HistogramBase {
       base::PickleIterator* iter);
   static HistogramBase* DeserializeInfoImpl(base::PickleIterator* iter);
 
+  // The per-thread samples of a histogram with kShardedSamples.
+  class Shards;
+
   // Create a snapshot containing all samples (both logged and unlogged).
   // Implementation of SnapshotSamples method with a more specific type for
   // internal use.
   std::unique_ptr<SampleVector> SnapshotAllSamples() const;
 
+  // Returns |shards_|, creating them if needed.
+  Shards* GetOrCreateShards();
+
+  // Moves the samples accumulated in |shards_| to |unlogged_samples_|.
+  void MergeShards() const;
+
   // Create a copy of unlogged samples.
   std::unique_ptr<SampleVector> SnapshotUnloggedSamples() const;
 
@@ -284,6 +294,10 @@ class BASE_EXPORT Histogram : public HistogramBase {
   // Accumulation of all samples that have been logged with SnapshotDelta().
   std::unique_ptr<SampleVectorBase> logged_samples_;
 
+  // Samples recorded with kShardedSamples that were not merged into
+  // |unlogged_samples_| yet. Created by the first such sample.
+  std::atomic<Shards*> shards_{nullptr};
+
 #if DCHECK_IS_ON()  // Don't waste memory if it won't be used.
   // Flag to indicate if PrepareFinalDelta has been previously called. It is
   // used to DCHECK that a final delta is not created multiple times.
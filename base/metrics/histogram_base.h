@@ -130,6 +130,15 @@ class BASE_EXPORT HistogramBase {
     // MemoryAllocator, and that loaded into the Histogram module before this
     // histogram is created.
     kIsPersistent = 0x40,
+
+    // Indicates that the samples are accumulated separately by each thread,
+    // then merged when a snapshot is taken. This avoids contention on the
+    // counts of histograms recorded very often from many threads, at the cost
+    // of more memory. Only supported by Histogram and its subclasses. Since
+    // samples are only merged by snapshots taken in the recording process,
+    // this shouldn't be used for histograms which are read from persistent
+    // memory by another process.
+    kShardedSamples = 0x80,
   };
 
   // Histogram data inconsistency types.
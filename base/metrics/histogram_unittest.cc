@@ -27,7 +27,9 @@
 #include "base/metrics/statistics_recorder.h"
 #include "base/pickle.h"
 #include "base/strings/stringprintf.h"
+#include "base/test/bind.h"
 #include "base/test/gtest_util.h"
+#include "base/threading/thread.h"
 #include "base/time/time.h"
 #include "base/values.h"
 #include "testing/gmock/include/gmock/gmock.h"
@@ -233,6 +235,49 @@ TEST_P(HistogramTest, FinalDeltaTest) {
   EXPECT_EQ(samples->TotalCount(), samples->redundant_count());
 }
 
+// Check that samples accumulated in per-thread shards are all reported once.
+TEST_P(HistogramTest, ShardedSamplesTest) {
+  HistogramBase* histogram =
+      Histogram::FactoryGet("ShardedHistogram", 1, 64, 8,
+                            HistogramBase::kShardedSamples);
+  histogram->Add(1);
+
+  constexpr int kNumThreads = 4;
+  constexpr int kSamplesPerThread = 1000;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<Thread>(StringPrintf("Thread%d", i)));
+    ASSERT_TRUE(threads.back()->Start());
+    threads.back()->task_runner()->PostTask(
+        FROM_HERE, BindLambdaForTesting([histogram]() {
+          for (int j = 0; j < kSamplesPerThread; ++j)
+            histogram->Add(j % 2 ? 10 : 50);
+        }));
+  }
+  // Snapshots taken concurrently with the recording threads.
+  int total_count = 0;
+  for (int i = 0; i < 10; ++i)
+    total_count += histogram->SnapshotDelta()->TotalCount();
+  for (auto& thread : threads)
+    thread->Stop();
+
+  std::unique_ptr<HistogramSamples> samples = histogram->SnapshotDelta();
+  total_count += samples->TotalCount();
+  EXPECT_EQ(1 + kNumThreads * kSamplesPerThread, total_count);
+  EXPECT_EQ(samples->TotalCount(), samples->redundant_count());
+  EXPECT_EQ(0, histogram->SnapshotDelta()->TotalCount());
+
+  samples = histogram->SnapshotSamples();
+  EXPECT_EQ(1, samples->GetCount(1));
+  EXPECT_EQ(kNumThreads * kSamplesPerThread / 2, samples->GetCount(10));
+  EXPECT_EQ(kNumThreads * kSamplesPerThread / 2, samples->GetCount(50));
+
+  histogram->Add(2);
+  samples = histogram->SnapshotFinalDelta();
+  EXPECT_EQ(1, samples->TotalCount());
+  EXPECT_EQ(1, samples->GetCount(2));
+}
+
 TEST_P(HistogramTest, ExponentialRangesTest) {
   // Check that we got a nice exponential when there was enough room.
   BucketRanges ranges(9);
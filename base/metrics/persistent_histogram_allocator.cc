@@ -22,6 +22,7 @@
 #include "base/metrics/histogram_samples.h"
 #include "base/metrics/metrics_hashes.h"
 #include "base/metrics/persistent_sample_map.h"
+#include "base/metrics/sample_vector.h"
 #include "base/metrics/sparse_histogram.h"
 #include "base/metrics/statistics_recorder.h"
 #include "base/notreached.h"
@@ -83,6 +84,30 @@ std::unique_ptr<BucketRanges> CreateRangesFromData(
   return ranges;
 }
 
+// Creates the BucketRanges of a histogram with |bucket_count| buckets from the
+// array at |ranges_ref| in |allocator|. A return of nullptr indicates that the
+// array is invalid.
+std::unique_ptr<BucketRanges> CreateRangesFromPersistentData(
+    PersistentMemoryAllocator* allocator,
+    PersistentMemoryAllocator::Reference ranges_ref,
+    uint32_t ranges_checksum,
+    uint32_t bucket_count) {
+  HistogramBase::Sample* ranges_data =
+      allocator->GetAsArray<HistogramBase::Sample>(
+          ranges_ref, kTypeIdRangesArray, PersistentMemoryAllocator::kSizeAny);
+
+  const uint32_t max_buckets =
+      std::numeric_limits<uint32_t>::max() / sizeof(HistogramBase::Sample);
+  size_t required_bytes = (bucket_count + 1) * sizeof(HistogramBase::Sample);
+  size_t allocated_bytes = allocator->GetAllocSize(ranges_ref);
+  if (!ranges_data || bucket_count < 2 || bucket_count >= max_buckets ||
+      allocated_bytes < required_bytes) {
+    return nullptr;
+  }
+
+  return CreateRangesFromData(ranges_data, ranges_checksum, bucket_count + 1);
+}
+
 // Calculate the number of bytes required to store all of a histogram's
 // "counts". This will return zero (0) if |bucket_count| is not valid.
 size_t CalculateRequiredCountsBytes(size_t bucket_count) {
@@ -99,6 +124,22 @@ size_t CalculateRequiredCountsBytes(size_t bucket_count) {
   return bucket_count * kBytesPerBucket;
 }
 
+// Copies the sample |metadata| of a histogram, which may be updated
+// concurrently, to |copy|.
+void CopyMetadata(const HistogramSamples::Metadata& metadata,
+                  HistogramSamples::LocalMetadata* copy) {
+  copy->id = metadata.id;
+#ifdef ARCH_CPU_64_BITS
+  copy->sum = subtle::NoBarrier_Load(&metadata.sum);
+#else
+  copy->sum = metadata.sum;
+#endif
+  copy->redundant_count = subtle::Acquire_Load(&metadata.redundant_count);
+  HistogramSamples::SingleSample single_sample = metadata.single_sample.Load();
+  if (single_sample.count != 0)
+    copy->single_sample.Accumulate(single_sample.bucket, single_sample.count);
+}
+
 }  // namespace
 
 const Feature kPersistentHistogramsFeature{
@@ -262,6 +303,23 @@ struct PersistentHistogramAllocator::PersistentHistogramData {
   // request. This must be the last field of the structure. A zero-size array
   // or a "flexible" array would be preferred but is not (yet) valid C++.
   char name[sizeof(uint64_t)];  // Force 64-bit alignment on 32-bit builds.
+
+  // Checks that metadata is reasonable, given the |length| of its allocation:
+  // name is null-terminated and non-empty, ID fields have been loaded with a
+  // hash of the name (0 is considered unset/invalid).
+  bool IsValid(size_t length) const {
+    return name[0] != '\0' &&
+           reinterpret_cast<const char*>(this)[length - 1] == '\0' &&
+           samples_metadata.id != 0 && logged_metadata.id != 0 &&
+           // Note: Sparse histograms use |id + 1| in |logged_metadata|.
+           (logged_metadata.id == samples_metadata.id ||
+            logged_metadata.id == samples_metadata.id + 1) &&
+           // Most non-matching values happen due to truncated names. Ideally,
+           // we could just verify the name length based on the overall alloc
+           // length, but that doesn't work because the allocated block may
+           // have been aligned to the next boundary value.
+           HashMetricName(name) == samples_metadata.id;
+  }
 };
 
 PersistentHistogramAllocator::Iterator::Iterator(
@@ -294,24 +352,8 @@ std::unique_ptr<HistogramBase> PersistentHistogramAllocator::GetHistogram(
   // references to histograms in other processes).
   PersistentHistogramData* data =
       memory_allocator_->GetAsObject<PersistentHistogramData>(ref);
-  const size_t length = memory_allocator_->GetAllocSize(ref);
-
-  // Check that metadata is reasonable: name is null-terminated and non-empty,
-  // ID fields have been loaded with a hash of the name (0 is considered
-  // unset/invalid).
-  if (!data || data->name[0] == '\0' ||
-      reinterpret_cast<char*>(data)[length - 1] != '\0' ||
-      data->samples_metadata.id == 0 || data->logged_metadata.id == 0 ||
-      // Note: Sparse histograms use |id + 1| in |logged_metadata|.
-      (data->logged_metadata.id != data->samples_metadata.id &&
-       data->logged_metadata.id != data->samples_metadata.id + 1) ||
-      // Most non-matching values happen due to truncated names. Ideally, we
-      // could just verify the name length based on the overall alloc length,
-      // but that doesn't work because the allocated block may have been
-      // aligned to the next boundary value.
-      HashMetricName(data->name) != data->samples_metadata.id) {
+  if (!data || !data->IsValid(memory_allocator_->GetAllocSize(ref)))
     return nullptr;
-  }
   return CreateHistogram(data);
 }
 
@@ -537,25 +579,10 @@ std::unique_ptr<HistogramBase> PersistentHistogramAllocator::CreateHistogram(
   uint32_t histogram_ranges_ref = histogram_data_ptr->ranges_ref;
   uint32_t histogram_ranges_checksum = histogram_data_ptr->ranges_checksum;
 
-  HistogramBase::Sample* ranges_data =
-      memory_allocator_->GetAsArray<HistogramBase::Sample>(
-          histogram_ranges_ref, kTypeIdRangesArray,
-          PersistentMemoryAllocator::kSizeAny);
-
-  const uint32_t max_buckets =
-      std::numeric_limits<uint32_t>::max() / sizeof(HistogramBase::Sample);
-  size_t required_bytes =
-      (histogram_bucket_count + 1) * sizeof(HistogramBase::Sample);
-  size_t allocated_bytes =
-      memory_allocator_->GetAllocSize(histogram_ranges_ref);
-  if (!ranges_data || histogram_bucket_count < 2 ||
-      histogram_bucket_count >= max_buckets ||
-      allocated_bytes < required_bytes) {
-    return nullptr;
-  }
-
-  std::unique_ptr<const BucketRanges> created_ranges = CreateRangesFromData(
-      ranges_data, histogram_ranges_checksum, histogram_bucket_count + 1);
+  std::unique_ptr<const BucketRanges> created_ranges =
+      CreateRangesFromPersistentData(
+          memory_allocator_.get(), histogram_ranges_ref,
+          histogram_ranges_checksum, histogram_bucket_count);
   if (!created_ranges)
     return nullptr;
   DCHECK_EQ(created_ranges->size(), histogram_bucket_count + 1);
@@ -674,6 +701,157 @@ PersistentHistogramAllocator::GetOrCreateStatisticsRecorderHistogram(
   return StatisticsRecorder::RegisterOrDeleteDuplicate(existing);
 }
 
+// The state of a histogram found by a PersistentHistogramReader.
+struct PersistentHistogramReader::HistogramState {
+  HistogramState(PersistentMemoryAllocator* allocator,
+                 PersistentHistogramAllocator::PersistentHistogramData* data,
+                 HistogramType type,
+                 int32_t flags,
+                 const BucketRanges* ranges,
+                 size_t counts_bytes)
+      : data(data),
+        name(data->name),
+        type(type),
+        flags(flags),
+        ranges(ranges),
+        counts_data(allocator,
+                    &data->counts_ref,
+                    kTypeIdCountsArray,
+                    counts_bytes,
+                    /*make_iterable=*/false),
+        logged_data(allocator,
+                    &data->counts_ref,
+                    kTypeIdCountsArray,
+                    counts_bytes,
+                    counts_bytes / 2,
+                    /*make_iterable=*/false),
+        logged_samples(data->samples_metadata.id, ranges) {}
+
+  const raw_ptr<PersistentHistogramAllocator::PersistentHistogramData> data;
+  const std::string name;
+  const HistogramType type;
+  const int32_t flags;
+  const raw_ptr<const BucketRanges> ranges;
+
+  // The "counts" and "logged counts" halves of the counts array, as created
+  // by PersistentHistogramAllocator::CreateHistogram().
+  const DelayedPersistentAllocation counts_data;
+  const DelayedPersistentAllocation logged_data;
+
+  // All the samples returned by previous calls to SnapshotDeltas().
+  SampleVector logged_samples;
+};
+
+PersistentHistogramReader::HistogramDelta::HistogramDelta() = default;
+PersistentHistogramReader::HistogramDelta::HistogramDelta(HistogramDelta&&) =
+    default;
+PersistentHistogramReader::HistogramDelta&
+PersistentHistogramReader::HistogramDelta::operator=(HistogramDelta&&) =
+    default;
+PersistentHistogramReader::HistogramDelta::~HistogramDelta() = default;
+
+PersistentHistogramReader::PersistentHistogramReader(
+    std::unique_ptr<PersistentMemoryAllocator> memory)
+    : memory_allocator_(std::move(memory)),
+      memory_iter_(memory_allocator_.get()) {}
+
+PersistentHistogramReader::~PersistentHistogramReader() = default;
+
+std::vector<PersistentHistogramReader::HistogramDelta>
+PersistentHistogramReader::SnapshotDeltas() {
+  FindNewHistograms();
+
+  std::vector<HistogramDelta> deltas;
+  for (const auto& state : histograms_) {
+    std::unique_ptr<HistogramSamples> samples = ReadSamples(state.get());
+    samples->Subtract(state->logged_samples);
+    if (samples->redundant_count() == 0)
+      continue;
+    state->logged_samples.Add(*samples);
+
+    HistogramDelta& delta = deltas.emplace_back();
+    delta.name = state->name;
+    delta.type = state->type;
+    delta.flags = state->flags;
+    delta.samples = std::move(samples);
+  }
+  return deltas;
+}
+
+void PersistentHistogramReader::FindNewHistograms() {
+  using PersistentHistogramData =
+      PersistentHistogramAllocator::PersistentHistogramData;
+
+  PersistentMemoryAllocator::Reference ref;
+  while ((ref = memory_iter_.GetNextOfType<PersistentHistogramData>()) != 0) {
+    PersistentHistogramData* data =
+        memory_allocator_->GetAsObject<PersistentHistogramData>(ref);
+    if (!data || !data->IsValid(memory_allocator_->GetAllocSize(ref)))
+      continue;
+
+    // Like in PersistentHistogramAllocator::CreateHistogram(), the fields are
+    // copied so that they can't change between validation and use.
+    const int32_t histogram_type = data->histogram_type;
+    const int32_t histogram_flags = data->flags;
+    const uint32_t histogram_bucket_count = data->bucket_count;
+    if (histogram_type != HISTOGRAM && histogram_type != LINEAR_HISTOGRAM &&
+        histogram_type != BOOLEAN_HISTOGRAM &&
+        histogram_type != CUSTOM_HISTOGRAM) {
+      continue;
+    }
+
+    std::unique_ptr<BucketRanges> created_ranges =
+        CreateRangesFromPersistentData(memory_allocator_.get(),
+                                       data->ranges_ref, data->ranges_checksum,
+                                       histogram_bucket_count);
+    const size_t counts_bytes =
+        CalculateRequiredCountsBytes(histogram_bucket_count);
+    if (!created_ranges || counts_bytes == 0)
+      continue;
+
+    histograms_.push_back(std::make_unique<HistogramState>(
+        memory_allocator_.get(), data,
+        static_cast<HistogramType>(histogram_type), histogram_flags,
+        ranges_manager_.RegisterOrDeleteDuplicateRanges(
+            created_ranges.release()),
+        counts_bytes));
+  }
+}
+
+std::unique_ptr<HistogramSamples> PersistentHistogramReader::ReadSamples(
+    HistogramState* state) {
+  const uint64_t id = state->logged_samples.id();
+  HistogramSamples::Metadata& samples_metadata = state->data->samples_metadata;
+  HistogramSamples::Metadata& logged_metadata = state->data->logged_metadata;
+
+  std::unique_ptr<SampleVector> samples;
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    // The counts are read in place, but the metadata is copied so that the
+    // redundant counts can be checked against them.
+    HistogramSamples::LocalMetadata samples_copy;
+    HistogramSamples::LocalMetadata logged_copy;
+    CopyMetadata(samples_metadata, &samples_copy);
+    CopyMetadata(logged_metadata, &logged_copy);
+
+    samples = std::make_unique<SampleVector>(id, state->ranges);
+    samples->Add(PersistentSampleVector(id, state->ranges, &samples_copy,
+                                        state->counts_data));
+    samples->Add(PersistentSampleVector(id, state->ranges, &logged_copy,
+                                        state->logged_data));
+
+    if (samples->TotalCount() == samples->redundant_count() &&
+        subtle::Acquire_Load(&samples_metadata.redundant_count) ==
+            samples_copy.redundant_count &&
+        subtle::Acquire_Load(&logged_metadata.redundant_count) ==
+            logged_copy.redundant_count) {
+      break;
+    }
+  }
+  // If the samples are still inconsistent, they are used anyway, like
+  // Histogram::SnapshotDelta() does.
+  return samples;
+}
+
 GlobalHistogramAllocator::~GlobalHistogramAllocator() = default;
 
 // static
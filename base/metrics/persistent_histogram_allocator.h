@@ -26,6 +26,7 @@ namespace base {
 
 class BucketRanges;
 class FilePath;
+class HistogramSamples;
 class PersistentSampleMapRecords;
 class PersistentSparseHistogramDataManager;
 class WritableSharedMemoryRegion;
@@ -324,6 +325,8 @@ class BASE_EXPORT PersistentHistogramAllocator {
                                                             Reference ignore);
 
  private:
+  friend class PersistentHistogramReader;
+
   // Create a histogram based on saved (persistent) information about it.
   std::unique_ptr<HistogramBase> CreateHistogram(
       PersistentHistogramData* histogram_data_ptr);
@@ -355,6 +358,86 @@ class BASE_EXPORT PersistentHistogramAllocator {
 };
 
 
+// Reads the histograms held in a PersistentMemoryAllocator without writing to
+// it, so that a collector can map the segment of another process read-only
+// (see ReadOnlySharedPersistentMemoryAllocator) and collect its samples in
+// place. Unlike PersistentHistogramAllocator, no Histogram objects are created
+// and nothing is registered with the StatisticsRecorder; deltas are computed
+// against the samples remembered by the reader instead of by updating the
+// "logged" samples in the segment. The producer thus does no work at all for
+// its histograms to be collected.
+//
+// The samples are read while the producer may be recording new ones, so the
+// counts of a histogram may momentarily disagree with its redundant count,
+// which is updated after them. Each histogram is read again, up to a few
+// times, until both agree and the redundant count did not change while the
+// counts were read. Sparse histograms are not supported and are skipped.
+//
+// This class is not thread-safe.
+class BASE_EXPORT PersistentHistogramReader {
+ public:
+  // The samples recorded in a histogram since the previous snapshot.
+  struct BASE_EXPORT HistogramDelta {
+    HistogramDelta();
+    HistogramDelta(HistogramDelta&&);
+    HistogramDelta& operator=(HistogramDelta&&);
+    ~HistogramDelta();
+
+    // Points into the reader, valid until it is destroyed.
+    StringPiece name;
+    HistogramType type = HISTOGRAM;
+    int32_t flags = 0;
+
+    // The bucket ranges of the samples are owned by the reader.
+    std::unique_ptr<HistogramSamples> samples;
+  };
+
+  // |memory| can be read-only.
+  explicit PersistentHistogramReader(
+      std::unique_ptr<PersistentMemoryAllocator> memory);
+
+  PersistentHistogramReader(const PersistentHistogramReader&) = delete;
+  PersistentHistogramReader& operator=(const PersistentHistogramReader&) =
+      delete;
+
+  ~PersistentHistogramReader();
+
+  // Returns the samples recorded in each histogram of the segment since the
+  // previous call, or since it was created for the first call, omitting the
+  // histograms without new samples. Histograms added to the segment since the
+  // previous call are included.
+  std::vector<HistogramDelta> SnapshotDeltas();
+
+  // Returns the number of histograms found in the segment so far.
+  size_t histogram_count() const { return histograms_.size(); }
+
+ private:
+  struct HistogramState;
+
+  // The number of times a histogram is read at most to get consistent samples.
+  static constexpr int kMaxReadAttempts = 3;
+
+  // Finds the histograms added to the segment since the previous call.
+  void FindNewHistograms();
+
+  // Returns all the samples of |state|, both logged and unlogged by the
+  // producer.
+  std::unique_ptr<HistogramSamples> ReadSamples(HistogramState* state);
+
+  // The memory allocator that provides the histograms.
+  std::unique_ptr<PersistentMemoryAllocator> memory_allocator_;
+
+  // Continues from the last histogram found.
+  PersistentMemoryAllocator::Iterator memory_iter_;
+
+  // Owns the bucket ranges of the histograms, without contending with the
+  // StatisticsRecorder.
+  RangesManager ranges_manager_;
+
+  std::vector<std::unique_ptr<HistogramState>> histograms_;
+};
+
+
 // A special case of the PersistentHistogramAllocator that operates on a
 // global scale, collecting histograms created through standard macros and
 // the FactoryGet() method.
@@ -11,6 +11,7 @@
 #include "base/memory/raw_ptr.h"
 #include "base/metrics/bucket_ranges.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/metrics/histogram_samples.h"
 #include "base/metrics/persistent_memory_allocator.h"
 #include "base/metrics/statistics_recorder.h"
 #include "testing/gmock/include/gmock/gmock.h"
@@ -454,4 +455,61 @@ TEST_F(PersistentHistogramAllocatorTest, RangesDeDuplication) {
   EXPECT_EQ(ranges_ref, data2[kRangesRefIndex]);
 }
 
+TEST_F(PersistentHistogramAllocatorTest, ReaderSnapshotsDeltas) {
+  HistogramBase* histogram =
+      Histogram::FactoryGet("TestHistogram", 1, 1000, 10, 0);
+  HistogramBase* linear_histogram =
+      LinearHistogram::FactoryGet("TestLinearHistogram", 1, 10, 11, 0);
+  HistogramBase* sparse_histogram =
+      SparseHistogram::FactoryGet("TestSparseHistogram", 0);
+  histogram->Add(5);
+  linear_histogram->Add(3);
+  linear_histogram->Add(3);
+  linear_histogram->Add(7);
+  sparse_histogram->Add(1);
+
+  // Read the segment like another process would.
+  PersistentHistogramReader reader(std::make_unique<PersistentMemoryAllocator>(
+      allocator_memory_.get(), kAllocatorMemorySize, 0, 0, "",
+      /*readonly=*/true));
+  std::vector<PersistentHistogramReader::HistogramDelta> deltas =
+      reader.SnapshotDeltas();
+
+  // The sparse histogram is skipped.
+  EXPECT_EQ(2U, reader.histogram_count());
+  ASSERT_EQ(2U, deltas.size());
+  EXPECT_EQ("TestHistogram", deltas[0].name);
+  EXPECT_EQ(HISTOGRAM, deltas[0].type);
+  EXPECT_EQ(1, deltas[0].samples->TotalCount());
+  EXPECT_EQ(1, deltas[0].samples->GetCount(5));
+  EXPECT_EQ("TestLinearHistogram", deltas[1].name);
+  EXPECT_EQ(LINEAR_HISTOGRAM, deltas[1].type);
+  EXPECT_EQ(3, deltas[1].samples->TotalCount());
+  EXPECT_EQ(2, deltas[1].samples->GetCount(3));
+  EXPECT_EQ(13, deltas[1].samples->sum());
+
+  EXPECT_TRUE(reader.SnapshotDeltas().empty());
+
+  // Samples moved to the "logged" counts by the producer are not reported
+  // again. The single sample of |histogram| moves to its counts array.
+  EXPECT_EQ(3, linear_histogram->SnapshotDelta()->TotalCount());
+  histogram->Add(500);
+  HistogramBase* boolean_histogram =
+      BooleanHistogram::FactoryGet("TestBooleanHistogram", 0);
+  boolean_histogram->Add(true);
+
+  deltas = reader.SnapshotDeltas();
+  EXPECT_EQ(3U, reader.histogram_count());
+  ASSERT_EQ(2U, deltas.size());
+  EXPECT_EQ("TestHistogram", deltas[0].name);
+  EXPECT_EQ(1, deltas[0].samples->TotalCount());
+  EXPECT_EQ(1, deltas[0].samples->GetCount(500));
+  EXPECT_EQ("TestBooleanHistogram", deltas[1].name);
+  EXPECT_EQ(BOOLEAN_HISTOGRAM, deltas[1].type);
+  EXPECT_EQ(1, deltas[1].samples->GetCount(1));
+
+  // The reader didn't change the samples logged by the producer.
+  EXPECT_EQ(2, histogram->SnapshotDelta()->TotalCount());
+}
+
 }  // namespace base
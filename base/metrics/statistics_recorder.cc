@@ -9,6 +9,7 @@
 #include "base/at_exit.h"
 #include "base/containers/contains.h"
 #include "base/debug/leak_annotations.h"
+#include "base/hash/hash.h"
 #include "base/json/string_escape.h"
 #include "base/logging.h"
 #include "base/memory/ptr_util.h"
@@ -29,14 +30,146 @@ bool HistogramNameLesser(const base::HistogramBase* a,
   return strcmp(a->histogram_name(), b->histogram_name()) < 0;
 }
 
+// A small direct-mapped cache of the histograms found by the current thread,
+// so that the same few histograms looked up by name over and over don't touch
+// memory shared with other threads.
+struct LookupCache {
+  static constexpr size_t kSize = 32;
+
+  struct Entry {
+    size_t hash;
+    HistogramBase* histogram;
+  };
+
+  // The StatisticsRecorder::lookup_cache_generation_ which |entries| are
+  // valid for.
+  uint32_t generation;
+  Entry entries[kSize];
+};
+
+thread_local LookupCache g_lookup_cache;
+
 }  // namespace
 
+// An open addressing hash table of the registered histograms. Histograms are
+// only added with the global lock held, and can be found concurrently without
+// it. When the table grows, or when a histogram is removed in tests, it is
+// replaced by a new table; the old ones stay alive as long as the index since
+// lock-free readers may still be using them.
+class StatisticsRecorder::HistogramIndex {
+ public:
+  HistogramIndex() {
+    tables_.push_back(std::make_unique<Table>(kInitialCapacity));
+    table_.store(tables_.back().get(), std::memory_order_relaxed);
+  }
+
+  HistogramIndex(const HistogramIndex&) = delete;
+  HistogramIndex& operator=(const HistogramIndex&) = delete;
+
+  ~HistogramIndex() = default;
+
+  // Returns the histogram named |name|, whose FastHash() is |hash|, or null.
+  // Doesn't require the global lock.
+  HistogramBase* Find(StringPiece name, size_t hash) const {
+    const Table* const table = table_.load(std::memory_order_acquire);
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+      const Slot& slot = table->slots[i];
+      HistogramBase* const histogram =
+          slot.histogram.load(std::memory_order_acquire);
+      if (!histogram)
+        return nullptr;
+      if (slot.hash == hash && name == histogram->histogram_name())
+        return histogram;
+    }
+  }
+
+  // Adds |histogram|, which must not be in the index yet.
+  //
+  // Precondition: The global lock is already acquired.
+  void Insert(HistogramBase* histogram) {
+    lock_.Get().AssertAcquired();
+    Table* table = tables_.back().get();
+    // Keeps the load factor at most 1/2 so that probe sequences stay short.
+    if ((size_ + 1) * 2 > table->mask + 1)
+      table = Rebuild((table->mask + 1) * 2, nullptr);
+    InsertInto(table, histogram);
+    ++size_;
+  }
+
+  // Removes |histogram| from the index, for testing.
+  //
+  // Precondition: The global lock is already acquired.
+  void RemoveForTesting(const HistogramBase* histogram) {
+    lock_.Get().AssertAcquired();
+    Rebuild(tables_.back()->mask + 1, histogram);
+    --size_;
+  }
+
+ private:
+  static constexpr size_t kInitialCapacity = 256;
+
+  struct Slot {
+    // Written before |histogram| is published, and never changed afterwards.
+    size_t hash = 0;
+    std::atomic<HistogramBase*> histogram{nullptr};
+  };
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : mask(capacity - 1), slots(new Slot[capacity]) {}
+
+    const size_t mask;
+    const std::unique_ptr<Slot[]> slots;
+  };
+
+  static void InsertInto(Table* table, HistogramBase* histogram) {
+    const size_t hash = FastHash(histogram->histogram_name());
+    size_t i = hash & table->mask;
+    while (table->slots[i].histogram.load(std::memory_order_relaxed))
+      i = (i + 1) & table->mask;
+    table->slots[i].hash = hash;
+    table->slots[i].histogram.store(histogram, std::memory_order_release);
+  }
+
+  // Publishes a table of |capacity| slots with all the histograms in the
+  // current one except |excluded|, and returns it.
+  Table* Rebuild(size_t capacity, const HistogramBase* excluded) {
+    const Table* const old_table = tables_.back().get();
+    auto table = std::make_unique<Table>(capacity);
+    for (size_t i = 0; i <= old_table->mask; ++i) {
+      HistogramBase* const histogram =
+          old_table->slots[i].histogram.load(std::memory_order_relaxed);
+      if (histogram && histogram != excluded)
+        InsertInto(table.get(), histogram);
+    }
+    tables_.push_back(std::move(table));
+    table_.store(tables_.back().get(), std::memory_order_release);
+    return tables_.back().get();
+  }
+
+  // The current table, which is the last of |tables_|.
+  std::atomic<const Table*> table_;
+
+  // All the tables ever used by the index.
+  std::vector<std::unique_ptr<Table>> tables_;
+
+  // The number of histograms in the index.
+  size_t size_ = 0;
+};
+
 // static
 LazyInstance<Lock>::Leaky StatisticsRecorder::lock_;
 
 // static
 StatisticsRecorder* StatisticsRecorder::top_ = nullptr;
 
+// static
+std::atomic<StatisticsRecorder::HistogramIndex*>
+    StatisticsRecorder::top_index_{nullptr};
+
+// static
+std::atomic<uint32_t> StatisticsRecorder::lookup_cache_generation_{0};
+
 // static
 bool StatisticsRecorder::is_vlog_initialized_ = false;
 
@@ -70,6 +203,13 @@ StatisticsRecorder::~StatisticsRecorder() {
   const AutoLock auto_lock(lock_.Get());
   DCHECK_EQ(this, top_);
   top_ = previous_;
+  top_index_.store(top_ ? top_->index_.get() : nullptr,
+                   std::memory_order_release);
+  lookup_cache_generation_.fetch_add(1, std::memory_order_release);
+
+  // Lock-free readers may still be using the index, so it is leaked like the
+  // histograms it refers to.
+  ANNOTATE_LEAKING_OBJECT_PTR(index_.release());
 }
 
 // static
@@ -108,6 +248,7 @@ HistogramBase* StatisticsRecorder::RegisterOrDeleteDuplicate(
     // as the histogram is alive (which is forever).
     registered = histogram;
     ANNOTATE_LEAKING_OBJECT_PTR(histogram);  // see crbug.com/79322
+    top_->index_->Insert(histogram);
     // If there are callbacks for this histogram, we set the kCallbackExists
     // flag.
     if (base::Contains(top_->observers_, name))
@@ -181,6 +322,12 @@ std::vector<const BucketRanges*> StatisticsRecorder::GetBucketRanges() {
 
 // static
 HistogramBase* StatisticsRecorder::FindHistogram(base::StringPiece name) {
+  // Registered histograms are never unregistered outside of tests, so there
+  // is no need to import persistent histograms or to take the lock to find
+  // them.
+  if (HistogramBase* histogram = FindHistogramLockFree(name, FastHash(name)))
+    return histogram;
+
   // This must be called *before* the lock is acquired below because it will
   // call back into this object to register histograms. Those called methods
   // will acquire the lock at that time.
@@ -333,6 +480,8 @@ void StatisticsRecorder::ForgetHistogramForTesting(base::StringPiece name) {
     return;
 
   HistogramBase* const base = found->second;
+  top_->index_->RemoveForTesting(base);
+  lookup_cache_generation_.fetch_add(1, std::memory_order_release);
   if (base->GetHistogramType() != SPARSE_HISTOGRAM) {
     // When forgetting a histogram, it's likely that other information is
     // also becoming invalid. Clear the persistent reference that may no
@@ -424,6 +573,32 @@ StatisticsRecorder::Histograms StatisticsRecorder::NonPersistent(
   return histograms;
 }
 
+// static
+HistogramBase* StatisticsRecorder::FindHistogramLockFree(StringPiece name,
+                                                         size_t hash) {
+  LookupCache& cache = g_lookup_cache;
+  const uint32_t generation =
+      lookup_cache_generation_.load(std::memory_order_acquire);
+  if (cache.generation != generation) {
+    cache = {};
+    cache.generation = generation;
+  }
+  LookupCache::Entry& entry = cache.entries[hash % LookupCache::kSize];
+  if (entry.histogram && entry.hash == hash &&
+      name == entry.histogram->histogram_name()) {
+    return entry.histogram;
+  }
+
+  const HistogramIndex* const index =
+      top_index_.load(std::memory_order_acquire);
+  if (!index)
+    return nullptr;
+  HistogramBase* const histogram = index->Find(name, hash);
+  if (histogram)
+    entry = {hash, histogram};
+  return histogram;
+}
+
 // static
 void StatisticsRecorder::ImportGlobalPersistentHistograms() {
   // Import histograms from known persistent storage. Histograms could have been
@@ -434,10 +609,13 @@ void StatisticsRecorder::ImportGlobalPersistentHistograms() {
     allocator->ImportHistogramsToStatisticsRecorder();
 }
 
-StatisticsRecorder::StatisticsRecorder() {
+StatisticsRecorder::StatisticsRecorder()
+    : index_(std::make_unique<HistogramIndex>()) {
   lock_.Get().AssertAcquired();
   previous_ = top_;
   top_ = this;
+  top_index_.store(index_.get(), std::memory_order_release);
+  lookup_cache_generation_.fetch_add(1, std::memory_order_release);
   InitLogOnShutdownWhileLocked();
 }
 
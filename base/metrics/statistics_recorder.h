@@ -10,6 +10,7 @@
 #ifndef BASE_METRICS_STATISTICS_RECORDER_H_
 #define BASE_METRICS_STATISTICS_RECORDER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <atomic>
@@ -169,7 +170,10 @@ class BASE_EXPORT StatisticsRecorder {
   // Finds a histogram by name. Matches the exact name. Returns a null pointer
   // if a matching histogram is not found.
   //
-  // This method is thread safe.
+  // This method is thread safe. Registered histograms are found without
+  // taking the global lock, and are cached per thread, so it is cheap enough
+  // to be called each time a sample is recorded, as the functions in
+  // histogram_functions.h do.
   static HistogramBase* FindHistogram(base::StringPiece name);
 
   // Imports histograms from providers.
@@ -307,9 +311,17 @@ class BASE_EXPORT StatisticsRecorder {
                              scoped_refptr<HistogramSampleObserverList>>
       ObserverMap;
 
+  // The registered histograms, indexed by name for lock-free lookups.
+  class HistogramIndex;
+
   friend class StatisticsRecorderTest;
   FRIEND_TEST_ALL_PREFIXES(StatisticsRecorderTest, IterationTest);
 
+  // Finds a registered histogram without taking the global lock. |hash| is
+  // the FastHash() of |name|. Returns null if it is not found, in which case
+  // it may still have been registered concurrently.
+  static HistogramBase* FindHistogramLockFree(StringPiece name, size_t hash);
+
   // Initializes the global recorder if it doesn't already exist. Safe to call
   // multiple times.
   //
@@ -343,6 +355,7 @@ class BASE_EXPORT StatisticsRecorder {
   static void InitLogOnShutdownWhileLocked();
 
   HistogramMap histograms_;
+  std::unique_ptr<HistogramIndex> index_;
   ObserverMap observers_;
   HistogramProviders providers_;
   RangesManager ranges_manager_;
@@ -359,6 +372,13 @@ class BASE_EXPORT StatisticsRecorder {
   // previous global recorder is referenced by top_->previous_.
   static StatisticsRecorder* top_;
 
+  // The index of |top_|, for lookups without the global lock.
+  static std::atomic<HistogramIndex*> top_index_;
+
+  // Incremented whenever a registered histogram may no longer be found, e.g.
+  // when |top_| changes, to invalidate the per-thread lookup caches.
+  static std::atomic<uint32_t> lookup_cache_generation_;
+
   // Tracks whether InitLogOnShutdownWhileLocked() has registered a logging
   // function that will be called when the program finishes.
   static bool is_vlog_initialized_;
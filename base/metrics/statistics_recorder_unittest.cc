@@ -20,7 +20,10 @@
 #include "base/metrics/persistent_histogram_allocator.h"
 #include "base/metrics/record_histogram_checker.h"
 #include "base/metrics/sparse_histogram.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/bind.h"
 #include "base/test/task_environment.h"
+#include "base/threading/thread.h"
 #include "base/values.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -225,6 +228,67 @@ TEST_P(StatisticsRecorderTest, FindHistogram) {
   EXPECT_FALSE(StatisticsRecorder::FindHistogram("TestHistogram"));
 }
 
+// Histograms are found without the lock, including while the index grows
+// because more histograms are registered concurrently.
+TEST_P(StatisticsRecorderTest, FindHistogramWhileRegistering) {
+  // More histograms are created than fit in the persistent memory.
+  old_global_allocator_ = GlobalHistogramAllocator::ReleaseForTesting();
+
+  constexpr int kNumHistograms = 1000;
+  std::vector<HistogramBase*> registered;
+  for (int i = 0; i < kNumHistograms; ++i) {
+    registered.push_back(
+        Histogram::FactoryGet("Registered" + NumberToString(i), 1, 1000, 10,
+                              HistogramBase::kNoFlags));
+  }
+
+  Thread thread("FindHistogram");
+  ASSERT_TRUE(thread.Start());
+  thread.task_runner()->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+    for (int round = 0; round < 10; ++round) {
+      for (int i = 0; i < kNumHistograms; ++i) {
+        EXPECT_EQ(registered[i], StatisticsRecorder::FindHistogram(
+                                     "Registered" + NumberToString(i)));
+      }
+    }
+  }));
+
+  std::vector<HistogramBase*> added;
+  for (int i = 0; i < kNumHistograms; ++i) {
+    added.push_back(Histogram::FactoryGet("Added" + NumberToString(i), 1,
+                                          1000, 10, HistogramBase::kNoFlags));
+  }
+  thread.Stop();
+
+  for (int i = 0; i < kNumHistograms; ++i) {
+    EXPECT_EQ(registered[i], StatisticsRecorder::FindHistogram(
+                                 "Registered" + NumberToString(i)));
+    EXPECT_EQ(added[i],
+              StatisticsRecorder::FindHistogram("Added" + NumberToString(i)));
+  }
+  EXPECT_EQ(2u * kNumHistograms, StatisticsRecorder::GetHistogramCount());
+}
+
+TEST_P(StatisticsRecorderTest, ForgetHistogram) {
+  old_global_allocator_ = GlobalHistogramAllocator::ReleaseForTesting();
+
+  HistogramBase* const histogram1 = Histogram::FactoryGet(
+      "TestHistogram1", 1, 1000, 10, HistogramBase::kNoFlags);
+  HistogramBase* const histogram2 = Histogram::FactoryGet(
+      "TestHistogram2", 1, 1000, 10, HistogramBase::kNoFlags);
+  // Looked up once to be in this thread's cache.
+  EXPECT_EQ(histogram1, StatisticsRecorder::FindHistogram("TestHistogram1"));
+
+  StatisticsRecorder::ForgetHistogramForTesting("TestHistogram1");
+  EXPECT_FALSE(StatisticsRecorder::FindHistogram("TestHistogram1"));
+  EXPECT_EQ(histogram2, StatisticsRecorder::FindHistogram("TestHistogram2"));
+
+  HistogramBase* const histogram3 = Histogram::FactoryGet(
+      "TestHistogram1", 1, 1000, 10, HistogramBase::kNoFlags);
+  EXPECT_NE(histogram1, histogram3);
+  EXPECT_EQ(histogram3, StatisticsRecorder::FindHistogram("TestHistogram1"));
+}
+
 TEST_P(StatisticsRecorderTest, WithName) {
   Histogram::FactoryGet("TestHistogram1", 1, 1000, 10, Histogram::kNoFlags);
   Histogram::FactoryGet("TestHistogram2", 1, 1000, 10, Histogram::kNoFlags);
@@ -0,0 +1,550 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/fork_server.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/command_line.h"
+#include "base/containers/cxx20_erase_vector.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/pickle.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/posix/file_descriptor_shuffle.h"
+#include "base/posix/unix_domain_socket.h"
+#include "base/threading/thread_restrictions.h"
+#include "base/trace_event/base_tracing.h"
+#include "build/build_config.h"
+
+namespace base {
+
+namespace {
+
+// Requests sent to the server. Each of them carries a reply socket as its
+// first file descriptor.
+enum Command {
+  // Followed by the arguments and by the target of each of the remaining file
+  // descriptors. Answered with the pid of the child, or -1 on failure.
+  kLaunch,
+  // Followed by the pid of a launched child. Answered once the child exited,
+  // with true and its exit code, or with false if it is unknown.
+  kWaitForExit,
+};
+
+// Launch requests are forwarded as-is to a child, so this bounds both the
+// request and the command line.
+constexpr size_t kMaxMessageSize = 64 * 1024;
+constexpr size_t kMaxReplySize = 4 * 1024;
+
+// Returns the name of a field of |options| that ForkServer::LaunchProcess()
+// does not support, or null if there is none.
+const char* GetUnsupportedOption(const LaunchOptions& options) {
+  if (!options.environment.empty())
+    return "environment";
+  if (options.clear_environment)
+    return "clear_environment";
+  if (!options.current_directory.empty())
+    return "current_directory";
+  if (options.wait)
+    return "wait";
+  if (!options.real_path.empty())
+    return "real_path";
+  if (options.pre_exec_delegate)
+    return "pre_exec_delegate";
+  if (options.maximize_rlimits)
+    return "maximize_rlimits";
+  if (options.new_process_group)
+    return "new_process_group";
+  if (options.clone_flags)
+    return "clone_flags";
+  if (options.kill_on_parent_death)
+    return "kill_on_parent_death";
+#if BUILDFLAG(IS_CHROMEOS)
+  if (options.ctrl_terminal_fd >= 0)
+    return "ctrl_terminal_fd";
+#endif
+  return nullptr;
+}
+
+struct IdleChild {
+  pid_t pid;
+  ScopedFD socket;
+};
+
+// Runs in an idle child: waits for a launch request, then becomes the
+// requested process. |signal_mask| is the mask of the caller of Create().
+[[noreturn]] void RunChild(int socket,
+                           ForkServer::ChildMain child_main,
+                           const sigset_t& signal_mask) {
+  // Only keep the connection to the server, in particular not the sockets of
+  // the other children: they must see EOF when the server goes away.
+  CloseSuperfluousFds({InjectionArc(socket, socket, false)});
+  sigprocmask(SIG_SETMASK, &signal_mask, nullptr);
+
+  std::vector<char> buffer(kMaxMessageSize);
+  std::vector<ScopedFD> fds;
+  const ssize_t length =
+      UnixDomainSocket::RecvMsg(socket, buffer.data(), buffer.size(), &fds);
+  // The server is shutting down.
+  if (length <= 0)
+    _exit(0);
+
+  Pickle request(buffer.data(), static_cast<size_t>(length));
+  PickleIterator iter(request);
+  int command;
+  int argc;
+  if (!iter.ReadInt(&command) || command != kLaunch || !iter.ReadInt(&argc) ||
+      argc <= 0) {
+    RAW_LOG(ERROR, "ForkServer: malformed launch request");
+    _exit(127);
+  }
+  std::vector<std::string> argv(static_cast<size_t>(argc));
+  for (std::string& arg : argv) {
+    if (!iter.ReadString(&arg)) {
+      RAW_LOG(ERROR, "ForkServer: malformed launch request");
+      _exit(127);
+    }
+  }
+
+  int fd_count;
+  if (!iter.ReadInt(&fd_count) || fd_count < 0 ||
+      static_cast<size_t>(fd_count) != fds.size()) {
+    RAW_LOG(ERROR, "ForkServer: malformed launch request");
+    _exit(127);
+  }
+  InjectiveMultimap fd_shuffle1;
+  InjectiveMultimap fd_shuffle2;
+  for (ScopedFD& fd : fds) {
+    int dest;
+    if (!iter.ReadInt(&dest) || dest < 0) {
+      RAW_LOG(ERROR, "ForkServer: malformed launch request");
+      _exit(127);
+    }
+    // Closed below by CloseSuperfluousFds(), unless mapped onto themselves.
+    const int source = fd.release();
+    fd_shuffle1.push_back(InjectionArc(source, dest, false));
+    fd_shuffle2.push_back(InjectionArc(source, dest, false));
+  }
+  // Same as in LaunchProcess(). This also closes |socket|.
+  if (!ShuffleFileDescriptors(&fd_shuffle1))
+    _exit(127);
+  CloseSuperfluousFds(fd_shuffle2);
+
+  std::vector<const char*> argv_cstr;
+  argv_cstr.reserve(argv.size());
+  for (const std::string& arg : argv)
+    argv_cstr.push_back(arg.c_str());
+  if (CommandLine::InitializedForCurrentProcess())
+    CommandLine::Reset();
+  CommandLine::Init(argc, argv_cstr.data());
+
+  _exit(child_main());
+}
+
+// Sends a pickled |reply| on |socket|. Returns false if the requester went
+// away, e.g. because it timed out.
+bool SendReply(int socket, const Pickle& reply) {
+  return UnixDomainSocket::SendMsg(socket, reply.data(), reply.size(), {});
+}
+
+bool SendExitCode(int socket, int exit_code) {
+  Pickle reply;
+  reply.WriteBool(true);
+  reply.WriteInt(exit_code);
+  return SendReply(socket, reply);
+}
+
+// Returns whether the requester closed its end of |socket|.
+bool PeerClosed(int socket) {
+  struct pollfd poll_fd = {socket, 0, 0};
+  return HANDLE_EINTR(poll(&poll_fd, 1, 0)) > 0 &&
+         (poll_fd.revents & (POLLHUP | POLLERR));
+}
+
+// State of the server. Runs in the server process only.
+class Server {
+ public:
+  Server(int socket,
+         ForkServer::ChildMain child_main,
+         size_t pool_size,
+         const sigset_t& signal_mask)
+      : socket_(socket),
+        child_main_(child_main),
+        pool_size_(pool_size),
+        signal_mask_(signal_mask) {}
+
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  // Serves requests until |socket_| is closed. |signal_fd| reports SIGCHLD.
+  void Run(int signal_fd) {
+    FillPool();
+    std::vector<char> buffer(kMaxMessageSize);
+    for (;;) {
+      struct pollfd poll_fds[] = {{socket_, POLLIN, 0}, {signal_fd, POLLIN, 0}};
+      if (HANDLE_EINTR(poll(poll_fds, std::size(poll_fds), -1)) < 0) {
+        DPLOG(ERROR) << "poll";
+        break;
+      }
+
+      if (poll_fds[1].revents) {
+        // SIGCHLD is not queued, so a single read clears it. Check all the
+        // children that may have exited since.
+        struct signalfd_siginfo siginfo;
+        HANDLE_EINTR(read(signal_fd, &siginfo, sizeof(siginfo)));
+        ReapChildren();
+        FillPool();
+      }
+
+      if (!poll_fds[0].revents)
+        continue;
+      std::vector<ScopedFD> fds;
+      const ssize_t length = UnixDomainSocket::RecvMsg(socket_, buffer.data(),
+                                                       buffer.size(), &fds);
+      // The caller went away.
+      if (length <= 0)
+        break;
+      Pickle request(buffer.data(), static_cast<size_t>(length));
+      HandleRequest(request, std::move(fds));
+    }
+
+    // Closing the sockets makes the idle children exit. Launched children are
+    // inherited by init, or by the nearest subreaper.
+    for (IdleChild& child : idle_children_) {
+      child.socket.reset();
+      HANDLE_EINTR(waitpid(child.pid, nullptr, 0));
+    }
+  }
+
+ private:
+  void HandleRequest(const Pickle& request, std::vector<ScopedFD> fds) {
+    PickleIterator iter(request);
+    int command;
+    if (fds.empty() || !iter.ReadInt(&command))
+      return;
+    ScopedFD reply_socket = std::move(fds.front());
+    fds.erase(fds.begin());
+
+    switch (command) {
+      case kLaunch:
+        Launch(request, std::move(fds), std::move(reply_socket));
+        break;
+      case kWaitForExit: {
+        int pid;
+        if (iter.ReadInt(&pid))
+          WaitForExit(pid, std::move(reply_socket));
+        break;
+      }
+    }
+  }
+
+  void Launch(const Pickle& request,
+              std::vector<ScopedFD> fds,
+              ScopedFD reply_socket) {
+    std::vector<int> raw_fds;
+    for (const ScopedFD& fd : fds)
+      raw_fds.push_back(fd.get());
+    pid_t pid = -1;
+    // Children can have died since they were forked, e.g. if they were
+    // killed. Reap such a child and try the next one.
+    while (pid < 0) {
+      if (idle_children_.empty() && !ForkChild())
+        break;
+      IdleChild child = std::move(idle_children_.back());
+      idle_children_.pop_back();
+      if (UnixDomainSocket::SendMsg(child.socket.get(), request.data(),
+                                    request.size(), raw_fds)) {
+        pid = child.pid;
+        launched_children_.insert(pid);
+      } else {
+        // Only its socket may be broken: make sure the child is gone.
+        kill(child.pid, SIGKILL);
+        HANDLE_EINTR(waitpid(child.pid, nullptr, 0));
+      }
+    }
+
+    Pickle reply;
+    reply.WriteInt(pid);
+    SendReply(reply_socket.get(), reply);
+    // Don't let the new children inherit the requester's descriptors.
+    fds.clear();
+    reply_socket.reset();
+
+    // Refill the pool once the requester has its answer.
+    FillPool();
+  }
+
+  void WaitForExit(pid_t pid, ScopedFD reply_socket) {
+    if (!launched_children_.count(pid)) {
+      Pickle reply;
+      reply.WriteBool(false);
+      SendReply(reply_socket.get(), reply);
+      return;
+    }
+    std::vector<ScopedFD>& waiters = waiters_[pid];
+    // Drop the requests that timed out, so that polling a long-running child
+    // does not accumulate sockets.
+    EraseIf(waiters,
+            [](const ScopedFD& waiter) { return PeerClosed(waiter.get()); });
+    waiters.push_back(std::move(reply_socket));
+    NotifyIfExited(pid);
+  }
+
+  // Reaps the idle children that exited, and answers the requests waiting for
+  // launched children that exited.
+  void ReapChildren() {
+    // An idle child died, e.g. because it was killed.
+    EraseIf(idle_children_, [](const IdleChild& child) {
+      return HANDLE_EINTR(waitpid(child.pid, nullptr, WNOHANG)) > 0;
+    });
+
+    std::vector<pid_t> waited_pids;
+    for (const auto& waiters : waiters_)
+      waited_pids.push_back(waiters.first);
+    for (pid_t pid : waited_pids)
+      NotifyIfExited(pid);
+  }
+
+  // Answers the requests waiting for |pid| if it exited. The child is only
+  // reaped once its exit code was delivered: until then it stays a zombie, so
+  // that its pid is not reused while the caller can still signal it. This also
+  // keeps its exit code, without the server having to.
+  void NotifyIfExited(pid_t pid) {
+    siginfo_t info = {};
+    if (HANDLE_EINTR(waitid(P_PID, static_cast<id_t>(pid), &info,
+                            WEXITED | WNOHANG | WNOWAIT)) < 0 ||
+        info.si_pid == 0) {
+      return;
+    }
+    // Same as Process::WaitForExitWithTimeout().
+    const int exit_code = info.si_code == CLD_EXITED ? info.si_status : -1;
+
+    bool delivered = false;
+    auto waiters = waiters_.find(pid);
+    if (waiters != waiters_.end()) {
+      for (const ScopedFD& reply_socket : waiters->second)
+        delivered |= SendExitCode(reply_socket.get(), exit_code);
+      waiters_.erase(waiters);
+    }
+    if (delivered) {
+      HANDLE_EINTR(waitpid(pid, nullptr, 0));
+      launched_children_.erase(pid);
+    }
+  }
+
+  void FillPool() {
+    while (idle_children_.size() < pool_size_ && ForkChild()) {
+    }
+  }
+
+  // Forks an idle child. Returns false on failure.
+  bool ForkChild() {
+    ScopedFD server_socket;
+    ScopedFD child_socket;
+    if (!CreateSocketPair(&server_socket, &child_socket))
+      return false;
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+      DPLOG(ERROR) << "fork";
+      return false;
+    }
+    if (pid == 0)
+      RunChild(child_socket.get(), child_main_, signal_mask_);
+
+    idle_children_.push_back({pid, std::move(server_socket)});
+    return true;
+  }
+
+  const int socket_;
+  const ForkServer::ChildMain child_main_;
+  const size_t pool_size_;
+  const sigset_t signal_mask_;
+
+  std::vector<IdleChild> idle_children_;
+  // Launched children that have not been reaped yet.
+  std::set<pid_t> launched_children_;
+  // Reply sockets of the kWaitForExit requests, by pid.
+  std::map<pid_t, std::vector<ScopedFD>> waiters_;
+};
+
+// Runs in the server: serves requests from |socket| until it is closed.
+[[noreturn]] void RunServer(int socket,
+                            ForkServer::ChildMain child_main,
+                            size_t pool_size) {
+  // Drop the file descriptors of the caller, which the children would
+  // otherwise inherit.
+  CloseSuperfluousFds({InjectionArc(socket, socket, false)});
+
+  // The server reaps its children, whatever the caller did with SIGCHLD.
+  signal(SIGCHLD, SIG_DFL);
+  sigset_t sigchld;
+  sigemptyset(&sigchld);
+  sigaddset(&sigchld, SIGCHLD);
+  sigset_t signal_mask;
+  sigprocmask(SIG_BLOCK, &sigchld, &signal_mask);
+  ScopedFD signal_fd(signalfd(-1, &sigchld, SFD_NONBLOCK | SFD_CLOEXEC));
+  if (!signal_fd.is_valid()) {
+    DPLOG(ERROR) << "signalfd";
+    _exit(1);
+  }
+
+  Server(socket, child_main, pool_size, signal_mask).Run(signal_fd.get());
+  _exit(0);
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<ForkServer> ForkServer::Create(ChildMain child_main,
+                                               size_t pool_size) {
+  DCHECK(child_main);
+  ScopedFD socket;
+  ScopedFD server_socket;
+  if (!CreateSocketPair(&socket, &server_socket))
+    return nullptr;
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    DPLOG(ERROR) << "fork";
+    return nullptr;
+  }
+  if (pid == 0) {
+    // See comments on the ResetFDOwnership() declaration in
+    // base/files/scoped_file.h regarding why this is called early here.
+    subtle::ResetFDOwnership();
+    RunServer(server_socket.get(), child_main, pool_size);
+  }
+
+  return WrapUnique(new ForkServer(pid, std::move(socket)));
+}
+
+ForkServer::ForkServer(pid_t server_pid, ScopedFD socket)
+    : server_pid_(server_pid), socket_(std::move(socket)) {}
+
+ForkServer::~ForkServer() {
+  // The server exits on EOF, once it reaped the idle children.
+  socket_.reset();
+  HANDLE_EINTR(waitpid(server_pid_, nullptr, 0));
+}
+
+Process ForkServer::LaunchProcess(const CommandLine& cmdline,
+                                  const LaunchOptions& options) {
+  TRACE_EVENT0("base", "ForkServer::LaunchProcess");
+  if (const char* option = GetUnsupportedOption(options)) {
+    LOG(ERROR) << "ForkServer: unsupported launch option " << option;
+    return Process();
+  }
+  // One descriptor is taken by the reply socket.
+  CHECK_LT(options.fds_to_remap.size(), UnixDomainSocket::kMaxFileDescriptors);
+
+  ScopedFD reply_socket;
+  ScopedFD server_reply_socket;
+  if (!CreateSocketPair(&reply_socket, &server_reply_socket))
+    return Process();
+
+  Pickle request;
+  request.WriteInt(kLaunch);
+  request.WriteInt(static_cast<int>(cmdline.argv().size()));
+  for (const std::string& arg : cmdline.argv())
+    request.WriteString(arg);
+  request.WriteInt(static_cast<int>(options.fds_to_remap.size()));
+  std::vector<int> fds = {server_reply_socket.get()};
+  for (const auto& fd_mapping : options.fds_to_remap) {
+    request.WriteInt(fd_mapping.second);
+    fds.push_back(fd_mapping.first);
+  }
+  CHECK_LE(request.size(), kMaxMessageSize);
+
+  if (!UnixDomainSocket::SendMsg(socket_.get(), request.data(), request.size(),
+                                 fds)) {
+    DPLOG(ERROR) << "ForkServer: sendmsg";
+    return Process();
+  }
+  // So that the read below fails instead of hanging if the server dies.
+  server_reply_socket.reset();
+
+  char buffer[kMaxReplySize];
+  std::vector<ScopedFD> reply_fds;
+  const ssize_t length = UnixDomainSocket::RecvMsg(
+      reply_socket.get(), buffer, sizeof(buffer), &reply_fds);
+  if (length <= 0)
+    return Process();
+  Pickle reply(buffer, static_cast<size_t>(length));
+  PickleIterator iter(reply);
+  int pid;
+  if (!iter.ReadInt(&pid) || pid <= 0)
+    return Process();
+  return Process(pid);
+}
+
+bool ForkServer::WaitForExit(const Process& process, int* exit_code) {
+  return WaitForExitWithTimeout(process, TimeDelta::Max(), exit_code);
+}
+
+bool ForkServer::WaitForExitWithTimeout(const Process& process,
+                                        TimeDelta timeout,
+                                        int* exit_code) {
+  TRACE_EVENT0("base", "ForkServer::WaitForExitWithTimeout");
+  DCHECK(process.IsValid());
+  if (!timeout.is_zero())
+    internal::AssertBaseSyncPrimitivesAllowed();
+
+  ScopedFD reply_socket;
+  ScopedFD server_reply_socket;
+  if (!CreateSocketPair(&reply_socket, &server_reply_socket))
+    return false;
+
+  Pickle request;
+  request.WriteInt(kWaitForExit);
+  request.WriteInt(process.Pid());
+  if (!UnixDomainSocket::SendMsg(socket_.get(), request.data(), request.size(),
+                                 {server_reply_socket.get()})) {
+    DPLOG(ERROR) << "ForkServer: sendmsg";
+    return false;
+  }
+  // So that the read below fails instead of hanging if the server dies.
+  server_reply_socket.reset();
+
+  // If this times out, the child is left unreaped for a later call.
+  struct pollfd poll_fd = {reply_socket.get(), POLLIN, 0};
+  const int timeout_ms =
+      timeout.is_max() ? -1
+                       : saturated_cast<int>(timeout.InMillisecondsRoundedUp());
+  if (HANDLE_EINTR(poll(&poll_fd, 1, timeout_ms)) <= 0)
+    return false;
+
+  char buffer[kMaxReplySize];
+  std::vector<ScopedFD> reply_fds;
+  const ssize_t length = UnixDomainSocket::RecvMsg(
+      reply_socket.get(), buffer, sizeof(buffer), &reply_fds);
+  if (length <= 0)
+    return false;
+  Pickle reply(buffer, static_cast<size_t>(length));
+  PickleIterator iter(reply);
+  bool exited;
+  int code;
+  if (!iter.ReadBool(&exited) || !exited || !iter.ReadInt(&code))
+    return false;
+  if (exit_code)
+    *exit_code = code;
+  return true;
+}
+
+}  // namespace base
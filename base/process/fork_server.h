@@ -0,0 +1,115 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROCESS_FORK_SERVER_H_
+#define BASE_PROCESS_FORK_SERVER_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <memory>
+
+#include "base/base_export.h"
+#include "base/files/scoped_file.h"
+#include "base/process/launch.h"
+#include "base/process/process.h"
+#include "base/time/time.h"
+
+namespace base {
+
+class CommandLine;
+
+// Launches child processes without forking the calling process.
+//
+// LaunchProcess() forks the caller and then execs the child, so the cost of a
+// launch grows with the size of the caller's address space, which has to be
+// copied, and includes the startup of the new binary. A ForkServer is instead
+// forked early, while the process is still small, and keeps a pool of idle
+// children forked from itself. Launching a process hands a command line and a
+// set of file descriptors to one of these children, which then runs
+// |child_main|, and the server forks a replacement. Launch latency is then
+// independent of the caller's size, which matters for processes spawning many
+// short-lived workers.
+//
+// The children are children of the server and not of the caller: use
+// ForkServer::WaitForExit() rather than Process::WaitForExit() to get their
+// exit code. The server only reaps a launched child once that exit code has
+// been returned, so until then the child stays a zombie after exiting, its pid
+// is not reused, and the returned Process can be used to signal or terminate
+// it.
+//
+// This composes with Mojo the same way LaunchProcess() does, as the endpoint
+// of a PlatformChannel is passed as one of |LaunchOptions::fds_to_remap|:
+//
+//   mojo::PlatformChannel channel;
+//   base::LaunchOptions options;
+//   channel.PrepareToPassRemoteEndpoint(&options, &command_line);
+//   base::Process process = fork_server->LaunchProcess(command_line, options);
+//   channel.RemoteProcessLaunchAttempted();
+//   mojo::OutgoingInvitation::Send(std::move(invitation), process.Handle(),
+//                                  channel.TakeLocalEndpoint());
+//
+// and |child_main| recovers the endpoint with
+// PlatformChannel::RecoverPassedEndpointFromCommandLine(). Children do not
+// exec, so |child_main| is responsible for initializing anything the server
+// did not, such as Mojo, and for engaging any sandbox.
+class BASE_EXPORT ForkServer {
+ public:
+  // Entry point of the children. The command line passed to LaunchProcess() is
+  // available through CommandLine::ForCurrentProcess(). The child exits with
+  // the returned code, without running exit handlers.
+  using ChildMain = int (*)();
+
+  // Forks the server, which keeps |pool_size| idle children ready. Returns
+  // null on failure. As the server does not exec, this should be called early,
+  // before other threads are started: both because forking a multi-threaded
+  // process is hazardous, and because children inherit the memory of the
+  // caller at the time of this call.
+  static std::unique_ptr<ForkServer> Create(ChildMain child_main,
+                                            size_t pool_size);
+
+  ForkServer(const ForkServer&) = delete;
+  ForkServer& operator=(const ForkServer&) = delete;
+  // Stops the server and the idle children, and waits for them to exit.
+  // Launched processes keep running, but are inherited by init, which reaps
+  // them: they can no longer be waited for, and their pids can be reused.
+  ~ForkServer();
+
+  // Launches a process running |child_main| with |cmdline| as its command
+  // line. Returns an invalid Process on failure. Can be called from any
+  // thread.
+  //
+  // The child is forked from the server, not exec'd, so of |options| only
+  // |fds_to_remap| is supported. Setting any of |environment|,
+  // |clear_environment|, |current_directory|, |wait|, |real_path|,
+  // |pre_exec_delegate|, |maximize_rlimits|, |new_process_group|,
+  // |clone_flags|, |kill_on_parent_death| or |ctrl_terminal_fd| makes the
+  // launch fail. |allow_new_privs| is ignored: the children do not set
+  // PR_SET_NO_NEW_PRIVS.
+  Process LaunchProcess(const CommandLine& cmdline,
+                        const LaunchOptions& options);
+
+  // Waits for a process returned by LaunchProcess() to exit, as
+  // Process::WaitForExitWithTimeout() does for children of the caller. This
+  // reaps the process, so its exit code is only returned once, after which
+  // its pid can be reused. Can be called from any thread.
+  bool WaitForExit(const Process& process, int* exit_code);
+  bool WaitForExitWithTimeout(const Process& process,
+                              TimeDelta timeout,
+                              int* exit_code);
+
+  pid_t server_pid() const { return server_pid_; }
+
+ private:
+  ForkServer(pid_t server_pid, ScopedFD socket);
+
+  const pid_t server_pid_;
+  // Connected to the server. Each request carries its own reply socket, so
+  // that requests from several threads do not need to be serialized.
+  ScopedFD socket_;
+};
+
+}  // namespace base
+
+#endif  // BASE_PROCESS_FORK_SERVER_H_
@@ -0,0 +1,306 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/fork_server.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_file.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/launch.h"
+#include "base/process/process.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/test/test_timeouts.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kExitCodeSwitch[] = "exit-code";
+constexpr char kWriteToFdSwitch[] = "write-to-fd";
+constexpr char kWaitForEofSwitch[] = "wait-for-eof";
+constexpr char kMessage[] = "hello";
+// Where the test maps the pipe in the children, as a PlatformChannel endpoint
+// would be.
+constexpr int kTargetFd = 42;
+
+int TestChildMain() {
+  const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+  if (command_line.HasSwitch(kWaitForEofSwitch)) {
+    int fd;
+    char c;
+    if (!StringToInt(command_line.GetSwitchValueASCII(kWaitForEofSwitch),
+                     &fd) ||
+        HANDLE_EINTR(read(fd, &c, 1)) != 0) {
+      return 1;
+    }
+  }
+  if (command_line.HasSwitch(kWriteToFdSwitch)) {
+    int fd;
+    if (!StringToInt(command_line.GetSwitchValueASCII(kWriteToFdSwitch), &fd) ||
+        !WriteFileDescriptor(fd, kMessage)) {
+      return 1;
+    }
+  }
+  int exit_code = 0;
+  StringToInt(command_line.GetSwitchValueASCII(kExitCodeSwitch), &exit_code);
+  return exit_code;
+}
+
+CommandLine ChildCommandLine(int exit_code) {
+  CommandLine command_line(FilePath("fork_server_child"));
+  command_line.AppendSwitchASCII(kExitCodeSwitch, NumberToString(exit_code));
+  return command_line;
+}
+
+// Returns the pids of the children of |pid|, or nothing if the kernel doesn't
+// list them.
+std::vector<pid_t> GetChildren(pid_t pid) {
+  const std::string pid_string = NumberToString(pid);
+  std::string children;
+  if (!ReadFileToString(FilePath("/proc")
+                            .Append(pid_string)
+                            .Append("task")
+                            .Append(pid_string)
+                            .Append("children"),
+                        &children)) {
+    return {};
+  }
+  std::vector<pid_t> pids;
+  for (StringPiece child :
+       SplitStringPiece(children, " ", TRIM_WHITESPACE, SPLIT_WANT_NONEMPTY)) {
+    int child_pid;
+    if (StringToInt(child, &child_pid))
+      pids.push_back(child_pid);
+  }
+  return pids;
+}
+
+}  // namespace
+
+class ForkServerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    fork_server_ = ForkServer::Create(&TestChildMain, 2);
+    ASSERT_TRUE(fork_server_);
+  }
+
+  int WaitForExitCode(const Process& process) {
+    int exit_code = -1;
+    EXPECT_TRUE(fork_server_->WaitForExitWithTimeout(
+        process, TestTimeouts::action_timeout(), &exit_code));
+    return exit_code;
+  }
+
+  std::unique_ptr<ForkServer> fork_server_;
+};
+
+TEST_F(ForkServerTest, LaunchAndWait) {
+  Process process =
+      fork_server_->LaunchProcess(ChildCommandLine(42), LaunchOptions());
+  ASSERT_TRUE(process.IsValid());
+  // The child was forked by the server, not by us.
+  EXPECT_NE(fork_server_->server_pid(), process.Pid());
+  EXPECT_EQ(42, WaitForExitCode(process));
+}
+
+TEST_F(ForkServerTest, RemapFds) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  ScopedFD read_fd(pipe_fds[0]);
+  ScopedFD write_fd(pipe_fds[1]);
+
+  CommandLine command_line = ChildCommandLine(0);
+  command_line.AppendSwitchASCII(kWriteToFdSwitch, NumberToString(kTargetFd));
+  LaunchOptions options;
+  options.fds_to_remap.emplace_back(write_fd.get(), kTargetFd);
+  Process process = fork_server_->LaunchProcess(command_line, options);
+  ASSERT_TRUE(process.IsValid());
+  write_fd.reset();
+
+  char buffer[sizeof(kMessage)] = {};
+  ASSERT_TRUE(ReadFromFD(read_fd.get(), buffer, sizeof(kMessage) - 1));
+  EXPECT_STREQ(kMessage, buffer);
+  EXPECT_EQ(0, WaitForExitCode(process));
+  // The child does not keep other descriptors, so this is EOF.
+  EXPECT_EQ(0, HANDLE_EINTR(read(read_fd.get(), buffer, 1)));
+}
+
+// Launching more processes than the pool holds forks children on demand.
+TEST_F(ForkServerTest, MoreLaunchesThanPoolSize) {
+  std::vector<Process> processes;
+  for (int i = 0; i < 8; i++) {
+    processes.push_back(
+        fork_server_->LaunchProcess(ChildCommandLine(i), LaunchOptions()));
+    ASSERT_TRUE(processes.back().IsValid());
+  }
+  for (int i = 0; i < 8; i++)
+    EXPECT_EQ(i, WaitForExitCode(processes[i]));
+}
+
+TEST_F(ForkServerTest, WaitForExit) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  ScopedFD read_fd(pipe_fds[0]);
+  ScopedFD write_fd(pipe_fds[1]);
+
+  CommandLine command_line = ChildCommandLine(3);
+  command_line.AppendSwitchASCII(kWaitForEofSwitch, NumberToString(kTargetFd));
+  LaunchOptions options;
+  options.fds_to_remap.emplace_back(read_fd.get(), kTargetFd);
+  Process process = fork_server_->LaunchProcess(command_line, options);
+  ASSERT_TRUE(process.IsValid());
+  read_fd.reset();
+
+  // The child is still running, and is left unreaped for a later call.
+  int exit_code = -1;
+  EXPECT_FALSE(
+      fork_server_->WaitForExitWithTimeout(process, TimeDelta(), &exit_code));
+  write_fd.reset();
+  EXPECT_EQ(3, WaitForExitCode(process));
+
+  // The exit code is only returned once.
+  EXPECT_FALSE(fork_server_->WaitForExitWithTimeout(
+      process, TestTimeouts::action_timeout(), &exit_code));
+}
+
+TEST_F(ForkServerTest, WaitForKilledChild) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  ScopedFD read_fd(pipe_fds[0]);
+  ScopedFD write_fd(pipe_fds[1]);
+
+  CommandLine command_line = ChildCommandLine(0);
+  command_line.AppendSwitchASCII(kWaitForEofSwitch, NumberToString(kTargetFd));
+  LaunchOptions options;
+  options.fds_to_remap.emplace_back(read_fd.get(), kTargetFd);
+  Process process = fork_server_->LaunchProcess(command_line, options);
+  ASSERT_TRUE(process.IsValid());
+
+  EXPECT_TRUE(process.Terminate(0, /*wait=*/false));
+  EXPECT_EQ(-1, WaitForExitCode(process));
+}
+
+// A child that exited stays a zombie until its exit code is collected, so
+// that its pid cannot be reused while the caller holds it.
+TEST_F(ForkServerTest, ExitedChildNotReapedUntilWaitedFor) {
+  Process process =
+      fork_server_->LaunchProcess(ChildCommandLine(5), LaunchOptions());
+  ASSERT_TRUE(process.IsValid());
+
+  const FilePath stat_path =
+      FilePath("/proc").Append(NumberToString(process.Pid())).Append("stat");
+  const TimeTicks deadline = TimeTicks::Now() + TestTimeouts::action_timeout();
+  for (;;) {
+    std::string stat;
+    ASSERT_TRUE(ReadFileToString(stat_path, &stat));
+    // The state follows the parenthesized command name.
+    const size_t name_end = stat.rfind(')');
+    ASSERT_NE(std::string::npos, name_end);
+    if (stat.substr(name_end + 2, 1) == "Z")
+      break;
+    ASSERT_LT(TimeTicks::Now(), deadline);
+    PlatformThread::Sleep(TestTimeouts::tiny_timeout());
+  }
+  // Give the server a chance to handle SIGCHLD.
+  PlatformThread::Sleep(TestTimeouts::tiny_timeout());
+  EXPECT_EQ(0, kill(process.Pid(), 0));
+
+  EXPECT_EQ(5, WaitForExitCode(process));
+}
+
+TEST_F(ForkServerTest, UnsupportedOptions) {
+  LaunchOptions options;
+  options.current_directory = FilePath("/");
+  EXPECT_FALSE(
+      fork_server_->LaunchProcess(ChildCommandLine(0), options).IsValid());
+
+  options = LaunchOptions();
+  options.environment["FOO"] = "bar";
+  EXPECT_FALSE(
+      fork_server_->LaunchProcess(ChildCommandLine(0), options).IsValid());
+
+  options = LaunchOptions();
+  options.new_process_group = true;
+  EXPECT_FALSE(
+      fork_server_->LaunchProcess(ChildCommandLine(0), options).IsValid());
+}
+
+// Idle children that die, e.g. because they were killed, are reaped by the
+// server and replaced.
+TEST_F(ForkServerTest, IdleChildDeath) {
+  // The pool is filled asynchronously.
+  const TimeTicks deadline = TimeTicks::Now() + TestTimeouts::action_timeout();
+  std::vector<pid_t> idle_children;
+  while ((idle_children = GetChildren(fork_server_->server_pid())).empty() &&
+         TimeTicks::Now() < deadline) {
+    PlatformThread::Sleep(Milliseconds(10));
+  }
+  if (idle_children.empty())
+    GTEST_SKIP() << "/proc/<pid>/task/<tid>/children is not available";
+  const pid_t killed_child = idle_children.front();
+  ASSERT_EQ(0, kill(killed_child, SIGKILL));
+
+  // The dead child doesn't linger as a zombie.
+  while (kill(killed_child, 0) == 0 && TimeTicks::Now() < deadline)
+    PlatformThread::Sleep(Milliseconds(10));
+  EXPECT_EQ(-1, kill(killed_child, 0));
+  EXPECT_EQ(ESRCH, errno);
+
+  for (int i = 0; i < 4; i++) {
+    Process process =
+        fork_server_->LaunchProcess(ChildCommandLine(i), LaunchOptions());
+    ASSERT_TRUE(process.IsValid());
+    EXPECT_EQ(i, WaitForExitCode(process));
+  }
+}
+
+TEST_F(ForkServerTest, Shutdown) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  ScopedFD read_fd(pipe_fds[0]);
+  ScopedFD write_fd(pipe_fds[1]);
+  ASSERT_EQ(0, pipe(pipe_fds));
+  ScopedFD result_read_fd(pipe_fds[0]);
+  ScopedFD result_write_fd(pipe_fds[1]);
+
+  constexpr int kResultFd = kTargetFd + 1;
+  CommandLine command_line = ChildCommandLine(0);
+  command_line.AppendSwitchASCII(kWaitForEofSwitch, NumberToString(kTargetFd));
+  command_line.AppendSwitchASCII(kWriteToFdSwitch, NumberToString(kResultFd));
+  LaunchOptions options;
+  options.fds_to_remap.emplace_back(read_fd.get(), kTargetFd);
+  options.fds_to_remap.emplace_back(result_write_fd.get(), kResultFd);
+  Process process = fork_server_->LaunchProcess(command_line, options);
+  ASSERT_TRUE(process.IsValid());
+  read_fd.reset();
+  result_write_fd.reset();
+
+  const pid_t server_pid = fork_server_->server_pid();
+  fork_server_.reset();
+  // The server was reaped.
+  EXPECT_EQ(-1, kill(server_pid, 0));
+  EXPECT_EQ(ESRCH, errno);
+
+  // Launched processes are not affected.
+  write_fd.reset();
+  char buffer[sizeof(kMessage)] = {};
+  ASSERT_TRUE(ReadFromFD(result_read_fd.get(), buffer, sizeof(kMessage) - 1));
+  EXPECT_STREQ(kMessage, buffer);
+}
+
+}  // namespace base
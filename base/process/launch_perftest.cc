@@ -0,0 +1,102 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "base/command_line.h"
+#include "base/process/launch.h"
+#include "base/process/process.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/multiprocess_test.h"
+#include "base/test/test_timeouts.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/multiprocess_func_list.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "LaunchProcess.";
+// Launches which clone the address space of the parent, see below.
+constexpr char kForkLatency[] = "fork_latency";
+// Launches which share it until exec.
+constexpr char kVforkLatency[] = "vfork_latency";
+
+constexpr int kIterations = 100;
+
+// Forces LaunchProcess() to fork(), as the clone(CLONE_VM | CLONE_VFORK) path
+// cannot run code in the child.
+class NoOpPreExecDelegate : public LaunchOptions::PreExecDelegate {
+ public:
+  void RunAsyncSafe() override {}
+};
+
+// Measures the time LaunchProcess() takes to return, which is what the parent
+// pays for; the startup of the child itself is not included.
+TimeDelta MeasureLaunchLatency(const LaunchOptions& options) {
+  TimeDelta total;
+  for (int i = 0; i < kIterations; i++) {
+    const TimeTicks start = TimeTicks::Now();
+    Process process =
+        SpawnMultiProcessTestChild("LaunchPerfTestChild",
+                                   GetMultiProcessTestChildBaseCommandLine(),
+                                   options);
+    total += TimeTicks::Now() - start;
+
+    EXPECT_TRUE(process.IsValid());
+    int exit_code = -1;
+    EXPECT_TRUE(process.WaitForExitWithTimeout(TestTimeouts::action_timeout(),
+                                               &exit_code));
+    EXPECT_EQ(0, exit_code);
+  }
+  return total / kIterations;
+}
+
+// Launch latency depends on the amount of memory mapped in the parent, so
+// measure it with |resident_megabytes| of touched ballast.
+void MeasureLaunchLatencyWithRss(size_t resident_megabytes) {
+  const size_t size = resident_megabytes * 1024 * 1024;
+  std::unique_ptr<char[]> ballast(new char[size]);
+  memset(ballast.get(), 1, size);
+
+  NoOpPreExecDelegate pre_exec_delegate;
+  LaunchOptions fork_options;
+  fork_options.pre_exec_delegate = &pre_exec_delegate;
+
+  perf_test::PerfResultReporter reporter(
+      kMetricPrefix, "rss_" + NumberToString(resident_megabytes) + "MiB");
+  reporter.RegisterImportantMetric(kForkLatency, "us");
+  reporter.RegisterImportantMetric(kVforkLatency, "us");
+  reporter.AddResult(kForkLatency, MeasureLaunchLatency(fork_options));
+  reporter.AddResult(kVforkLatency, MeasureLaunchLatency(LaunchOptions()));
+
+  // Keeps the ballast alive.
+  if (size)
+    EXPECT_EQ(1, ballast[size - 1]);
+}
+
+}  // namespace
+
+MULTIPROCESS_TEST_MAIN(LaunchPerfTestChild) {
+  return 0;
+}
+
+TEST(LaunchProcessPerfTest, SmallParent) {
+  MeasureLaunchLatencyWithRss(0);
+}
+
+TEST(LaunchProcessPerfTest, MediumParent) {
+  MeasureLaunchLatencyWithRss(256);
+}
+
+TEST(LaunchProcessPerfTest, LargeParent) {
+  MeasureLaunchLatencyWithRss(1024);
+}
+
+}  // namespace base
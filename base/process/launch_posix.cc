@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/resource.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
@@ -207,7 +208,12 @@ static const char kFDDir[] = "/dev/fd";
 static const char kFDDir[] = "/proc/self/fd";
 #endif
 
-void CloseSuperfluousFds(const base::InjectiveMultimap& saved_mapping) {
+namespace {
+
+// Calls |action| on the descriptors of the process which are neither standard
+// ones nor destinations of |saved_mapping|.
+void ForEachSuperfluousFd(const base::InjectiveMultimap& saved_mapping,
+                          int (*action)(int fd)) {
   // DANGER: no calls to malloc or locks are allowed from now on:
   // http://crbug.com/36678
 
@@ -230,9 +236,9 @@ void CloseSuperfluousFds(const base::InjectiveMultimap& saved_mapping) {
       if (j < saved_mapping.size())
         continue;
 
-      // Since we're just trying to close anything we can find,
-      // ignore any error return values of close().
-      close(fd);
+      // Since we're just trying to act on anything we can find, ignore any
+      // error return values of |action|.
+      action(fd);
     }
     return;
   }
@@ -262,11 +268,170 @@ void CloseSuperfluousFds(const base::InjectiveMultimap& saved_mapping) {
     if (fd == dir_fd)
       continue;
 
-    int ret = IGNORE_EINTR(close(fd));
+    int ret = action(static_cast<int>(fd));
     DPCHECK(ret == 0);
   }
 }
 
+int CloseFd(int fd) {
+  return IGNORE_EINTR(close(fd));
+}
+
+// Applies |new_process_group| and |maximize_rlimits| in the child.
+void SetUpChildProcessGroupAndRlimits(const LaunchOptions& options) {
+  if (options.new_process_group) {
+    // Instead of inheriting the process group ID of the parent, the child
+    // starts off a new process group with pgid equal to its process ID.
+    if (setpgid(0, 0) < 0) {
+      RAW_LOG(ERROR, "setpgid failed");
+      _exit(127);
+    }
+  }
+
+  if (options.maximize_rlimits) {
+    // Some resource limits need to be maximal in this child.
+    for (auto resource : *options.maximize_rlimits) {
+      struct rlimit limit;
+      if (getrlimit(resource, &limit) < 0) {
+        RAW_LOG(WARNING, "getrlimit failed");
+      } else if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(resource, &limit) < 0) {
+          RAW_LOG(WARNING, "setrlimit failed");
+        }
+      }
+    }
+  }
+}
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS) || BUILDFLAG(IS_AIX)
+// Applies |allow_new_privs| and |kill_on_parent_death| in the child.
+void SetUpChildPrctls(const LaunchOptions& options) {
+  // Set NO_NEW_PRIVS by default. Since NO_NEW_PRIVS only exists in kernel
+  // 3.5+, do not check the return value of prctl here.
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS 38
+#endif
+  if (!options.allow_new_privs) {
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) && errno != EINVAL) {
+      // Only log if the error is not EINVAL (i.e. not supported).
+      RAW_LOG(FATAL, "prctl(PR_SET_NO_NEW_PRIVS) failed");
+    }
+  }
+
+  if (options.kill_on_parent_death) {
+    if (prctl(PR_SET_PDEATHSIG, SIGKILL) != 0) {
+      RAW_LOG(ERROR, "prctl(PR_SET_PDEATHSIG) failed");
+      _exit(127);
+    }
+  }
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+int SetCloseOnExec(int fd) {
+  const int flags = fcntl(fd, F_GETFD);
+  if (flags < 0)
+    return flags;
+  return fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+}
+
+// Size of the stack of children created with CLONE_VM. They only make a few
+// system calls before exec.
+constexpr size_t kVforkChildStackSize = 64 * 1024;
+
+// What a child created with clone(CLONE_VM | CLONE_VFORK) needs. It cannot
+// allocate, so this is all prepared by the parent.
+struct VforkChildParams {
+  const LaunchOptions* options;
+  const char* executable_path;
+  char* const* argv;
+  char* const* envp;
+  const char* current_directory;
+  InjectiveMultimap* fd_shuffle1;
+  const InjectiveMultimap* fd_shuffle2;
+  sigset_t orig_sigmask;
+};
+
+// Whether LaunchProcess() can create the child with clone(CLONE_VM |
+// CLONE_VFORK), which does not copy the page tables of the parent, instead of
+// fork(). This is the case unless |options| require running code, or
+// behaviors VforkChildMain() does not support.
+bool CanLaunchWithVfork(const LaunchOptions& options,
+                        const char* executable_path) {
+  if (options.pre_exec_delegate || options.clone_flags)
+    return false;
+#if BUILDFLAG(IS_CHROMEOS)
+  if (options.ctrl_terminal_fd >= 0)
+    return false;
+#endif
+  // execvpe() looks |executable_path| up in the PATH of the parent, as the
+  // child cannot change its environment.
+  if (!strchr(executable_path, '/') &&
+      (options.clear_environment || options.environment.count("PATH"))) {
+    return false;
+  }
+  return true;
+}
+
+// Entry point of children created with clone(CLONE_VM | CLONE_VFORK). Does the
+// same as the fork() child in LaunchProcess(), for the options supported by
+// CanLaunchWithVfork().
+int VforkChildMain(void* arg) {
+  // DANGER: this runs on its own stack, but shares the memory of the parent,
+  // whose thread is suspended until exec*() or _exit(). On top of the rules of
+  // the fork() child, memory used by the parent must not be modified: there is
+  // no ScopedFD (FD ownership tracking), no SetEnvironment(), and superfluous
+  // descriptors are marked close-on-exec instead of being closed, as close()
+  // checks the FD ownership of the parent.
+  const VforkChildParams& params = *static_cast<VforkChildParams*>(arg);
+  const LaunchOptions& options = *params.options;
+
+  {
+    // See the fork() child. Closed on exec.
+    const int null_fd =
+        HANDLE_EINTR(open("/dev/null", O_RDONLY | O_CLOEXEC));
+    if (null_fd < 0) {
+      RAW_LOG(ERROR, "Failed to open /dev/null");
+      _exit(127);
+    }
+    if (HANDLE_EINTR(dup2(null_fd, STDIN_FILENO)) != STDIN_FILENO) {
+      RAW_LOG(ERROR, "Failed to dup /dev/null for stdin");
+      _exit(127);
+    }
+  }
+
+  SetUpChildProcessGroupAndRlimits(options);
+
+  // Without CLONE_SIGHAND, the child has its own signal handlers.
+  ResetChildSignalHandlersToDefaults();
+  SetSignalMask(params.orig_sigmask);
+
+  // |fd_shuffle1| belongs to the parent, which does not use it afterwards.
+  if (!ShuffleFileDescriptors(params.fd_shuffle1))
+    _exit(127);
+  ForEachSuperfluousFd(*params.fd_shuffle2, &SetCloseOnExec);
+
+  SetUpChildPrctls(options);
+
+  if (params.current_directory != nullptr) {
+    RAW_CHECK(chdir(params.current_directory) == 0);
+  }
+
+  execvpe(params.executable_path, params.argv, params.envp);
+
+  RAW_LOG(ERROR, "LaunchProcess: failed to execvp:");
+  RAW_LOG(ERROR, params.argv[0]);
+  _exit(127);
+}
+#endif  // BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+
+}  // namespace
+
+void CloseSuperfluousFds(const base::InjectiveMultimap& saved_mapping) {
+  ForEachSuperfluousFd(saved_mapping, &CloseFd);
+}
+
 Process LaunchProcess(const CommandLine& cmdline,
                       const LaunchOptions& options) {
   return LaunchProcess(cmdline.argv(), options);
@@ -304,30 +469,69 @@ Process LaunchProcess(const std::vector<std::string>& argv,
     current_directory = options.current_directory.value().c_str();
   }
 
-  pid_t pid;
+  const char* executable_path = !options.real_path.empty() ?
+      options.real_path.value().c_str() : argv_cstr[0];
+
+  pid_t pid = -1;
   base::TimeTicks before_fork = TimeTicks::Now();
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  // Only used by the clone(CLONE_VM | CLONE_VFORK) child, which cannot
+  // allocate.
+  std::unique_ptr<char[]> vfork_child_stack;
+  VforkChildParams vfork_child_params;
+  if (CanLaunchWithVfork(options, executable_path)) {
+    for (const auto& value : options.fds_to_remap) {
+      fd_shuffle1.push_back(InjectionArc(value.first, value.second, false));
+      fd_shuffle2.push_back(InjectionArc(value.first, value.second, false));
+    }
+    vfork_child_params.options = &options;
+    vfork_child_params.executable_path = executable_path;
+    vfork_child_params.argv = argv_cstr.data();
+    vfork_child_params.envp = new_environ ? new_environ.get() : old_environ;
+    vfork_child_params.current_directory = current_directory;
+    vfork_child_params.fd_shuffle1 = &fd_shuffle1;
+    vfork_child_params.fd_shuffle2 = &fd_shuffle2;
+    vfork_child_params.orig_sigmask = orig_sigmask;
+    // Uninitialized, the child only touches the pages it uses.
+    vfork_child_stack.reset(new char[kVforkChildStackSize]);
+
+    // The parent is suspended until the child execs or exits. Stacks grow
+    // down on all supported architectures.
+    pid = clone(&VforkChildMain,
+                vfork_child_stack.get() + kVforkChildStackSize,
+                CLONE_VM | CLONE_VFORK | SIGCHLD, &vfork_child_params);
+    // Fall back to fork() if clone() is unavailable, e.g. in some sandboxes.
+    if (pid < 0) {
+      DPLOG(WARNING) << "clone(CLONE_VM | CLONE_VFORK)";
+      fd_shuffle1.clear();
+      fd_shuffle2.clear();
+    }
+  }
+#endif
+  if (pid < 0) {
 #if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS) || BUILDFLAG(IS_AIX)
-  if (options.clone_flags) {
-    // Signal handling in this function assumes the creation of a new
-    // process, so we check that a thread is not being created by mistake
-    // and that signal handling follows the process-creation rules.
-    RAW_CHECK(
-        !(options.clone_flags & (CLONE_SIGHAND | CLONE_THREAD | CLONE_VM)));
-
-    // We specify a null ptid and ctid.
-    RAW_CHECK(
-        !(options.clone_flags &
-          (CLONE_CHILD_CLEARTID | CLONE_CHILD_SETTID | CLONE_PARENT_SETTID)));
-
-    // Since we use waitpid, we do not support custom termination signals in the
-    // clone flags.
-    RAW_CHECK((options.clone_flags & 0xff) == 0);
-
-    pid = ForkWithFlags(options.clone_flags | SIGCHLD, nullptr, nullptr);
-  } else
+    if (options.clone_flags) {
+      // Signal handling in this function assumes the creation of a new
+      // process, so we check that a thread is not being created by mistake
+      // and that signal handling follows the process-creation rules.
+      RAW_CHECK(
+          !(options.clone_flags & (CLONE_SIGHAND | CLONE_THREAD | CLONE_VM)));
+
+      // We specify a null ptid and ctid.
+      RAW_CHECK(
+          !(options.clone_flags &
+            (CLONE_CHILD_CLEARTID | CLONE_CHILD_SETTID | CLONE_PARENT_SETTID)));
+
+      // Since we use waitpid, we do not support custom termination signals in
+      // the clone flags.
+      RAW_CHECK((options.clone_flags & 0xff) == 0);
+
+      pid = ForkWithFlags(options.clone_flags | SIGCHLD, nullptr, nullptr);
+    } else
 #endif
-  {
-    pid = fork();
+    {
+      pid = fork();
+    }
   }
 
   // Always restore the original signal mask in the parent.
@@ -378,29 +582,7 @@ Process LaunchProcess(const std::vector<std::string>& argv,
       }
     }
 
-    if (options.new_process_group) {
-      // Instead of inheriting the process group ID of the parent, the child
-      // starts off a new process group with pgid equal to its process ID.
-      if (setpgid(0, 0) < 0) {
-        RAW_LOG(ERROR, "setpgid failed");
-        _exit(127);
-      }
-    }
-
-    if (options.maximize_rlimits) {
-      // Some resource limits need to be maximal in this child.
-      for (auto resource : *options.maximize_rlimits) {
-        struct rlimit limit;
-        if (getrlimit(resource, &limit) < 0) {
-          RAW_LOG(WARNING, "getrlimit failed");
-        } else if (limit.rlim_cur < limit.rlim_max) {
-          limit.rlim_cur = limit.rlim_max;
-          if (setrlimit(resource, &limit) < 0) {
-            RAW_LOG(WARNING, "setrlimit failed");
-          }
-        }
-      }
-    }
+    SetUpChildProcessGroupAndRlimits(options);
 
     ResetChildSignalHandlersToDefaults();
     SetSignalMask(orig_sigmask);
@@ -446,25 +628,8 @@ Process LaunchProcess(const std::vector<std::string>& argv,
 
     CloseSuperfluousFds(fd_shuffle2);
 
-    // Set NO_NEW_PRIVS by default. Since NO_NEW_PRIVS only exists in kernel
-    // 3.5+, do not check the return value of prctl here.
 #if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS) || BUILDFLAG(IS_AIX)
-#ifndef PR_SET_NO_NEW_PRIVS
-#define PR_SET_NO_NEW_PRIVS 38
-#endif
-    if (!options.allow_new_privs) {
-      if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) && errno != EINVAL) {
-        // Only log if the error is not EINVAL (i.e. not supported).
-        RAW_LOG(FATAL, "prctl(PR_SET_NO_NEW_PRIVS) failed");
-      }
-    }
-
-    if (options.kill_on_parent_death) {
-      if (prctl(PR_SET_PDEATHSIG, SIGKILL) != 0) {
-        RAW_LOG(ERROR, "prctl(PR_SET_PDEATHSIG) failed");
-        _exit(127);
-      }
-    }
+    SetUpChildPrctls(options);
 #endif
 
     if (current_directory != nullptr) {
@@ -475,9 +640,6 @@ Process LaunchProcess(const std::vector<std::string>& argv,
       options.pre_exec_delegate->RunAsyncSafe();
     }
 
-    const char* executable_path = !options.real_path.empty() ?
-        options.real_path.value().c_str() : argv_cstr[0];
-
     execvp(executable_path, argv_cstr.data());
 
     RAW_LOG(ERROR, "LaunchProcess: failed to execvp:");
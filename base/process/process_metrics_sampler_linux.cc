@@ -0,0 +1,307 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_metrics_sampler_linux.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "base/containers/cxx20_erase.h"
+#include "base/logging.h"
+#include "base/memory/page_size.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/internal_linux.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/threading/thread_restrictions.h"
+
+namespace base {
+
+namespace {
+
+// /proc/<pid>/status is typically below 2kB, but grows with the number of
+// supplementary groups. Larger contents are truncated, and the fields which
+// are cut off are not reported.
+constexpr size_t kBufferSize = 16 * 1024;
+
+// Cursor over the contents of a /proc file, which never allocates.
+class ProcScanner {
+ public:
+  explicit ProcScanner(StringPiece data) : data_(data) {}
+
+  // Skips a field, and the whitespace before it.
+  bool SkipField() {
+    SkipWhitespace();
+    const size_t end = data_.find_first_of(" \t\n");
+    if (end == 0 || data_.empty())
+      return false;
+    data_.remove_prefix(end == StringPiece::npos ? data_.size() : end);
+    return true;
+  }
+
+  bool ReadChar(char* value) {
+    SkipWhitespace();
+    if (data_.empty())
+      return false;
+    *value = data_.front();
+    data_.remove_prefix(1);
+    return true;
+  }
+
+  bool ReadInt64(int64_t* value) {
+    return StringToInt64(NextNumber(), value);
+  }
+
+  bool ReadUint64(uint64_t* value) {
+    return StringToUint64(NextNumber(), value);
+  }
+
+  // Consumes |prefix| if the remaining data starts with it.
+  bool ConsumePrefix(StringPiece prefix) {
+    if (!StartsWith(data_, prefix))
+      return false;
+    data_.remove_prefix(prefix.size());
+    return true;
+  }
+
+  // Moves to the start of the next line. Returns false if there is none.
+  bool NextLine() {
+    const size_t end = data_.find('\n');
+    if (end == StringPiece::npos || end + 1 == data_.size())
+      return false;
+    data_.remove_prefix(end + 1);
+    return true;
+  }
+
+ private:
+  void SkipWhitespace() {
+    while (!data_.empty() && (data_.front() == ' ' || data_.front() == '\t'))
+      data_.remove_prefix(1);
+  }
+
+  StringPiece NextNumber() {
+    SkipWhitespace();
+    const size_t end = data_.find_first_not_of("-0123456789");
+    const StringPiece number = data_.substr(0, end);
+    data_.remove_prefix(number.size());
+    return number;
+  }
+
+  StringPiece data_;
+};
+
+// Reads a "<value> kB" field of /proc/<pid>/status.
+bool ReadKilobytes(ProcScanner* scanner, uint64_t* bytes) {
+  uint64_t kilobytes;
+  if (!scanner->ReadUint64(&kilobytes))
+    return false;
+  *bytes = kilobytes * 1024;
+  return true;
+}
+
+}  // namespace
+
+ProcessMetricsSampler::TrackedProcess::TrackedProcess() = default;
+ProcessMetricsSampler::TrackedProcess::TrackedProcess(TrackedProcess&&) =
+    default;
+ProcessMetricsSampler::TrackedProcess&
+ProcessMetricsSampler::TrackedProcess::operator=(TrackedProcess&&) = default;
+ProcessMetricsSampler::TrackedProcess::~TrackedProcess() = default;
+
+ProcessMetricsSampler::ProcessMetricsSampler()
+    : buffer_(new char[kBufferSize]) {}
+
+ProcessMetricsSampler::~ProcessMetricsSampler() = default;
+
+bool ProcessMetricsSampler::AddProcess(ProcessId pid) {
+  // Synchronously reading files in /proc is safe.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  // Opening the files relative to the directory guarantees that they all
+  // belong to the same process, even if |pid| is reused concurrently.
+  ScopedFD dir_fd(HANDLE_EINTR(
+      open(internal::GetProcPidDir(pid).value().c_str(),
+           O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+  if (!dir_fd.is_valid())
+    return false;
+
+  TrackedProcess process;
+  process.pid = pid;
+  process.stat_fd.reset(HANDLE_EINTR(
+      openat(dir_fd.get(), internal::kStatFile, O_RDONLY | O_CLOEXEC)));
+  process.statm_fd.reset(
+      HANDLE_EINTR(openat(dir_fd.get(), "statm", O_RDONLY | O_CLOEXEC)));
+  process.status_fd.reset(
+      HANDLE_EINTR(openat(dir_fd.get(), "status", O_RDONLY | O_CLOEXEC)));
+  if (!process.stat_fd.is_valid() || !process.statm_fd.is_valid() ||
+      !process.status_fd.is_valid()) {
+    return false;
+  }
+
+  processes_.push_back(std::move(process));
+  return true;
+}
+
+void ProcessMetricsSampler::RemoveProcess(ProcessId pid) {
+  EraseIf(processes_, [pid](const TrackedProcess& process) {
+    return process.pid == pid;
+  });
+}
+
+void ProcessMetricsSampler::Sample(std::vector<ProcessSample>* samples) {
+  // Synchronously reading files in /proc is safe.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  samples->resize(processes_.size());
+  size_t sample_count = 0;
+  for (auto it = processes_.begin(); it != processes_.end();) {
+    ProcessSample& sample = (*samples)[sample_count];
+    sample = ProcessSample();
+    if (SampleProcess(*it, &sample)) {
+      sample_count++;
+      ++it;
+    } else {
+      it = processes_.erase(it);
+    }
+  }
+  samples->resize(sample_count);
+}
+
+StringPiece ProcessMetricsSampler::ReadFile(int fd) {
+  const ssize_t length = HANDLE_EINTR(pread(fd, buffer_.get(), kBufferSize, 0));
+  // Reading the files of a process which exited fails with ESRCH.
+  if (length <= 0)
+    return StringPiece();
+  return StringPiece(buffer_.get(), static_cast<size_t>(length));
+}
+
+bool ProcessMetricsSampler::SampleProcess(const TrackedProcess& process,
+                                          ProcessSample* sample) {
+  sample->pid = process.pid;
+
+  StringPiece data = ReadFile(process.stat_fd.get());
+  if (data.empty())
+    return false;
+  if (!internal::ParseProcStatSample(data, sample)) {
+    DLOG(WARNING) << "Failed to parse /proc/" << process.pid << "/stat";
+    return false;
+  }
+
+  data = ReadFile(process.statm_fd.get());
+  if (data.empty())
+    return false;
+  if (!internal::ParseProcStatmSample(data, sample)) {
+    DLOG(WARNING) << "Failed to parse /proc/" << process.pid << "/statm";
+    return false;
+  }
+
+  data = ReadFile(process.status_fd.get());
+  if (data.empty())
+    return false;
+  if (!internal::ParseProcStatusSample(data, sample)) {
+    DLOG(WARNING) << "Failed to parse /proc/" << process.pid << "/status";
+    return false;
+  }
+  return true;
+}
+
+namespace internal {
+
+bool ParseProcStatSample(StringPiece data, ProcessSample* sample) {
+  // The file is formatted as "pid (name) field2 field3 ...". Look for the
+  // closing paren by scanning backwards, to avoid being fooled by processes
+  // with ')' in the name. See ParseProcStats().
+  const size_t close_parens_idx = data.rfind(") ");
+  if (close_parens_idx == StringPiece::npos)
+    return false;
+  ProcScanner scanner(data.substr(close_parens_idx + 2));
+
+  int64_t parent_pid = 0;
+  int64_t utime = 0;
+  int64_t stime = 0;
+  int64_t num_threads = 0;
+  for (int field = VM_STATE; field <= VM_NUMTHREADS; field++) {
+    bool result;
+    switch (field) {
+      case VM_STATE:
+        result = scanner.ReadChar(&sample->state);
+        break;
+      case VM_PPID:
+        result = scanner.ReadInt64(&parent_pid);
+        break;
+      case VM_MINFLT:
+        result = scanner.ReadInt64(&sample->minor_page_faults);
+        break;
+      case VM_MAJFLT:
+        result = scanner.ReadInt64(&sample->major_page_faults);
+        break;
+      case VM_UTIME:
+        result = scanner.ReadInt64(&utime);
+        break;
+      case VM_STIME:
+        result = scanner.ReadInt64(&stime);
+        break;
+      case VM_NUMTHREADS:
+        result = scanner.ReadInt64(&num_threads);
+        break;
+      default:
+        result = scanner.SkipField();
+        break;
+    }
+    if (!result)
+      return false;
+  }
+
+  sample->parent_pid = saturated_cast<ProcessId>(parent_pid);
+  sample->cumulative_cpu_usage =
+      ClockTicksToTimeDelta(saturated_cast<int>(utime + stime));
+  sample->num_threads = saturated_cast<int>(num_threads);
+  return true;
+}
+
+bool ParseProcStatmSample(StringPiece data, ProcessSample* sample) {
+  // "size resident shared text lib data dt", in pages.
+  ProcScanner scanner(data);
+  uint64_t size_pages;
+  uint64_t resident_pages;
+  uint64_t shared_pages;
+  if (!scanner.ReadUint64(&size_pages) ||
+      !scanner.ReadUint64(&resident_pages) ||
+      !scanner.ReadUint64(&shared_pages)) {
+    return false;
+  }
+
+  const uint64_t page_size = GetPageSize();
+  sample->virtual_bytes = size_pages * page_size;
+  sample->resident_bytes = resident_pages * page_size;
+  sample->shared_bytes = shared_pages * page_size;
+  return true;
+}
+
+bool ParseProcStatusSample(StringPiece data, ProcessSample* sample) {
+  // "Key:\tvalue" lines. Kernel threads do not have the memory fields.
+  ProcScanner scanner(data);
+  do {
+    bool result = true;
+    if (scanner.ConsumePrefix("VmHWM:")) {
+      result = ReadKilobytes(&scanner, &sample->peak_resident_bytes);
+    } else if (scanner.ConsumePrefix("VmSwap:")) {
+      result = ReadKilobytes(&scanner, &sample->swap_bytes);
+    } else if (scanner.ConsumePrefix("voluntary_ctxt_switches:")) {
+      result = scanner.ReadInt64(&sample->voluntary_context_switches);
+    } else if (scanner.ConsumePrefix("nonvoluntary_ctxt_switches:")) {
+      result = scanner.ReadInt64(&sample->involuntary_context_switches);
+    }
+    if (!result)
+      return false;
+  } while (scanner.NextLine());
+  return true;
+}
+
+}  // namespace internal
+
+}  // namespace base
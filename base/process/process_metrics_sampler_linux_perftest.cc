@@ -0,0 +1,84 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_metrics_sampler_linux.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/process/process_metrics.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "ProcessMetricsSampler.";
+constexpr char kTimePerProcess[] = "time_per_process";
+
+// Samples the current process this many times per iteration, as a monitor
+// would sample that many processes. Each of them takes 3 file descriptors in
+// ProcessMetricsSampler.
+constexpr int kProcessCount = 100;
+constexpr int kIterations = 100;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story_name);
+  reporter.RegisterImportantMetric(kTimePerProcess, "us");
+  return reporter;
+}
+
+}  // namespace
+
+// The getters of ProcessMetrics which return the same data, for comparison.
+TEST(ProcessMetricsSamplerPerfTest, ProcessMetrics) {
+  std::vector<std::unique_ptr<ProcessMetrics>> metrics;
+  for (int i = 0; i < kProcessCount; i++)
+    metrics.push_back(ProcessMetrics::CreateCurrentProcessMetrics());
+
+  uint64_t total_resident_bytes = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int iteration = 0; iteration < kIterations; iteration++) {
+    for (auto& process_metrics : metrics) {
+      total_resident_bytes += process_metrics->GetResidentSetSize();
+      process_metrics->GetCumulativeCPUUsage();
+      PageFaultCounts page_faults;
+      process_metrics->GetPageFaultCounts(&page_faults);
+      process_metrics->GetVmSwapBytes();
+    }
+  }
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  EXPECT_GT(total_resident_bytes, 0u);
+
+  SetUpReporter("ProcessMetrics")
+      .AddResult(kTimePerProcess, elapsed / (kIterations * kProcessCount));
+}
+
+TEST(ProcessMetricsSamplerPerfTest, Sampler) {
+  ProcessMetricsSampler sampler;
+  for (int i = 0; i < kProcessCount; i++)
+    ASSERT_TRUE(sampler.AddProcess(getpid()));
+
+  std::vector<ProcessSample> samples;
+  uint64_t total_resident_bytes = 0;
+  const TimeTicks start = TimeTicks::Now();
+  for (int iteration = 0; iteration < kIterations; iteration++) {
+    sampler.Sample(&samples);
+    for (const ProcessSample& sample : samples)
+      total_resident_bytes += sample.resident_bytes;
+  }
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  EXPECT_EQ(static_cast<size_t>(kProcessCount), samples.size());
+  EXPECT_GT(total_resident_bytes, 0u);
+
+  SetUpReporter("Sampler").AddResult(kTimePerProcess,
+                                     elapsed / (kIterations * kProcessCount));
+}
+
+}  // namespace base
@@ -0,0 +1,138 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_metrics_sampler_linux.h"
+
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/memory/page_size.h"
+#include "base/process/internal_linux.h"
+#include "base/process/process.h"
+#include "base/test/multiprocess_test.h"
+#include "base/test/test_timeouts.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/multiprocess_func_list.h"
+
+namespace base {
+
+namespace {
+
+// Name with spaces and parentheses, which ParseProcStatSample() must skip.
+constexpr char kStat[] =
+    "1234 (a) b (c) S 1 1234 1234 0 -1 4194560 4182 0 2 0 150 50 0 0 20 0 7 0 "
+    "2093 175247360 4096 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 3 0 0 "
+    "0 0 0\n";
+
+constexpr char kStatm[] = "42784 1024 512 1 0 7000 0\n";
+
+constexpr char kStatus[] =
+    "Name:\tcat\n"
+    "State:\tS (sleeping)\n"
+    "Pid:\t1234\n"
+    "VmPeak:\t  171148 kB\n"
+    "VmHWM:\t    8192 kB\n"
+    "VmRSS:\t    4096 kB\n"
+    "VmSwap:\t      16 kB\n"
+    "Threads:\t7\n"
+    "voluntary_ctxt_switches:\t300\n"
+    "nonvoluntary_ctxt_switches:\t20\n";
+
+}  // namespace
+
+TEST(ProcessMetricsSamplerTest, ParseStat) {
+  ProcessSample sample;
+  ASSERT_TRUE(internal::ParseProcStatSample(kStat, &sample));
+  EXPECT_EQ('S', sample.state);
+  EXPECT_EQ(1, sample.parent_pid);
+  EXPECT_EQ(4182, sample.minor_page_faults);
+  EXPECT_EQ(2, sample.major_page_faults);
+  EXPECT_EQ(internal::ClockTicksToTimeDelta(200), sample.cumulative_cpu_usage);
+  EXPECT_EQ(7, sample.num_threads);
+
+  EXPECT_FALSE(internal::ParseProcStatSample("1234 (a", &sample));
+  EXPECT_FALSE(internal::ParseProcStatSample("1234 (a) S 1 2", &sample));
+}
+
+TEST(ProcessMetricsSamplerTest, ParseStatm) {
+  ProcessSample sample;
+  ASSERT_TRUE(internal::ParseProcStatmSample(kStatm, &sample));
+  EXPECT_EQ(42784u * GetPageSize(), sample.virtual_bytes);
+  EXPECT_EQ(1024u * GetPageSize(), sample.resident_bytes);
+  EXPECT_EQ(512u * GetPageSize(), sample.shared_bytes);
+
+  EXPECT_FALSE(internal::ParseProcStatmSample("42784 1024", &sample));
+}
+
+TEST(ProcessMetricsSamplerTest, ParseStatus) {
+  ProcessSample sample;
+  ASSERT_TRUE(internal::ParseProcStatusSample(kStatus, &sample));
+  EXPECT_EQ(8192u * 1024, sample.peak_resident_bytes);
+  EXPECT_EQ(16u * 1024, sample.swap_bytes);
+  EXPECT_EQ(300, sample.voluntary_context_switches);
+  EXPECT_EQ(20, sample.involuntary_context_switches);
+
+  EXPECT_FALSE(internal::ParseProcStatusSample("VmSwap:\tkB\n", &sample));
+}
+
+TEST(ProcessMetricsSamplerTest, SampleCurrentProcess) {
+  ProcessMetricsSampler sampler;
+  ASSERT_TRUE(sampler.AddProcess(getpid()));
+
+  std::vector<ProcessSample> samples;
+  sampler.Sample(&samples);
+  ASSERT_EQ(1u, samples.size());
+  const ProcessSample& sample = samples[0];
+  EXPECT_EQ(getpid(), sample.pid);
+  EXPECT_EQ('R', sample.state);
+  EXPECT_EQ(getppid(), sample.parent_pid);
+  EXPECT_GE(sample.num_threads, 1);
+  EXPECT_GT(sample.resident_bytes, 0u);
+  EXPECT_GE(sample.peak_resident_bytes, sample.resident_bytes);
+  EXPECT_GE(sample.virtual_bytes, sample.resident_bytes);
+
+  // Samples reuse the storage of |samples|.
+  sampler.Sample(&samples);
+  EXPECT_EQ(1u, samples.size());
+
+  sampler.RemoveProcess(getpid());
+  sampler.Sample(&samples);
+  EXPECT_TRUE(samples.empty());
+}
+
+TEST(ProcessMetricsSamplerTest, NonExistentProcess) {
+  ProcessMetricsSampler sampler;
+  // Pids are at most 2^22.
+  EXPECT_FALSE(sampler.AddProcess(1 << 23));
+  EXPECT_EQ(0u, sampler.process_count());
+}
+
+class ProcessMetricsSamplerMultiProcessTest : public MultiProcessTest {};
+
+MULTIPROCESS_TEST_MAIN(ProcessMetricsSamplerChild) {
+  return 0;
+}
+
+// Processes which exited are dropped.
+TEST_F(ProcessMetricsSamplerMultiProcessTest, ExitedProcessesAreDropped) {
+  Process child = SpawnChild("ProcessMetricsSamplerChild");
+  ASSERT_TRUE(child.IsValid());
+
+  ProcessMetricsSampler sampler;
+  ASSERT_TRUE(sampler.AddProcess(child.Pid()));
+  ASSERT_TRUE(sampler.AddProcess(getpid()));
+
+  int exit_code;
+  ASSERT_TRUE(
+      child.WaitForExitWithTimeout(TestTimeouts::action_timeout(), &exit_code));
+
+  std::vector<ProcessSample> samples;
+  sampler.Sample(&samples);
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_EQ(getpid(), samples[0].pid);
+  EXPECT_EQ(1u, sampler.process_count());
+}
+
+}  // namespace base
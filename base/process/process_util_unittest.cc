@@ -1423,6 +1423,22 @@ TEST_F(ProcessUtilTest, LaunchProcess) {
 }
 
 #if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+// The executable is looked up in the PATH of the child, which requires
+// LaunchProcess() to fork() instead of sharing the address space of the parent.
+TEST_F(ProcessUtilTest, LaunchProcessWithPathInEnvironment) {
+  const FilePath::CharType kBaseTest[] = FILE_PATH_LITERAL("BASE_TEST");
+  const CommandLine kPrintEnvCommand(CommandLine::StringVector(
+      {test_helper_path_.BaseName().value(), FILE_PATH_LITERAL("-e"),
+       kBaseTest}));
+
+  EnvironmentMap env_changes;
+  env_changes["PATH"] = test_helper_path_.DirName().value();
+  env_changes[kBaseTest] = FILE_PATH_LITERAL("bar");
+  EXPECT_EQ("bar", TestLaunchProcess(kPrintEnvCommand, env_changes,
+                                     false /* clear_environ */,
+                                     0 /* clone_flags */));
+}
+
 MULTIPROCESS_TEST_MAIN(CheckPidProcess) {
   const pid_t kInitPid = 1;
   const pid_t pid = syscall(__NR_getpid);
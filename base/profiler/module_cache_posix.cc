@@ -11,10 +11,15 @@
 #include "build/build_config.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 
-// arm64 has execute-only memory (XOM) protecting code pages from being read.
-// PosixModule reads executable pages in order to extract module info. This may
-// result in a crash if the module is mapped as XOM so the code is disabled on
-// that arch. See https://crbug.com/957801.
+// Android arm64 has execute-only memory (XOM) protecting code pages from being
+// read. PosixModule reads executable pages in order to extract module info.
+// This may result in a crash if the module is mapped as XOM so the code is
+// disabled there. See https://crbug.com/957801. Linux and ChromeOS don't map
+// modules as XOM, so module info is extracted on all their architectures.
+#if BUILDFLAG(IS_ANDROID) && defined(ARCH_CPU_ARM64)
+#define EXECUTE_ONLY_MEMORY 1
+#endif
+
 #if BUILDFLAG(IS_ANDROID) && !defined(ARCH_CPU_ARM64)
 extern "C" {
 // &__executable_start is the start address of the current module.
@@ -28,7 +33,7 @@ namespace base {
 
 namespace {
 
-#if !defined(ARCH_CPU_ARM64)
+#if !defined(EXECUTE_ONLY_MEMORY)
 // Returns the unique build ID for a module loaded at |module_addr|. Returns the
 // empty string if the function fails to get the build ID.
 //
@@ -83,7 +88,7 @@ FilePath GetDebugBasenameForModule(const void* base_address, const char* file) {
 
   return FilePath(file).BaseName();
 }
-#endif  // !defined(ARCH_CPU_ARM64)
+#endif  // !defined(EXECUTE_ONLY_MEMORY)
 
 class PosixModule : public ModuleCache::Module {
  public:
@@ -123,7 +128,7 @@ PosixModule::PosixModule(uintptr_t base_address,
 // static
 std::unique_ptr<const ModuleCache::Module> ModuleCache::CreateModuleForAddress(
     uintptr_t address) {
-#if defined(ARCH_CPU_ARM64)
+#if defined(EXECUTE_ONLY_MEMORY)
   // arm64 has execute-only memory (XOM) protecting code pages from being read.
   // PosixModule reads executable pages in order to extract module info. This
   // may result in a crash if the module is mapped as XOM
@@ -0,0 +1,95 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/profiler/native_unwinder_linux.h"
+
+#include "base/check_op.h"
+#include "base/notreached.h"
+#include "base/numerics/clamped_math.h"
+#include "base/profiler/module_cache.h"
+#include "base/profiler/native_unwinder.h"
+#include "build/build_config.h"
+
+namespace base {
+
+NativeUnwinderLinux::NativeUnwinderLinux() = default;
+
+bool NativeUnwinderLinux::CanUnwindFrom(const Frame& current_frame) const {
+  return current_frame.module && current_frame.module->IsNative();
+}
+
+UnwindResult NativeUnwinderLinux::TryUnwind(RegisterContext* thread_context,
+                                            uintptr_t stack_top,
+                                            std::vector<Frame>* stack) const {
+  // We expect the frame corresponding to the |thread_context| register state to
+  // exist within |stack|.
+  DCHECK_GT(stack->size(), 0u);
+#if defined(ARCH_CPU_ARM64)
+  constexpr uintptr_t align_mask = 0x7;
+#elif defined(ARCH_CPU_X86_64)
+  constexpr uintptr_t align_mask = 0xf;
+#endif
+
+  uintptr_t frame_lower_bound = RegisterContextStackPointer(thread_context);
+  const auto is_fp_valid = [&](uintptr_t fp) {
+    // Ensure there's space on the stack to read two values: the caller's
+    // frame pointer and the return address.
+    return fp >= frame_lower_bound &&
+           ClampAdd(fp, sizeof(uintptr_t) * 2) <= stack_top &&
+           (fp & align_mask) == 0;
+  };
+  uintptr_t next_frame = RegisterContextFramePointer(thread_context);
+  if (!is_fp_valid(next_frame))
+    return UnwindResult::kAborted;
+
+  for (;;) {
+    if (!stack->back().module)
+      return UnwindResult::kAborted;
+    if (!stack->back().module->IsNative()) {
+      // This is a non-native module associated with the auxiliary unwinder
+      // (e.g. corresponding to a frame in V8 generated code). Report as
+      // UNRECOGNIZED_FRAME to allow that unwinder to unwind the frame.
+      return UnwindResult::kUnrecognizedFrame;
+    }
+
+    // The stack was copied by the StackCopier, so the frame can be read
+    // directly. Both the x86-64 and the AArch64 ABIs store the caller's frame
+    // pointer at the frame pointer, followed by the return address.
+    const uintptr_t frame = next_frame;
+    const uintptr_t* const frame_record = reinterpret_cast<uintptr_t*>(frame);
+    next_frame = frame_record[0];
+    const uintptr_t retaddr = frame_record[1];
+    frame_lower_bound = frame + 1;
+
+    // The outermost frame of the main thread and of threads created by
+    // pthread_create() has a null frame pointer, and its return address isn't
+    // useful. Bail without recording the frame.
+    if (next_frame == 0)
+      return UnwindResult::kCompleted;
+
+    const ModuleCache::Module* module =
+        module_cache()->GetModuleForAddress(retaddr);
+    // V8 doesn't conform to the x86_64 ABI re: stack alignment. For V8 frames,
+    // let the V8 unwinder determine whether the FP is valid or not.
+    const bool is_non_native_module = module && !module->IsNative();
+    // If the FP doesn't look correct, don't record this frame. This is where
+    // unwinding stops for frames in code built without frame pointers.
+    if (!is_non_native_module && !is_fp_valid(next_frame))
+      return UnwindResult::kAborted;
+
+    RegisterContextFramePointer(thread_context) = next_frame;
+    RegisterContextInstructionPointer(thread_context) = retaddr;
+    RegisterContextStackPointer(thread_context) = frame + sizeof(uintptr_t) * 2;
+    stack->emplace_back(retaddr, module);
+  }
+
+  NOTREACHED();
+  return UnwindResult::kCompleted;
+}
+
+std::unique_ptr<Unwinder> CreateNativeUnwinder(ModuleCache* module_cache) {
+  return std::make_unique<NativeUnwinderLinux>();
+}
+
+}  // namespace base
@@ -0,0 +1,47 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROFILER_NATIVE_UNWINDER_LINUX_H_
+#define BASE_PROFILER_NATIVE_UNWINDER_LINUX_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/profiler/unwinder.h"
+
+namespace base {
+
+// Native unwinder implementation for Linux and ChromeOS, ARM64 and X86_64. It
+// walks the chain of frame pointers, so it relies on the code being built with
+// frame pointers (see enable_frame_pointers), which is the default on these
+// platforms.
+//
+// System libraries such as glibc are usually built without frame pointers and
+// the unwinder doesn't read their .eh_frame unwind info, so stacks through
+// them are truncated:
+//   - A function without frame pointers may use the frame pointer register for
+//     other values. The unwind aborts at the first frame whose frame pointer
+//     doesn't point further up the stack, keeping the frames found so far.
+//   - If the sample is taken in such a function, the frame pointer register
+//     still refers to a frame of its caller, whose own return address isn't
+//     recorded.
+// In particular, a stack running through a glibc callback (e.g. qsort()) is
+// not unwound past the glibc frame.
+class BASE_EXPORT NativeUnwinderLinux : public Unwinder {
+ public:
+  NativeUnwinderLinux();
+
+  NativeUnwinderLinux(const NativeUnwinderLinux&) = delete;
+  NativeUnwinderLinux& operator=(const NativeUnwinderLinux&) = delete;
+
+  // Unwinder:
+  bool CanUnwindFrom(const Frame& current_frame) const override;
+  UnwindResult TryUnwind(RegisterContext* thread_context,
+                         uintptr_t stack_top,
+                         std::vector<Frame>* stack) const override;
+};
+
+}  // namespace base
+
+#endif  // BASE_PROFILER_NATIVE_UNWINDER_LINUX_H_
@@ -0,0 +1,246 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/profiler/native_unwinder_linux.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "base/profiler/module_cache.h"
+#include "base/profiler/stack_sampling_profiler_test_util.h"
+#include "base/profiler/unwinder.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+constexpr uintptr_t kModuleStart = 0x1000;
+constexpr size_t kModuleSize = 0x1000;
+constexpr uintptr_t kNonNativeModuleStart = 0x4000;
+
+// Used to construct test stacks. If `relative` is true, the value should be the
+// address `offset` positions from the bottom of the stack (at 8-byte alignment)
+// Otherwise, `offset` is added to the stack as an absolute address/value.
+// For example, when creating a stack with bottom 0x2000, {false, 0xf00d} will
+// become 0xf00d, and {true, 0x3} will become 0x2018.
+struct StackEntrySpec {
+  bool relative;
+  uintptr_t offset;
+};
+
+// Enables constructing a stack buffer that has pointers to itself
+// and provides convenience methods for calling the unwinder. The bottom of the
+// stack is 16-byte aligned, like frame pointers on x86-64.
+struct InputStack {
+  explicit InputStack(const std::vector<StackEntrySpec>& offsets)
+      : buffer(offsets.size()) {
+    EXPECT_EQ(0u, bottom() % 16);
+    size_t size = offsets.size();
+    for (size_t i = 0; i < size; ++i) {
+      auto spec = offsets[i];
+      if (spec.relative) {
+        buffer[i] = bottom() + (spec.offset * sizeof(uintptr_t));
+      } else {
+        buffer[i] = spec.offset;
+      }
+    }
+  }
+  uintptr_t bottom() const {
+    return reinterpret_cast<uintptr_t>(buffer.data());
+  }
+  uintptr_t top() const { return bottom() + buffer.size() * sizeof(uintptr_t); }
+
+ private:
+  std::vector<uintptr_t> buffer;
+};
+
+}  // namespace
+
+class NativeUnwinderLinuxTest : public testing::Test {
+ protected:
+  NativeUnwinderLinuxTest() {
+    unwinder_ = std::make_unique<NativeUnwinderLinux>();
+
+    auto test_module = std::make_unique<TestModule>(kModuleStart, kModuleSize);
+    module_ = test_module.get();
+    module_cache_.AddCustomNativeModule(std::move(test_module));
+    auto non_native_module = std::make_unique<TestModule>(
+        kNonNativeModuleStart, kModuleSize, false);
+    non_native_module_ = non_native_module.get();
+    std::vector<std::unique_ptr<const ModuleCache::Module>> wrapper;
+    wrapper.push_back(std::move(non_native_module));
+    module_cache()->UpdateNonNativeModules({}, std::move(wrapper));
+
+    unwinder_->Initialize(&module_cache_);
+  }
+
+  ModuleCache* module_cache() { return &module_cache_; }
+  ModuleCache::Module* module() { return module_; }
+  ModuleCache::Module* non_native_module() { return non_native_module_; }
+  Unwinder* unwinder() { return unwinder_.get(); }
+
+ private:
+  std::unique_ptr<Unwinder> unwinder_;
+  base::ModuleCache module_cache_;
+  raw_ptr<ModuleCache::Module> module_;
+  raw_ptr<ModuleCache::Module> non_native_module_;
+};
+
+TEST_F(NativeUnwinderLinuxTest, FPPointsOutsideOfStack) {
+  InputStack input({
+      {false, 0x1000},
+      {false, 0x1000},
+      {false, 0x1000},
+      {false, 0x1000},
+  });
+
+  RegisterContext context;
+  RegisterContextStackPointer(&context) = input.bottom();
+  RegisterContextInstructionPointer(&context) = kModuleStart;
+  std::vector<Frame> stack = {
+      Frame(RegisterContextInstructionPointer(&context), module())};
+
+  const uintptr_t invalid_fps[] = {
+      0x1,
+      input.bottom() - 2 * sizeof(uintptr_t),
+      input.top(),
+      // Checking that two values can be read must not overflow.
+      std::numeric_limits<uintptr_t>::max() - 1,
+  };
+  for (uintptr_t fp : invalid_fps) {
+    RegisterContextFramePointer(&context) = fp;
+    EXPECT_EQ(UnwindResult::kAborted,
+              unwinder()->TryUnwind(&context, input.top(), &stack));
+    EXPECT_EQ(std::vector<Frame>({{kModuleStart, module()}}), stack);
+  }
+}
+
+// Tests that two frame pointers that point to each other can't create an
+// infinite loop.
+TEST_F(NativeUnwinderLinuxTest, FPCycle) {
+  InputStack input({
+      {true, 2},
+      {false, kModuleStart + 0x10},
+      {true, 0},
+      {false, kModuleStart + 0x20},
+  });
+
+  RegisterContext context;
+  RegisterContextStackPointer(&context) = input.bottom();
+  RegisterContextInstructionPointer(&context) = kModuleStart;
+  RegisterContextFramePointer(&context) = input.bottom();
+  std::vector<Frame> stack = {
+      Frame(RegisterContextInstructionPointer(&context), module())};
+
+  EXPECT_EQ(UnwindResult::kAborted,
+            unwinder()->TryUnwind(&context, input.top(), &stack));
+  EXPECT_EQ(std::vector<Frame>({
+                {kModuleStart, module()},
+                {kModuleStart + 0x10, module()},
+            }),
+            stack);
+}
+
+// Tests the happy path: a successful unwind with no non-native modules, ending
+// at the null frame pointer of the outermost frame.
+TEST_F(NativeUnwinderLinuxTest, RegularUnwind) {
+  InputStack input({
+      {true, 4},                     // fp of frame 1
+      {false, kModuleStart + 0x20},  // ip of frame 1
+      {false, 0xaaaa},
+      {false, 0xaaaa},
+      {true, 8},                     // fp of frame 2
+      {false, kModuleStart + 0x42},  // ip of frame 2
+      {false, 0xaaaa},
+      {false, 0xaaaa},
+      {false, 0},
+      {false, 1},
+  });
+
+  RegisterContext context;
+  RegisterContextStackPointer(&context) = input.bottom();
+  RegisterContextInstructionPointer(&context) = kModuleStart;
+  RegisterContextFramePointer(&context) = input.bottom();
+  std::vector<Frame> stack = {
+      Frame(RegisterContextInstructionPointer(&context), module())};
+
+  EXPECT_EQ(UnwindResult::kCompleted,
+            unwinder()->TryUnwind(&context, input.top(), &stack));
+  EXPECT_EQ(std::vector<Frame>({
+                {kModuleStart, module()},
+                {kModuleStart + 0x20, module()},
+                {kModuleStart + 0x42, module()},
+            }),
+            stack);
+}
+
+// Tests that unwinding stops at a frame built without frame pointers, like
+// glibc's, whose frame pointer register holds an unrelated value. The frames
+// found before it are kept.
+TEST_F(NativeUnwinderLinuxTest, FrameWithoutFramePointer) {
+  InputStack input({
+      {true, 4},                     // fp of frame 1
+      {false, kModuleStart + 0x20},  // ip of frame 1
+      {false, 0xaaaa},
+      {false, 0xaaaa},
+      {false, 0x5},                  // Not a frame pointer.
+      {false, kModuleStart + 0x42},  // ip of frame 2, never recorded
+      {false, 0xaaaa},
+      {false, 0xaaaa},
+      {false, 0},
+      {false, 1},
+  });
+
+  RegisterContext context;
+  RegisterContextStackPointer(&context) = input.bottom();
+  RegisterContextInstructionPointer(&context) = kModuleStart;
+  RegisterContextFramePointer(&context) = input.bottom();
+  std::vector<Frame> stack = {
+      Frame(RegisterContextInstructionPointer(&context), module())};
+
+  EXPECT_EQ(UnwindResult::kAborted,
+            unwinder()->TryUnwind(&context, input.top(), &stack));
+  EXPECT_EQ(std::vector<Frame>({
+                {kModuleStart, module()},
+                {kModuleStart + 0x20, module()},
+            }),
+            stack);
+}
+
+// Tests that if a V8 frame is encountered, unwinding stops and
+// kUnrecognizedFrame is returned to facilitate continuing with the V8 unwinder.
+TEST_F(NativeUnwinderLinuxTest, NonNativeFrame) {
+  InputStack input({
+      {true, 4},                     // fp of frame 1
+      {false, kModuleStart + 0x20},  // ip of frame 1
+      {false, 0xaaaa},
+      {false, 0xaaaa},
+      {true, 8},                              // fp of frame 2
+      {false, kNonNativeModuleStart + 0x42},  // ip of frame 2
+      {false, 0xaaaa},
+      {false, 0xaaaa},
+      {false, 0},
+      {false, 1},
+  });
+
+  RegisterContext context;
+  RegisterContextStackPointer(&context) = input.bottom();
+  RegisterContextInstructionPointer(&context) = kModuleStart;
+  RegisterContextFramePointer(&context) = input.bottom();
+  std::vector<Frame> stack = {
+      Frame(RegisterContextInstructionPointer(&context), module())};
+
+  EXPECT_EQ(UnwindResult::kUnrecognizedFrame,
+            unwinder()->TryUnwind(&context, input.top(), &stack));
+  EXPECT_EQ(std::vector<Frame>({
+                {kModuleStart, module()},
+                {kModuleStart + 0x20, module()},
+                {kNonNativeModuleStart + 0x42, non_native_module()},
+            }),
+            stack);
+}
+
+}  // namespace base
@@ -0,0 +1,250 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/profiler/pprof_profile.h"
+
+#include <utility>
+
+#include "base/check_op.h"
+#include "base/files/file_path.h"
+
+namespace base {
+
+namespace {
+
+// Field numbers of the messages in profile.proto.
+enum ProfileField : uint32_t {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileMapping = 3,
+  kProfileLocation = 4,
+  kProfileStringTable = 6,
+  kProfileTimeNanos = 9,
+  kProfileDurationNanos = 10,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+};
+
+enum ValueTypeField : uint32_t {
+  kValueTypeType = 1,
+  kValueTypeUnit = 2,
+};
+
+enum SampleField : uint32_t {
+  kSampleLocationId = 1,
+  kSampleValue = 2,
+};
+
+enum MappingField : uint32_t {
+  kMappingId = 1,
+  kMappingMemoryStart = 2,
+  kMappingMemoryLimit = 3,
+  kMappingFilename = 5,
+  kMappingBuildId = 6,
+};
+
+enum LocationField : uint32_t {
+  kLocationId = 1,
+  kLocationMappingId = 2,
+  kLocationAddress = 3,
+};
+
+enum WireType : uint32_t {
+  kVarint = 0,
+  kLengthDelimited = 2,
+};
+
+// Appends protocol buffer fields to a string. Nested messages are written to
+// their own ProtoWriter, then appended with AppendMessage().
+class ProtoWriter {
+ public:
+  void AppendVarint(uint32_t field, uint64_t value) {
+    AppendTag(field, kVarint);
+    AppendRawVarint(value);
+  }
+
+  // Zero values are omitted, which is their default.
+  void AppendOptionalVarint(uint32_t field, uint64_t value) {
+    if (value)
+      AppendVarint(field, value);
+  }
+
+  void AppendBytes(uint32_t field, StringPiece bytes) {
+    AppendTag(field, kLengthDelimited);
+    AppendRawVarint(bytes.size());
+    output_.append(bytes.data(), bytes.size());
+  }
+
+  void AppendMessage(uint32_t field, const ProtoWriter& message) {
+    AppendBytes(field, message.output_);
+  }
+
+  template <typename T>
+  void AppendPacked(uint32_t field, const std::vector<T>& values) {
+    ProtoWriter packed;
+    for (T value : values)
+      packed.AppendRawVarint(static_cast<uint64_t>(value));
+    AppendMessage(field, packed);
+  }
+
+  const std::string& output() const { return output_; }
+
+ private:
+  void AppendTag(uint32_t field, WireType wire_type) {
+    AppendRawVarint((field << 3) | wire_type);
+  }
+
+  void AppendRawVarint(uint64_t value) {
+    while (value >= 0x80) {
+      output_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    output_.push_back(static_cast<char>(value));
+  }
+
+  std::string output_;
+};
+
+}  // namespace
+
+PprofProfile::PprofProfile(std::vector<ValueType> sample_types)
+    : sample_types_(std::move(sample_types)) {
+  InternString("");
+  for (const ValueType& sample_type : sample_types_) {
+    InternString(sample_type.type);
+    InternString(sample_type.unit);
+  }
+}
+
+PprofProfile::~PprofProfile() = default;
+
+void PprofProfile::AddSample(const std::vector<Frame>& frames,
+                             const std::vector<int64_t>& values) {
+  DCHECK_EQ(sample_types_.size(), values.size());
+  std::vector<uint64_t> location_ids;
+  location_ids.reserve(frames.size());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    // The instruction pointers of the caller frames are return addresses,
+    // which may belong to the next line or even the next function. Step back
+    // into the call instruction.
+    uintptr_t address = frames[i].instruction_pointer;
+    if (i > 0 && address > 0)
+      --address;
+    location_ids.push_back(GetLocationId(address, frames[i].module));
+  }
+
+  auto result = samples_.emplace(std::move(location_ids), values);
+  if (result.second)
+    return;
+  std::vector<int64_t>& sums = result.first->second;
+  for (size_t i = 0; i < sums.size(); ++i)
+    sums[i] += values[i];
+}
+
+void PprofProfile::SetPeriod(ValueType period_type, int64_t period) {
+  InternString(period_type.type);
+  InternString(period_type.unit);
+  period_type_ = std::move(period_type);
+  period_ = period;
+}
+
+std::string PprofProfile::Serialize() const {
+  ProtoWriter profile;
+  auto append_value_type = [&profile, this](uint32_t field,
+                                            const ValueType& value_type) {
+    ProtoWriter message;
+    message.AppendOptionalVarint(kValueTypeType,
+                                 string_indices_.find(value_type.type)->second);
+    message.AppendOptionalVarint(kValueTypeUnit,
+                                 string_indices_.find(value_type.unit)->second);
+    profile.AppendMessage(field, message);
+  };
+
+  for (const ValueType& sample_type : sample_types_)
+    append_value_type(kProfileSampleType, sample_type);
+
+  for (const auto& sample : samples_) {
+    ProtoWriter message;
+    message.AppendPacked(kSampleLocationId, sample.first);
+    message.AppendPacked(kSampleValue, sample.second);
+    profile.AppendMessage(kProfileSample, message);
+  }
+
+  for (size_t i = 0; i < mappings_.size(); ++i) {
+    const Mapping& mapping = mappings_[i];
+    ProtoWriter message;
+    message.AppendVarint(kMappingId, i + 1);
+    message.AppendOptionalVarint(kMappingMemoryStart, mapping.memory_start);
+    message.AppendOptionalVarint(kMappingMemoryLimit, mapping.memory_limit);
+    message.AppendOptionalVarint(kMappingFilename, mapping.filename);
+    message.AppendOptionalVarint(kMappingBuildId, mapping.build_id);
+    profile.AppendMessage(kProfileMapping, message);
+  }
+
+  for (size_t i = 0; i < locations_.size(); ++i) {
+    const Location& location = locations_[i];
+    ProtoWriter message;
+    message.AppendVarint(kLocationId, i + 1);
+    message.AppendOptionalVarint(kLocationMappingId, location.mapping_id);
+    message.AppendOptionalVarint(kLocationAddress, location.address);
+    profile.AppendMessage(kProfileLocation, message);
+  }
+
+  for (const std::string& string : strings_)
+    profile.AppendBytes(kProfileStringTable, string);
+
+  if (!start_time_.is_null()) {
+    const TimeDelta since_epoch = start_time_ - Time::UnixEpoch();
+    profile.AppendVarint(kProfileTimeNanos,
+                         static_cast<uint64_t>(since_epoch.InNanoseconds()));
+  }
+  const int64_t duration_nanos = duration_.InNanoseconds();
+  profile.AppendOptionalVarint(kProfileDurationNanos,
+                               static_cast<uint64_t>(duration_nanos));
+  if (!period_type_.type.empty())
+    append_value_type(kProfilePeriodType, period_type_);
+  profile.AppendOptionalVarint(kProfilePeriod, static_cast<uint64_t>(period_));
+
+  return profile.output();
+}
+
+int64_t PprofProfile::InternString(StringPiece string) {
+  auto it = string_indices_.find(string);
+  if (it != string_indices_.end())
+    return it->second;
+  const int64_t index = static_cast<int64_t>(strings_.size());
+  strings_.emplace_back(string);
+  string_indices_.emplace(strings_.back(), index);
+  return index;
+}
+
+uint64_t PprofProfile::GetMappingId(const ModuleCache::Module* module) {
+  if (!module)
+    return 0;
+  auto it = mapping_ids_.find(module);
+  if (it != mapping_ids_.end())
+    return it->second;
+
+  const uintptr_t base_address = module->GetBaseAddress();
+  mappings_.push_back({base_address, base_address + module->GetSize(),
+                       InternString(module->GetDebugBasename().AsUTF8Unsafe()),
+                       InternString(module->GetId())});
+  const uint64_t id = mappings_.size();
+  mapping_ids_.emplace(module, id);
+  return id;
+}
+
+uint64_t PprofProfile::GetLocationId(uintptr_t address,
+                                     const ModuleCache::Module* module) {
+  auto it = location_ids_.find(address);
+  if (it != location_ids_.end())
+    return it->second;
+
+  locations_.push_back({GetMappingId(module), address});
+  const uint64_t id = locations_.size();
+  location_ids_.emplace(address, id);
+  return id;
+}
+
+}  // namespace base
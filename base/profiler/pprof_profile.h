@@ -0,0 +1,110 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROFILER_PPROF_PROFILE_H_
+#define BASE_PROFILER_PPROF_PROFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/profiler/frame.h"
+#include "base/profiler/module_cache.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// Accumulates samples of call stacks and writes them in the pprof format (see
+// https://github.com/google/pprof/blob/main/proto/profile.proto) for offline
+// analysis with the pprof tool. The values of identical call stacks are summed,
+// so memory use grows with the number of distinct call stacks rather than with
+// the number of samples.
+//
+// Addresses are not symbolized. Each frame refers to the mapping of its module,
+// identified by its build ID and debug basename, so that pprof can symbolize
+// the profile offline with the matching symbol files.
+class BASE_EXPORT PprofProfile {
+ public:
+  // The type and unit of a value, e.g. {"samples", "count"}.
+  struct ValueType {
+    std::string type;
+    std::string unit;
+  };
+
+  // Each sample has one value of each of |sample_types|.
+  explicit PprofProfile(std::vector<ValueType> sample_types);
+
+  PprofProfile(const PprofProfile&) = delete;
+  PprofProfile& operator=(const PprofProfile&) = delete;
+
+  ~PprofProfile();
+
+  // Adds |values|, one per sample type, to the sample of the call stack
+  // |frames|, which is ordered from the innermost frame.
+  void AddSample(const std::vector<Frame>& frames,
+                 const std::vector<int64_t>& values);
+
+  // Describes how the samples were taken, e.g. every 10 ms of CPU time.
+  void SetPeriod(ValueType period_type, int64_t period);
+
+  void set_start_time(Time start_time) { start_time_ = start_time; }
+  void set_duration(TimeDelta duration) { duration_ = duration; }
+
+  // Returns the number of distinct call stacks sampled.
+  size_t sample_count() const { return samples_.size(); }
+
+  // Returns the profile as a serialized, uncompressed profile.proto message,
+  // which pprof reads as is.
+  std::string Serialize() const;
+
+ private:
+  struct Mapping {
+    uintptr_t memory_start;
+    uintptr_t memory_limit;
+    int64_t filename;
+    int64_t build_id;
+  };
+
+  struct Location {
+    uint64_t mapping_id;
+    uintptr_t address;
+  };
+
+  // Returns the index of |string| in |strings_|, adding it if needed.
+  int64_t InternString(StringPiece string);
+
+  // Returns the ID of the mapping of |module|, or 0 if there is none.
+  uint64_t GetMappingId(const ModuleCache::Module* module);
+
+  // Returns the ID of the location of |address| in |module|.
+  uint64_t GetLocationId(uintptr_t address, const ModuleCache::Module* module);
+
+  const std::vector<ValueType> sample_types_;
+  ValueType period_type_;
+  int64_t period_ = 0;
+  Time start_time_;
+  TimeDelta duration_;
+
+  // The string table, whose first entry must be the empty string.
+  std::vector<std::string> strings_;
+  std::map<std::string, int64_t, std::less<>> string_indices_;
+
+  // Mappings and locations are numbered from 1, their index plus one.
+  std::vector<Mapping> mappings_;
+  std::map<const ModuleCache::Module*, uint64_t> mapping_ids_;
+  std::vector<Location> locations_;
+  std::map<uintptr_t, uint64_t> location_ids_;
+
+  // The summed values of each call stack, as location IDs.
+  std::map<std::vector<uint64_t>, std::vector<int64_t>> samples_;
+};
+
+}  // namespace base
+
+#endif  // BASE_PROFILER_PPROF_PROFILE_H_
@@ -0,0 +1,41 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/profiler/pprof_profile_builder.h"
+
+#include <utility>
+
+#include "base/check.h"
+
+namespace base {
+
+PprofProfileBuilder::PprofProfileBuilder(ModuleCache* module_cache,
+                                         CompletedCallback callback)
+    : module_cache_(module_cache),
+      callback_(std::move(callback)),
+      profile_(std::vector<PprofProfile::ValueType>{{"samples", "count"}}) {
+  DCHECK(module_cache_);
+  DCHECK(callback_);
+  profile_.set_start_time(Time::Now());
+}
+
+PprofProfileBuilder::~PprofProfileBuilder() = default;
+
+ModuleCache* PprofProfileBuilder::GetModuleCache() {
+  return module_cache_;
+}
+
+void PprofProfileBuilder::OnSampleCompleted(std::vector<Frame> frames,
+                                            TimeTicks sample_timestamp) {
+  profile_.AddSample(frames, {1});
+}
+
+void PprofProfileBuilder::OnProfileCompleted(TimeDelta profile_duration,
+                                             TimeDelta sampling_period) {
+  profile_.SetPeriod({"wall", "nanoseconds"}, sampling_period.InNanoseconds());
+  profile_.set_duration(profile_duration);
+  std::move(callback_).Run(profile_.Serialize());
+}
+
+}  // namespace base
@@ -0,0 +1,49 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROFILER_PPROF_PROFILE_BUILDER_H_
+#define BASE_PROFILER_PPROF_PROFILE_BUILDER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/callback.h"
+#include "base/memory/raw_ptr.h"
+#include "base/profiler/pprof_profile.h"
+#include "base/profiler/profile_builder.h"
+
+namespace base {
+
+// A ProfileBuilder which collects the samples of a StackSamplingProfiler into
+// a PprofProfile, and passes the serialized profile to a callback once the
+// profile is completed. The callback is run on the profiler thread.
+class BASE_EXPORT PprofProfileBuilder : public ProfileBuilder {
+ public:
+  using CompletedCallback = OnceCallback<void(std::string serialized_profile)>;
+
+  // |module_cache| must outlive the builder.
+  PprofProfileBuilder(ModuleCache* module_cache, CompletedCallback callback);
+
+  PprofProfileBuilder(const PprofProfileBuilder&) = delete;
+  PprofProfileBuilder& operator=(const PprofProfileBuilder&) = delete;
+
+  ~PprofProfileBuilder() override;
+
+  // ProfileBuilder:
+  ModuleCache* GetModuleCache() override;
+  void OnSampleCompleted(std::vector<Frame> frames,
+                         TimeTicks sample_timestamp) override;
+  void OnProfileCompleted(TimeDelta profile_duration,
+                          TimeDelta sampling_period) override;
+
+ private:
+  const raw_ptr<ModuleCache> module_cache_;
+  CompletedCallback callback_;
+  PprofProfile profile_;
+};
+
+}  // namespace base
+
+#endif  // BASE_PROFILER_PPROF_PROFILE_BUILDER_H_
@@ -0,0 +1,154 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/profiler/pprof_profile.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/profiler/stack_sampling_profiler_test_util.h"
+#include "base/strings/string_piece.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// The fields of a decoded protocol buffer message, by field number. Varints
+// are decoded to integers, length-delimited fields are kept as bytes.
+struct Message {
+  std::multimap<uint32_t, uint64_t> varints;
+  std::multimap<uint32_t, std::string> bytes;
+
+  uint64_t Varint(uint32_t field) const {
+    auto it = varints.find(field);
+    return it == varints.end() ? 0 : it->second;
+  }
+
+  std::vector<std::string> Bytes(uint32_t field) const {
+    std::vector<std::string> result;
+    auto range = bytes.equal_range(field);
+    for (auto it = range.first; it != range.second; ++it)
+      result.push_back(it->second);
+    return result;
+  }
+};
+
+uint64_t ReadVarint(StringPiece* input) {
+  uint64_t value = 0;
+  for (int shift = 0; !input->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(input->front());
+    input->remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+  }
+  return value;
+}
+
+// Decodes a message which only has varint and length-delimited fields.
+Message Decode(StringPiece input) {
+  Message message;
+  while (!input.empty()) {
+    const uint64_t tag = ReadVarint(&input);
+    const uint32_t field = static_cast<uint32_t>(tag >> 3);
+    if ((tag & 0x7) == 0) {
+      message.varints.emplace(field, ReadVarint(&input));
+    } else {
+      EXPECT_EQ(2u, tag & 0x7);
+      const size_t length = static_cast<size_t>(ReadVarint(&input));
+      message.bytes.emplace(field, std::string(input.substr(0, length)));
+      input.remove_prefix(length);
+    }
+  }
+  return message;
+}
+
+// Decodes a packed repeated varint field.
+std::vector<uint64_t> DecodePacked(StringPiece input) {
+  std::vector<uint64_t> values;
+  while (!input.empty())
+    values.push_back(ReadVarint(&input));
+  return values;
+}
+
+}  // namespace
+
+TEST(PprofProfileTest, Serialize) {
+  TestModule module(0x1000, 0x1000);
+  module.set_id("0123456789ABCDEF");
+  module.set_debug_basename(FilePath(FILE_PATH_LITERAL("libtest.so")));
+
+  PprofProfile profile({{"samples", "count"}, {"cpu", "nanoseconds"}});
+  profile.SetPeriod({"cpu", "nanoseconds"}, 10000);
+  profile.set_duration(Seconds(1));
+  const std::vector<Frame> stack = {{0x1100, &module}, {0x1200, &module}};
+  profile.AddSample(stack, {1, 10000});
+  profile.AddSample(stack, {2, 20000});
+  profile.AddSample({{0x1200, &module}, {0x5000, nullptr}}, {1, 10000});
+  EXPECT_EQ(2u, profile.sample_count());
+
+  const Message decoded = Decode(profile.Serialize());
+  const std::vector<std::string> strings = decoded.Bytes(6);
+  ASSERT_FALSE(strings.empty());
+  EXPECT_EQ("", strings[0]);
+  auto string_at = [&strings](uint64_t index) {
+    return index < strings.size() ? strings[index] : "<invalid>";
+  };
+
+  const std::vector<std::string> sample_types = decoded.Bytes(1);
+  ASSERT_EQ(2u, sample_types.size());
+  EXPECT_EQ("samples", string_at(Decode(sample_types[0]).Varint(1)));
+  EXPECT_EQ("count", string_at(Decode(sample_types[0]).Varint(2)));
+  EXPECT_EQ("cpu", string_at(Decode(sample_types[1]).Varint(1)));
+  EXPECT_EQ("nanoseconds", string_at(Decode(sample_types[1]).Varint(2)));
+
+  const std::vector<std::string> mappings = decoded.Bytes(3);
+  ASSERT_EQ(1u, mappings.size());
+  const Message mapping = Decode(mappings[0]);
+  EXPECT_EQ(0x1000u, mapping.Varint(2));
+  EXPECT_EQ(0x2000u, mapping.Varint(3));
+  EXPECT_EQ("libtest.so", string_at(mapping.Varint(5)));
+  EXPECT_EQ("0123456789ABCDEF", string_at(mapping.Varint(6)));
+
+  // Caller frames point into the call instruction.
+  std::map<uint64_t, Message> locations;
+  for (const std::string& location : decoded.Bytes(4)) {
+    Message message = Decode(location);
+    locations.emplace(message.Varint(1), std::move(message));
+  }
+  auto address_of = [&locations](uint64_t id) {
+    return locations.count(id) ? locations.at(id).Varint(3) : 0;
+  };
+
+  std::map<std::vector<uint64_t>, std::vector<uint64_t>> samples;
+  for (const std::string& sample : decoded.Bytes(2)) {
+    const Message message = Decode(sample);
+    std::vector<uint64_t> addresses;
+    for (uint64_t id : DecodePacked(message.Bytes(1).at(0)))
+      addresses.push_back(address_of(id));
+    samples.emplace(addresses, DecodePacked(message.Bytes(2).at(0)));
+  }
+  EXPECT_EQ((std::map<std::vector<uint64_t>, std::vector<uint64_t>>{
+                {{0x1100, 0x11ff}, {3, 30000}},
+                {{0x1200, 0x4fff}, {1, 10000}},
+            }),
+            samples);
+
+  // Only the location in |module| has a mapping.
+  for (const auto& location : locations) {
+    EXPECT_EQ(location.second.Varint(3) == 0x4fff ? 0u : 1u,
+              location.second.Varint(2));
+  }
+
+  EXPECT_EQ("cpu", string_at(Decode(decoded.Bytes(11).at(0)).Varint(1)));
+  EXPECT_EQ(10000u, decoded.Varint(12));
+  EXPECT_EQ(1000000000u, decoded.Varint(10));
+}
+
+}  // namespace base
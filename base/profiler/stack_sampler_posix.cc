@@ -6,18 +6,64 @@
 
 #include <pthread.h>
 
+#include "base/debug/debugging_buildflags.h"
 #include "base/threading/platform_thread.h"
 #include "build/build_config.h"
 
+// The stack is unwound with frame pointers on Linux and ChromeOS.
+#if (BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)) && \
+    (defined(ARCH_CPU_X86_64) || defined(ARCH_CPU_ARM64)) && \
+    BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS)
+#define STACK_SAMPLER_SUPPORTED 1
+#endif
+
+#if defined(STACK_SAMPLER_SUPPORTED)
+#include "base/bind.h"
+#include "base/profiler/native_unwinder.h"
+#include "base/profiler/stack_copier_signal.h"
+#include "base/profiler/stack_sampler_impl.h"
+#include "base/profiler/thread_delegate_posix.h"
+#include "base/profiler/unwinder.h"
+#endif
+
 namespace base {
 
+#if defined(STACK_SAMPLER_SUPPORTED)
+namespace {
+
+std::vector<std::unique_ptr<Unwinder>> CreateUnwinders(
+    ModuleCache* module_cache) {
+  std::vector<std::unique_ptr<Unwinder>> unwinders;
+  unwinders.push_back(CreateNativeUnwinder(module_cache));
+  return unwinders;
+}
+
+}  // namespace
+#endif
+
 std::unique_ptr<StackSampler> StackSampler::Create(
     SamplingProfilerThreadToken thread_token,
     ModuleCache* module_cache,
     UnwindersFactory core_unwinders_factory,
     RepeatingClosure record_sample_callback,
     StackSamplerTestDelegate* test_delegate) {
+#if defined(STACK_SAMPLER_SUPPORTED)
+  auto thread_delegate = ThreadDelegatePosix::Create(thread_token);
+  if (!thread_delegate)
+    return nullptr;
+  // The stack is copied by signaling the thread, and unwound by default with
+  // the frame pointer unwinder.
+  if (!core_unwinders_factory) {
+    core_unwinders_factory =
+        BindOnce(&CreateUnwinders, Unretained(module_cache));
+  }
+  return std::make_unique<StackSamplerImpl>(
+      std::make_unique<StackCopierSignal>(std::move(thread_delegate)),
+      std::move(core_unwinders_factory), module_cache,
+      std::move(record_sample_callback), test_delegate);
+#else
   return nullptr;
+#endif
 }
 
 size_t StackSampler::GetStackBufferSize() {
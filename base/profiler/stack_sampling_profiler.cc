@@ -14,6 +14,7 @@
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/callback_helpers.h"
+#include "base/debug/debugging_buildflags.h"
 #include "base/location.h"
 #include "base/memory/ptr_util.h"
 #include "base/memory/raw_ptr.h"
@@ -760,12 +761,15 @@ TimeTicks StackSamplingProfiler::TestPeer::GetNextSampleTime(
 }
 
 // static
-// The profiler is currently supported for Windows x64, macOS, iOS 64-bit, and
-// Android ARM32.
+// The profiler is currently supported for Windows x64, macOS, iOS 64-bit,
+// Android ARM32, and Linux/ChromeOS x64 and ARM64 with frame pointers.
 bool StackSamplingProfiler::IsSupportedForCurrentPlatform() {
 #if (BUILDFLAG(IS_WIN) && defined(ARCH_CPU_X86_64)) || BUILDFLAG(IS_MAC) ||  \
     (BUILDFLAG(IS_IOS) && defined(ARCH_CPU_64_BITS)) ||                      \
-    (BUILDFLAG(IS_ANDROID) && BUILDFLAG(ENABLE_ARM_CFI_TABLE))
+    (BUILDFLAG(IS_ANDROID) && BUILDFLAG(ENABLE_ARM_CFI_TABLE)) ||            \
+    ((BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)) &&                      \
+     (defined(ARCH_CPU_X86_64) || defined(ARCH_CPU_ARM64)) &&                \
+     BUILDFLAG(CAN_UNWIND_WITH_FRAME_POINTERS))
 #if BUILDFLAG(IS_WIN)
   // Do not start the profiler when Application Verifier is in use; running them
   // simultaneously can cause crashes and has no known use case.
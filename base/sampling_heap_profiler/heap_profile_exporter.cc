@@ -0,0 +1,159 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/sampling_heap_profiler/heap_profile_exporter.h"
+
+#include <memory>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/check.h"
+#include "base/files/file_util.h"
+#include "base/profiler/frame.h"
+#include "base/profiler/pprof_profile.h"
+#include "base/strings/string_number_conversions.h"
+
+namespace base {
+
+namespace {
+
+using Sample = SamplingHeapProfiler::Sample;
+
+bool WriteToFile(const FilePath& path_prefix,
+                 int* next_index,
+                 std::string serialized_profile) {
+  const FilePath path = path_prefix.AddExtensionASCII(
+      NumberToString((*next_index)++) + ".pb");
+  return WriteFile(path, serialized_profile);
+}
+
+std::vector<PprofProfile::ValueType> GetSampleTypes() {
+  return {{"inuse_objects", "count"}, {"inuse_space", "bytes"}};
+}
+
+// Adds |values| to the call stack |stack| of |profile|, looking up the
+// modules of the frames in |module_cache|.
+void AddSample(const std::vector<void*>& stack,
+               std::vector<int64_t> values,
+               ModuleCache* module_cache,
+               PprofProfile* profile) {
+  std::vector<Frame> frames;
+  frames.reserve(stack.size());
+  for (void* address : stack) {
+    const uintptr_t instruction_pointer = reinterpret_cast<uintptr_t>(address);
+    frames.emplace_back(instruction_pointer,
+                        module_cache->GetModuleForAddress(instruction_pointer));
+  }
+  profile->AddSample(frames, values);
+}
+
+// Returns the number of objects a sample stands for. Each sample stands for
+// the allocations of its size in |total| bytes.
+int64_t GetCount(const Sample& sample) {
+  return sample.size ? static_cast<int64_t>(sample.total / sample.size) : 1;
+}
+
+}  // namespace
+
+// static
+HeapProfileExporter::Sink HeapProfileExporter::FileSink(
+    const FilePath& path_prefix) {
+  return BindRepeating(&WriteToFile, path_prefix,
+                       Owned(std::make_unique<int>(0)));
+}
+
+// static
+std::string HeapProfileExporter::SerializeSamples(
+    const std::vector<Sample>& samples,
+    ModuleCache* module_cache) {
+  PprofProfile profile(GetSampleTypes());
+  profile.set_start_time(Time::Now());
+  for (const Sample& sample : samples) {
+    AddSample(sample.stack,
+              {GetCount(sample), static_cast<int64_t>(sample.total)},
+              module_cache, &profile);
+  }
+  return profile.Serialize();
+}
+
+HeapProfileExporter::HeapProfileExporter(Sink sink, TimeDelta interval)
+    : sink_(std::move(sink)), interval_(interval) {
+  DCHECK(sink_);
+  DCHECK(interval_.is_positive());
+}
+
+HeapProfileExporter::~HeapProfileExporter() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (is_running())
+    SamplingHeapProfiler::Get()->Stop();
+}
+
+void HeapProfileExporter::Start() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(!is_running());
+  profile_id_ = SamplingHeapProfiler::Get()->Start();
+  previous_totals_.clear();
+  previous_time_ = Time::Now();
+  timer_.Start(FROM_HERE, interval_,
+               BindRepeating(&HeapProfileExporter::Export, Unretained(this)));
+}
+
+void HeapProfileExporter::Stop() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!is_running())
+    return;
+  Export();
+  // The export may have stopped the exporter on failure.
+  if (!is_running())
+    return;
+  timer_.Stop();
+  SamplingHeapProfiler::Get()->Stop();
+}
+
+bool HeapProfileExporter::ExportSamples(const std::vector<Sample>& samples) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  TotalsByStack totals;
+  for (const Sample& sample : samples) {
+    Totals& stack_totals = totals[sample.stack];
+    stack_totals.count += GetCount(sample);
+    stack_totals.size += static_cast<int64_t>(sample.total);
+  }
+
+  // Stacks which are no longer sampled get the negated previous totals.
+  TotalsByStack deltas;
+  for (const auto& previous : previous_totals_)
+    deltas[previous.first] = {-previous.second.count, -previous.second.size};
+  for (const auto& current : totals) {
+    Totals& delta = deltas[current.first];
+    delta.count += current.second.count;
+    delta.size += current.second.size;
+  }
+
+  PprofProfile profile(GetSampleTypes());
+  for (const auto& delta : deltas) {
+    if (delta.second.count || delta.second.size) {
+      AddSample(delta.first, {delta.second.count, delta.second.size},
+                &module_cache_, &profile);
+    }
+  }
+  previous_totals_ = std::move(totals);
+
+  const Time now = Time::Now();
+  profile.set_start_time(previous_time_);
+  profile.set_duration(now - previous_time_);
+  previous_time_ = now;
+
+  if (!profile.sample_count())
+    return true;
+  return sink_.Run(profile.Serialize());
+}
+
+void HeapProfileExporter::Export() {
+  if (ExportSamples(SamplingHeapProfiler::Get()->GetSamples(profile_id_)))
+    return;
+  timer_.Stop();
+  SamplingHeapProfiler::Get()->Stop();
+}
+
+}  // namespace base
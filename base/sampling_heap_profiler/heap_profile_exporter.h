@@ -0,0 +1,110 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SAMPLING_HEAP_PROFILER_HEAP_PROFILE_EXPORTER_H_
+#define BASE_SAMPLING_HEAP_PROFILER_HEAP_PROFILE_EXPORTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/profiler/module_cache.h"
+#include "base/sampling_heap_profiler/sampling_heap_profiler.h"
+#include "base/sequence_checker.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace base {
+
+// Periodically exports the allocations sampled by the SamplingHeapProfiler in
+// the pprof format (see base/profiler/pprof_profile.h), so that the heap of a
+// long-running process can be watched without restarting it.
+//
+// Each export is a delta: it holds, for each allocation call stack, the change
+// in the sampled live objects and bytes since the previous export. The first
+// export holds the whole live heap, and summing the exports, e.g. with
+// `pprof -base`, gives the heap at any later export. Exports without any
+// change are skipped.
+//
+// The exporter only keeps the totals of the previous export, whose size is
+// bounded by the number of distinct call stacks of the live sampled
+// allocations, not by the number of exports.
+//
+// Must be used on a single sequence, which runs the sink.
+class BASE_EXPORT HeapProfileExporter {
+ public:
+  // Receives each serialized profile. Returns false on failure, after which
+  // the exporter stops.
+  using Sink = RepeatingCallback<bool(std::string serialized_profile)>;
+
+  // Returns a Sink which writes each profile to its own file, named
+  // |path_prefix| followed by the index of the profile, e.g. "heap.0.pb",
+  // "heap.1.pb"... for the prefix "heap".
+  static Sink FileSink(const FilePath& path_prefix);
+
+  // Returns the live allocations in |samples| as a serialized pprof profile,
+  // symbolizable offline with the modules of |module_cache|.
+  static std::string SerializeSamples(
+      const std::vector<SamplingHeapProfiler::Sample>& samples,
+      ModuleCache* module_cache);
+
+  HeapProfileExporter(Sink sink, TimeDelta interval);
+
+  HeapProfileExporter(const HeapProfileExporter&) = delete;
+  HeapProfileExporter& operator=(const HeapProfileExporter&) = delete;
+
+  // Stops the exporter if it is running.
+  ~HeapProfileExporter();
+
+  // Starts a SamplingHeapProfiler session, and exports the allocations sampled
+  // since then every |interval|.
+  void Start();
+
+  // Exports the last delta, and stops the profiler session.
+  void Stop();
+
+  bool is_running() const { return timer_.IsRunning(); }
+
+  // Exports |samples|, the live sampled allocations, as the delta since the
+  // previous call. Returns false if the sink failed. Exposed for testing.
+  bool ExportSamples(const std::vector<SamplingHeapProfiler::Sample>& samples);
+
+ private:
+  // The sampled objects and bytes allocated by a call stack.
+  struct Totals {
+    int64_t count = 0;
+    int64_t size = 0;
+  };
+  using TotalsByStack = std::map<std::vector<void*>, Totals>;
+
+  // Exports the samples since Start().
+  void Export();
+
+  const Sink sink_;
+  const TimeDelta interval_;
+
+  RepeatingTimer timer_;
+
+  // The SamplingHeapProfiler session, as returned by its Start().
+  uint32_t profile_id_ = 0;
+
+  // Maps the sampled addresses to modules, to symbolize the profiles.
+  ModuleCache module_cache_;
+
+  // The totals of the previous export, and its time.
+  TotalsByStack previous_totals_;
+  Time previous_time_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+}  // namespace base
+
+#endif  // BASE_SAMPLING_HEAP_PROFILER_HEAP_PROFILE_EXPORTER_H_
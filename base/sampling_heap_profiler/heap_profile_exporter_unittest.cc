@@ -0,0 +1,89 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/sampling_heap_profiler/heap_profile_exporter.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/test/bind.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+using Sample = SamplingHeapProfiler::Sample;
+
+Sample MakeSample(size_t size, size_t total, std::vector<void*> stack) {
+  Sample sample(size, total, /*ordinal=*/1);
+  sample.stack = std::move(stack);
+  return sample;
+}
+
+}  // namespace
+
+TEST(HeapProfileExporterTest, ExportsDeltas) {
+  std::vector<std::string> profiles;
+  bool sink_result = true;
+  HeapProfileExporter exporter(
+      BindLambdaForTesting([&](std::string serialized_profile) {
+        profiles.push_back(std::move(serialized_profile));
+        return sink_result;
+      }),
+      Seconds(1));
+
+  void* const kCaller = reinterpret_cast<void*>(0x1000);
+  void* const kOtherCaller = reinterpret_cast<void*>(0x2000);
+  const std::vector<Sample> samples = {
+      MakeSample(16, 1024, {kCaller}),
+      MakeSample(32, 1024, {kCaller}),
+      MakeSample(64, 4096, {kOtherCaller, kCaller}),
+  };
+
+  // The first export holds the whole heap.
+  EXPECT_TRUE(exporter.ExportSamples(samples));
+  ASSERT_EQ(1u, profiles.size());
+  EXPECT_FALSE(profiles[0].empty());
+
+  // Nothing changed.
+  EXPECT_TRUE(exporter.ExportSamples(samples));
+  EXPECT_EQ(1u, profiles.size());
+
+  // One stack is gone, the other changed.
+  EXPECT_TRUE(exporter.ExportSamples({samples[0]}));
+  EXPECT_EQ(2u, profiles.size());
+
+  // The heap is back to the first export.
+  EXPECT_TRUE(exporter.ExportSamples(samples));
+  ASSERT_EQ(3u, profiles.size());
+  EXPECT_NE(profiles[0], profiles[2]);
+
+  sink_result = false;
+  EXPECT_FALSE(exporter.ExportSamples({}));
+  EXPECT_EQ(4u, profiles.size());
+}
+
+TEST(HeapProfileExporterTest, FileSink) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath prefix = temp_dir.GetPath().AppendASCII("heap");
+  HeapProfileExporter::Sink sink = HeapProfileExporter::FileSink(prefix);
+  EXPECT_TRUE(sink.Run("first"));
+  EXPECT_TRUE(sink.Run("second"));
+
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(temp_dir.GetPath().AppendASCII("heap.0.pb"),
+                               &contents));
+  EXPECT_EQ("first", contents);
+  ASSERT_TRUE(ReadFileToString(temp_dir.GetPath().AppendASCII("heap.1.pb"),
+                               &contents));
+  EXPECT_EQ("second", contents);
+}
+
+}  // namespace base
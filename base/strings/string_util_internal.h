@@ -5,8 +5,11 @@
 #ifndef BASE_STRINGS_STRING_UTIL_INTERNAL_H_
 #define BASE_STRINGS_STRING_UTIL_INTERNAL_H_
 
+#include <stdint.h>
+
 #include <algorithm>
 
+#include "base/bits.h"
 #include "base/check.h"
 #include "base/check_op.h"
 #include "base/logging.h"
@@ -14,6 +17,13 @@
 #include "base/ranges/algorithm.h"
 #include "base/strings/string_piece.h"
 #include "base/third_party/icu/icu_utf.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
 
 namespace base {
 
@@ -227,6 +237,64 @@ bool DoIsStringASCII(const Char* characters, size_t length) {
   return !(all_char_bits & non_ascii_bit_mask);
 }
 
+// Returns the number of leading ASCII characters in |str|. Text is often
+// mostly ASCII, so the UTF-8 validation and UTF conversion loops use this to
+// skip over ASCII runs 16 bytes at a time where SSE2 or NEON are available.
+inline size_t CountLeadingASCII(StringPiece str) {
+  const char* const begin = str.data();
+  const char* const end = begin + str.length();
+  const char* pos = begin;
+#if defined(ARCH_CPU_X86_FAMILY)
+  for (; end - pos >= 16; pos += 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)));
+    if (mask) {
+      return static_cast<size_t>(pos - begin) +
+             bits::CountTrailingZeroBits(static_cast<uint32_t>(mask));
+    }
+  }
+#elif defined(ARCH_CPU_ARM64)
+  for (; end - pos >= 16; pos += 16) {
+    // The scalar loop below finds the non-ASCII character.
+    if (vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(pos))) >= 0x80)
+      break;
+  }
+#endif
+  while (pos < end && static_cast<unsigned char>(*pos) < 0x80)
+    ++pos;
+  return static_cast<size_t>(pos - begin);
+}
+
+inline size_t CountLeadingASCII(StringPiece16 str) {
+  const char16_t* const begin = str.data();
+  const char16_t* const end = begin + str.length();
+  const char16_t* pos = begin;
+#if defined(ARCH_CPU_X86_FAMILY)
+  const __m128i non_ascii_bits = _mm_set1_epi16(static_cast<int16_t>(0xFF80));
+  for (; end - pos >= 8; pos += 8) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const __m128i is_ascii = _mm_cmpeq_epi16(
+        _mm_and_si128(chunk, non_ascii_bits), _mm_setzero_si128());
+    // Two bits per character.
+    const uint32_t mask =
+        ~static_cast<uint32_t>(_mm_movemask_epi8(is_ascii)) & 0xFFFF;
+    if (mask) {
+      return static_cast<size_t>(pos - begin) +
+             bits::CountTrailingZeroBits(mask) / 2;
+    }
+  }
+#elif defined(ARCH_CPU_ARM64)
+  for (; end - pos >= 8; pos += 8) {
+    if (vmaxvq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(pos))) >= 0x80)
+      break;
+  }
+#endif
+  while (pos < end && *pos < 0x80)
+    ++pos;
+  return static_cast<size_t>(pos - begin);
+}
+
 template <bool (*Validator)(uint32_t)>
 inline bool DoIsStringUTF8(StringPiece str) {
   const char* src = str.data();
@@ -234,6 +302,12 @@ inline bool DoIsStringUTF8(StringPiece str) {
   int32_t char_index = 0;
 
   while (char_index < src_len) {
+    // ASCII characters are valid for every |Validator|.
+    if (static_cast<unsigned char>(src[char_index]) < 0x80) {
+      char_index += static_cast<int32_t>(
+          CountLeadingASCII(str.substr(static_cast<size_t>(char_index))));
+      continue;
+    }
     int32_t code_point;
     CBU8_NEXT(src, char_index, src_len, code_point);
     if (!Validator(code_point))
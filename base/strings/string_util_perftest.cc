@@ -6,6 +6,7 @@
 
 #include <cinttypes>
 
+#include "base/strings/utf_string_conversions.h"
 #include "base/time/time.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -43,4 +44,38 @@ TEST(StringUtilTest, DISABLED_IsStringASCIIPerf) {
   }
 }
 
+// Measures UTF-8 validation and UTF-8 <-> UTF-16 conversion of mostly ASCII
+// text with a non-ASCII character every |ascii_run_length| characters.
+void MeasureUTFConversions(size_t str_length, size_t ascii_run_length) {
+  std::string utf8;
+  while (utf8.length() < str_length) {
+    utf8.append(ascii_run_length, 'A');
+    utf8.append("\xc3\xa9");
+  }
+  const std::u16string utf16 = UTF8ToUTF16(utf8);
+  const size_t iterations = 100000000 / str_length;
+
+  TimeTicks t0 = TimeTicks::Now();
+  for (size_t i = 0; i < iterations; ++i)
+    IsStringUTF8(utf8);
+  TimeTicks t1 = TimeTicks::Now();
+  for (size_t i = 0; i < iterations; ++i)
+    UTF8ToUTF16(utf8);
+  TimeTicks t2 = TimeTicks::Now();
+  for (size_t i = 0; i < iterations; ++i)
+    UTF16ToUTF8(utf16);
+  TimeTicks t3 = TimeTicks::Now();
+  printf("length:\t%zu\tascii-run:\t%zu\tis-utf8-ms:\t%" PRIu64
+         "\tutf8-to-utf16-ms:\t%" PRIu64 "\tutf16-to-utf8-ms:\t%" PRIu64 "\n",
+         utf8.length(), ascii_run_length, (t1 - t0).InMilliseconds(),
+         (t2 - t1).InMilliseconds(), (t3 - t2).InMilliseconds());
+}
+
+TEST(StringUtilTest, DISABLED_UTFConversionsPerf) {
+  for (size_t str_length = 16; str_length <= 16384; str_length *= 4) {
+    for (size_t ascii_run_length : {0, 8, 64, 1024})
+      MeasureUTFConversions(str_length, ascii_run_length);
+  }
+}
+
 }  // namespace base
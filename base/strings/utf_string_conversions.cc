@@ -12,6 +12,7 @@
 
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
+#include "base/strings/string_util_internal.h"
 #include "base/strings/utf_string_conversion_utils.h"
 #include "base/third_party/icu/icu_utf.h"
 #include "build/build_config.h"
@@ -85,6 +86,22 @@ void UnicodeAppendUnsafe(Char* out, int32_t* size, uint32_t code_point) {
   out[(*size)++] = code_point;
 }
 
+// CopyLeadingASCII -----------------------------------------------------------
+// Copies the run of ASCII characters at the beginning of |src|, which are
+// encoded by one codeunit in all encodings, to |dest|. Returns the length of
+// the run.
+
+template <typename SrcChar, typename DestChar>
+int32_t CopyLeadingASCII(const SrcChar* src,
+                         int32_t src_len,
+                         DestChar* dest) {
+  const int32_t length = static_cast<int32_t>(internal::CountLeadingASCII(
+      BasicStringPiece<SrcChar>(src, static_cast<size_t>(src_len))));
+  for (int32_t i = 0; i < length; ++i)
+    dest[i] = static_cast<DestChar>(src[i]);
+  return length;
+}
+
 // DoUTFConversion ------------------------------------------------------------
 // Main driver of UTFConversion specialized for different Src encodings.
 // dest has to have enough room for the converted text.
@@ -97,6 +114,14 @@ bool DoUTFConversion(const char* src,
   bool success = true;
 
   for (int32_t i = 0; i < src_len;) {
+    if (static_cast<unsigned char>(src[i]) < 0x80) {
+      const int32_t length =
+          CopyLeadingASCII(src + i, src_len - i, dest + *dest_len);
+      i += length;
+      *dest_len += length;
+      continue;
+    }
+
     int32_t code_point;
     CBU8_NEXT(src, i, src_len, code_point);
 
@@ -131,6 +156,14 @@ bool DoUTFConversion(const char16_t* src,
   // Always have another symbol in order to avoid checking boundaries in the
   // middle of the surrogate pair.
   while (i < src_len - 1) {
+    if (src[i] < 0x80) {
+      const int32_t length =
+          CopyLeadingASCII(src + i, src_len - i, dest + *dest_len);
+      i += length;
+      *dest_len += length;
+      continue;
+    }
+
     int32_t code_point;
 
     if (CBU16_IS_LEAD(src[i]) && CBU16_IS_TRAIL(src[i + 1])) {
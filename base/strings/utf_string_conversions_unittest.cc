@@ -5,9 +5,20 @@
 #include "base/strings/utf_string_conversions.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
+#include "base/strings/string_util_internal.h"
+#include "base/strings/utf_string_conversion_utils.h"
+#include "base/third_party/icu/icu_utf.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -15,6 +26,60 @@ namespace base {
 
 namespace {
 
+// Character-at-a-time versions of the functions that skip ASCII runs in
+// blocks, used as references on random input.
+size_t CountLeadingASCIIReference(StringPiece str) {
+  size_t i = 0;
+  while (i < str.length() && static_cast<unsigned char>(str[i]) < 0x80)
+    ++i;
+  return i;
+}
+
+size_t CountLeadingASCIIReference(StringPiece16 str) {
+  size_t i = 0;
+  while (i < str.length() && str[i] < 0x80)
+    ++i;
+  return i;
+}
+
+bool IsStringUTF8Reference(StringPiece str) {
+  const char* src = str.data();
+  int32_t src_len = static_cast<int32_t>(str.length());
+  for (int32_t i = 0; i < src_len;) {
+    int32_t code_point;
+    CBU8_NEXT(src, i, src_len, code_point);
+    if (!IsValidCharacter(code_point))
+      return false;
+  }
+  return true;
+}
+
+template <typename SrcChar, typename DestString>
+DestString ConvertReference(BasicStringPiece<SrcChar> src) {
+  DestString dest;
+  int32_t src_len = static_cast<int32_t>(src.length());
+  for (int32_t i = 0; i < src_len; ++i) {
+    uint32_t code_point;
+    if (!ReadUnicodeCharacter(src.data(), src_len, &i, &code_point))
+      code_point = 0xFFFD;
+    WriteUnicodeCharacter(code_point, &dest);
+  }
+  return dest;
+}
+
+// Returns a random string of |length| code units, mostly ASCII so that runs
+// of various lengths end at various offsets.
+template <typename String>
+String RandomMostlyASCIIString(size_t length) {
+  using Unit = std::make_unsigned_t<typename String::value_type>;
+  String str(length, 'a');
+  constexpr uint64_t kUnitRange =
+      uint64_t{std::numeric_limits<Unit>::max()} + 1;
+  for (auto& c : str)
+    c = static_cast<Unit>(RandGenerator(RandInt(0, 7) ? 0x80 : kUnitRange));
+  return str;
+}
+
 const wchar_t* const kConvertRoundtripCases[] = {
   L"Google Video",
   // "网页 图片 资讯更多 »"
@@ -200,4 +265,92 @@ TEST(UTFStringConversionsTest, ConvertMultiString) {
   EXPECT_EQ(expected, converted);
 }
 
+// ASCII runs are converted in blocks. Checks that the result of converting
+// a string made of pieces is the same as converting each piece on its own,
+// whatever the offset of the pieces relative to the blocks.
+TEST(UTFStringConversionsTest, ConvertASCIIRunsAtAnyOffset) {
+  const char* const kUTF8Pieces[] = {
+      "a",
+      "0123456789abcdefghijklmnopqrstuvwxyz",
+      "\xc3\xa9",          // U+00E9
+      "\xe6\x97\xa5",      // U+65E5
+      "\xf0\x9f\x98\x80",  // U+1F600
+      "\xff",              // Invalid byte.
+      "\xc3",              // Truncated sequence.
+      "\xef\xbf\xbe",      // Noncharacter U+FFFE.
+  };
+  const char16_t* const kUTF16Pieces[] = {
+      u"a",
+      u"0123456789abcdefghijklmnopqrstuvwxyz",
+      u"\x00e9",
+      u"\x65e5",
+      u"\xd83d\xde00",  // U+1F600
+      u"\xde00",        // Unpaired trail surrogate.
+      u"\x007f",
+  };
+
+  for (size_t offset = 0; offset < 16; ++offset) {
+    const std::string prefix(offset, 'x');
+    for (const char* first : kUTF8Pieces) {
+      for (const char* second : kUTF8Pieces) {
+        for (const char* third : kUTF8Pieces) {
+          const std::string input = prefix + first + second + third;
+          SCOPED_TRACE(input);
+          const std::u16string expected =
+              ASCIIToUTF16(prefix) + UTF8ToUTF16(first) +
+              UTF8ToUTF16(second) + UTF8ToUTF16(third);
+          EXPECT_EQ(expected, UTF8ToUTF16(input));
+          EXPECT_EQ(IsStringUTF8(first) && IsStringUTF8(second) &&
+                        IsStringUTF8(third),
+                    IsStringUTF8(input));
+        }
+      }
+    }
+
+    const std::u16string prefix16(offset, 'x');
+    for (const char16_t* first : kUTF16Pieces) {
+      for (const char16_t* second : kUTF16Pieces) {
+        for (const char16_t* third : kUTF16Pieces) {
+          const std::u16string input = prefix16 + first + second + third;
+          const std::string expected = UTF16ToASCII(prefix16) +
+                                       UTF16ToUTF8(first) +
+                                       UTF16ToUTF8(second) + UTF16ToUTF8(third);
+          EXPECT_EQ(expected, UTF16ToUTF8(input));
+        }
+      }
+    }
+  }
+}
+
+// Compares the functions that skip ASCII runs in blocks with their
+// character-at-a-time references on random input, at random alignments.
+TEST(UTFStringConversionsTest, RandomInputMatchesCharacterAtATime) {
+  for (int i = 0; i < 10000; ++i) {
+    const size_t length = static_cast<size_t>(RandInt(0, 100));
+    const size_t offset = static_cast<size_t>(RandInt(0, 15));
+
+    const std::string buffer = RandomMostlyASCIIString<std::string>(length);
+    const StringPiece str =
+        StringPiece(buffer).substr(std::min(offset, length));
+    const std::u16string buffer16 =
+        RandomMostlyASCIIString<std::u16string>(length);
+    const StringPiece16 str16 =
+        StringPiece16(buffer16).substr(std::min(offset, length));
+    SCOPED_TRACE(testing::Message()
+                 << "UTF-8 input: " << HexEncode(str.data(), str.length())
+                 << ", UTF-16 input: "
+                 << HexEncode(str16.data(), str16.length() * sizeof(char16_t)));
+
+    EXPECT_EQ(CountLeadingASCIIReference(str),
+              internal::CountLeadingASCII(str));
+    EXPECT_EQ(IsStringUTF8Reference(str), IsStringUTF8(str));
+    EXPECT_EQ((ConvertReference<char, std::u16string>(str)), UTF8ToUTF16(str));
+
+    EXPECT_EQ(CountLeadingASCIIReference(str16),
+              internal::CountLeadingASCII(str16));
+    EXPECT_EQ((ConvertReference<char16_t, std::string>(str16)),
+              UTF16ToUTF8(str16));
+  }
+}
+
 }  // namespace base
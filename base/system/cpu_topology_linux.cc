@@ -0,0 +1,214 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/system/cpu_topology_linux.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <string>
+
+#include "base/containers/contains.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/no_destructor.h"
+#include "base/ranges/algorithm.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+
+namespace base {
+
+namespace {
+
+// Upper bound on cache index directories probed per CPU
+// (cpu/cpuN/cache/indexM). Real hardware exposes at most 4 or 5.
+constexpr int kMaxCacheIndex = 16;
+
+// Ids above this are rejected by ParseCpuList(), to bound the size of the
+// result on malformed input. Matches the kernel's NR_CPUS upper bound.
+constexpr int kMaxCpuId = 8192;
+
+// Sysfs files are backed by kernel data structures: reading them never blocks
+// and is allowed on any thread.
+bool ReadSysfsString(const FilePath& path, std::string* contents) {
+  if (!ReadFileToStringNonBlocking(path, contents))
+    return false;
+  TrimWhitespaceASCII(*contents, TRIM_ALL, contents);
+  return true;
+}
+
+bool ReadSysfsCpuList(const FilePath& path, std::vector<int>* ids) {
+  std::string contents;
+  return ReadSysfsString(path, &contents) && ParseCpuList(contents, ids);
+}
+
+// Returns the online CPUs among |cpus|.
+std::vector<int> FilterOnline(const std::vector<int>& cpus,
+                              const std::vector<int>& online_cpus) {
+  std::vector<int> result;
+  for (int cpu : cpus) {
+    if (std::binary_search(online_cpus.begin(), online_cpus.end(), cpu))
+      result.push_back(cpu);
+  }
+  return result;
+}
+
+// Returns the CPUs in the affinity mask of the current thread, or nullopt if
+// it can't be read.
+absl::optional<std::vector<int>> GetAllowedCpus() {
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    DPLOG(ERROR) << "sched_getaffinity";
+    return absl::nullopt;
+  }
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set))
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+std::vector<std::vector<int>> ReadNodes(const FilePath& sysfs_system_dir,
+                                        const std::vector<int>& online_cpus) {
+  std::vector<std::vector<int>> nodes;
+  std::vector<int> node_ids;
+  if (ReadSysfsCpuList(sysfs_system_dir.Append("node/online"), &node_ids)) {
+    for (int node_id : node_ids) {
+      std::vector<int> node_cpus;
+      if (!ReadSysfsCpuList(sysfs_system_dir.Append(
+                                StringPrintf("node/node%d/cpulist", node_id)),
+                            &node_cpus)) {
+        continue;
+      }
+      node_cpus = FilterOnline(node_cpus, online_cpus);
+      // Memory-only nodes have no CPUs to place work on.
+      if (!node_cpus.empty())
+        nodes.push_back(std::move(node_cpus));
+    }
+  }
+  // Kernels built without CONFIG_NUMA don't expose nodes.
+  if (nodes.empty())
+    nodes.push_back(online_cpus);
+  return nodes;
+}
+
+// Returns the CPUs sharing the highest-level cache of |cpu|, or an empty
+// vector if the cache topology isn't exposed.
+std::vector<int> ReadLastLevelCache(const FilePath& sysfs_system_dir,
+                                    int cpu) {
+  const FilePath cache_dir =
+      sysfs_system_dir.Append(StringPrintf("cpu/cpu%d/cache", cpu));
+  int highest_level = 0;
+  std::vector<int> shared_cpus;
+  for (int index = 0; index < kMaxCacheIndex; ++index) {
+    const FilePath index_dir = cache_dir.Append(StringPrintf("index%d", index));
+    std::string level_string;
+    int level;
+    if (!ReadSysfsString(index_dir.Append("level"), &level_string))
+      break;
+    if (!StringToInt(level_string, &level) || level <= highest_level)
+      continue;
+    std::string type;
+    // Instruction caches don't hold the data shared between workers.
+    if (ReadSysfsString(index_dir.Append("type"), &type) &&
+        type == "Instruction") {
+      continue;
+    }
+    std::vector<int> cpus;
+    if (!ReadSysfsCpuList(index_dir.Append("shared_cpu_list"), &cpus))
+      continue;
+    highest_level = level;
+    shared_cpus = std::move(cpus);
+  }
+  return shared_cpus;
+}
+
+std::vector<std::vector<int>> ReadLastLevelCaches(
+    const FilePath& sysfs_system_dir,
+    const std::vector<int>& online_cpus) {
+  std::vector<std::vector<int>> caches;
+  for (int cpu : online_cpus) {
+    // CPUs already assigned to a cache were covered by an earlier sibling.
+    if (ranges::any_of(caches, [cpu](const std::vector<int>& cache) {
+          return Contains(cache, cpu);
+        })) {
+      continue;
+    }
+    std::vector<int> cache =
+        FilterOnline(ReadLastLevelCache(sysfs_system_dir, cpu), online_cpus);
+    if (cache.empty() || !Contains(cache, cpu)) {
+      // Inconsistent or missing cache information: don't report any, rather
+      // than a partial view.
+      return {};
+    }
+    caches.push_back(std::move(cache));
+  }
+  return caches;
+}
+
+}  // namespace
+
+CpuTopology::CpuTopology() = default;
+CpuTopology::CpuTopology(const CpuTopology&) = default;
+CpuTopology& CpuTopology::operator=(const CpuTopology&) = default;
+CpuTopology::~CpuTopology() = default;
+
+bool ParseCpuList(StringPiece cpu_list, std::vector<int>* ids) {
+  ids->clear();
+  for (StringPiece range : SplitStringPiece(cpu_list, ",", TRIM_WHITESPACE,
+                                            SPLIT_WANT_NONEMPTY)) {
+    const size_t dash = range.find('-');
+    int first;
+    int last;
+    if (dash == StringPiece::npos) {
+      if (!StringToInt(range, &first))
+        return false;
+      last = first;
+    } else if (!StringToInt(range.substr(0, dash), &first) ||
+               !StringToInt(range.substr(dash + 1), &last)) {
+      return false;
+    }
+    if (first < 0 || last < first || last > kMaxCpuId)
+      return false;
+    for (int id = first; id <= last; ++id)
+      ids->push_back(id);
+  }
+  std::sort(ids->begin(), ids->end());
+  ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+  return true;
+}
+
+absl::optional<CpuTopology> ReadCpuTopology(
+    const FilePath& sysfs_system_dir,
+    const absl::optional<std::vector<int>>& allowed_cpus) {
+  std::vector<int> online_cpus;
+  if (!ReadSysfsCpuList(sysfs_system_dir.Append("cpu/online"), &online_cpus))
+    return absl::nullopt;
+  // CPUs outside of the allowed ones are treated as offline, so that they are
+  // dropped from the nodes and caches as well.
+  if (allowed_cpus) {
+    std::vector<int> sorted_allowed_cpus = *allowed_cpus;
+    std::sort(sorted_allowed_cpus.begin(), sorted_allowed_cpus.end());
+    online_cpus = FilterOnline(sorted_allowed_cpus, online_cpus);
+  }
+  if (online_cpus.empty())
+    return absl::nullopt;
+
+  CpuTopology topology;
+  topology.nodes = ReadNodes(sysfs_system_dir, online_cpus);
+  topology.last_level_caches =
+      ReadLastLevelCaches(sysfs_system_dir, online_cpus);
+  return topology;
+}
+
+const absl::optional<CpuTopology>& GetCpuTopology() {
+  static const NoDestructor<absl::optional<CpuTopology>> topology(
+      ReadCpuTopology(FilePath("/sys/devices/system"), GetAllowedCpus()));
+  return *topology;
+}
+
+}  // namespace base
@@ -0,0 +1,55 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYSTEM_CPU_TOPOLOGY_LINUX_H_
+#define BASE_SYSTEM_CPU_TOPOLOGY_LINUX_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/files/file_path.h"
+#include "base/strings/string_piece.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace base {
+
+// Describes how the online CPUs of the machine are grouped into NUMA nodes and
+// last-level cache domains, as reported by sysfs.
+struct BASE_EXPORT CpuTopology {
+  CpuTopology();
+  CpuTopology(const CpuTopology&);
+  CpuTopology& operator=(const CpuTopology&);
+  ~CpuTopology();
+
+  // Online CPUs of each NUMA node with at least one online CPU, in increasing
+  // node id order. Machines without NUMA support report a single node with all
+  // online CPUs.
+  std::vector<std::vector<int>> nodes;
+
+  // Groups of online CPUs sharing a last-level cache (e.g. a socket, or a core
+  // complex on chiplet-based CPUs), ordered by their lowest CPU. Empty if the
+  // cache topology isn't exposed.
+  std::vector<std::vector<int>> last_level_caches;
+};
+
+// Parses a sysfs CPU/node list such as "0-3,8,10-11" into the sorted list of
+// ids it contains. Returns false if |cpu_list| is malformed.
+BASE_EXPORT bool ParseCpuList(StringPiece cpu_list, std::vector<int>* ids);
+
+// Reads the topology from |sysfs_system_dir|, which is normally
+// /sys/devices/system. Only the CPUs in |allowed_cpus| are reported if set,
+// e.g. the affinity mask of the process inside a cpuset. Returns nullopt if
+// none of the allowed CPUs is online, or the online CPUs can't be determined.
+BASE_EXPORT absl::optional<CpuTopology> ReadCpuTopology(
+    const FilePath& sysfs_system_dir,
+    const absl::optional<std::vector<int>>& allowed_cpus);
+
+// Returns the topology of the CPUs the process may run on, according to the
+// affinity mask of the calling thread. Read once and cached for the lifetime
+// of the process.
+BASE_EXPORT const absl::optional<CpuTopology>& GetCpuTopology();
+
+}  // namespace base
+
+#endif  // BASE_SYSTEM_CPU_TOPOLOGY_LINUX_H_
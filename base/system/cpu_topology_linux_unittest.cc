@@ -0,0 +1,150 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/system/cpu_topology_linux.h"
+
+#include <string>
+#include <vector>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+using CpuGroups = std::vector<std::vector<int>>;
+
+class CpuTopologyTest : public testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  void WriteSysfsFile(const std::string& relative_path,
+                      const std::string& contents) {
+    const FilePath path = temp_dir_.GetPath().Append(relative_path);
+    ASSERT_TRUE(CreateDirectory(path.DirName()));
+    ASSERT_TRUE(WriteFile(path, contents + "\n"));
+  }
+
+  // Writes a unified L2 cache private to |cpu| and an L3 cache shared with
+  // |llc_cpus|, along with an instruction cache shared with everything.
+  void WriteCaches(int cpu, const std::string& llc_cpus) {
+    const std::string cache_dir = StringPrintf("cpu/cpu%d/cache/", cpu);
+    WriteSysfsFile(cache_dir + "index0/level", "1");
+    WriteSysfsFile(cache_dir + "index0/type", "Instruction");
+    WriteSysfsFile(cache_dir + "index0/shared_cpu_list", "0-7");
+    WriteSysfsFile(cache_dir + "index1/level", "2");
+    WriteSysfsFile(cache_dir + "index1/type", "Unified");
+    WriteSysfsFile(cache_dir + "index1/shared_cpu_list",
+                   StringPrintf("%d", cpu));
+    WriteSysfsFile(cache_dir + "index2/level", "3");
+    WriteSysfsFile(cache_dir + "index2/type", "Unified");
+    WriteSysfsFile(cache_dir + "index2/shared_cpu_list", llc_cpus);
+  }
+
+  absl::optional<CpuTopology> Read(
+      const absl::optional<std::vector<int>>& allowed_cpus = absl::nullopt) {
+    return ReadCpuTopology(temp_dir_.GetPath(), allowed_cpus);
+  }
+
+ private:
+  ScopedTempDir temp_dir_;
+};
+
+}  // namespace
+
+TEST(CpuTopologyParseTest, ParseCpuList) {
+  std::vector<int> ids;
+  EXPECT_TRUE(ParseCpuList("", &ids));
+  EXPECT_TRUE(ids.empty());
+
+  EXPECT_TRUE(ParseCpuList("5", &ids));
+  EXPECT_EQ(std::vector<int>({5}), ids);
+
+  EXPECT_TRUE(ParseCpuList("0-3,8,10-11", &ids));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), ids);
+
+  // Unordered and overlapping ranges are normalized.
+  EXPECT_TRUE(ParseCpuList("4-5, 0,5,1-2", &ids));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 4, 5}), ids);
+}
+
+TEST(CpuTopologyParseTest, ParseCpuListMalformed) {
+  std::vector<int> ids;
+  EXPECT_FALSE(ParseCpuList("a", &ids));
+  EXPECT_FALSE(ParseCpuList("1-", &ids));
+  EXPECT_FALSE(ParseCpuList("-1", &ids));
+  EXPECT_FALSE(ParseCpuList("3-1", &ids));
+  EXPECT_FALSE(ParseCpuList("0-1000000", &ids));
+}
+
+TEST_F(CpuTopologyTest, NoOnlineCpus) {
+  EXPECT_FALSE(Read());
+}
+
+// Kernels without NUMA or cache information report a single node and no
+// last-level caches.
+TEST_F(CpuTopologyTest, OnlineCpusOnly) {
+  WriteSysfsFile("cpu/online", "0-3");
+  absl::optional<CpuTopology> topology = Read();
+  ASSERT_TRUE(topology);
+  EXPECT_EQ(CpuGroups({{0, 1, 2, 3}}), topology->nodes);
+  EXPECT_TRUE(topology->last_level_caches.empty());
+}
+
+TEST_F(CpuTopologyTest, NumaNodes) {
+  WriteSysfsFile("cpu/online", "0-5");
+  WriteSysfsFile("node/online", "0-2");
+  WriteSysfsFile("node/node0/cpulist", "0-2");
+  WriteSysfsFile("node/node1/cpulist", "3-5,6-7");
+  // Memory-only node.
+  WriteSysfsFile("node/node2/cpulist", "");
+  absl::optional<CpuTopology> topology = Read();
+  ASSERT_TRUE(topology);
+  // Offline CPUs 6 and 7 are dropped.
+  EXPECT_EQ(CpuGroups({{0, 1, 2}, {3, 4, 5}}), topology->nodes);
+}
+
+// Inside a cpuset, only the CPUs the process may run on are reported.
+TEST_F(CpuTopologyTest, AllowedCpus) {
+  WriteSysfsFile("cpu/online", "0-5");
+  WriteSysfsFile("node/online", "0-1");
+  WriteSysfsFile("node/node0/cpulist", "0-2");
+  WriteSysfsFile("node/node1/cpulist", "3-5");
+  absl::optional<CpuTopology> topology = Read(std::vector<int>({5, 1, 2}));
+  ASSERT_TRUE(topology);
+  EXPECT_EQ(CpuGroups({{1, 2}, {5}}), topology->nodes);
+
+  // Node 1 has none of the allowed CPUs.
+  topology = Read(std::vector<int>({0, 1}));
+  ASSERT_TRUE(topology);
+  EXPECT_EQ(CpuGroups({{0, 1}}), topology->nodes);
+
+  EXPECT_FALSE(Read(std::vector<int>({7})));
+}
+
+TEST_F(CpuTopologyTest, LastLevelCaches) {
+  WriteSysfsFile("cpu/online", "0-3");
+  WriteCaches(0, "0,2");
+  WriteCaches(1, "1,3");
+  WriteCaches(2, "0,2");
+  WriteCaches(3, "1,3");
+  absl::optional<CpuTopology> topology = Read();
+  ASSERT_TRUE(topology);
+  EXPECT_EQ(CpuGroups({{0, 2}, {1, 3}}), topology->last_level_caches);
+}
+
+// A partial view of the cache topology isn't reported.
+TEST_F(CpuTopologyTest, MissingCacheInformation) {
+  WriteSysfsFile("cpu/online", "0-3");
+  WriteCaches(0, "0-1");
+  WriteCaches(1, "0-1");
+  absl::optional<CpuTopology> topology = Read();
+  ASSERT_TRUE(topology);
+  EXPECT_TRUE(topology->last_level_caches.empty());
+}
+
+}  // namespace base
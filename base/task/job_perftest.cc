@@ -11,6 +11,7 @@
 #include "base/containers/queue.h"
 #include "base/containers/stack.h"
 #include "base/synchronization/lock.h"
+#include "base/task/parallel_algorithms.h"
 #include "base/task/post_job.h"
 #include "base/task/thread_pool.h"
 #include "base/test/bind.h"
@@ -51,6 +52,13 @@ constexpr char kStoryNoOpLoopAroundDisrupted[] = "noop_loop_around_disrupted";
 constexpr char kStoryBusyWaitLoopAround[] = "busy_wait_loop_around";
 constexpr char kStoryBusyWaitLoopAroundDisrupted[] =
     "busy_wait_loop_around_disrupted";
+constexpr char kStoryNoOpSerialLoop[] = "noop_serial_loop";
+constexpr char kStoryBusyWaitSerialLoop[] = "busy_wait_serial_loop";
+constexpr char kStoryNoOpParallelFor[] = "noop_parallel_for";
+constexpr char kStoryNoOpParallelForDisrupted[] = "noop_parallel_for_disrupted";
+constexpr char kStoryBusyWaitParallelFor[] = "busy_wait_parallel_for";
+constexpr char kStoryBusyWaitParallelForDisrupted[] =
+    "busy_wait_parallel_for_disrupted";
 
 perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
   perf_test::PerfResultReporter reporter(kMetricPrefixJob, story_name);
@@ -397,6 +405,44 @@ class JobPerfTest : public testing::Test {
                        size_t(num_work_items / job_duration.InMilliseconds()));
   }
 
+  // Process |num_work_items| items with |process_item| serially on the
+  // current thread. Baseline for RunParallelFor().
+  void RunSerialLoop(const std::string& story_name,
+                     size_t num_work_items,
+                     RepeatingCallback<void(size_t)> process_item) {
+    const TimeTicks job_run_start = TimeTicks::Now();
+    for (size_t i = 0; i < num_work_items; ++i)
+      process_item.Run(i);
+    const TimeDelta job_duration = TimeTicks::Now() - job_run_start;
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricWorkThroughput,
+                       size_t(num_work_items / job_duration.InMilliseconds()));
+  }
+
+  // Process |num_work_items| items with |process_item| in parallel using
+  // base::ParallelFor(), which assigns work in adaptively sized chunks.
+  void RunParallelFor(const std::string& story_name,
+                      size_t num_work_items,
+                      RepeatingCallback<void(size_t)> process_item,
+                      bool disruptive_post_tasks = false) {
+    WorkList work_list(num_work_items, std::move(process_item));
+
+    // Post extra tasks to disrupt Job execution and cause workers to yield.
+    if (disruptive_post_tasks)
+      DisruptivePostTasks(10, Milliseconds(1));
+
+    const TimeTicks job_run_start = TimeTicks::Now();
+    ParallelFor(FROM_HERE, {TaskPriority::USER_VISIBLE}, 0, num_work_items,
+                [&work_list](size_t i) { work_list.ProcessWorkItem(i); });
+    const TimeDelta job_duration = TimeTicks::Now() - job_run_start;
+    EXPECT_EQ(0U, work_list.NumIncompleteWorkItems(0));
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricWorkThroughput,
+                       size_t(num_work_items / job_duration.InMilliseconds()));
+  }
+
  private:
   test::TaskEnvironment task_environment;
 };
@@ -473,4 +519,32 @@ TEST_F(JobPerfTest, BusyWaitDisruptedWorkLoopAround) {
                        std::move(callback), true);
 }
 
+TEST_F(JobPerfTest, NoOpWorkSerialLoop) {
+  RunSerialLoop(kStoryNoOpSerialLoop, 10000000, DoNothing());
+}
+
+TEST_F(JobPerfTest, BusyWaitWorkSerialLoop) {
+  RepeatingCallback<void(size_t)> callback = BusyWaitCallback(Microseconds(5));
+  RunSerialLoop(kStoryBusyWaitSerialLoop, 500000, std::move(callback));
+}
+
+TEST_F(JobPerfTest, NoOpWorkParallelFor) {
+  RunParallelFor(kStoryNoOpParallelFor, 10000000, DoNothing());
+}
+
+TEST_F(JobPerfTest, NoOpDisruptedWorkParallelFor) {
+  RunParallelFor(kStoryNoOpParallelForDisrupted, 10000000, DoNothing(), true);
+}
+
+TEST_F(JobPerfTest, BusyWaitWorkParallelFor) {
+  RepeatingCallback<void(size_t)> callback = BusyWaitCallback(Microseconds(5));
+  RunParallelFor(kStoryBusyWaitParallelFor, 500000, std::move(callback));
+}
+
+TEST_F(JobPerfTest, BusyWaitDisruptedWorkParallelFor) {
+  RepeatingCallback<void(size_t)> callback = BusyWaitCallback(Microseconds(5));
+  RunParallelFor(kStoryBusyWaitParallelForDisrupted, 500000,
+                 std::move(callback), true);
+}
+
 }  // namespace base
@@ -0,0 +1,173 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/parallel_algorithms.h"
+
+#include <atomic>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "base/system/sys_info.h"
+#include "base/task/post_job.h"
+#include "base/time/time.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Chunk sizes are adapted so that a chunk takes roughly this long to run. This
+// is long enough to amortize the cost of claiming a chunk and checking
+// ShouldYield(), and short enough for workers to yield promptly.
+constexpr TimeDelta kTargetChunkDuration = Microseconds(200);
+
+// With guided scheduling, a chunk never covers more than 1/kGuidedDivisor of
+// the remaining work per potential worker, so that the tail of the range is
+// still shared between workers.
+constexpr size_t kGuidedDivisor = 2;
+
+// Blocks smaller than this are not worth sorting on a separate worker.
+constexpr size_t kMinParallelSortBlockSize = 1 << 12;
+
+size_t GetNumParticipants() {
+  // The calling thread participates in addition to the workers.
+  return static_cast<size_t>(SysInfo::NumberOfProcessors()) + 1;
+}
+
+// State shared between all threads running a ParallelForChunks() job.
+class ParallelForState {
+ public:
+  ParallelForState(size_t size,
+                   size_t min_grain_size,
+                   RepeatingCallback<void(size_t, size_t)> body)
+      : size_(size),
+        min_grain_size_(min_grain_size),
+        num_participants_(GetNumParticipants()),
+        body_(std::move(body)) {}
+
+  ParallelForState(const ParallelForState&) = delete;
+  ParallelForState& operator=(const ParallelForState&) = delete;
+
+  // Worker task of the job. Processes chunks until the range is exhausted or
+  // |delegate| asks to yield.
+  void RunWorker(JobDelegate* delegate) {
+    size_t grain_size = min_grain_size_;
+    while (!delegate->ShouldYield()) {
+      size_t chunk_begin;
+      size_t chunk_end;
+      if (!ClaimChunk(grain_size, &chunk_begin, &chunk_end))
+        return;
+
+      const TimeTicks start = TimeTicks::Now();
+      body_.Run(chunk_begin, chunk_end);
+      const TimeDelta duration = TimeTicks::Now() - start;
+
+      // Adapt this thread's grain size to the observed cost per item. Growing
+      // and shrinking geometrically converges quickly while being robust to
+      // noise from preemption.
+      if (duration < kTargetChunkDuration / 2)
+        grain_size *= 2;
+      else if (duration > kTargetChunkDuration * 2)
+        grain_size = std::max(min_grain_size_, grain_size / 2);
+    }
+  }
+
+  // Max concurrency callback of the job.
+  size_t GetMaxConcurrency(size_t /*worker_count*/) const {
+    const size_t remaining = GetRemaining();
+    // Don't ask for more workers than there are minimum-size chunks left.
+    return std::min((remaining + min_grain_size_ - 1) / min_grain_size_,
+                    num_participants_);
+  }
+
+  // Processes the items that weren't claimed yet on the current thread. Used
+  // when the job could not be posted, or was cancelled before covering the
+  // whole range.
+  void RunRemaining() {
+    size_t chunk_begin;
+    size_t chunk_end;
+    while (ClaimChunk(size_, &chunk_begin, &chunk_end))
+      body_.Run(chunk_begin, chunk_end);
+  }
+
+ private:
+  size_t GetRemaining() const {
+    // std::memory_order_relaxed is sufficient since chunks are claimed
+    // atomically; this value is only a heuristic.
+    const size_t next_index = next_index_.load(std::memory_order_relaxed);
+    return next_index < size_ ? size_ - next_index : 0;
+  }
+
+  // Claims the next chunk of at most |grain_size| items, bounded by guided
+  // scheduling. Returns false if there are no items left.
+  bool ClaimChunk(size_t grain_size, size_t* chunk_begin, size_t* chunk_end) {
+    const size_t guided_size =
+        GetRemaining() / (kGuidedDivisor * num_participants_);
+    const size_t chunk_size =
+        std::max(min_grain_size_, std::min(grain_size, guided_size));
+    *chunk_begin = next_index_.fetch_add(chunk_size, std::memory_order_relaxed);
+    if (*chunk_begin >= size_)
+      return false;
+    *chunk_end = std::min(size_, *chunk_begin + chunk_size);
+    return true;
+  }
+
+  const size_t size_;
+  const size_t min_grain_size_;
+  const size_t num_participants_;
+  const RepeatingCallback<void(size_t, size_t)> body_;
+  // Index of the first item that wasn't claimed yet. May overshoot |size_|.
+  std::atomic_size_t next_index_{0};
+};
+
+}  // namespace
+
+void ParallelForChunks(const Location& from_here,
+                       const TaskTraits& traits,
+                       size_t size,
+                       size_t min_grain_size,
+                       RepeatingCallback<void(size_t, size_t)> body) {
+  DCHECK_GT(min_grain_size, 0U);
+  if (size == 0)
+    return;
+  // A single chunk isn't worth a job: run it inline.
+  if (size <= min_grain_size) {
+    body.Run(0, size);
+    return;
+  }
+
+  ParallelForState state(size, min_grain_size, std::move(body));
+  JobHandle handle =
+      PostJob(from_here, traits,
+              BindRepeating(&ParallelForState::RunWorker, Unretained(&state)),
+              BindRepeating(&ParallelForState::GetMaxConcurrency,
+                            Unretained(&state)));
+  if (!handle) {
+    // The job was rejected (e.g. during shutdown). The calls are synchronous,
+    // so the work must still happen.
+    state.RunRemaining();
+    return;
+  }
+  // |state| outlives all workers since Join() returns only once they all
+  // returned.
+  handle.Join();
+  // The job may have been cancelled (e.g. by shutdown) before all the chunks
+  // were claimed. The calls are synchronous, so the rest must still happen.
+  state.RunRemaining();
+}
+
+size_t GetParallelSortBlockCount(size_t size) {
+  // Twice as many blocks as participants keeps threads busy when blocks take
+  // uneven time to sort, and gives the first merge rounds enough parallelism.
+  const size_t desired_blocks = std::min<size_t>(2 * GetNumParticipants(),
+                                                 size_t{1} << 16);
+  size_t num_blocks =
+      size_t{1} << bits::Log2Ceiling(static_cast<uint32_t>(desired_blocks));
+  while (num_blocks > 1 && size / num_blocks < kMinParallelSortBlockSize)
+    num_blocks /= 2;
+  return num_blocks;
+}
+
+}  // namespace internal
+}  // namespace base
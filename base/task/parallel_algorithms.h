@@ -0,0 +1,205 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_PARALLEL_ALGORITHMS_H_
+#define BASE_TASK_PARALLEL_ALGORITHMS_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/synchronization/lock.h"
+#include "base/task/task_traits.h"
+
+// Parallel algorithms built on top of base::PostJob(). Each algorithm splits
+// its input range in chunks which are handed out to ThreadPool workers and to
+// the calling thread, which participates through JobHandle::Join(). The calls
+// are synchronous: they return once every element was processed.
+//
+// Chunk sizes are adaptive: every participating thread starts with small
+// chunks and grows or shrinks them so that each chunk runs for roughly
+// a fixed duration, while never taking more than a fraction of the remaining
+// work (guided scheduling). This keeps per-chunk overhead low for cheap
+// elements without starving other threads at the end of the range for
+// expensive ones. Workers check JobDelegate::ShouldYield() between chunks so
+// that higher priority work and job cancellation are honored.
+//
+// Callables passed to these algorithms are invoked concurrently from multiple
+// threads and must therefore be thread-safe. Like any ThreadPool API, they must
+// not be called while holding a lock that the callables could acquire, and
+// the calling thread's priority must be at least as high as |traits|'s (see
+// JobHandle::Join()).
+//
+// Example:
+//   std::vector<uint32_t> checksums(blocks.size());
+//   base::ParallelTransform(FROM_HERE, {base::TaskPriority::USER_VISIBLE},
+//                           blocks.begin(), blocks.end(), checksums.begin(),
+//                           [](const Block& block) { return Crc32(block); });
+
+namespace base {
+
+namespace internal {
+
+// Invokes |body| with disjoint [begin, end) sub-ranges covering [0, |size|),
+// each containing at least |min_grain_size| items (except possibly the last
+// one). Sub-ranges are processed concurrently by a job posted with |traits|
+// and by the calling thread. Returns once all sub-ranges were processed.
+BASE_EXPORT void ParallelForChunks(
+    const Location& from_here,
+    const TaskTraits& traits,
+    size_t size,
+    size_t min_grain_size,
+    RepeatingCallback<void(size_t, size_t)> body);
+
+// Returns the number of blocks, always a power of two, that ParallelSort()
+// splits a range of |size| elements into before merging them.
+BASE_EXPORT size_t GetParallelSortBlockCount(size_t size);
+
+// Ranges smaller than this are sorted serially by ParallelSort().
+constexpr size_t kMinParallelSortSize = 1 << 13;
+
+}  // namespace internal
+
+// Invokes |func(i)| for each i in [|begin|, |end|). There is no guarantee on
+// the order in which indices are visited. |min_grain_size| is a lower bound on
+// the number of consecutive indices processed by a thread before checking for
+// yield; increase it when |func| is very cheap and the range very large.
+template <typename Function>
+void ParallelFor(const Location& from_here,
+                 const TaskTraits& traits,
+                 size_t begin,
+                 size_t end,
+                 Function func,
+                 size_t min_grain_size = 1) {
+  if (begin >= end)
+    return;
+  internal::ParallelForChunks(
+      from_here, traits, end - begin, min_grain_size,
+      BindRepeating(
+          [](Function* func, size_t offset, size_t chunk_begin,
+             size_t chunk_end) {
+            for (size_t i = chunk_begin; i < chunk_end; ++i)
+              (*func)(offset + i);
+          },
+          Unretained(&func), begin));
+}
+
+// Parallel equivalent of std::transform(): stores |op(*it)| in the matching
+// position of the output range starting at |d_first|, for each |it| in
+// [|first|, |last|). Both ranges must support random access and must not
+// overlap. Returns an iterator past the last element written.
+template <typename InputIt, typename OutputIt, typename UnaryOperation>
+OutputIt ParallelTransform(const Location& from_here,
+                           const TaskTraits& traits,
+                           InputIt first,
+                           InputIt last,
+                           OutputIt d_first,
+                           UnaryOperation op) {
+  const auto size = std::distance(first, last);
+  ParallelFor(
+      from_here, traits, 0, static_cast<size_t>(size),
+      [first, d_first, &op](size_t i) {
+        using Difference =
+            typename std::iterator_traits<InputIt>::difference_type;
+        d_first[static_cast<Difference>(i)] =
+            op(first[static_cast<Difference>(i)]);
+      });
+  return d_first + size;
+}
+
+// Parallel equivalent of std::accumulate(): folds [|first|, |last|) with
+// |reduce_op|, starting from |init|. |reduce_op| must be associative but need
+// not be commutative: partial results are combined in the order of the range,
+// so the result is deterministic for a given input. Since |reduce_op| combines
+// both elements and partial results, it must accept T for either argument.
+template <typename InputIt,
+          typename T,
+          typename BinaryOperation = std::plus<>>
+T ParallelReduce(const Location& from_here,
+                 const TaskTraits& traits,
+                 InputIt first,
+                 InputIt last,
+                 T init,
+                 BinaryOperation reduce_op = {}) {
+  using Difference = typename std::iterator_traits<InputIt>::difference_type;
+  Lock lock;
+  // Partial result of each chunk, keyed by the index of its first element.
+  std::vector<std::pair<size_t, T>> partials;
+
+  auto reduce_chunk = [&](size_t chunk_begin, size_t chunk_end) {
+    T partial = first[static_cast<Difference>(chunk_begin)];
+    for (size_t i = chunk_begin + 1; i < chunk_end; ++i) {
+      partial =
+          reduce_op(std::move(partial), first[static_cast<Difference>(i)]);
+    }
+    AutoLock auto_lock(lock);
+    partials.emplace_back(chunk_begin, std::move(partial));
+  };
+  const auto size = std::distance(first, last);
+  if (size > 0) {
+    internal::ParallelForChunks(
+        from_here, traits, static_cast<size_t>(size), 1,
+        BindRepeating(
+            [](decltype(reduce_chunk)* reduce_chunk, size_t chunk_begin,
+               size_t chunk_end) { (*reduce_chunk)(chunk_begin, chunk_end); },
+            Unretained(&reduce_chunk)));
+  }
+
+  std::sort(partials.begin(), partials.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  for (auto& partial : partials)
+    init = reduce_op(std::move(init), std::move(partial.second));
+  return init;
+}
+
+// Parallel equivalent of std::sort(): sorts [|first|, |last|) according to
+// |comp|. The range is split in blocks which are sorted concurrently and then
+// merged pairwise, also concurrently. Like std::sort(), the sort is not stable.
+template <typename RandomIt, typename Compare = std::less<>>
+void ParallelSort(const Location& from_here,
+                  const TaskTraits& traits,
+                  RandomIt first,
+                  RandomIt last,
+                  Compare comp = {}) {
+  const size_t size = static_cast<size_t>(std::distance(first, last));
+  if (size < internal::kMinParallelSortSize) {
+    std::sort(first, last, comp);
+    return;
+  }
+
+  const size_t num_blocks = internal::GetParallelSortBlockCount(size);
+  // Returns an iterator to the beginning of block |block|. Block boundaries
+  // are spread evenly so that each block has size/num_blocks elements give or
+  // take one.
+  auto block_begin = [first, size, num_blocks](size_t block) {
+    return first + static_cast<typename std::iterator_traits<
+                       RandomIt>::difference_type>(size * block / num_blocks);
+  };
+
+  ParallelFor(from_here, traits, 0, num_blocks,
+              [&block_begin, &comp](size_t block) {
+                std::sort(block_begin(block), block_begin(block + 1), comp);
+              });
+  for (size_t width = 1; width < num_blocks; width *= 2) {
+    ParallelFor(from_here, traits, 0, num_blocks / (2 * width),
+                [&block_begin, &comp, width](size_t pair) {
+                  const size_t left = pair * 2 * width;
+                  std::inplace_merge(block_begin(left),
+                                     block_begin(left + width),
+                                     block_begin(left + 2 * width), comp);
+                });
+  }
+}
+
+}  // namespace base
+
+#endif  // BASE_TASK_PARALLEL_ALGORITHMS_H_
@@ -0,0 +1,147 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/parallel_algorithms.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/task_environment.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+class ParallelAlgorithmsTest : public testing::Test {
+ protected:
+  test::TaskEnvironment task_environment_;
+};
+
+TEST_F(ParallelAlgorithmsTest, ParallelForVisitsEachIndexOnce) {
+  constexpr size_t kBegin = 17;
+  constexpr size_t kEnd = 100000;
+  std::vector<std::atomic_int> visits(kEnd);
+  ParallelFor(FROM_HERE, {}, kBegin, kEnd,
+              [&](size_t i) { visits[i].fetch_add(1); });
+  for (size_t i = 0; i < kEnd; ++i)
+    EXPECT_EQ(i < kBegin ? 0 : 1, visits[i].load()) << i;
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelForEmptyRange) {
+  bool called = false;
+  ParallelFor(FROM_HERE, {}, 5, 5, [&](size_t) { called = true; });
+  ParallelFor(FROM_HERE, {}, 6, 5, [&](size_t) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelForMinGrainSize) {
+  static constexpr size_t kMinGrainSize = 64;
+  std::vector<std::atomic_int> visits(1000);
+  std::atomic_size_t num_chunks{0};
+  internal::ParallelForChunks(
+      FROM_HERE, {}, visits.size(), kMinGrainSize,
+      BindRepeating(
+          [](std::vector<std::atomic_int>* visits, std::atomic_size_t* chunks,
+             size_t begin, size_t end) {
+            // Only the last chunk may be smaller than the minimum.
+            if (end != visits->size())
+              EXPECT_GE(end - begin, kMinGrainSize);
+            for (size_t i = begin; i < end; ++i)
+              (*visits)[i].fetch_add(1);
+            chunks->fetch_add(1);
+          },
+          Unretained(&visits), Unretained(&num_chunks)));
+  for (auto& visit : visits)
+    EXPECT_EQ(1, visit.load());
+  EXPECT_LE(num_chunks.load(), visits.size() / kMinGrainSize + 1);
+}
+
+// Expensive items must still be shared between threads, even though each
+// thread starts with the minimum grain size.
+TEST_F(ParallelAlgorithmsTest, ParallelForExpensiveItems) {
+  std::vector<std::atomic_int> visits(64);
+  ParallelFor(FROM_HERE, {}, 0, visits.size(), [&](size_t i) {
+    PlatformThread::Sleep(Milliseconds(1));
+    visits[i].fetch_add(1);
+  });
+  for (auto& visit : visits)
+    EXPECT_EQ(1, visit.load());
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelTransform) {
+  std::vector<int> input(50000);
+  std::iota(input.begin(), input.end(), 0);
+  std::vector<std::string> output(input.size());
+  auto output_end = ParallelTransform(
+      FROM_HERE, {}, input.begin(), input.end(), output.begin(),
+      [](int i) { return NumberToString(i); });
+  EXPECT_EQ(output.end(), output_end);
+  for (size_t i = 0; i < input.size(); ++i)
+    EXPECT_EQ(NumberToString(i), output[i]);
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelReduceSum) {
+  std::vector<uint64_t> input(200000);
+  std::iota(input.begin(), input.end(), 1);
+  EXPECT_EQ(std::accumulate(input.begin(), input.end(), uint64_t{42}),
+            ParallelReduce(FROM_HERE, {}, input.begin(), input.end(),
+                           uint64_t{42}));
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelReduceEmpty) {
+  std::vector<int> input;
+  EXPECT_EQ(7, ParallelReduce(FROM_HERE, {}, input.begin(), input.end(), 7));
+}
+
+// Partial results must be combined in order for non-commutative operations.
+TEST_F(ParallelAlgorithmsTest, ParallelReduceNonCommutative) {
+  std::vector<std::string> input(20000);
+  for (size_t i = 0; i < input.size(); ++i)
+    input[i] = std::string(1, static_cast<char>('a' + i % 26));
+  const std::string expected =
+      std::accumulate(input.begin(), input.end(), std::string(">"));
+  EXPECT_EQ(expected, ParallelReduce(FROM_HERE, {}, input.begin(), input.end(),
+                                     std::string(">")));
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelSort) {
+  for (size_t size : {size_t{0}, size_t{1}, size_t{1000},
+                      internal::kMinParallelSortSize, size_t{300001}}) {
+    std::vector<uint32_t> input(size);
+    for (auto& value : input)
+      value = static_cast<uint32_t>(RandUint64() % 1000);
+    std::vector<uint32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+    ParallelSort(FROM_HERE, {}, input.begin(), input.end());
+    EXPECT_EQ(expected, input) << size;
+  }
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelSortComparator) {
+  std::vector<int> input(100000);
+  std::iota(input.begin(), input.end(), 0);
+  ParallelSort(FROM_HERE, {}, input.begin(), input.end(), std::greater<>());
+  EXPECT_TRUE(std::is_sorted(input.begin(), input.end(), std::greater<>()));
+  EXPECT_EQ(99999, input.front());
+}
+
+TEST(ParallelAlgorithmsInternalTest, GetParallelSortBlockCount) {
+  EXPECT_EQ(1U, internal::GetParallelSortBlockCount(0));
+  EXPECT_EQ(1U, internal::GetParallelSortBlockCount(
+                    internal::kMinParallelSortSize - 1));
+  for (size_t size : {size_t{1} << 14, size_t{1} << 20, size_t{1} << 30}) {
+    const size_t num_blocks = internal::GetParallelSortBlockCount(size);
+    EXPECT_GE(num_blocks, 1U);
+    // Must be a power of two.
+    EXPECT_EQ(0U, num_blocks & (num_blocks - 1)) << size;
+  }
+}
+
+}  // namespace base
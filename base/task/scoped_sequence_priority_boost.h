@@ -0,0 +1,59 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_SCOPED_SEQUENCE_PRIORITY_BOOST_H_
+#define BASE_TASK_SCOPED_SEQUENCE_PRIORITY_BOOST_H_
+
+#include "base/base_export.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/task/task_traits.h"
+#include "base/task/updateable_sequenced_task_runner.h"
+
+namespace base {
+
+// Within the scope of this object, the tasks posted to |task_runner|, including
+// a task that is already running, run with a priority of at least |priority|.
+// This is meant for a task that waits (e.g. on a WaitableEvent or on a lock)
+// for work owned by a sequence of lower priority, so that the wait isn't
+// delayed by unrelated work of intermediate priority: while the boost lasts,
+// the sequence is sorted with its boosted priority in the ThreadPool and, if
+// it runs on a background thread, that thread's priority is raised on
+// platforms that allow it (Linux and ChromeOS).
+//
+// Boosts can nest and don't change the priority set with
+// UpdateableSequencedTaskRunner::UpdatePriority(), which applies again once
+// all boosts end.
+//
+// Example:
+//   // Runs in a USER_BLOCKING task.
+//   {
+//     ScopedSequencePriorityBoost boost(best_effort_task_runner);
+//     ScopedBlockingCall scoped_blocking_call(FROM_HERE,
+//                                             BlockingType::WILL_BLOCK);
+//     done_event->Wait();
+//   }
+class BASE_EXPORT ScopedSequencePriorityBoost {
+ public:
+  // Boosts the sequence of |task_runner| to the priority of the current task,
+  // i.e. the waiting sequence's priority is inherited by |task_runner|.
+  explicit ScopedSequencePriorityBoost(
+      scoped_refptr<UpdateableSequencedTaskRunner> task_runner);
+  ScopedSequencePriorityBoost(
+      scoped_refptr<UpdateableSequencedTaskRunner> task_runner,
+      TaskPriority priority);
+
+  ScopedSequencePriorityBoost(const ScopedSequencePriorityBoost&) = delete;
+  ScopedSequencePriorityBoost& operator=(const ScopedSequencePriorityBoost&) =
+      delete;
+
+  ~ScopedSequencePriorityBoost();
+
+ private:
+  const scoped_refptr<UpdateableSequencedTaskRunner> task_runner_;
+  const TaskPriority priority_;
+};
+
+}  // namespace base
+
+#endif  // BASE_TASK_SCOPED_SEQUENCE_PRIORITY_BOOST_H_
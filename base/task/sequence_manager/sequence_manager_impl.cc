@@ -16,6 +16,7 @@
 #include "base/debug/stack_trace.h"
 #include "base/json/json_writer.h"
 #include "base/logging.h"
+#include "base/message_loop/message_pump.h"
 #include "base/memory/ptr_util.h"
 #include "base/no_destructor.h"
 #include "base/notreached.h"
@@ -324,6 +325,7 @@ std::unique_ptr<SequenceManagerImpl> SequenceManagerImpl::CreateUnbound(
 // static
 void SequenceManagerImpl::InitializeFeatures() {
   ApplyNoWakeUpsForCanceledTasks();
+  MessagePump::InitializeFeatures();
   TaskQueueImpl::InitializeFeatures();
   ThreadControllerWithMessagePumpImpl::InitializeFeatures();
   g_task_leeway.store(kTaskLeewayParam.Get(), std::memory_order_relaxed);
@@ -1245,6 +1247,10 @@ MessagePump* SequenceManagerImpl::GetMessagePump() const {
   return controller_->GetBoundMessagePump();
 }
 
+ThreadController::WakeUpCounts SequenceManagerImpl::GetWakeUpCounts() const {
+  return controller_->GetWakeUpCounts();
+}
+
 bool SequenceManagerImpl::IsType(MessagePumpType type) const {
   return settings_.message_loop_type == type;
 }
@@ -170,6 +170,7 @@ class BASE_EXPORT SequenceManagerImpl
   scoped_refptr<SingleThreadTaskRunner> GetTaskRunner();
   bool IsBoundToCurrentThread() const;
   MessagePump* GetMessagePump() const;
+  ThreadController::WakeUpCounts GetWakeUpCounts() const;
   bool IsType(MessagePumpType type) const;
   void SetAddQueueTimeToTasks(bool enable);
   void SetTaskExecutionAllowed(bool allowed);
@@ -5,6 +5,8 @@
 #ifndef BASE_TASK_SEQUENCE_MANAGER_THREAD_CONTROLLER_H_
 #define BASE_TASK_SEQUENCE_MANAGER_THREAD_CONTROLLER_H_
 
+#include <stdint.h>
+
 #include <stack>
 #include <vector>
 
@@ -35,6 +37,16 @@ class SequencedTaskSource;
 // interface will become more concise.
 class ThreadController {
  public:
+  // Counts the times the thread woke up after waiting for work in its
+  // MessagePump.
+  struct WakeUpCounts {
+    // All wake-ups.
+    uint64_t total = 0;
+    // Wake-ups at or after the delayed run time the thread was waiting for,
+    // which were most likely caused by the delayed work timer.
+    uint64_t delayed = 0;
+  };
+
   virtual ~ThreadController() = default;
 
   // Sets the number of tasks executed in a single invocation of DoWork.
@@ -96,6 +108,10 @@ class ThreadController {
   // Returns true if the current run loop should quit when idle.
   virtual bool ShouldQuitRunLoopWhenIdle() = 0;
 
+  // Returns the wake-ups of the thread so far. Always empty if the controller
+  // doesn't drive a MessagePump.
+  virtual WakeUpCounts GetWakeUpCounts() const = 0;
+
 #if BUILDFLAG(IS_IOS) || BUILDFLAG(IS_ANDROID)
   // On iOS, the main message loop cannot be Run().  Instead call
   // AttachToMessagePump(), which connects this ThreadController to the
@@ -346,6 +346,11 @@ MessagePump* ThreadControllerImpl::GetBoundMessagePump() const {
   return nullptr;
 }
 
+ThreadController::WakeUpCounts ThreadControllerImpl::GetWakeUpCounts() const {
+  // The thread is driven by a task runner, which doesn't report wake-ups.
+  return WakeUpCounts();
+}
+
 #if BUILDFLAG(IS_IOS) || BUILDFLAG(IS_ANDROID)
 void ThreadControllerImpl::AttachToMessagePump() {
   NOTREACHED();
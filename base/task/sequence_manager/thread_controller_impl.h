@@ -73,6 +73,7 @@ class BASE_EXPORT ThreadControllerImpl : public ThreadController,
 #endif
   void PrioritizeYieldingToNative(base::TimeTicks prioritize_until) override;
   bool ShouldQuitRunLoopWhenIdle() override;
+  WakeUpCounts GetWakeUpCounts() const override;
 
   // RunLoop::NestingObserver:
   void OnBeginNestedRunLoop() override;
@@ -40,12 +40,15 @@ TimeTicks CapAtOneDay(TimeTicks next_run_time, LazyNow* lazy_now) {
 }
 
 std::atomic_bool g_align_wake_ups = false;
-std::atomic<TimeDelta> g_task_leeway{WakeUp::kDefaultLeeway};
+std::atomic<TimeDelta> g_wake_up_slack{WakeUp::kDefaultLeeway};
 
 TimeTicks WakeUpRunTime(const WakeUp& wake_up) {
-  if (g_align_wake_ups.load(std::memory_order_relaxed)) {
+  // Align low resolution wake ups to the slack window so that nearby wake ups
+  // coalesce into one. High resolution wake ups are honored as is.
+  if (g_align_wake_ups.load(std::memory_order_relaxed) &&
+      wake_up.resolution == WakeUpResolution::kLow) {
     TimeTicks aligned_run_time = wake_up.earliest_time().SnappedToNextTick(
-        TimeTicks(), g_task_leeway.load(std::memory_order_relaxed));
+        TimeTicks(), g_wake_up_slack.load(std::memory_order_relaxed));
     return std::min(aligned_run_time, wake_up.latest_time());
   }
   return wake_up.time;
@@ -56,7 +59,8 @@ TimeTicks WakeUpRunTime(const WakeUp& wake_up) {
 // static
 void ThreadControllerWithMessagePumpImpl::InitializeFeatures() {
   g_align_wake_ups = FeatureList::IsEnabled(kAlignWakeUps);
-  g_task_leeway.store(kTaskLeewayParam.Get(), std::memory_order_relaxed);
+  g_wake_up_slack.store(kAlignWakeUpsSlackParam.Get(),
+                        std::memory_order_relaxed);
 }
 
 // static
@@ -64,8 +68,8 @@ void ThreadControllerWithMessagePumpImpl::ResetFeatures() {
   g_align_wake_ups.store(
       kAlignWakeUps.default_state == FEATURE_ENABLED_BY_DEFAULT,
       std::memory_order_relaxed);
-  g_task_leeway.store(kTaskLeewayParam.default_value,
-                      std::memory_order_relaxed);
+  g_wake_up_slack.store(kAlignWakeUpsSlackParam.default_value,
+                        std::memory_order_relaxed);
 }
 
 ThreadControllerWithMessagePumpImpl::ThreadControllerWithMessagePumpImpl(
@@ -262,6 +266,7 @@ ThreadControllerWithMessagePumpImpl::GetAssociatedThread() const {
 }
 
 void ThreadControllerWithMessagePumpImpl::OnBeginWorkItem() {
+  MaybeRecordWakeUp();
   MaybeStartWatchHangsInScope();
   work_id_provider_->IncrementWorkId();
   main_thread_only().run_level_tracker.OnTaskStarted();
@@ -279,12 +284,26 @@ void ThreadControllerWithMessagePumpImpl::BeforeWait() {
   // The loop is going to sleep, stop watching for hangs.
   hang_watch_scope_.reset();
   main_thread_only().run_level_tracker.OnIdle();
+  main_thread_only().is_waiting = true;
+  main_thread_only().wait_deadline = main_thread_only().next_delayed_do_work;
+}
+
+void ThreadControllerWithMessagePumpImpl::MaybeRecordWakeUp() {
+  if (!main_thread_only().is_waiting)
+    return;
+  main_thread_only().is_waiting = false;
+  ++main_thread_only().wake_up_counts.total;
+  if (!main_thread_only().wait_deadline.is_max() &&
+      time_source_->NowTicks() >= main_thread_only().wait_deadline) {
+    ++main_thread_only().wake_up_counts.delayed;
+  }
 }
 
 MessagePump::Delegate::NextWorkInfo
 ThreadControllerWithMessagePumpImpl::DoWork() {
   MessagePump::Delegate::NextWorkInfo next_work_info{};
 
+  MaybeRecordWakeUp();
   work_deduplicator_.OnWorkStarted();
   LazyNow continuation_lazy_now(time_source_);
   absl::optional<WakeUp> next_wake_up = DoWorkImpl(&continuation_lazy_now);
@@ -559,6 +578,11 @@ MessagePump* ThreadControllerWithMessagePumpImpl::GetBoundMessagePump() const {
   return pump_.get();
 }
 
+ThreadController::WakeUpCounts
+ThreadControllerWithMessagePumpImpl::GetWakeUpCounts() const {
+  return main_thread_only().wake_up_counts;
+}
+
 void ThreadControllerWithMessagePumpImpl::PrioritizeYieldingToNative(
     base::TimeTicks prioritize_until) {
   main_thread_only().yield_to_native_after_batch = prioritize_until;
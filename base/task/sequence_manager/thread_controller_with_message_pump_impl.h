@@ -86,6 +86,7 @@ class BASE_EXPORT ThreadControllerWithMessagePumpImpl
   void DetachFromMessagePump() override;
 #endif
   bool ShouldQuitRunLoopWhenIdle() override;
+  WakeUpCounts GetWakeUpCounts() const override;
 
   // RunLoop::NestingObserver:
   void OnBeginNestedRunLoop() override;
@@ -138,6 +139,13 @@ class BASE_EXPORT ThreadControllerWithMessagePumpImpl
     // The time after which the runloop should quit.
     TimeTicks quit_runloop_after = TimeTicks::Max();
 
+    // Whether the pump is waiting for work since BeforeWait(), and the delayed
+    // run time it is waiting for.
+    bool is_waiting = false;
+    TimeTicks wait_deadline = TimeTicks::Max();
+
+    WakeUpCounts wake_up_counts;
+
     bool task_execution_allowed = true;
   };
 
@@ -175,6 +183,9 @@ class BASE_EXPORT ThreadControllerWithMessagePumpImpl
   // watching is activated via finch.
   void MaybeStartWatchHangsInScope();
 
+  // Records a wake-up if this is the first work since BeforeWait().
+  void MaybeRecordWakeUp();
+
   // TODO(altimin): Merge with the one in SequenceManager.
   scoped_refptr<AssociatedThreadId> associated_thread_;
   MainThreadOnly main_thread_only_;
@@ -15,8 +15,10 @@
 #include "base/memory/scoped_refptr.h"
 #include "base/task/sequence_manager/thread_controller_power_monitor.h"
 #include "base/task/single_thread_task_runner.h"
+#include "base/task/task_features.h"
 #include "base/test/bind.h"
 #include "base/test/mock_callback.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/simple_test_tick_clock.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "build/build_config.h"
@@ -294,6 +296,86 @@ TEST_F(ThreadControllerWithMessagePumpTest, DelayedWork_CapAtOneDay) {
   EXPECT_EQ(next_work_info.delayed_run_time, Days(1));
 }
 
+// Under kAlignWakeUps, low resolution wake ups are aligned to the slack window
+// while high resolution ones aren't.
+TEST_F(ThreadControllerWithMessagePumpTest, AlignLowResolutionWakeUps) {
+  test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(kAlignWakeUps,
+                                                  {{"slack", "10ms"}});
+  internal::ThreadControllerWithMessagePumpImpl::InitializeFeatures();
+
+  LazyNow lazy_now(&clock_);
+  EXPECT_CALL(*message_pump_,
+              ScheduleDelayedWork_TimeTicks(Seconds(1) + Milliseconds(10)));
+  thread_controller_.SetNextDelayedDoWork(
+      &lazy_now, WakeUp{Seconds(1) + Milliseconds(3), Milliseconds(20),
+                        WakeUpResolution::kLow});
+  testing::Mock::VerifyAndClearExpectations(message_pump_);
+
+  // Alignment never delays a wake up past its leeway.
+  EXPECT_CALL(*message_pump_,
+              ScheduleDelayedWork_TimeTicks(Seconds(2) + Milliseconds(4)));
+  thread_controller_.SetNextDelayedDoWork(
+      &lazy_now, WakeUp{Seconds(2) + Milliseconds(3), Milliseconds(1),
+                        WakeUpResolution::kLow});
+  testing::Mock::VerifyAndClearExpectations(message_pump_);
+
+  EXPECT_CALL(*message_pump_,
+              ScheduleDelayedWork_TimeTicks(Seconds(3) + Milliseconds(3)));
+  thread_controller_.SetNextDelayedDoWork(
+      &lazy_now, WakeUp{Seconds(3) + Milliseconds(3), Milliseconds(20),
+                        WakeUpResolution::kHigh});
+  testing::Mock::VerifyAndClearExpectations(message_pump_);
+
+  internal::ThreadControllerWithMessagePumpImpl::ResetFeatures();
+}
+
+// The pump isn't re-armed when the aligned wake up doesn't change.
+TEST_F(ThreadControllerWithMessagePumpTest, AlignedWakeUpsAreCoalesced) {
+  test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(kAlignWakeUps,
+                                                  {{"slack", "10ms"}});
+  internal::ThreadControllerWithMessagePumpImpl::InitializeFeatures();
+
+  LazyNow lazy_now(&clock_);
+  EXPECT_CALL(*message_pump_,
+              ScheduleDelayedWork_TimeTicks(Seconds(1) + Milliseconds(10)))
+      .Times(1);
+  for (int i = 1; i < 10; ++i) {
+    thread_controller_.SetNextDelayedDoWork(
+        &lazy_now, WakeUp{Seconds(1) + Milliseconds(i), Milliseconds(20),
+                          WakeUpResolution::kLow});
+  }
+  testing::Mock::VerifyAndClearExpectations(message_pump_);
+
+  internal::ThreadControllerWithMessagePumpImpl::ResetFeatures();
+}
+
+TEST_F(ThreadControllerWithMessagePumpTest, WakeUpCounts) {
+  task_source_.AddTask(FROM_HERE, DoNothing(), Seconds(10));
+
+  // Work done without waiting first isn't a wake-up.
+  clock_.SetNowTicks(Seconds(5));
+  EXPECT_EQ(thread_controller_.DoWork().delayed_run_time, Seconds(10));
+  EXPECT_EQ(0u, thread_controller_.GetWakeUpCounts().total);
+
+  // Waking up at the delayed run time is a delayed wake-up.
+  thread_controller_.BeforeWait();
+  clock_.SetNowTicks(Seconds(10));
+  EXPECT_EQ(thread_controller_.DoWork().delayed_run_time, TimeTicks::Max());
+  EXPECT_EQ(1u, thread_controller_.GetWakeUpCounts().total);
+  EXPECT_EQ(1u, thread_controller_.GetWakeUpCounts().delayed);
+
+  // Native work after a wait is a wake-up, but not a delayed one since no
+  // delayed work is pending.
+  thread_controller_.BeforeWait();
+  thread_controller_.OnBeginWorkItem();
+  thread_controller_.OnEndWorkItem();
+  EXPECT_EQ(thread_controller_.DoWork().delayed_run_time, TimeTicks::Max());
+  EXPECT_EQ(2u, thread_controller_.GetWakeUpCounts().total);
+  EXPECT_EQ(1u, thread_controller_.GetWakeUpCounts().delayed);
+}
+
 TEST_F(ThreadControllerWithMessagePumpTest, DoWorkDoesntScheduleDelayedWork) {
   MockCallback<OnceClosure> task1;
   task_source_.AddTask(FROM_HERE, task1.Get(), Seconds(10));
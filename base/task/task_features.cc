@@ -47,6 +47,21 @@ const Feature kUseBackgroundNativeThreadPool = {
 const Feature kUseFiveMinutesThreadReclaimTime = {
     "UseFiveMinutesThreadReclaimTime", base::FEATURE_DISABLED_BY_DEFAULT};
 
+const Feature kTopologyAwareWorkerPlacement = {
+    "TopologyAwareWorkerPlacement", base::FEATURE_DISABLED_BY_DEFAULT};
+
+const Feature kWorkerSpinBeforeSleep = {"WorkerSpinBeforeSleep",
+                                        base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::FeatureParam<TimeDelta> kWorkerSpinMaxDuration{
+    &kWorkerSpinBeforeSleep, "max_spin_duration", Microseconds(50)};
+
+const Feature kThreadPoolTaskLocationStats = {
+    "ThreadPoolTaskLocationStats", base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::FeatureParam<int> kTaskLocationStatsSamplingInterval{
+    &kThreadPoolTaskLocationStats, "sampling_interval", 64};
+
 const BASE_EXPORT Feature kRemoveCanceledTasksInTaskQueue = {
     "RemoveCanceledTasksInTaskQueue2", base::FEATURE_DISABLED_BY_DEFAULT};
 
@@ -59,6 +74,9 @@ const base::FeatureParam<TimeDelta> kTaskLeewayParam{&kAddTaskLeewayFeature,
 const BASE_EXPORT Feature kAlignWakeUps = {"AlignWakeUps",
                                            base::FEATURE_DISABLED_BY_DEFAULT};
 
+const base::FeatureParam<TimeDelta> kAlignWakeUpsSlackParam{
+    &kAlignWakeUps, "slack", Milliseconds(8)};
+
 const BASE_EXPORT Feature kExplicitHighResolutionTimerWin = {
     "ExplicitHighResolutionTimerWin", base::FEATURE_DISABLED_BY_DEFAULT};
 
@@ -68,6 +68,24 @@ extern const BASE_EXPORT Feature kUseBackgroundNativeThreadPool;
 // minutes, instead of 30 seconds.
 extern const BASE_EXPORT Feature kUseFiveMinutesThreadReclaimTime;
 
+// Under this feature, ThreadGroupImpl spreads its workers across NUMA nodes
+// (or last-level cache domains), pins them to the CPUs of their domain and
+// prefers waking up a worker from the domain in which a task source last ran.
+extern const BASE_EXPORT Feature kTopologyAwareWorkerPlacement;
+
+// Under this feature, an idle ThreadGroupImpl worker spins for up to
+// |kWorkerSpinMaxDuration| before going to sleep, when task sources arrive
+// often enough for the spin to be likely to catch the next one.
+extern const BASE_EXPORT Feature kWorkerSpinBeforeSleep;
+extern const BASE_EXPORT base::FeatureParam<TimeDelta> kWorkerSpinMaxDuration;
+
+// Under this feature, one ThreadPool task out of every
+// |kTaskLocationStatsSamplingInterval| run on each worker is recorded in
+// TaskLocationStats.
+extern const BASE_EXPORT Feature kThreadPoolTaskLocationStats;
+extern const BASE_EXPORT base::FeatureParam<int>
+    kTaskLocationStatsSamplingInterval;
+
 // Controls whether or not canceled delayed tasks are removed from task queues.
 extern const BASE_EXPORT base::Feature kRemoveCanceledTasksInTaskQueue;
 
@@ -76,9 +94,11 @@ extern const BASE_EXPORT base::Feature kRemoveCanceledTasksInTaskQueue;
 extern const BASE_EXPORT Feature kAddTaskLeewayFeature;
 extern const BASE_EXPORT base::FeatureParam<TimeDelta> kTaskLeewayParam;
 
-// Under this feature, wake ups are aligned at a 4ms boundary when allowed per
-// DelayPolicy.
+// Under this feature, low resolution wake ups are aligned at a boundary of
+// |kAlignWakeUpsSlackParam| when allowed per DelayPolicy, so that nearby wake
+// ups coalesce into one.
 extern const BASE_EXPORT base::Feature kAlignWakeUps;
+extern const BASE_EXPORT base::FeatureParam<TimeDelta> kAlignWakeUpsSlackParam;
 
 // Under this feature, tasks that need high resolution timer are determined
 // based on explicit DelayPolicy rather than based on a threshold.
@@ -87,5 +87,13 @@ void PooledSequencedTaskRunner::UpdatePriority(TaskPriority priority) {
   pooled_task_runner_delegate_->UpdatePriority(sequence_, priority);
 }
 
+void PooledSequencedTaskRunner::BeginPriorityBoost(TaskPriority priority) {
+  pooled_task_runner_delegate_->BeginPriorityBoost(sequence_, priority);
+}
+
+void PooledSequencedTaskRunner::EndPriorityBoost(TaskPriority priority) {
+  pooled_task_runner_delegate_->EndPriorityBoost(sequence_, priority);
+}
+
 }  // namespace internal
 }  // namespace base
@@ -56,6 +56,10 @@ class BASE_EXPORT PooledSequencedTaskRunner
  private:
   ~PooledSequencedTaskRunner() override;
 
+  // UpdateableSequencedTaskRunner:
+  void BeginPriorityBoost(TaskPriority priority) override;
+  void EndPriorityBoost(TaskPriority priority) override;
+
   const raw_ptr<PooledTaskRunnerDelegate> pooled_task_runner_delegate_;
 
   // Sequence for all Tasks posted through this TaskRunner.
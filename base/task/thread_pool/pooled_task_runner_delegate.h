@@ -60,6 +60,14 @@ class BASE_EXPORT PooledTaskRunnerDelegate {
                               TaskPriority priority) = 0;
   virtual void UpdateJobPriority(scoped_refptr<TaskSource> task_source,
                                  TaskPriority priority) = 0;
+
+  // Invoked when a priority boost of |task_source|'s TaskRunner to |priority|
+  // begins or ends. The implementation must update |task_source|'s priority
+  // accordingly, then place it like UpdatePriority() does.
+  virtual void BeginPriorityBoost(scoped_refptr<TaskSource> task_source,
+                                  TaskPriority priority) = 0;
+  virtual void EndPriorityBoost(scoped_refptr<TaskSource> task_source,
+                                TaskPriority priority) = 0;
 };
 
 }  // namespace internal
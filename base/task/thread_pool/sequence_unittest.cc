@@ -233,5 +233,57 @@ TEST(ThreadPoolSequenceTest, TakeEmptySequence) {
   });
 }
 
+// Verify that priority boosts raise the effective priority of a sequence until
+// they all end, without losing priority updates made in the meantime.
+TEST(ThreadPoolSequenceTest, PriorityBoost) {
+  scoped_refptr<Sequence> sequence =
+      MakeRefCounted<Sequence>(TaskTraits(TaskPriority::BEST_EFFORT), nullptr,
+                               TaskSourceExecutionMode::kParallel);
+  Sequence::Transaction sequence_transaction(sequence->BeginTransaction());
+
+  sequence_transaction.BeginPriorityBoost(TaskPriority::USER_VISIBLE);
+  EXPECT_EQ(TaskPriority::USER_VISIBLE,
+            sequence_transaction.traits().priority());
+  EXPECT_EQ(TaskPriority::USER_VISIBLE, sequence->priority_racy());
+  EXPECT_EQ(TaskPriority::BEST_EFFORT,
+            sequence_transaction.unboosted_priority());
+
+  // Nested boosts: the highest one wins.
+  sequence_transaction.BeginPriorityBoost(TaskPriority::USER_BLOCKING);
+  sequence_transaction.BeginPriorityBoost(TaskPriority::USER_BLOCKING);
+  EXPECT_EQ(TaskPriority::USER_BLOCKING,
+            sequence_transaction.traits().priority());
+  sequence_transaction.EndPriorityBoost(TaskPriority::USER_BLOCKING);
+  EXPECT_EQ(TaskPriority::USER_BLOCKING,
+            sequence_transaction.traits().priority());
+  sequence_transaction.EndPriorityBoost(TaskPriority::USER_BLOCKING);
+  EXPECT_EQ(TaskPriority::USER_VISIBLE,
+            sequence_transaction.traits().priority());
+
+  // A priority update while boosted applies once the boost ends.
+  sequence_transaction.UpdatePriority(TaskPriority::BEST_EFFORT);
+  sequence_transaction.UpdatePriority(TaskPriority::USER_BLOCKING);
+  EXPECT_EQ(TaskPriority::USER_BLOCKING,
+            sequence_transaction.traits().priority());
+  sequence_transaction.UpdatePriority(TaskPriority::BEST_EFFORT);
+  EXPECT_EQ(TaskPriority::USER_VISIBLE,
+            sequence_transaction.traits().priority());
+  sequence_transaction.EndPriorityBoost(TaskPriority::USER_VISIBLE);
+  EXPECT_EQ(TaskPriority::BEST_EFFORT,
+            sequence_transaction.traits().priority());
+  EXPECT_EQ(TaskPriority::BEST_EFFORT, sequence->priority_racy());
+}
+
+// Verify that a DCHECK fires if a priority boost that didn't begin ends.
+TEST(ThreadPoolSequenceTest, EndPriorityBoostWithoutBegin) {
+  scoped_refptr<Sequence> sequence = MakeRefCounted<Sequence>(
+      TaskTraits(), nullptr, TaskSourceExecutionMode::kParallel);
+  Sequence::Transaction sequence_transaction(sequence->BeginTransaction());
+  sequence_transaction.BeginPriorityBoost(TaskPriority::USER_VISIBLE);
+  EXPECT_DCHECK_DEATH({
+    sequence_transaction.EndPriorityBoost(TaskPriority::USER_BLOCKING);
+  });
+}
+
 }  // namespace internal
 }  // namespace base
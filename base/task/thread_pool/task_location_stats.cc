@@ -0,0 +1,356 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/task_location_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include "base/json/json_writer.h"
+#include "base/memory/ptr_util.h"
+#include "base/no_destructor.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/threading/thread_local.h"
+#include "base/trace_event/base_tracing.h"
+#include "base/values.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Number of distinct locations tracked per thread. Must be a power of two.
+constexpr size_t kNumSlots = 256;
+// Number of slots probed for a location before it is counted as "other".
+constexpr size_t kMaxProbes = 16;
+
+std::atomic<uint32_t> g_sampling_interval{0};
+
+// The counters of a Slot are only written by the thread owning its buffer, so
+// they are updated with a relaxed load and store rather than a read-modify-
+// write operation.
+void AddTo(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+void AddTo(std::atomic<int64_t>& counter, int64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+void StoreMax(std::atomic<int64_t>& max, int64_t value) {
+  if (value > max.load(std::memory_order_relaxed))
+    max.store(value, std::memory_order_relaxed);
+}
+
+struct Slot {
+  // Identifies the location. Published with a release store once the other
+  // location fields are set; null for unused slots.
+  std::atomic<const void*> program_counter{nullptr};
+  const char* function_name = nullptr;
+  const char* file_name = nullptr;
+  int line_number = -1;
+
+  std::atomic<uint64_t> num_tasks{0};
+  std::atomic<int64_t> total_queue_time_us{0};
+  std::atomic<int64_t> max_queue_time_us{0};
+  std::atomic<int64_t> total_run_time_us{0};
+  std::atomic<int64_t> max_run_time_us{0};
+  std::atomic<uint64_t> num_reenqueues{0};
+
+  void Record(TimeDelta queue_time, TimeDelta run_time, bool reenqueued) {
+    AddTo(num_tasks, 1);
+    AddTo(total_queue_time_us, queue_time.InMicroseconds());
+    StoreMax(max_queue_time_us, queue_time.InMicroseconds());
+    AddTo(total_run_time_us, run_time.InMicroseconds());
+    StoreMax(max_run_time_us, run_time.InMicroseconds());
+    if (reenqueued)
+      AddTo(num_reenqueues, 1);
+  }
+
+  // Merges this slot into |entry|. Can be called from any thread.
+  void MergeInto(TaskLocationStats::Entry* entry) const {
+    entry->num_tasks += num_tasks.load(std::memory_order_relaxed);
+    entry->total_queue_time +=
+        Microseconds(total_queue_time_us.load(std::memory_order_relaxed));
+    entry->max_queue_time = std::max(
+        entry->max_queue_time,
+        Microseconds(max_queue_time_us.load(std::memory_order_relaxed)));
+    entry->total_run_time +=
+        Microseconds(total_run_time_us.load(std::memory_order_relaxed));
+    entry->max_run_time = std::max(
+        entry->max_run_time,
+        Microseconds(max_run_time_us.load(std::memory_order_relaxed)));
+    entry->num_reenqueues += num_reenqueues.load(std::memory_order_relaxed);
+  }
+
+  void Reset() {
+    program_counter.store(nullptr, std::memory_order_relaxed);
+    num_tasks.store(0, std::memory_order_relaxed);
+    total_queue_time_us.store(0, std::memory_order_relaxed);
+    max_queue_time_us.store(0, std::memory_order_relaxed);
+    total_run_time_us.store(0, std::memory_order_relaxed);
+    max_run_time_us.store(0, std::memory_order_relaxed);
+    num_reenqueues.store(0, std::memory_order_relaxed);
+  }
+};
+
+// Statistics recorded by one thread at a time. Buffers of exited threads are
+// recycled, so their statistics are kept.
+class ThreadBuffer {
+ public:
+  ThreadBuffer() = default;
+  ThreadBuffer(const ThreadBuffer&) = delete;
+  ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+  ~ThreadBuffer() = default;
+
+  // Returns the slot for |location|, claiming one if needed. Must be called
+  // from the thread owning this buffer.
+  Slot* GetSlot(const Location& location) {
+    const void* const program_counter = location.program_counter();
+    if (!program_counter)
+      return &other_slot_;
+    const size_t hash = static_cast<size_t>(
+        (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(program_counter)) *
+         0x9E3779B97F4A7C15ull) >>
+        32);
+    for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+      Slot& slot = slots_[(hash + probe) & (kNumSlots - 1)];
+      const void* const slot_program_counter =
+          slot.program_counter.load(std::memory_order_relaxed);
+      if (slot_program_counter == program_counter)
+        return &slot;
+      if (!slot_program_counter) {
+        slot.function_name = location.function_name();
+        slot.file_name = location.file_name();
+        slot.line_number = location.line_number();
+        slot.program_counter.store(program_counter, std::memory_order_release);
+        return &slot;
+      }
+    }
+    return &other_slot_;
+  }
+
+  // Merges the statistics of this buffer into |entries|, keyed by program
+  // counter. Can be called from any thread.
+  void MergeInto(
+      std::map<const void*, TaskLocationStats::Entry>* entries) const {
+    for (const Slot& slot : slots_) {
+      const void* const program_counter =
+          slot.program_counter.load(std::memory_order_acquire);
+      if (!program_counter)
+        continue;
+      TaskLocationStats::Entry& entry = (*entries)[program_counter];
+      entry.location = Location(slot.function_name, slot.file_name,
+                                slot.line_number, program_counter);
+      slot.MergeInto(&entry);
+    }
+    if (other_slot_.num_tasks.load(std::memory_order_relaxed))
+      other_slot_.MergeInto(&(*entries)[nullptr]);
+  }
+
+  void Reset() {
+    for (Slot& slot : slots_)
+      slot.Reset();
+    other_slot_.Reset();
+  }
+
+  // Number of tasks to skip before the next sample. Only accessed by the
+  // thread owning this buffer.
+  uint32_t tasks_until_next_sample = 0;
+
+ private:
+  std::array<Slot, kNumSlots> slots_;
+  // Locations without a program counter, or that didn't fit in |slots_|.
+  Slot other_slot_;
+};
+
+class Registry {
+ public:
+  static Registry& Get() {
+    static NoDestructor<Registry> registry;
+    return *registry;
+  }
+
+  Registry() = default;
+  Registry(const Registry&) = delete;
+  Registry& operator=(const Registry&) = delete;
+
+  ThreadBuffer* GetBufferForCurrentThread() {
+    BufferOwner* owner = current_thread_owner_.Get();
+    if (!owner) {
+      owner = new BufferOwner(AcquireBuffer());
+      current_thread_owner_.Set(WrapUnique(owner));
+    }
+    return owner->buffer;
+  }
+
+  std::vector<TaskLocationStats::Entry> GetEntries() {
+    std::map<const void*, TaskLocationStats::Entry> entries_map;
+    {
+      AutoLock auto_lock(lock_);
+      for (const auto& buffer : buffers_)
+        buffer->MergeInto(&entries_map);
+    }
+    std::vector<TaskLocationStats::Entry> entries;
+    entries.reserve(entries_map.size());
+    for (auto& entry : entries_map) {
+      // Slots are published before their first sample is recorded.
+      if (entry.second.num_tasks > 0)
+        entries.push_back(std::move(entry.second));
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const TaskLocationStats::Entry& a,
+                 const TaskLocationStats::Entry& b) {
+                return a.total_queue_time > b.total_queue_time;
+              });
+    return entries;
+  }
+
+  void Reset() {
+    AutoLock auto_lock(lock_);
+    for (const auto& buffer : buffers_)
+      buffer->Reset();
+  }
+
+ private:
+  // Returns its buffer to the registry when its thread exits.
+  struct BufferOwner {
+    explicit BufferOwner(ThreadBuffer* buffer) : buffer(buffer) {}
+    ~BufferOwner() { Registry::Get().ReleaseBuffer(buffer); }
+    ThreadBuffer* const buffer;
+  };
+
+  ThreadBuffer* AcquireBuffer() {
+    AutoLock auto_lock(lock_);
+    if (!free_buffers_.empty()) {
+      ThreadBuffer* buffer = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    buffers_.push_back(std::make_unique<ThreadBuffer>());
+    return buffers_.back().get();
+  }
+
+  void ReleaseBuffer(ThreadBuffer* buffer) {
+    AutoLock auto_lock(lock_);
+    free_buffers_.push_back(buffer);
+  }
+
+  Lock lock_;
+  // All buffers ever created. Their number is bounded by the maximum number
+  // of threads that recorded samples concurrently.
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ GUARDED_BY(lock_);
+  // Buffers of exited threads, available for reuse.
+  std::vector<ThreadBuffer*> free_buffers_ GUARDED_BY(lock_);
+  ThreadLocalOwnedPointer<BufferOwner> current_thread_owner_;
+};
+
+std::string GetLocationName(const Location& location) {
+  return location.program_counter() ? location.ToString() : "(other)";
+}
+
+}  // namespace
+
+TaskLocationStats::Entry::Entry() = default;
+TaskLocationStats::Entry::Entry(const Entry&) = default;
+TaskLocationStats::Entry& TaskLocationStats::Entry::operator=(const Entry&) =
+    default;
+TaskLocationStats::Entry::~Entry() = default;
+
+// static
+void TaskLocationStats::SetSamplingInterval(uint32_t sampling_interval) {
+  g_sampling_interval.store(sampling_interval, std::memory_order_relaxed);
+}
+
+// static
+bool TaskLocationStats::ShouldSampleNextTask() {
+  const uint32_t sampling_interval =
+      g_sampling_interval.load(std::memory_order_relaxed);
+  if (sampling_interval == 0)
+    return false;
+  ThreadBuffer* const buffer = Registry::Get().GetBufferForCurrentThread();
+  // The interval may have been lowered since the last sample.
+  buffer->tasks_until_next_sample =
+      std::min(buffer->tasks_until_next_sample, sampling_interval - 1);
+  if (buffer->tasks_until_next_sample > 0) {
+    --buffer->tasks_until_next_sample;
+    return false;
+  }
+  buffer->tasks_until_next_sample = sampling_interval - 1;
+  return true;
+}
+
+// static
+void TaskLocationStats::RecordSample(const Location& posted_from,
+                                     TimeDelta queue_time,
+                                     TimeDelta run_time,
+                                     bool reenqueued) {
+  Registry::Get()
+      .GetBufferForCurrentThread()
+      ->GetSlot(posted_from)
+      ->Record(queue_time, run_time, reenqueued);
+}
+
+// static
+std::vector<TaskLocationStats::Entry> TaskLocationStats::GetEntries() {
+  return Registry::Get().GetEntries();
+}
+
+// static
+std::string TaskLocationStats::GetEntriesAsJson() {
+  Value::List list;
+  for (const Entry& entry : GetEntries()) {
+    Value::Dict dict;
+    dict.Set("location", GetLocationName(entry.location));
+    // Value doesn't support 64-bit integers.
+    dict.Set("num_tasks", static_cast<double>(entry.num_tasks));
+    dict.Set("total_queue_time_us",
+             static_cast<double>(entry.total_queue_time.InMicroseconds()));
+    dict.Set("max_queue_time_us",
+             static_cast<double>(entry.max_queue_time.InMicroseconds()));
+    dict.Set("total_run_time_us",
+             static_cast<double>(entry.total_run_time.InMicroseconds()));
+    dict.Set("max_run_time_us",
+             static_cast<double>(entry.max_run_time.InMicroseconds()));
+    dict.Set("num_reenqueues", static_cast<double>(entry.num_reenqueues));
+    list.Append(std::move(dict));
+  }
+  std::string json;
+  JSONWriter::Write(list, &json);
+  return json;
+}
+
+// static
+void TaskLocationStats::EmitTraceCounters() {
+  bool enabled = false;
+  TRACE_EVENT_CATEGORY_GROUP_ENABLED(
+      TRACE_DISABLED_BY_DEFAULT("thread_pool_diagnostics"), &enabled);
+  if (!enabled)
+    return;
+  for (const Entry& entry : GetEntries()) {
+    const int64_t num_tasks = static_cast<int64_t>(entry.num_tasks);
+    const std::string name =
+        "ThreadPool.TaskLocation " + GetLocationName(entry.location);
+    TRACE_COPY_COUNTER2(
+        TRACE_DISABLED_BY_DEFAULT("thread_pool_diagnostics"), name.c_str(),
+        "avg_queue_time_us",
+        (entry.total_queue_time / num_tasks).InMicroseconds(),
+        "avg_run_time_us",
+        (entry.total_run_time / num_tasks).InMicroseconds());
+  }
+}
+
+// static
+void TaskLocationStats::ResetForTesting() {
+  Registry::Get().Reset();
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,86 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_THREAD_POOL_TASK_LOCATION_STATS_H_
+#define BASE_TASK_THREAD_POOL_TASK_LOCATION_STATS_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/location.h"
+#include "base/time/time.h"
+
+namespace base {
+namespace internal {
+
+// Sampled, per-posting-location statistics about the tasks run by the
+// ThreadPool: how long they waited in the queue, how long they ran and how
+// often their task source had to be re-enqueued afterwards. Meant to find the
+// posting sites that starve the pool.
+//
+// Samples are aggregated into per-thread buffers that only their thread writes
+// to, without locks; GetEntries() merges them on demand. Recording is disabled
+// until SetSamplingInterval() is called with a non-zero interval, and only
+// costs a relaxed load per task while disabled.
+//
+// All methods are static and thread-safe.
+class BASE_EXPORT TaskLocationStats {
+ public:
+  // Aggregated statistics for the sampled tasks posted from |location|.
+  struct BASE_EXPORT Entry {
+    Entry();
+    Entry(const Entry&);
+    Entry& operator=(const Entry&);
+    ~Entry();
+
+    Location location;
+    uint64_t num_tasks = 0;
+    TimeDelta total_queue_time;
+    TimeDelta max_queue_time;
+    TimeDelta total_run_time;
+    TimeDelta max_run_time;
+    // Number of sampled tasks after which their task source was re-enqueued
+    // because it had more work.
+    uint64_t num_reenqueues = 0;
+  };
+
+  TaskLocationStats() = delete;
+
+  // Records one task out of every |sampling_interval| run on each thread, or
+  // none if |sampling_interval| is 0. Previously recorded statistics are kept.
+  static void SetSamplingInterval(uint32_t sampling_interval);
+
+  // Returns true if the task about to run on the current thread should be
+  // sampled and passed to RecordSample().
+  static bool ShouldSampleNextTask();
+
+  // Records a sampled task posted from |posted_from|. |reenqueued| is true if
+  // its task source was re-enqueued after it ran.
+  static void RecordSample(const Location& posted_from,
+                           TimeDelta queue_time,
+                           TimeDelta run_time,
+                           bool reenqueued);
+
+  // Returns the statistics of all threads, merged by location, sorted by
+  // decreasing total queue time.
+  static std::vector<Entry> GetEntries();
+
+  // Returns GetEntries() as a JSON list. Times are in microseconds.
+  static std::string GetEntriesAsJson();
+
+  // Emits the average queue and run times of each location as counters in the
+  // "disabled-by-default-thread_pool_diagnostics" trace category.
+  static void EmitTraceCounters();
+
+  // Clears all statistics. Must not be called concurrently with RecordSample().
+  static void ResetForTesting();
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_TASK_THREAD_POOL_TASK_LOCATION_STATS_H_
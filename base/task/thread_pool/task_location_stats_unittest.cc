@@ -0,0 +1,140 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/task_location_stats.h"
+
+#include "base/bind.h"
+#include "base/json/json_reader.h"
+#include "base/location.h"
+#include "base/task/thread_pool.h"
+#include "base/test/task_environment.h"
+#include "base/threading/simple_thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+class ThreadPoolTaskLocationStatsTest : public testing::Test {
+ protected:
+  ThreadPoolTaskLocationStatsTest() { TaskLocationStats::ResetForTesting(); }
+  ~ThreadPoolTaskLocationStatsTest() override {
+    TaskLocationStats::SetSamplingInterval(0);
+    TaskLocationStats::ResetForTesting();
+  }
+};
+
+class RecordSampleThread : public SimpleThread {
+ public:
+  explicit RecordSampleThread(const Location& location)
+      : SimpleThread("RecordSampleThread"), location_(location) {}
+
+  void Run() override {
+    TaskLocationStats::RecordSample(location_, Milliseconds(8),
+                                    Milliseconds(3), /*reenqueued=*/true);
+  }
+
+ private:
+  const Location location_;
+};
+
+const TaskLocationStats::Entry* FindEntry(
+    const std::vector<TaskLocationStats::Entry>& entries,
+    const Location& location) {
+  for (const auto& entry : entries) {
+    if (entry.location == location)
+      return &entry;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST_F(ThreadPoolTaskLocationStatsTest, DisabledByDefault) {
+  for (int i = 0; i < 100; ++i)
+    EXPECT_FALSE(TaskLocationStats::ShouldSampleNextTask());
+}
+
+TEST_F(ThreadPoolTaskLocationStatsTest, SamplingInterval) {
+  TaskLocationStats::SetSamplingInterval(3);
+  // Consume the first sample, whose position depends on previous tests.
+  while (!TaskLocationStats::ShouldSampleNextTask()) {
+  }
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(TaskLocationStats::ShouldSampleNextTask());
+    EXPECT_FALSE(TaskLocationStats::ShouldSampleNextTask());
+    EXPECT_TRUE(TaskLocationStats::ShouldSampleNextTask());
+  }
+}
+
+TEST_F(ThreadPoolTaskLocationStatsTest, MergesThreads) {
+  const Location location_a = FROM_HERE;
+  const Location location_b = FROM_HERE;
+
+  TaskLocationStats::RecordSample(location_a, Milliseconds(2), Milliseconds(1),
+                                  /*reenqueued=*/false);
+  TaskLocationStats::RecordSample(location_b, Milliseconds(1), Milliseconds(5),
+                                  /*reenqueued=*/true);
+  RecordSampleThread thread(location_a);
+  thread.Start();
+  thread.Join();
+
+  const std::vector<TaskLocationStats::Entry> entries =
+      TaskLocationStats::GetEntries();
+  ASSERT_EQ(2U, entries.size());
+  // Sorted by decreasing total queue time.
+  EXPECT_EQ(location_a, entries[0].location);
+  EXPECT_EQ(location_b, entries[1].location);
+
+  EXPECT_EQ(2U, entries[0].num_tasks);
+  EXPECT_EQ(Milliseconds(10), entries[0].total_queue_time);
+  EXPECT_EQ(Milliseconds(8), entries[0].max_queue_time);
+  EXPECT_EQ(Milliseconds(4), entries[0].total_run_time);
+  EXPECT_EQ(Milliseconds(3), entries[0].max_run_time);
+  EXPECT_EQ(1U, entries[0].num_reenqueues);
+
+  EXPECT_EQ(1U, entries[1].num_tasks);
+  EXPECT_EQ(Milliseconds(5), entries[1].max_run_time);
+  EXPECT_EQ(1U, entries[1].num_reenqueues);
+}
+
+TEST_F(ThreadPoolTaskLocationStatsTest, Json) {
+  const Location location = FROM_HERE;
+  TaskLocationStats::RecordSample(location, Microseconds(30), Microseconds(7),
+                                  /*reenqueued=*/false);
+
+  absl::optional<Value> json =
+      JSONReader::Read(TaskLocationStats::GetEntriesAsJson());
+  ASSERT_TRUE(json);
+  ASSERT_TRUE(json->is_list());
+  ASSERT_EQ(1U, json->GetList().size());
+  const Value& entry = json->GetList()[0];
+  EXPECT_EQ(location.ToString(), *entry.FindStringKey("location"));
+  EXPECT_EQ(1, entry.FindDoubleKey("num_tasks"));
+  EXPECT_EQ(30, entry.FindDoubleKey("total_queue_time_us"));
+  EXPECT_EQ(7, entry.FindDoubleKey("max_run_time_us"));
+  EXPECT_EQ(0, entry.FindDoubleKey("num_reenqueues"));
+}
+
+// Tasks run by the ThreadPool are recorded under their posting location.
+TEST_F(ThreadPoolTaskLocationStatsTest, ThreadPoolTasks) {
+  test::TaskEnvironment task_environment;
+  TaskLocationStats::SetSamplingInterval(1);
+
+  const Location location = FROM_HERE;
+  constexpr int kNumTasks = 10;
+  for (int i = 0; i < kNumTasks; ++i)
+    ThreadPool::PostTask(location, DoNothing());
+  task_environment.RunUntilIdle();
+
+  const TaskLocationStats::Entry* entry =
+      FindEntry(TaskLocationStats::GetEntries(), location);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(static_cast<uint64_t>(kNumTasks), entry->num_tasks);
+}
+
+}  // namespace internal
+}  // namespace base
@@ -4,6 +4,7 @@
 
 #include "base/task/thread_pool/task_source.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "base/check_op.h"
@@ -12,9 +13,33 @@
 #include "base/task/task_features.h"
 #include "base/task/thread_pool/task_tracker.h"
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+#include <sys/resource.h>
+
+#include "base/logging.h"
+#include "base/threading/platform_thread_internal_posix.h"
+#endif
+
 namespace base {
 namespace internal {
 
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+namespace {
+
+// Sets the nice value of |thread_id| for |priority|. Unlike
+// PlatformThread::SetThreadPriority(), this doesn't move the thread between
+// cgroups, which requires file I/O: it is allowed from any task, and cheap
+// enough to do under a lock.
+void SetThreadNiceValue(PlatformThreadId thread_id, ThreadPriority priority) {
+  if (setpriority(PRIO_PROCESS, static_cast<id_t>(thread_id),
+                  ThreadPriorityToNiceValue(priority)) != 0) {
+    DVPLOG(1) << "Failed to set nice value of thread " << thread_id;
+  }
+}
+
+}  // namespace
+#endif
+
 TaskSource::Transaction::Transaction(TaskSource* task_source)
     : task_source_(task_source) {
   task_source->lock_.Acquire();
@@ -33,9 +58,21 @@ TaskSource::Transaction::~Transaction() {
 }
 
 void TaskSource::Transaction::UpdatePriority(TaskPriority priority) {
-  task_source_->traits_.UpdatePriority(priority);
-  task_source_->priority_racy_.store(task_source_->traits_.priority(),
-                                     std::memory_order_relaxed);
+  task_source_->unboosted_priority_ = priority;
+  task_source_->UpdateEffectivePriorityLockRequired();
+}
+
+void TaskSource::Transaction::BeginPriorityBoost(TaskPriority priority) {
+  ++task_source_->num_priority_boosts_[static_cast<size_t>(priority)];
+  task_source_->UpdateEffectivePriorityLockRequired();
+}
+
+void TaskSource::Transaction::EndPriorityBoost(TaskPriority priority) {
+  int& num_boosts =
+      task_source_->num_priority_boosts_[static_cast<size_t>(priority)];
+  DCHECK_GT(num_boosts, 0);
+  --num_boosts;
+  task_source_->UpdateEffectivePriorityLockRequired();
 }
 
 void TaskSource::SetHeapHandle(const HeapHandle& handle) {
@@ -46,13 +83,76 @@ void TaskSource::ClearHeapHandle() {
   heap_handle_ = HeapHandle();
 }
 
+void TaskSource::WillRunOnBackgroundThread(PlatformThreadId thread_id) {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (execution_mode_ == TaskSourceExecutionMode::kJob)
+    return;
+  CheckedAutoLock auto_lock(background_thread_lock_);
+  DCHECK_EQ(background_thread_id_, kInvalidThreadId);
+  background_thread_id_ = thread_id;
+  // The TaskSource may have been boosted after the worker got it.
+  UpdateBackgroundThreadPriorityLockRequired();
+#endif
+}
+
+void TaskSource::DidRunOnBackgroundThread() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  if (execution_mode_ == TaskSourceExecutionMode::kJob)
+    return;
+  CheckedAutoLock auto_lock(background_thread_lock_);
+  DCHECK_EQ(background_thread_id_, PlatformThread::CurrentId());
+  if (background_thread_priority_raised_) {
+    SetThreadNiceValue(background_thread_id_, ThreadPriority::BACKGROUND);
+    background_thread_priority_raised_ = false;
+  }
+  background_thread_id_ = kInvalidThreadId;
+#endif
+}
+
+void TaskSource::UpdateBackgroundThreadPriority() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  CheckedAutoLock auto_lock(background_thread_lock_);
+  UpdateBackgroundThreadPriorityLockRequired();
+#endif
+}
+
+void TaskSource::UpdateEffectivePriorityLockRequired() {
+  lock_.AssertAcquired();
+  TaskPriority priority = unboosted_priority_;
+  for (size_t i = 0; i < num_priority_boosts_.size(); ++i) {
+    if (num_priority_boosts_[i] > 0)
+      priority = std::max(priority, static_cast<TaskPriority>(i));
+  }
+  traits_.UpdatePriority(priority);
+  priority_racy_.store(priority, std::memory_order_relaxed);
+}
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+void TaskSource::UpdateBackgroundThreadPriorityLockRequired() {
+  background_thread_lock_.AssertAcquired();
+  if (background_thread_id_ == kInvalidThreadId)
+    return;
+  // |priority_racy_| is read under |background_thread_lock_|, after it was
+  // updated: the last update applies the latest priority.
+  const bool should_raise = priority_racy_.load(std::memory_order_relaxed) !=
+                            TaskPriority::BEST_EFFORT;
+  if (should_raise == background_thread_priority_raised_)
+    return;
+  SetThreadNiceValue(background_thread_id_, should_raise
+                                                ? ThreadPriority::NORMAL
+                                                : ThreadPriority::BACKGROUND);
+  background_thread_priority_raised_ = should_raise;
+}
+#endif
+
 TaskSource::TaskSource(const TaskTraits& traits,
                        TaskRunner* task_runner,
                        TaskSourceExecutionMode execution_mode)
     : traits_(traits),
       priority_racy_(traits.priority()),
       task_runner_(task_runner),
-      execution_mode_(execution_mode) {
+      execution_mode_(execution_mode),
+      unboosted_priority_(traits.priority()) {
   DCHECK(task_runner_ ||
          execution_mode_ == TaskSourceExecutionMode::kParallel ||
          execution_mode_ == TaskSourceExecutionMode::kJob);
@@ -7,6 +7,9 @@
 
 #include <stddef.h>
 
+#include <array>
+#include <atomic>
+
 #include "base/base_export.h"
 #include "base/containers/intrusive_heap.h"
 #include "base/dcheck_is_on.h"
@@ -17,7 +20,9 @@
 #include "base/task/task_traits.h"
 #include "base/task/thread_pool/task.h"
 #include "base/task/thread_pool/task_source_sort_key.h"
+#include "base/threading/platform_thread.h"
 #include "base/threading/sequence_local_storage_map.h"
+#include "build/build_config.h"
 
 namespace base {
 namespace internal {
@@ -106,10 +111,24 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
 
     operator bool() const { return !!task_source_; }
 
-    // Sets TaskSource priority to |priority|.
+    // Sets TaskSource priority to |priority|. While priority boosts are
+    // active, the effective priority is the highest of |priority| and of the
+    // boosts' priorities.
     void UpdatePriority(TaskPriority priority);
 
-    // Returns the traits of all Tasks in the TaskSource.
+    // Begins a priority boost which raises the effective priority of the
+    // TaskSource to at least |priority| until a matching call to
+    // EndPriorityBoost() with the same |priority|. Boosts can nest.
+    void BeginPriorityBoost(TaskPriority priority);
+    void EndPriorityBoost(TaskPriority priority);
+
+    // Returns the priority last set with UpdatePriority(), ignoring boosts.
+    TaskPriority unboosted_priority() const {
+      return task_source_->unboosted_priority_;
+    }
+
+    // Returns the traits of all Tasks in the TaskSource. The priority of the
+    // returned traits is the effective priority.
     TaskTraits traits() const { return task_source_->traits_; }
 
     TaskSource* task_source() const { return task_source_; }
@@ -177,6 +196,33 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
 
   TaskSourceExecutionMode execution_mode() const { return execution_mode_; }
 
+  // Returns the placement domain of the worker that last got this TaskSource
+  // from its thread group, or WorkerPlacement::kNoDomain. This is only a
+  // scheduling hint: it can be accessed without a Transaction and may be
+  // outdated.
+  int last_placement_domain() const {
+    return last_placement_domain_.load(std::memory_order_relaxed);
+  }
+  void set_last_placement_domain(int domain) {
+    last_placement_domain_.store(domain, std::memory_order_relaxed);
+  }
+
+  // Invoked by a worker running at background thread priority, respectively
+  // before and after it runs a task from this TaskSource. In between, the
+  // nice value of |thread_id| is raised to the one of NORMAL priority whenever
+  // the effective priority of the TaskSource is above BEST_EFFORT, on
+  // platforms that allow changing the priority of another thread.
+  // DidRunOnBackgroundThread() restores it, and must be called on the worker.
+  // No-op for jobs, which can run on many workers.
+  void WillRunOnBackgroundThread(PlatformThreadId thread_id);
+  void DidRunOnBackgroundThread();
+
+  // Applies the effective priority to the background worker running a task
+  // from this TaskSource, if any. Must be called after a Transaction changed
+  // the effective priority, once it is released: the thread priority isn't
+  // changed under |lock_|.
+  void UpdateBackgroundThreadPriority();
+
  protected:
   virtual ~TaskSource();
 
@@ -196,7 +242,8 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
   // Sets TaskSource priority to |priority|.
   void UpdatePriority(TaskPriority priority);
 
-  // The TaskTraits of all Tasks in the TaskSource.
+  // The TaskTraits of all Tasks in the TaskSource. Their priority is the
+  // effective priority, which accounts for priority boosts.
   TaskTraits traits_;
 
   // The cached priority for atomic access.
@@ -209,6 +256,16 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
   friend class RefCountedThreadSafe<TaskSource>;
   friend class RegisteredTaskSource;
 
+  // Recomputes the effective priority from |unboosted_priority_| and
+  // |num_priority_boosts_|.
+  void UpdateEffectivePriorityLockRequired();
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  // Raises or restores the thread priority of |background_thread_id_| to
+  // match the effective priority. Requires |background_thread_lock_|.
+  void UpdateBackgroundThreadPriorityLockRequired();
+#endif
+
   // The TaskSource's position in its current PriorityQueue. Access is protected
   // by the PriorityQueue's lock.
   HeapHandle heap_handle_;
@@ -220,6 +277,30 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
   raw_ptr<TaskRunner> task_runner_;
 
   TaskSourceExecutionMode execution_mode_;
+
+  // See last_placement_domain(). -1 is WorkerPlacement::kNoDomain.
+  std::atomic_int last_placement_domain_{-1};
+
+  // The priority set with Transaction::UpdatePriority(), ignoring boosts.
+  // Protected by |lock_|.
+  TaskPriority unboosted_priority_;
+
+  // Number of active priority boosts, indexed by TaskPriority. Protected by
+  // |lock_|.
+  std::array<int, static_cast<size_t>(TaskPriority::HIGHEST) + 1>
+      num_priority_boosts_{};
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  // Serializes the thread priority changes of the background worker. Never
+  // held with |lock_|.
+  CheckedLock background_thread_lock_;
+
+  // The background worker running a task from this TaskSource, if any, and
+  // whether its thread priority is raised. Protected by
+  // |background_thread_lock_|.
+  PlatformThreadId background_thread_id_ = kInvalidThreadId;
+  bool background_thread_priority_raised_ = false;
+#endif
 };
 
 // Wrapper around TaskSource to signify the intent to queue and run it.
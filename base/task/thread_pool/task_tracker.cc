@@ -24,6 +24,7 @@
 #include "base/synchronization/waitable_event.h"
 #include "base/task/scoped_set_task_priority_for_current_thread.h"
 #include "base/task/task_executor.h"
+#include "base/task/thread_pool/task_location_stats.h"
 #include "base/threading/sequence_local_storage_map.h"
 #include "base/threading/sequenced_task_runner_handle.h"
 #include "base/threading/thread_restrictions.h"
@@ -464,13 +465,29 @@ RegisteredTaskSource TaskTracker::RunAndPopNextTask(
     traits = transaction.traits();
   }
 
+  // Start time and posting details of |task|, if it's sampled for
+  // TaskLocationStats.
+  TimeTicks sampled_task_start_time;
+  TimeDelta sampled_task_queue_time;
+  Location sampled_task_posted_from;
   if (task) {
+    if (should_run_tasks && TaskLocationStats::ShouldSampleNextTask()) {
+      sampled_task_start_time = TimeTicks::Now();
+      sampled_task_queue_time =
+          sampled_task_start_time - task->GetDesiredExecutionTime();
+      sampled_task_posted_from = task->posted_from;
+    }
     // Run the |task| (whether it's a worker task or the Clear() closure).
     RunTask(std::move(task.value()), task_source.get(), traits);
   }
   if (should_run_tasks)
     AfterRunTask(task_source->shutdown_behavior());
   const bool task_source_must_be_queued = task_source.DidProcessTask();
+  if (!sampled_task_start_time.is_null()) {
+    TaskLocationStats::RecordSample(
+        sampled_task_posted_from, sampled_task_queue_time,
+        TimeTicks::Now() - sampled_task_start_time, task_source_must_be_queued);
+  }
   // |task_source| should be reenqueued iff requested by DidProcessTask().
   if (task_source_must_be_queued)
     return task_source;
@@ -245,6 +245,22 @@ void MockPooledTaskRunnerDelegate::UpdateJobPriority(
   UpdatePriority(std::move(task_source), priority);
 }
 
+void MockPooledTaskRunnerDelegate::BeginPriorityBoost(
+    scoped_refptr<TaskSource> task_source,
+    TaskPriority priority) {
+  auto transaction = task_source->BeginTransaction();
+  transaction.BeginPriorityBoost(priority);
+  thread_group_->UpdateSortKey(std::move(transaction));
+}
+
+void MockPooledTaskRunnerDelegate::EndPriorityBoost(
+    scoped_refptr<TaskSource> task_source,
+    TaskPriority priority) {
+  auto transaction = task_source->BeginTransaction();
+  transaction.EndPriorityBoost(priority);
+  thread_group_->UpdateSortKey(std::move(transaction));
+}
+
 void MockPooledTaskRunnerDelegate::SetThreadGroup(ThreadGroup* thread_group) {
   thread_group_ = thread_group;
 }
@@ -70,6 +70,10 @@ class MockPooledTaskRunnerDelegate : public PooledTaskRunnerDelegate {
                       TaskPriority priority) override;
   void UpdateJobPriority(scoped_refptr<TaskSource> task_source,
                          TaskPriority priority) override;
+  void BeginPriorityBoost(scoped_refptr<TaskSource> task_source,
+                          TaskPriority priority) override;
+  void EndPriorityBoost(scoped_refptr<TaskSource> task_source,
+                        TaskPriority priority) override;
 
   void SetThreadGroup(ThreadGroup* thread_group);
 
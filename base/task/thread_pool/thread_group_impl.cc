@@ -18,6 +18,7 @@
 #include "base/containers/stack_container.h"
 #include "base/feature_list.h"
 #include "base/location.h"
+#include "base/logging.h"
 #include "base/memory/ptr_util.h"
 #include "base/memory/raw_ptr.h"
 #include "base/metrics/histogram.h"
@@ -53,6 +54,8 @@ namespace {
 
 constexpr char kNumTasksBeforeDetachHistogramPrefix[] =
     "ThreadPool.NumTasksBeforeDetach.";
+constexpr char kWorkerSpinSucceededHistogramPrefix[] =
+    "ThreadPool.WorkerSpinSucceeded.";
 constexpr size_t kMaxNumberOfWorkers = 256;
 
 // In a background thread group:
@@ -223,7 +226,10 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
                                                   public BlockingObserver {
  public:
   // |outer| owns the worker for which this delegate is constructed.
-  explicit WorkerThreadDelegateImpl(TrackedRef<ThreadGroupImpl> outer);
+  // |placement_domain| is the domain in |outer|'s WorkerPlacement to which the
+  // worker is pinned, or WorkerPlacement::kNoDomain.
+  WorkerThreadDelegateImpl(TrackedRef<ThreadGroupImpl> outer,
+                           int placement_domain);
   WorkerThreadDelegateImpl(const WorkerThreadDelegateImpl&) = delete;
   WorkerThreadDelegateImpl& operator=(const WorkerThreadDelegateImpl&) = delete;
 
@@ -237,6 +243,7 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
   RegisteredTaskSource GetWork(WorkerThread* worker) override;
   void DidProcessTask(RegisteredTaskSource task_source) override;
   TimeDelta GetSleepTimeout() override;
+  void WaitForWork(WaitableEvent* wake_up_event) override;
   void OnMainExit(WorkerThread* worker) override;
 
   // BlockingObserver:
@@ -273,6 +280,8 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
     return outer_->lock_;
   }
 
+  int placement_domain() const { return placement_domain_; }
+
  private:
   // Returns true if |worker| is allowed to cleanup and remove itself from the
   // thread group. Called from GetWork() when no work is available.
@@ -344,6 +353,8 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
 
   const TrackedRef<ThreadGroupImpl> outer_;
 
+  const int placement_domain_;
+
   // Whether |outer_->max_tasks_|/|outer_->max_best_effort_tasks_| were
   // incremented due to a ScopedBlockingCall on the thread.
   bool incremented_max_tasks_since_blocked_ GUARDED_BY(outer_->lock_) = false;
@@ -364,6 +375,7 @@ ThreadGroupImpl::ThreadGroupImpl(StringPiece histogram_label,
                                  TrackedRef<TaskTracker> task_tracker,
                                  TrackedRef<Delegate> delegate)
     : ThreadGroup(std::move(task_tracker), std::move(delegate)),
+      histogram_label_(histogram_label),
       thread_group_label_(thread_group_label),
       priority_hint_(priority_hint),
       idle_workers_stack_cv_for_testing_(lock_.CreateConditionVariable()),
@@ -410,6 +422,18 @@ void ThreadGroupImpl::Start(
   in_start().blocked_workers_poll_period =
       priority_hint_ == ThreadPriority::NORMAL ? kForegroundBlockedWorkersPoll
                                                : kBackgroundBlockedWorkersPoll;
+  if (FeatureList::IsEnabled(kTopologyAwareWorkerPlacement))
+    in_start().worker_placement = WorkerPlacement::CreateForCurrentMachine();
+  if (FeatureList::IsEnabled(kWorkerSpinBeforeSleep)) {
+    in_start().spin_policy =
+        std::make_unique<WorkerSpinPolicy>(kWorkerSpinMaxDuration.Get());
+    if (!histogram_label_.empty()) {
+      in_start().spin_succeeded_histogram = BooleanHistogram::FactoryGet(
+          JoinString({kWorkerSpinSucceededHistogramPrefix, histogram_label_},
+                     ""),
+          HistogramBase::kUmaTargetedHistogramFlag);
+    }
+  }
 
   ScopedCommandsExecutor executor(this);
   CheckedAutoLock auto_lock(lock_);
@@ -428,6 +452,8 @@ void ThreadGroupImpl::Start(
 #if DCHECK_IS_ON()
   in_start().initialized = true;
 #endif
+  spin_policy_for_arrivals_.store(after_start().spin_policy.get(),
+                                  std::memory_order_release);
 
   if (synchronous_thread_start_for_testing) {
     worker_started_for_testing_.emplace(WaitableEvent::ResetPolicy::AUTOMATIC);
@@ -455,6 +481,12 @@ void ThreadGroupImpl::UpdateSortKey(TaskSource::Transaction transaction) {
 
 void ThreadGroupImpl::PushTaskSourceAndWakeUpWorkers(
     TransactionWithRegisteredTaskSource transaction_with_task_source) {
+  WorkerSpinPolicy* const spin_policy =
+      spin_policy_for_arrivals_.load(std::memory_order_acquire);
+  if (spin_policy) {
+    spin_policy->RecordTaskSourceArrival(
+        subtle::TimeTicksNowIgnoringOverride());
+  }
   ScopedCommandsExecutor executor(this);
   PushTaskSourceAndWakeUpWorkersImpl(&executor,
                                      std::move(transaction_with_task_source));
@@ -550,8 +582,9 @@ size_t ThreadGroupImpl::NumberOfIdleWorkersForTesting() const {
 }
 
 ThreadGroupImpl::WorkerThreadDelegateImpl::WorkerThreadDelegateImpl(
-    TrackedRef<ThreadGroupImpl> outer)
-    : outer_(std::move(outer)) {
+    TrackedRef<ThreadGroupImpl> outer,
+    int placement_domain)
+    : outer_(std::move(outer)), placement_domain_(placement_domain) {
   // Bound in OnMainEntry().
   DETACH_FROM_THREAD(worker_thread_checker_);
 }
@@ -580,6 +613,16 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::OnMainEntry(
   PlatformThread::SetName(
       StringPrintf("ThreadPool%sWorker", outer_->thread_group_label_.c_str()));
 
+  // A worker which can't be pinned (e.g. the CPUs were taken out of the
+  // process' cpuset) still runs, unpinned. It keeps its domain as a wake-up
+  // preference.
+  if (placement_domain_ != WorkerPlacement::kNoDomain &&
+      !outer_->after_start().worker_placement->PinCurrentThread(
+          placement_domain_)) {
+    DVLOG(1) << "Failed to pin worker to placement domain "
+             << placement_domain_;
+  }
+
   outer_->BindToCurrentThread();
   worker_only().worker_thread_ = worker;
   SetBlockingObserverForCurrentThread(this);
@@ -646,6 +689,8 @@ RegisteredTaskSource ThreadGroupImpl::WorkerThreadDelegateImpl::GetWork(
   DCHECK(!outer_->idle_workers_stack_.Contains(worker));
   write_worker().current_task_priority = priority;
   write_worker().current_shutdown_behavior = task_source->shutdown_behavior();
+  if (placement_domain_ != WorkerPlacement::kNoDomain)
+    task_source->set_last_placement_domain(placement_domain_);
 
   if (outer_->after_start().wakeup_after_getwork &&
       outer_->after_start().wakeup_strategy !=
@@ -742,6 +787,26 @@ TimeDelta ThreadGroupImpl::WorkerThreadDelegateImpl::GetSleepTimeout() {
   return outer_->after_start().suggested_reclaim_time * 1.1;
 }
 
+void ThreadGroupImpl::WorkerThreadDelegateImpl::WaitForWork(
+    WaitableEvent* wake_up_event) {
+  DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
+  WorkerSpinPolicy* const spin_policy = outer_->after_start().spin_policy.get();
+  if (spin_policy) {
+    const WorkerSpinPolicy::SpinResult result =
+        spin_policy->SpinOnEvent(wake_up_event,
+                                 worker_only().worker_thread_.get());
+    if ((result == WorkerSpinPolicy::SpinResult::kWokenUp ||
+         result == WorkerSpinPolicy::SpinResult::kTimedOut) &&
+        outer_->after_start().spin_succeeded_histogram) {
+      outer_->after_start().spin_succeeded_histogram->AddBoolean(
+          result == WorkerSpinPolicy::SpinResult::kWokenUp);
+    }
+    if (result == WorkerSpinPolicy::SpinResult::kWokenUp)
+      return;
+  }
+  WorkerThread::Delegate::WaitForWork(wake_up_event);
+}
+
 bool ThreadGroupImpl::WorkerThreadDelegateImpl::CanCleanupLockRequired(
     const WorkerThread* worker) const {
   DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
@@ -766,6 +831,8 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::CleanupLockRequired(
   }
   worker->Cleanup();
   outer_->idle_workers_stack_.Remove(worker);
+  if (placement_domain_ != WorkerPlacement::kNoDomain)
+    outer_->after_start().worker_placement->ReleaseDomain(placement_domain_);
 
   // Remove the worker from |workers_|.
   auto worker_iter = ranges::find(outer_->workers_, worker);
@@ -781,6 +848,10 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::OnWorkerBecomesIdleLockRequired(
   DCHECK(!outer_->idle_workers_stack_.Contains(worker));
   outer_->idle_workers_stack_.Push(worker);
   DCHECK_LE(outer_->idle_workers_stack_.Size(), outer_->workers_.size());
+  // The worker on top of the idle stack is the next one woken up, so it is the
+  // only one worth spinning.
+  if (outer_->after_start().spin_policy)
+    outer_->after_start().spin_policy->SetSpinCandidate(worker);
   outer_->idle_workers_stack_cv_for_testing_->Broadcast();
 }
 
@@ -1027,11 +1098,15 @@ ThreadGroupImpl::CreateAndRegisterWorkerLockRequired(
   // WorkerThread needs |lock_| as a predecessor for its thread lock
   // because in WakeUpOneWorker, |lock_| is first acquired and then
   // the thread lock is acquired when WakeUp is called on the worker.
-  scoped_refptr<WorkerThread> worker =
-      MakeRefCounted<WorkerThread>(priority_hint_,
-                                   std::make_unique<WorkerThreadDelegateImpl>(
-                                       tracked_ref_factory_.GetTrackedRef()),
-                                   task_tracker_, &lock_);
+  const int placement_domain =
+      after_start().worker_placement
+          ? after_start().worker_placement->AcquireDomain()
+          : WorkerPlacement::kNoDomain;
+  scoped_refptr<WorkerThread> worker = MakeRefCounted<WorkerThread>(
+      priority_hint_,
+      std::make_unique<WorkerThreadDelegateImpl>(
+          tracked_ref_factory_.GetTrackedRef(), placement_domain),
+      task_tracker_, &lock_);
 
   workers_.push_back(worker);
   executor->ScheduleStart(worker);
@@ -1125,7 +1200,9 @@ void ThreadGroupImpl::EnsureEnoughWorkersLockRequired(
   // Wake up the appropriate number of workers.
   for (size_t i = 0; i < num_workers_to_wake_up; ++i) {
     MaintainAtLeastOneIdleWorkerLockRequired(executor);
-    WorkerThread* worker_to_wakeup = idle_workers_stack_.Pop();
+    WorkerThread* worker_to_wakeup =
+        i == 0 ? TakeIdleWorkerForNextTaskSourceLockRequired()
+               : idle_workers_stack_.Pop();
     DCHECK(worker_to_wakeup);
     executor->ScheduleWakeUp(worker_to_wakeup);
   }
@@ -1145,6 +1222,28 @@ void ThreadGroupImpl::EnsureEnoughWorkersLockRequired(
   MaybeScheduleAdjustMaxTasksLockRequired(executor);
 }
 
+WorkerThread* ThreadGroupImpl::TakeIdleWorkerForNextTaskSourceLockRequired() {
+  DCHECK(!idle_workers_stack_.IsEmpty());
+  if (!after_start().worker_placement || priority_queue_.IsEmpty())
+    return idle_workers_stack_.Pop();
+
+  // The woken up worker isn't guaranteed to get the task source at the front of
+  // the queue, but it's the one most likely to be picked next.
+  const int domain = priority_queue_.PeekTaskSource()->last_placement_domain();
+  if (domain == WorkerPlacement::kNoDomain)
+    return idle_workers_stack_.Pop();
+
+  WorkerThread* worker =
+      idle_workers_stack_.FindFromTop([domain](WorkerThread* idle_worker) {
+        return static_cast<WorkerThreadDelegateImpl*>(idle_worker->delegate())
+                   ->placement_domain() == domain;
+      });
+  if (!worker)
+    return idle_workers_stack_.Pop();
+  idle_workers_stack_.Take(worker);
+  return worker;
+}
+
 void ThreadGroupImpl::AdjustMaxTasks() {
   DCHECK(
       after_start().service_thread_task_runner->RunsTasksInCurrentSequence());
@@ -7,6 +7,7 @@
 
 #include <stddef.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,6 +27,8 @@
 #include "base/task/thread_pool/task_source.h"
 #include "base/task/thread_pool/thread_group.h"
 #include "base/task/thread_pool/tracked_ref.h"
+#include "base/task/thread_pool/worker_placement.h"
+#include "base/task/thread_pool/worker_spin_policy.h"
 #include "base/task/thread_pool/worker_thread.h"
 #include "base/task/thread_pool/worker_thread_stack.h"
 #include "base/time/time.h"
@@ -167,6 +170,12 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
   scoped_refptr<WorkerThread> CreateAndRegisterWorkerLockRequired(
       ScopedCommandsExecutor* executor) EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Removes a worker from the non-empty idle stack so that it can be woken up.
+  // With worker placement, prefers a worker from the domain in which the next
+  // task source to run last ran. Otherwise, returns the top of the stack.
+  WorkerThread* TakeIdleWorkerForNextTaskSourceLockRequired()
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Returns the number of workers that are awake (i.e. not on the idle stack).
   size_t GetNumAwakeWorkersLockRequired() const EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
@@ -262,6 +271,21 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
     // The period between calls to AdjustMaxTasks() when the thread group is at
     // capacity.
     TimeDelta blocked_workers_poll_period;
+
+    // Assigns workers to placement domains, or null if workers aren't placed
+    // (kTopologyAwareWorkerPlacement disabled or single-domain machine). The
+    // pointer is never modified after Start(), but the per-domain worker
+    // counts it holds are guarded by |lock_|.
+    std::unique_ptr<WorkerPlacement> worker_placement;
+
+    // Decides whether idle workers spin before going to sleep, or null if
+    // kWorkerSpinBeforeSleep is disabled.
+    std::unique_ptr<WorkerSpinPolicy> spin_policy;
+
+    // ThreadPool.WorkerSpinSucceeded.[thread group name] histogram, or null
+    // if |spin_policy| is null or the thread group has no histogram label.
+    // Intentionally leaked.
+    raw_ptr<HistogramBase> spin_succeeded_histogram = nullptr;
   } initialized_in_start_;
 
   InitializedInStart& in_start() {
@@ -277,6 +301,7 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
     return initialized_in_start_;
   }
 
+  const std::string histogram_label_;
   const std::string thread_group_label_;
   const ThreadPriority priority_hint_;
 
@@ -338,6 +363,11 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
   // Set at the start of JoinForTesting().
   bool join_for_testing_started_ GUARDED_BY(lock_) = false;
 
+  // |after_start().spin_policy|, published at the end of Start() so that task
+  // source arrivals can be recorded without |lock_| (task sources may be
+  // pushed before Start()).
+  std::atomic<WorkerSpinPolicy*> spin_policy_for_arrivals_{nullptr};
+
   // Null-opt unless |synchronous_thread_start_for_testing| was true at
   // construction. In that case, it's signaled each time
   // WorkerThreadDelegateImpl::OnMainEntry() completes.
@@ -41,6 +41,7 @@
 #include "base/test/bind.h"
 #include "base/test/gtest_util.h"
 #include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/test_simple_task_runner.h"
 #include "base/test/test_timeouts.h"
 #include "base/test/test_waitable_event.h"
@@ -808,6 +809,35 @@ TEST_F(ThreadGroupImplHistogramTest, NumTasksBeforeCleanup) {
   EXPECT_EQ(0, histogram->SnapshotSamples()->GetCount(10));
 }
 
+// An idle worker spinning before going to sleep picks up a task posted while
+// it spins, without having to be woken up from sleep.
+TEST_F(ThreadGroupImplHistogramTest, SpinningWorkerPicksUpTask) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(
+      kWorkerSpinBeforeSleep, {{"max_spin_duration", "100ms"}});
+  HistogramTester histogram_tester;
+  CreateThreadGroup();
+  // A single worker, so that it is the one on top of the idle stack.
+  StartThreadGroup(TimeDelta::Max(), 1);
+  auto task_runner =
+      test::CreatePooledTaskRunner({}, &mock_pooled_task_runner_delegate_);
+
+  // Tasks posted shortly after the previous one ran make the spin worthwhile.
+  // Spins can legitimately time out on a loaded machine; one must succeed.
+  constexpr char kHistogramName[] =
+      "ThreadPool.WorkerSpinSucceeded.TestThreadGroup";
+  for (int i = 0;
+       i < 1000 && histogram_tester.GetBucketCount(kHistogramName, true) == 0;
+       ++i) {
+    TestWaitableEvent task_ran;
+    task_runner->PostTask(
+        FROM_HERE, BindOnce(&TestWaitableEvent::Signal, Unretained(&task_ran)));
+    task_ran.Wait();
+    PlatformThread::Sleep(Milliseconds(1));
+  }
+  EXPECT_GE(histogram_tester.GetBucketCount(kHistogramName, true), 1);
+}
+
 namespace {
 
 class ThreadGroupImplStandbyPolicyTest : public ThreadGroupImplImplTestBase,
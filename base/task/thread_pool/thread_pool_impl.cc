@@ -23,6 +23,7 @@
 #include "base/task/thread_pool/pooled_parallel_task_runner.h"
 #include "base/task/thread_pool/pooled_sequenced_task_runner.h"
 #include "base/task/thread_pool/task.h"
+#include "base/task/thread_pool/task_location_stats.h"
 #include "base/task/thread_pool/task_source.h"
 #include "base/task/thread_pool/task_source_sort_key.h"
 #include "base/task/thread_pool/thread_group_impl.h"
@@ -132,6 +133,10 @@ void ThreadPoolImpl::Start(const ThreadPoolInstance::InitParams& init_params,
   disable_fair_scheduling_ = FeatureList::IsEnabled(kDisableFairJobScheduling);
   disable_job_update_priority_ =
       FeatureList::IsEnabled(kDisableJobUpdatePriority);
+  if (FeatureList::IsEnabled(kThreadPoolTaskLocationStats)) {
+    internal::TaskLocationStats::SetSamplingInterval(
+        std::max(kTaskLocationStatsSamplingInterval.Get(), 1));
+  }
 
   // The max number of concurrent BEST_EFFORT tasks is |kMaxBestEffortTasks|,
   // unless the max number of foreground threads is lower.
@@ -507,10 +512,10 @@ void ThreadPoolImpl::UpdatePriority(scoped_refptr<TaskSource> task_source,
                                     TaskPriority priority) {
   auto transaction = task_source->BeginTransaction();
 
-  if (transaction.traits().priority() == priority)
+  if (transaction.unboosted_priority() == priority)
     return;
 
-  if (transaction.traits().priority() == TaskPriority::BEST_EFFORT) {
+  if (transaction.unboosted_priority() == TaskPriority::BEST_EFFORT) {
     DCHECK(transaction.traits().thread_policy_set_explicitly())
         << "A ThreadPolicy must be specified in the TaskTraits of an "
            "UpdateableSequencedTaskRunner whose priority is increased from "
@@ -520,24 +525,9 @@ void ThreadPoolImpl::UpdatePriority(scoped_refptr<TaskSource> task_source,
   ThreadGroup* const current_thread_group =
       GetThreadGroupForTraits(transaction.traits());
   transaction.UpdatePriority(priority);
-  ThreadGroup* const new_thread_group =
-      GetThreadGroupForTraits(transaction.traits());
-
-  if (new_thread_group == current_thread_group) {
-    // |task_source|'s position needs to be updated within its current thread
-    // group.
-    current_thread_group->UpdateSortKey(std::move(transaction));
-  } else {
-    // |task_source| is changing thread groups; remove it from its current
-    // thread group and reenqueue it.
-    auto registered_task_source =
-        current_thread_group->RemoveTaskSource(*task_source);
-    if (registered_task_source) {
-      DCHECK(task_source);
-      new_thread_group->PushTaskSourceAndWakeUpWorkers(
-          {std::move(registered_task_source), std::move(transaction)});
-    }
-  }
+  UpdateTaskSourcePosition(task_source, std::move(transaction),
+                           current_thread_group);
+  task_source->UpdateBackgroundThreadPriority();
 }
 
 void ThreadPoolImpl::UpdateJobPriority(scoped_refptr<TaskSource> task_source,
@@ -547,6 +537,37 @@ void ThreadPoolImpl::UpdateJobPriority(scoped_refptr<TaskSource> task_source,
   UpdatePriority(std::move(task_source), priority);
 }
 
+void ThreadPoolImpl::BeginPriorityBoost(scoped_refptr<TaskSource> task_source,
+                                        TaskPriority priority) {
+  // Unlike UpdatePriority(), a boost from BEST_EFFORT doesn't require an
+  // explicit ThreadPolicy: the boost is temporary and meant to get the task
+  // source off background threads.
+  auto transaction = task_source->BeginTransaction();
+  const TaskPriority previous_priority = transaction.traits().priority();
+  ThreadGroup* const current_thread_group =
+      GetThreadGroupForTraits(transaction.traits());
+  transaction.BeginPriorityBoost(priority);
+  if (transaction.traits().priority() == previous_priority)
+    return;
+  UpdateTaskSourcePosition(task_source, std::move(transaction),
+                           current_thread_group);
+  task_source->UpdateBackgroundThreadPriority();
+}
+
+void ThreadPoolImpl::EndPriorityBoost(scoped_refptr<TaskSource> task_source,
+                                      TaskPriority priority) {
+  auto transaction = task_source->BeginTransaction();
+  const TaskPriority previous_priority = transaction.traits().priority();
+  ThreadGroup* const current_thread_group =
+      GetThreadGroupForTraits(transaction.traits());
+  transaction.EndPriorityBoost(priority);
+  if (transaction.traits().priority() == previous_priority)
+    return;
+  UpdateTaskSourcePosition(task_source, std::move(transaction),
+                           current_thread_group);
+  task_source->UpdateBackgroundThreadPriority();
+}
+
 const ThreadGroup* ThreadPoolImpl::GetThreadGroupForTraits(
     const TaskTraits& traits) const {
   return const_cast<ThreadPoolImpl*>(this)->GetThreadGroupForTraits(traits);
@@ -562,6 +583,30 @@ ThreadGroup* ThreadPoolImpl::GetThreadGroupForTraits(const TaskTraits& traits) {
   return foreground_thread_group_.get();
 }
 
+void ThreadPoolImpl::UpdateTaskSourcePosition(
+    scoped_refptr<TaskSource> task_source,
+    TaskSource::Transaction transaction,
+    ThreadGroup* previous_thread_group) {
+  ThreadGroup* const new_thread_group =
+      GetThreadGroupForTraits(transaction.traits());
+
+  if (new_thread_group == previous_thread_group) {
+    // |task_source|'s position needs to be updated within its current thread
+    // group.
+    previous_thread_group->UpdateSortKey(std::move(transaction));
+  } else {
+    // |task_source| is changing thread groups; remove it from its current
+    // thread group and reenqueue it.
+    auto registered_task_source =
+        previous_thread_group->RemoveTaskSource(*task_source);
+    if (registered_task_source) {
+      DCHECK(task_source);
+      new_thread_group->PushTaskSourceAndWakeUpWorkers(
+          {std::move(registered_task_source), std::move(transaction)});
+    }
+  }
+}
+
 void ThreadPoolImpl::UpdateCanRunPolicy() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
 
@@ -108,6 +108,10 @@ class BASE_EXPORT ThreadPoolImpl : public ThreadPoolInstance,
                       TaskPriority priority) override;
   void UpdateJobPriority(scoped_refptr<TaskSource> task_source,
                          TaskPriority priority) override;
+  void BeginPriorityBoost(scoped_refptr<TaskSource> task_source,
+                          TaskPriority priority) override;
+  void EndPriorityBoost(scoped_refptr<TaskSource> task_source,
+                        TaskPriority priority) override;
 
   // Returns the TimeTicks of the next task scheduled on ThreadPool (Now() if
   // immediate, nullopt if none). This is thread-safe, i.e., it's safe if tasks
@@ -141,6 +145,14 @@ class BASE_EXPORT ThreadPoolImpl : public ThreadPoolInstance,
   // TaskTracker::WillPostTask() and after |task|'s delayed run time.
   bool PostTaskWithSequenceNow(Task task, scoped_refptr<Sequence> sequence);
 
+  // Places |task_source|, whose priority was just updated in |transaction|,
+  // in the correct priority-queue position within the appropriate thread
+  // group. |previous_thread_group| is the thread group for its traits before
+  // the update.
+  void UpdateTaskSourcePosition(scoped_refptr<TaskSource> task_source,
+                                TaskSource::Transaction transaction,
+                                ThreadGroup* previous_thread_group);
+
   // PooledTaskRunnerDelegate:
   bool PostTaskWithSequence(Task task,
                             scoped_refptr<Sequence> sequence) override;
@@ -12,6 +12,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/barrier_closure.h"
 #include "base/base_switches.h"
 #include "base/bind.h"
 #include "base/callback.h"
@@ -23,6 +24,8 @@
 #include "base/metrics/field_trial.h"
 #include "base/metrics/field_trial_params.h"
 #include "base/system/sys_info.h"
+#include "base/task/scoped_sequence_priority_boost.h"
+#include "base/task/scoped_set_task_priority_for_current_thread.h"
 #include "base/task/task_features.h"
 #include "base/task/task_traits.h"
 #include "base/task/thread_pool/environment_config.h"
@@ -1550,6 +1553,159 @@ TEST_P(ThreadPoolImplTest, UpdatePriorityFromBestEffortNoThreadPolicy) {
   }
 }
 
+// Verify that a task waiting on a BEST_EFFORT sequence can boost it past
+// unrelated BEST_EFFORT work that occupies all the workers allowed to run
+// BEST_EFFORT tasks, bounding the priority inversion.
+TEST_P(ThreadPoolImplTest, PriorityBoostBestEffortSequence) {
+#if HAS_NATIVE_THREAD_POOL()
+  // Native thread groups don't bound the number of BEST_EFFORT tasks.
+  if (GetGroupTypes().foreground_type == test::GroupType::NATIVE)
+    return;
+#endif
+  StartThreadPool();
+
+  // Mirrors the maximum number of concurrent BEST_EFFORT tasks in
+  // ThreadPoolImpl.
+  constexpr int kMaxBestEffortTasks = 2;
+  TestWaitableEvent blocking_tasks_started;
+  TestWaitableEvent unblock;
+  RepeatingClosure blocking_task_started =
+      BarrierClosure(kMaxBestEffortTasks,
+                     BindOnce(&TestWaitableEvent::Signal,
+                              Unretained(&blocking_tasks_started)));
+  auto blocking_task_runner =
+      thread_pool_->CreateTaskRunner({TaskPriority::BEST_EFFORT});
+  for (int i = 0; i < kMaxBestEffortTasks; ++i) {
+    blocking_task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                                     blocking_task_started.Run();
+                                     unblock.Wait();
+                                   }));
+  }
+  blocking_tasks_started.Wait();
+
+  auto task_runner = thread_pool_->CreateUpdateableSequencedTaskRunner(
+      {TaskPriority::BEST_EFFORT});
+  TestWaitableEvent task_ran;
+  task_runner->PostTask(FROM_HERE, BindOnce(&TestWaitableEvent::Signal,
+                                            Unretained(&task_ran)));
+
+  // Without a boost, the task waits for the blocking tasks.
+  EXPECT_FALSE(task_ran.TimedWait(TestTimeouts::tiny_timeout()));
+  {
+    ScopedSequencePriorityBoost boost(task_runner,
+                                      TaskPriority::USER_BLOCKING);
+    EXPECT_TRUE(task_ran.TimedWait(TestTimeouts::action_timeout()));
+  }
+
+  // Once the boost ends, the sequence is BEST_EFFORT again.
+  TestWaitableEvent unboosted_task_ran;
+  task_runner->PostTask(FROM_HERE, BindOnce(&TestWaitableEvent::Signal,
+                                            Unretained(&unboosted_task_ran)));
+  EXPECT_FALSE(unboosted_task_ran.TimedWait(TestTimeouts::tiny_timeout()));
+  unblock.Signal();
+  unboosted_task_ran.Wait();
+}
+
+// Verify that a boost without an explicit priority inherits the priority of
+// the current task.
+TEST_P(ThreadPoolImplTest, PriorityBoostInheritsCurrentTaskPriority) {
+  StartThreadPool();
+  auto task_runner = thread_pool_->CreateUpdateableSequencedTaskRunner(
+      {TaskPriority::BEST_EFFORT});
+  TestWaitableEvent boosted_task_ran;
+  TestWaitableEvent waiting_task_ran;
+
+  auto waiting_task_runner =
+      thread_pool_->CreateTaskRunner({TaskPriority::USER_VISIBLE});
+  waiting_task_runner->PostTask(
+      FROM_HERE, BindLambdaForTesting([&]() {
+        ScopedSequencePriorityBoost boost(task_runner);
+        task_runner->PostTask(
+            FROM_HERE, BindLambdaForTesting([&]() {
+              EXPECT_EQ(TaskPriority::USER_VISIBLE,
+                        GetTaskPriorityForCurrentThread());
+              boosted_task_ran.Signal();
+            }));
+        boosted_task_ran.Wait();
+        waiting_task_ran.Signal();
+      }));
+  waiting_task_ran.Wait();
+}
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+// Verify that a boost raises the priority of the background thread already
+// running a task from the boosted sequence, and that the priority is restored
+// once the task is done.
+TEST_P(ThreadPoolImplTest, PriorityBoostRaisesRunningBackgroundThread) {
+  if (!CanUseBackgroundPriorityForWorkerThread())
+    return;
+  StartThreadPool();
+
+  auto task_runner = thread_pool_->CreateUpdateableSequencedTaskRunner(
+      {TaskPriority::BEST_EFFORT});
+  TestWaitableEvent task_started;
+  TestWaitableEvent boost_started;
+  TestWaitableEvent task_ran;
+  task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                          EXPECT_EQ(ThreadPriority::BACKGROUND,
+                                    PlatformThread::GetCurrentThreadPriority());
+                          task_started.Signal();
+                          boost_started.Wait();
+                          EXPECT_EQ(ThreadPriority::NORMAL,
+                                    PlatformThread::GetCurrentThreadPriority());
+                          task_ran.Signal();
+                        }));
+
+  task_started.Wait();
+  {
+    ScopedSequencePriorityBoost boost(task_runner,
+                                      TaskPriority::USER_BLOCKING);
+    boost_started.Signal();
+    task_ran.Wait();
+  }
+
+  TestWaitableEvent unboosted_task_ran;
+  task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                          EXPECT_EQ(ThreadPriority::BACKGROUND,
+                                    PlatformThread::GetCurrentThreadPriority());
+                          unboosted_task_ran.Signal();
+                        }));
+  unboosted_task_ran.Wait();
+}
+
+// Verify that a task without MayBlock() can boost a sequence running on a
+// background thread: raising the thread priority doesn't block.
+TEST_P(ThreadPoolImplTest, PriorityBoostFromNonMayBlockTask) {
+  if (!CanUseBackgroundPriorityForWorkerThread())
+    return;
+  StartThreadPool();
+
+  auto task_runner = thread_pool_->CreateUpdateableSequencedTaskRunner(
+      {TaskPriority::BEST_EFFORT});
+  TestWaitableEvent task_started;
+  TestWaitableEvent boost_started;
+  TestWaitableEvent task_ran;
+  task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                          task_started.Signal();
+                          boost_started.Wait();
+                          EXPECT_EQ(ThreadPriority::NORMAL,
+                                    PlatformThread::GetCurrentThreadPriority());
+                          task_ran.Signal();
+                        }));
+  task_started.Wait();
+
+  TestWaitableEvent waiting_task_ran;
+  thread_pool_->CreateTaskRunner({TaskPriority::USER_BLOCKING})
+      ->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                   ScopedSequencePriorityBoost boost(task_runner);
+                   boost_started.Signal();
+                   task_ran.Wait();
+                   waiting_task_ran.Signal();
+                 }));
+  waiting_task_ran.Wait();
+}
+#endif  // BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+
 auto GetGroupTypes() {
   return ::testing::Values(
       GroupTypes { test::GroupType::GENERIC, test::GroupType::GENERIC }
@@ -0,0 +1,76 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/worker_placement.h"
+
+#include "base/check_op.h"
+#include "base/threading/platform_thread.h"
+#include "build/build_config.h"
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+#include "base/cpu_affinity_posix.h"
+#include "base/system/cpu_topology_linux.h"
+#endif
+
+namespace base {
+namespace internal {
+
+WorkerPlacement::WorkerPlacement(std::vector<std::vector<int>> domains)
+    : domains_(std::move(domains)), num_workers_(domains_.size()) {
+  DCHECK(!domains_.empty());
+  for (const auto& domain : domains_)
+    DCHECK(!domain.empty());
+}
+
+WorkerPlacement::~WorkerPlacement() = default;
+
+// static
+std::unique_ptr<WorkerPlacement> WorkerPlacement::CreateForCurrentMachine() {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  const absl::optional<CpuTopology>& topology = GetCpuTopology();
+  if (!topology)
+    return nullptr;
+  // Remote memory is the most expensive to reach, so NUMA nodes take
+  // precedence. On single-node machines, chiplet CPUs still have several
+  // last-level caches between which migrating is costly.
+  if (topology->nodes.size() > 1)
+    return std::make_unique<WorkerPlacement>(topology->nodes);
+  if (topology->last_level_caches.size() > 1)
+    return std::make_unique<WorkerPlacement>(topology->last_level_caches);
+#endif
+  return nullptr;
+}
+
+int WorkerPlacement::AcquireDomain() {
+  size_t best_domain = 0;
+  for (size_t domain = 1; domain < domains_.size(); ++domain) {
+    // Compare num_workers / num_cpus ratios without dividing.
+    if (num_workers_[domain] * domains_[best_domain].size() <
+        num_workers_[best_domain] * domains_[domain].size()) {
+      best_domain = domain;
+    }
+  }
+  ++num_workers_[best_domain];
+  return static_cast<int>(best_domain);
+}
+
+void WorkerPlacement::ReleaseDomain(int domain) {
+  DCHECK_GE(domain, 0);
+  DCHECK_LT(static_cast<size_t>(domain), domains_.size());
+  DCHECK_GT(num_workers_[domain], 0U);
+  --num_workers_[domain];
+}
+
+bool WorkerPlacement::PinCurrentThread(int domain) const {
+  DCHECK_GE(domain, 0);
+  DCHECK_LT(static_cast<size_t>(domain), domains_.size());
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  return SetThreadCpuAffinity(PlatformThread::CurrentId(), domains_[domain]);
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+}  // namespace base
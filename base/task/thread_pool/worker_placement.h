@@ -0,0 +1,69 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_THREAD_POOL_WORKER_PLACEMENT_H_
+#define BASE_TASK_THREAD_POOL_WORKER_PLACEMENT_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/base_export.h"
+
+namespace base {
+namespace internal {
+
+// Spreads the workers of a thread group across placement domains (NUMA nodes,
+// or last-level cache domains on single-node machines) and pins each worker to
+// the CPUs of its domain. Task sources remember the domain they last ran in
+// (TaskSource::last_placement_domain()) so that the thread group can prefer
+// waking up a worker from that domain, keeping their data in nearby caches
+// and memory.
+//
+// This class is NOT thread-safe; its owner must synchronize calls to
+// AcquireDomain() and ReleaseDomain().
+class BASE_EXPORT WorkerPlacement {
+ public:
+  // Returned by TaskSource::last_placement_domain() for task sources that
+  // haven't run on a placed worker yet.
+  static constexpr int kNoDomain = -1;
+
+  // |domains| are the CPUs of each placement domain. There must be at least
+  // one domain and no domain may be empty.
+  explicit WorkerPlacement(std::vector<std::vector<int>> domains);
+  WorkerPlacement(const WorkerPlacement&) = delete;
+  WorkerPlacement& operator=(const WorkerPlacement&) = delete;
+  ~WorkerPlacement();
+
+  // Returns a WorkerPlacement for the topology of the current machine, or
+  // nullptr if there is a single placement domain or the platform doesn't
+  // support pinning threads.
+  static std::unique_ptr<WorkerPlacement> CreateForCurrentMachine();
+
+  // Returns the domain in which to place a new worker: the one with the fewest
+  // workers relative to its number of CPUs.
+  int AcquireDomain();
+
+  // Notifies that a worker returned by AcquireDomain() went away.
+  void ReleaseDomain(int domain);
+
+  // Restricts the current thread to the CPUs of |domain|. Returns false on
+  // failure. Thread-safe.
+  bool PinCurrentThread(int domain) const;
+
+  size_t num_domains() const { return domains_.size(); }
+  size_t NumWorkersInDomainForTesting(int domain) const {
+    return num_workers_[domain];
+  }
+
+ private:
+  const std::vector<std::vector<int>> domains_;
+  std::vector<size_t> num_workers_;
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_TASK_THREAD_POOL_WORKER_PLACEMENT_H_
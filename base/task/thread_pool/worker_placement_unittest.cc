@@ -0,0 +1,50 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/worker_placement.h"
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+TEST(ThreadPoolWorkerPlacementTest, AcquireSpreadsEvenly) {
+  WorkerPlacement placement({{0, 1}, {2, 3}});
+  EXPECT_EQ(2U, placement.num_domains());
+
+  EXPECT_EQ(0, placement.AcquireDomain());
+  EXPECT_EQ(1, placement.AcquireDomain());
+  EXPECT_EQ(0, placement.AcquireDomain());
+  EXPECT_EQ(1, placement.AcquireDomain());
+  EXPECT_EQ(2U, placement.NumWorkersInDomainForTesting(0));
+  EXPECT_EQ(2U, placement.NumWorkersInDomainForTesting(1));
+}
+
+// Domains with more CPUs get proportionally more workers.
+TEST(ThreadPoolWorkerPlacementTest, AcquireProportionalToCpus) {
+  WorkerPlacement placement({{0}, {1, 2, 3}});
+  std::vector<int> num_workers(2);
+  for (int i = 0; i < 8; ++i)
+    ++num_workers[placement.AcquireDomain()];
+  EXPECT_EQ(2, num_workers[0]);
+  EXPECT_EQ(6, num_workers[1]);
+}
+
+TEST(ThreadPoolWorkerPlacementTest, ReleaseDomain) {
+  WorkerPlacement placement({{0, 1}, {2, 3}});
+  EXPECT_EQ(0, placement.AcquireDomain());
+  EXPECT_EQ(1, placement.AcquireDomain());
+  EXPECT_EQ(0, placement.AcquireDomain());
+
+  // The next worker goes where a worker went away.
+  placement.ReleaseDomain(0);
+  placement.ReleaseDomain(0);
+  EXPECT_EQ(0U, placement.NumWorkersInDomainForTesting(0));
+  EXPECT_EQ(0, placement.AcquireDomain());
+}
+
+}  // namespace internal
+}  // namespace base
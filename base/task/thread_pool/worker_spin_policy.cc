@@ -0,0 +1,130 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/worker_spin_policy.h"
+
+#include <algorithm>
+
+#include "base/allocator/partition_allocator/yield_processor.h"
+#include "base/check.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/time/time_override.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Inter-arrival times are clamped to this value, which is also the initial
+// average, before any task source arrived.
+constexpr TimeDelta kMaxInterArrivalTime = Seconds(1);
+
+// Each new inter-arrival time contributes 1/2^kAverageWeightShift of the
+// moving average.
+constexpr int kAverageWeightShift = 3;
+
+// Bounds the backoff: the spin duration is divided by at most 2^this.
+constexpr int kMaxBackoffShift = 5;
+
+// Number of yield instructions between two polls of the wake-up event, to
+// avoid hammering the event's lock.
+constexpr int kYieldsPerPoll = 16;
+
+}  // namespace
+
+WorkerSpinPolicy::WorkerSpinPolicy(TimeDelta max_spin_duration)
+    : max_spin_duration_(max_spin_duration),
+      average_inter_arrival_us_(kMaxInterArrivalTime.InMicroseconds()) {
+  DCHECK(!max_spin_duration_.is_negative());
+}
+
+WorkerSpinPolicy::~WorkerSpinPolicy() = default;
+
+void WorkerSpinPolicy::RecordTaskSourceArrival(TimeTicks now) {
+  const int64_t now_us = (now - TimeTicks()).InMicroseconds();
+  const int64_t last_arrival_us =
+      last_arrival_us_.exchange(now_us, std::memory_order_relaxed);
+  if (last_arrival_us == 0)
+    return;
+  const int64_t inter_arrival_us = std::clamp<int64_t>(
+      now_us - last_arrival_us, 0, kMaxInterArrivalTime.InMicroseconds());
+  const int64_t average_us =
+      average_inter_arrival_us_.load(std::memory_order_relaxed);
+  average_inter_arrival_us_.store(
+      average_us + ((inter_arrival_us - average_us) >> kAverageWeightShift),
+      std::memory_order_relaxed);
+}
+
+TimeDelta WorkerSpinPolicy::GetSpinDuration() const {
+  const TimeDelta average_inter_arrival = Microseconds(
+      average_inter_arrival_us_.load(std::memory_order_relaxed));
+  // Task sources arrive too far apart for a spin to catch the next one.
+  if (average_inter_arrival > max_spin_duration_)
+    return TimeDelta();
+  // Spin for twice the average, to catch most arrivals of a steady stream.
+  const TimeDelta spin_duration =
+      std::min(max_spin_duration_, average_inter_arrival * 2);
+  return spin_duration / (1 << backoff_shift_.load(std::memory_order_relaxed));
+}
+
+void WorkerSpinPolicy::SetSpinCandidate(const void* worker) {
+  spin_candidate_.store(worker, std::memory_order_relaxed);
+}
+
+WorkerSpinPolicy::SpinResult WorkerSpinPolicy::SpinOnEvent(
+    WaitableEvent* wake_up_event,
+    const void* worker) {
+  DCHECK(wake_up_event);
+  DCHECK(worker);
+  const TimeDelta spin_duration = GetSpinDuration();
+  if (spin_duration.is_zero() ||
+      spin_candidate_.load(std::memory_order_relaxed) != worker) {
+    return SpinResult::kDidNotSpin;
+  }
+
+  // Ignore time overrides: mock time wouldn't advance while spinning.
+  const TimeTicks deadline =
+      subtle::TimeTicksNowIgnoringOverride() + spin_duration;
+  SpinResult result = SpinResult::kTimedOut;
+  do {
+    if (wake_up_event->IsSignaled()) {
+      result = SpinResult::kWokenUp;
+      break;
+    }
+    if (spin_candidate_.load(std::memory_order_relaxed) != worker) {
+      result = SpinResult::kSuperseded;
+      break;
+    }
+    for (int i = 0; i < kYieldsPerPoll; ++i)
+      PA_YIELD_PROCESSOR;
+  } while (subtle::TimeTicksNowIgnoringOverride() < deadline);
+
+  DidSpin(result);
+  return result;
+}
+
+TimeDelta WorkerSpinPolicy::GetAverageInterArrivalTimeForTesting() const {
+  return Microseconds(
+      average_inter_arrival_us_.load(std::memory_order_relaxed));
+}
+
+void WorkerSpinPolicy::DidSpin(SpinResult result) {
+  // Stepping up on failure and down on success settles on a spin duration that
+  // succeeds about half of the time, or on the maximum duration if spins
+  // mostly succeed.
+  // Being superseded says nothing about when the next task source arrives.
+  if (result == SpinResult::kSuperseded)
+    return;
+  const int backoff_shift = backoff_shift_.load(std::memory_order_relaxed);
+  if (result == SpinResult::kWokenUp) {
+    backoff_shift_.store(std::max(backoff_shift - 1, 0),
+                         std::memory_order_relaxed);
+  } else {
+    backoff_shift_.store(std::min(backoff_shift + 1, kMaxBackoffShift),
+                         std::memory_order_relaxed);
+  }
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,99 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_THREAD_POOL_WORKER_SPIN_POLICY_H_
+#define BASE_TASK_THREAD_POOL_WORKER_SPIN_POLICY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "base/base_export.h"
+#include "base/time/time.h"
+
+namespace base {
+
+class WaitableEvent;
+
+namespace internal {
+
+// Decides whether an idle worker of a thread group should busy-wait for a
+// short while before going to sleep, so that work arriving soon after it
+// became idle doesn't pay for a full wake-up (futex wake and scheduler round
+// trip).
+//
+// The spin duration adapts to the thread group's workload:
+//  - It follows the average time between task source arrivals: spinning is
+//    pointless if the next task source is unlikely to come before the worker
+//    gives up.
+//  - It backs off exponentially when spins fail, and recovers when they
+//    succeed.
+// Only the spin candidate, the most recently idle worker, may spin. It is on
+// top of the idle stack, which is where the thread group takes the next
+// worker to wake up. A single wake-up is expected per task source arrival, so
+// other idle workers wouldn't be woken up by it. When another worker becomes
+// idle, it becomes the candidate and the previous one stops spinning.
+//
+// This class is thread-safe. Its state is maintained with relaxed atomics: it
+// is a heuristic, and concurrent updates may occasionally be lost.
+class BASE_EXPORT WorkerSpinPolicy {
+ public:
+  enum class SpinResult {
+    // The worker didn't spin, either because spinning isn't expected to pay
+    // off or because it isn't the spin candidate.
+    kDidNotSpin,
+    // The wake-up event was signaled while spinning.
+    kWokenUp,
+    // The spin duration elapsed without the wake-up event being signaled.
+    kTimedOut,
+    // Another worker became the spin candidate while spinning.
+    kSuperseded,
+  };
+
+  // |max_spin_duration| bounds the time spent spinning per idle period.
+  explicit WorkerSpinPolicy(TimeDelta max_spin_duration);
+  WorkerSpinPolicy(const WorkerSpinPolicy&) = delete;
+  WorkerSpinPolicy& operator=(const WorkerSpinPolicy&) = delete;
+  ~WorkerSpinPolicy();
+
+  // Notifies that a task source was added to the thread group at |now|.
+  void RecordTaskSourceArrival(TimeTicks now);
+
+  // Returns how long an idle worker should spin at this point, possibly zero.
+  TimeDelta GetSpinDuration() const;
+
+  // Makes |worker|, which identifies a worker that just became idle, the only
+  // one allowed to spin.
+  void SetSpinCandidate(const void* worker);
+
+  // Busy-waits on |wake_up_event| for up to GetSpinDuration(), if |worker| is
+  // the spin candidate, and until it no longer is. If kWokenUp is returned,
+  // the signal of |wake_up_event| was consumed, like a successful TimedWait()
+  // would.
+  SpinResult SpinOnEvent(WaitableEvent* wake_up_event, const void* worker);
+
+  TimeDelta GetAverageInterArrivalTimeForTesting() const;
+
+ private:
+  // Adjusts the backoff after a spin that ended with |result|.
+  void DidSpin(SpinResult result);
+
+  const TimeDelta max_spin_duration_;
+
+  // Time of the last task source arrival and exponentially weighted moving
+  // average of the time between arrivals, in microseconds.
+  std::atomic<int64_t> last_arrival_us_{0};
+  std::atomic<int64_t> average_inter_arrival_us_;
+
+  // The spin duration is divided by 2^|backoff_shift_|.
+  std::atomic_int backoff_shift_{0};
+
+  // The worker allowed to spin. See SetSpinCandidate().
+  std::atomic<const void*> spin_candidate_{nullptr};
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_TASK_THREAD_POOL_WORKER_SPIN_POLICY_H_
@@ -0,0 +1,182 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/worker_spin_policy.h"
+
+#include "base/memory/raw_ptr.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+constexpr TimeDelta kMaxSpinDuration = Microseconds(100);
+
+// Identify workers.
+constexpr int kWorker = 0;
+constexpr int kOtherWorker = 1;
+
+// Records task source arrivals every |interval|, starting at an arbitrary
+// non-null time.
+void RecordArrivals(WorkerSpinPolicy* policy, TimeDelta interval, int count) {
+  TimeTicks now = TimeTicks() + Seconds(10);
+  for (int i = 0; i < count; ++i) {
+    policy->RecordTaskSourceArrival(now);
+    now += interval;
+  }
+}
+
+class SignalThread : public SimpleThread {
+ public:
+  explicit SignalThread(WaitableEvent* event)
+      : SimpleThread("SignalThread"), event_(event) {}
+
+  void Run() override { event_->Signal(); }
+
+ private:
+  const raw_ptr<WaitableEvent> event_;
+};
+
+// Makes another worker the spin candidate.
+class SupersedeThread : public SimpleThread {
+ public:
+  SupersedeThread(WorkerSpinPolicy* policy, const void* worker)
+      : SimpleThread("SupersedeThread"), policy_(policy), worker_(worker) {}
+
+  void Run() override { policy_->SetSpinCandidate(worker_); }
+
+ private:
+  const raw_ptr<WorkerSpinPolicy> policy_;
+  const void* const worker_;
+};
+
+}  // namespace
+
+// Spinning is pointless until frequent arrivals are observed.
+TEST(ThreadPoolWorkerSpinPolicyTest, NoSpinWithoutArrivals) {
+  WorkerSpinPolicy policy(kMaxSpinDuration);
+  policy.SetSpinCandidate(&kWorker);
+  EXPECT_TRUE(policy.GetSpinDuration().is_zero());
+
+  WaitableEvent event(WaitableEvent::ResetPolicy::AUTOMATIC);
+  event.Signal();
+  EXPECT_EQ(WorkerSpinPolicy::SpinResult::kDidNotSpin,
+            policy.SpinOnEvent(&event, &kWorker));
+  // The signal wasn't consumed.
+  EXPECT_TRUE(event.IsSignaled());
+}
+
+TEST(ThreadPoolWorkerSpinPolicyTest, NoSpinWithInfrequentArrivals) {
+  WorkerSpinPolicy policy(kMaxSpinDuration);
+  policy.SetSpinCandidate(&kWorker);
+  RecordArrivals(&policy, Milliseconds(5), 100);
+  EXPECT_GT(policy.GetAverageInterArrivalTimeForTesting(), kMaxSpinDuration);
+  EXPECT_TRUE(policy.GetSpinDuration().is_zero());
+}
+
+TEST(ThreadPoolWorkerSpinPolicyTest, SpinDurationFollowsArrivals) {
+  WorkerSpinPolicy policy(kMaxSpinDuration);
+  policy.SetSpinCandidate(&kWorker);
+  RecordArrivals(&policy, Microseconds(20), 200);
+  EXPECT_EQ(Microseconds(20), policy.GetAverageInterArrivalTimeForTesting());
+  EXPECT_EQ(Microseconds(40), policy.GetSpinDuration());
+
+  // The spin duration never exceeds the maximum.
+  RecordArrivals(&policy, Microseconds(90), 200);
+  EXPECT_EQ(kMaxSpinDuration, policy.GetSpinDuration());
+}
+
+TEST(ThreadPoolWorkerSpinPolicyTest, WokenUpWhileSpinning) {
+  WorkerSpinPolicy policy(kMaxSpinDuration);
+  policy.SetSpinCandidate(&kWorker);
+  RecordArrivals(&policy, Microseconds(50), 200);
+
+  WaitableEvent event(WaitableEvent::ResetPolicy::AUTOMATIC);
+  event.Signal();
+  EXPECT_EQ(WorkerSpinPolicy::SpinResult::kWokenUp,
+            policy.SpinOnEvent(&event, &kWorker));
+  // The automatic-reset event's signal was consumed.
+  EXPECT_FALSE(event.IsSignaled());
+}
+
+TEST(ThreadPoolWorkerSpinPolicyTest, WokenUpFromOtherThread) {
+  WorkerSpinPolicy policy(Milliseconds(500));
+  policy.SetSpinCandidate(&kWorker);
+  RecordArrivals(&policy, Milliseconds(1), 200);
+
+  WaitableEvent event(WaitableEvent::ResetPolicy::AUTOMATIC);
+  SignalThread thread(&event);
+  // Spins can legitimately time out on a loaded machine; one must succeed.
+  bool woken_up = false;
+  thread.Start();
+  while (!woken_up) {
+    woken_up = policy.SpinOnEvent(&event, &kWorker) ==
+               WorkerSpinPolicy::SpinResult::kWokenUp;
+  }
+  thread.Join();
+}
+
+// Only the spin candidate spins, and it stops once superseded.
+TEST(ThreadPoolWorkerSpinPolicyTest, OnlySpinCandidateSpins) {
+  WorkerSpinPolicy policy(Milliseconds(500));
+  policy.SetSpinCandidate(&kWorker);
+  RecordArrivals(&policy, Milliseconds(200), 200);
+
+  WaitableEvent event(WaitableEvent::ResetPolicy::AUTOMATIC);
+  event.Signal();
+  EXPECT_EQ(WorkerSpinPolicy::SpinResult::kDidNotSpin,
+            policy.SpinOnEvent(&event, &kOtherWorker));
+  EXPECT_TRUE(event.IsSignaled());
+  event.Reset();
+
+  // The other worker may become the candidate before the spin starts, or the
+  // spin may time out on a loaded machine; one spin must be superseded.
+  bool superseded = false;
+  while (!superseded) {
+    policy.SetSpinCandidate(&kWorker);
+    const TimeDelta spin_duration = policy.GetSpinDuration();
+    SupersedeThread thread(&policy, &kOtherWorker);
+    thread.Start();
+    superseded = policy.SpinOnEvent(&event, &kWorker) ==
+                 WorkerSpinPolicy::SpinResult::kSuperseded;
+    thread.Join();
+    // The backoff isn't affected by being superseded.
+    if (superseded)
+      EXPECT_EQ(spin_duration, policy.GetSpinDuration());
+  }
+}
+
+// Failed spins shorten the spin duration, successful ones restore it.
+TEST(ThreadPoolWorkerSpinPolicyTest, Backoff) {
+  WorkerSpinPolicy policy(kMaxSpinDuration);
+  policy.SetSpinCandidate(&kWorker);
+  RecordArrivals(&policy, Microseconds(50), 200);
+  ASSERT_EQ(kMaxSpinDuration, policy.GetSpinDuration());
+
+  WaitableEvent event(WaitableEvent::ResetPolicy::AUTOMATIC);
+  EXPECT_EQ(WorkerSpinPolicy::SpinResult::kTimedOut,
+            policy.SpinOnEvent(&event, &kWorker));
+  EXPECT_EQ(kMaxSpinDuration / 2, policy.GetSpinDuration());
+  EXPECT_EQ(WorkerSpinPolicy::SpinResult::kTimedOut,
+            policy.SpinOnEvent(&event, &kWorker));
+  EXPECT_EQ(kMaxSpinDuration / 4, policy.GetSpinDuration());
+
+  // The backoff is bounded: some spinning remains to detect a change in the
+  // workload.
+  for (int i = 0; i < 10; ++i)
+    policy.SpinOnEvent(&event, &kWorker);
+  EXPECT_FALSE(policy.GetSpinDuration().is_zero());
+  const TimeDelta min_spin_duration = policy.GetSpinDuration();
+
+  event.Signal();
+  EXPECT_EQ(WorkerSpinPolicy::SpinResult::kWokenUp,
+            policy.SpinOnEvent(&event, &kWorker));
+  EXPECT_EQ(min_spin_duration * 2, policy.GetSpinDuration());
+}
+
+}  // namespace internal
+}  // namespace base
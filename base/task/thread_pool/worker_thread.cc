@@ -378,8 +378,22 @@ void WorkerThread::RunWorker() {
     TaskSource* task_source_before_run = task_source.get();
     base::debug::Alias(&task_source_before_run);
 
+    // While running at background thread priority, let priority boosts of
+    // |task_source| raise the thread priority (see
+    // TaskSource::WillRunOnBackgroundThread()).
+    scoped_refptr<TaskSource> boostable_task_source;
+    if (current_thread_priority_ == ThreadPriority::BACKGROUND) {
+      boostable_task_source = WrapRefCounted(task_source.get());
+      boostable_task_source->WillRunOnBackgroundThread(
+          PlatformThread::CurrentId());
+    }
+
     task_source = task_tracker_->RunAndPopNextTask(std::move(task_source));
 
+    // Restores the thread priority if it was raised by a boost.
+    if (boostable_task_source)
+      boostable_task_source->DidRunOnBackgroundThread();
+
     // Alias pointer for investigation of memory corruption. crbug.com/1218384
     TaskSource* task_source_before_move = task_source.get();
     base::debug::Alias(&task_source_before_move);
@@ -52,5 +52,17 @@ void WorkerThreadStack::Remove(const WorkerThread* worker) {
   stack_.erase(it);
 }
 
+void WorkerThreadStack::Take(WorkerThread* worker) {
+  DCHECK(!IsEmpty());
+  if (worker == stack_.back()) {
+    Pop();
+    return;
+  }
+  auto it = ranges::find(stack_, worker);
+  DCHECK(it != stack_.end());
+  stack_.erase(it);
+  worker->EndUnusedPeriod();
+}
+
 }  // namespace internal
 }  // namespace base
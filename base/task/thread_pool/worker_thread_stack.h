@@ -21,8 +21,8 @@ class WorkerThread;
 // towards being inactive / reclaimable). Supports removal of arbitrary
 // WorkerThreads. DCHECKs when a WorkerThread is inserted multiple times.
 // WorkerThreads are not owned by the stack. Push() is amortized O(1). Pop(),
-// Peek(), Size() and Empty() are O(1). Contains() and Remove() are O(n). This
-// class is NOT thread-safe.
+// Peek(), Size() and Empty() are O(1). Contains(), Remove(), FindFromTop() and
+// Take() are O(n). This class is NOT thread-safe.
 class BASE_EXPORT WorkerThreadStack {
  public:
   WorkerThreadStack();
@@ -50,6 +50,22 @@ class BASE_EXPORT WorkerThreadStack {
   // on the stack.
   void Remove(const WorkerThread* worker);
 
+  // Returns the WorkerThread closest to the top of the stack for which
+  // |predicate| returns true, or nullptr if there is none.
+  template <typename Predicate>
+  WorkerThread* FindFromTop(Predicate predicate) const {
+    for (auto it = stack_.rbegin(); it != stack_.rend(); ++it) {
+      if (predicate(*it))
+        return *it;
+    }
+    return nullptr;
+  }
+
+  // Removes |worker|, which must be on the stack, in preparation for waking it
+  // up. Unlike Remove(), |worker| may be anywhere on the stack; it is flagged
+  // as being in-use, like the worker returned by Pop().
+  void Take(WorkerThread* worker);
+
   // Returns the number of WorkerThreads on the stack.
   size_t Size() const { return stack_.size(); }
 
@@ -234,6 +234,48 @@ TEST_F(ThreadPoolWorkerStackTest, PushAfterRemove) {
   EXPECT_EQ(2U, stack.Size());
 }
 
+// Verify that FindFromTop() returns the matching worker closest to the top.
+TEST_F(ThreadPoolWorkerStackTest, FindFromTop) {
+  WorkerThreadStack stack;
+  EXPECT_EQ(nullptr, stack.FindFromTop([](WorkerThread*) { return true; }));
+
+  stack.Push(worker_a_.get());
+  stack.Push(worker_b_.get());
+  stack.Push(worker_c_.get());
+
+  EXPECT_EQ(worker_c_.get(),
+            stack.FindFromTop([](WorkerThread*) { return true; }));
+  EXPECT_EQ(nullptr, stack.FindFromTop([](WorkerThread*) { return false; }));
+  EXPECT_EQ(worker_b_.get(), stack.FindFromTop([&](WorkerThread* worker) {
+    return worker != worker_c_.get();
+  }));
+  EXPECT_EQ(3U, stack.Size());
+}
+
+// Verify that Take() removes workers from any position and flags them as
+// in-use.
+TEST_F(ThreadPoolWorkerStackTest, Take) {
+  WorkerThreadStack stack;
+  stack.Push(worker_a_.get());
+  stack.Push(worker_b_.get());
+  stack.Push(worker_c_.get());
+  EXPECT_FALSE(worker_b_->GetLastUsedTime().is_null());
+
+  stack.Take(worker_b_.get());
+  EXPECT_EQ(2U, stack.Size());
+  EXPECT_FALSE(stack.Contains(worker_b_.get()));
+  EXPECT_TRUE(worker_b_->GetLastUsedTime().is_null());
+
+  // Taking the top of the stack flags the worker below it as in-use, like
+  // Pop().
+  stack.Take(worker_c_.get());
+  EXPECT_EQ(1U, stack.Size());
+  EXPECT_TRUE(worker_a_->GetLastUsedTime().is_null());
+
+  stack.Take(worker_a_.get());
+  EXPECT_TRUE(stack.IsEmpty());
+}
+
 // Verify that Push() DCHECKs when a value is inserted twice.
 TEST_F(ThreadPoolWorkerStackTest, PushTwice) {
   WorkerThreadStack stack;
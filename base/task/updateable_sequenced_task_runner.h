@@ -11,6 +11,8 @@
 
 namespace base {
 
+class ScopedSequencePriorityBoost;
+
 // A SequencedTaskRunner whose posted tasks' priorities can be updated.
 class BASE_EXPORT UpdateableSequencedTaskRunner : public SequencedTaskRunner {
  public:
@@ -24,6 +26,16 @@ class BASE_EXPORT UpdateableSequencedTaskRunner : public SequencedTaskRunner {
  protected:
   UpdateableSequencedTaskRunner() = default;
   ~UpdateableSequencedTaskRunner() override = default;
+
+ private:
+  friend class ScopedSequencePriorityBoost;
+
+  // Raises the priority of tasks posted through this TaskRunner to at least
+  // |priority|, until a matching call to EndPriorityBoost() with the same
+  // |priority|. Use ScopedSequencePriorityBoost instead of calling these
+  // directly.
+  virtual void BeginPriorityBoost(TaskPriority priority) = 0;
+  virtual void EndPriorityBoost(TaskPriority priority) = 0;
 };
 
 }  // namespace base
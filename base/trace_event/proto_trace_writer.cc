@@ -0,0 +1,359 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/trace_event/proto_trace_writer.h"
+
+#include <string.h>
+
+#include <string>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/notreached.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/process/process_handle.h"
+#include "base/trace_event/trace_buffer.h"
+#include "base/trace_event/trace_log.h"
+#include "base/tracing/trace_time.h"
+#include "third_party/perfetto/protos/perfetto/trace/interned_data/interned_data.pbzero.h"
+#include "third_party/perfetto/protos/perfetto/trace/trace_packet.pbzero.h"
+#include "third_party/perfetto/protos/perfetto/trace/track_event/debug_annotation.pbzero.h"
+#include "third_party/perfetto/protos/perfetto/trace/track_event/process_descriptor.pbzero.h"
+#include "third_party/perfetto/protos/perfetto/trace/track_event/thread_descriptor.pbzero.h"
+#include "third_party/perfetto/protos/perfetto/trace/track_event/track_descriptor.pbzero.h"
+#include "third_party/perfetto/protos/perfetto/trace/track_event/track_event.pbzero.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+using perfetto::protos::pbzero::DebugAnnotation;
+using perfetto::protos::pbzero::InternedData;
+using perfetto::protos::pbzero::TracePacket;
+using perfetto::protos::pbzero::TrackDescriptor;
+using perfetto::protos::pbzero::TrackEvent;
+
+// All the packets are written on a single sequence, to which the interned
+// strings belong.
+constexpr uint32_t kSequenceId = 1;
+
+constexpr char kStrippedArgument[] = "__stripped__";
+
+InternedData* GetInternedData(TracePacket* packet,
+                              InternedData** interned_data) {
+  if (!*interned_data)
+    *interned_data = packet->set_interned_data();
+  return *interned_data;
+}
+
+void SetLegacyEventFields(const TraceEvent& event,
+                          bool has_process_id,
+                          TrackEvent::LegacyEvent* legacy_event) {
+  legacy_event->set_phase(event.phase());
+
+  const unsigned int flags = event.flags();
+  if (event.phase() == TRACE_EVENT_PHASE_COMPLETE) {
+    if (event.duration().ToInternalValue() != -1)
+      legacy_event->set_duration_us(event.duration().InMicroseconds());
+    if (!event.thread_timestamp().is_null() &&
+        event.thread_duration().ToInternalValue() != -1) {
+      legacy_event->set_thread_duration_us(
+          event.thread_duration().InMicroseconds());
+    }
+    if (!event.thread_instruction_count().is_null()) {
+      legacy_event->set_thread_instruction_delta(
+          event.thread_instruction_delta().ToInternalValue());
+    }
+  }
+
+  if (flags & TRACE_EVENT_FLAG_ASYNC_TTS)
+    legacy_event->set_use_async_tts(true);
+
+  const unsigned int id_flags =
+      flags & (TRACE_EVENT_FLAG_HAS_ID | TRACE_EVENT_FLAG_HAS_LOCAL_ID |
+               TRACE_EVENT_FLAG_HAS_GLOBAL_ID);
+  if (id_flags) {
+    if (event.scope() != trace_event_internal::kGlobalScope)
+      legacy_event->set_id_scope(event.scope(), strlen(event.scope()));
+
+    switch (id_flags) {
+      case TRACE_EVENT_FLAG_HAS_ID:
+        legacy_event->set_unscoped_id(event.id());
+        break;
+      case TRACE_EVENT_FLAG_HAS_LOCAL_ID:
+        legacy_event->set_local_id(event.id());
+        break;
+      case TRACE_EVENT_FLAG_HAS_GLOBAL_ID:
+        legacy_event->set_global_id(event.id());
+        break;
+      default:
+        NOTREACHED() << "More than one of the ID flags are set";
+        break;
+    }
+  }
+
+  if (flags & TRACE_EVENT_FLAG_BIND_TO_ENCLOSING)
+    legacy_event->set_bind_to_enclosing(true);
+
+  const bool flow_in = flags & TRACE_EVENT_FLAG_FLOW_IN;
+  const bool flow_out = flags & TRACE_EVENT_FLAG_FLOW_OUT;
+  if (flow_in || flow_out) {
+    legacy_event->set_bind_id(event.bind_id());
+    if (flow_in && flow_out)
+      legacy_event->set_flow_direction(TrackEvent::LegacyEvent::FLOW_INOUT);
+    else if (flow_in)
+      legacy_event->set_flow_direction(TrackEvent::LegacyEvent::FLOW_IN);
+    else
+      legacy_event->set_flow_direction(TrackEvent::LegacyEvent::FLOW_OUT);
+  }
+
+  if (event.phase() == TRACE_EVENT_PHASE_INSTANT) {
+    switch (flags & TRACE_EVENT_FLAG_SCOPE_MASK) {
+      case TRACE_EVENT_SCOPE_GLOBAL:
+        legacy_event->set_instant_event_scope(
+            TrackEvent::LegacyEvent::SCOPE_GLOBAL);
+        break;
+      case TRACE_EVENT_SCOPE_PROCESS:
+        legacy_event->set_instant_event_scope(
+            TrackEvent::LegacyEvent::SCOPE_PROCESS);
+        break;
+      case TRACE_EVENT_SCOPE_THREAD:
+        legacy_event->set_instant_event_scope(
+            TrackEvent::LegacyEvent::SCOPE_THREAD);
+        break;
+    }
+  }
+
+  if (has_process_id)
+    legacy_event->set_pid_override(event.process_id());
+}
+
+void SetAnnotationValue(unsigned char type,
+                        const TraceValue& value,
+                        DebugAnnotation* annotation) {
+  switch (type) {
+    case TRACE_VALUE_TYPE_BOOL:
+      annotation->set_bool_value(value.as_bool);
+      break;
+    case TRACE_VALUE_TYPE_UINT:
+      annotation->set_uint_value(value.as_uint);
+      break;
+    case TRACE_VALUE_TYPE_INT:
+      annotation->set_int_value(value.as_int);
+      break;
+    case TRACE_VALUE_TYPE_DOUBLE:
+      annotation->set_double_value(value.as_double);
+      break;
+    case TRACE_VALUE_TYPE_POINTER:
+      annotation->set_pointer_value(
+          static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value.as_pointer)));
+      break;
+    case TRACE_VALUE_TYPE_STRING:
+    case TRACE_VALUE_TYPE_COPY_STRING: {
+      const char* string = value.as_string ? value.as_string : "NULL";
+      annotation->set_string_value(string, strlen(string));
+      break;
+    }
+    case TRACE_VALUE_TYPE_CONVERTABLE: {
+      std::string json;
+      value.as_convertable->AppendAsTraceFormat(&json);
+      annotation->set_legacy_json_value(json);
+      break;
+    }
+    case TRACE_VALUE_TYPE_PROTO: {
+      // The value is a serialized DebugAnnotation without a name.
+      const std::string serialized = value.as_proto->SerializeAsString();
+      annotation->AppendRawProtoBytes(serialized.data(), serialized.size());
+      break;
+    }
+    default:
+      NOTREACHED() << "Don't know how to write this value";
+      break;
+  }
+}
+
+}  // namespace
+
+ProtoTraceWriter::ProtoTraceWriter(
+    File file,
+    const ArgumentFilterPredicate& argument_filter_predicate)
+    : file_(std::move(file)),
+      argument_filter_predicate_(argument_filter_predicate) {
+  DCHECK(file_.IsValid());
+}
+
+ProtoTraceWriter::~ProtoTraceWriter() = default;
+
+void ProtoTraceWriter::WriteChunk(const TraceBufferChunk& chunk) {
+  if (!ok_)
+    return;
+
+  for (size_t i = 0; i < chunk.size(); ++i)
+    AddEvent(*chunk.GetEventAt(i));
+  WriteToFile();
+}
+
+void ProtoTraceWriter::AddEvent(const TraceEvent& event) {
+  // Same as in TraceEvent::AppendAsJSON().
+  const bool has_process_id =
+      (event.flags() & TRACE_EVENT_FLAG_HAS_PROCESS_ID) &&
+      event.process_id() != kNullProcessId;
+  const uint64_t track_uuid =
+      has_process_id
+          ? GetTrackUuid(event.process_id(), -1)
+          : GetTrackUuid(TraceLog::GetInstance()->process_id(),
+                         event.thread_id());
+
+  TracePacket* packet = NewPacket();
+  packet->set_timestamp(
+      static_cast<uint64_t>((event.timestamp() - TimeTicks()).InNanoseconds()));
+  packet->set_timestamp_clock_id(tracing::kTraceClockId);
+
+  // The names are copied when TRACE_EVENT_FLAG_COPY is set, so interning them
+  // by address wouldn't work: write them inline instead.
+  const bool copied_names = event.flags() & TRACE_EVENT_FLAG_COPY;
+  const char* category_group_name =
+      TraceLog::GetCategoryGroupName(event.category_group_enabled());
+
+  ArgumentNameFilterPredicate argument_name_filter_predicate;
+  const bool strip_args =
+      event.arg_size() > 0 && event.arg_name(0) &&
+      !argument_filter_predicate_.is_null() &&
+      !argument_filter_predicate_.Run(category_group_name, event.name(),
+                                      &argument_name_filter_predicate);
+  size_t num_args = 0;
+  if (!strip_args) {
+    while (num_args < event.arg_size() && event.arg_name(num_args))
+      ++num_args;
+  }
+
+  // The interned data must be complete before the event is written, as nested
+  // messages can't be interleaved.
+  InternedData* interned_data = nullptr;
+  bool is_new;
+  const uint64_t category_iid =
+      Intern(category_group_name, &interned_categories_, &is_new);
+  if (is_new) {
+    auto* category =
+        GetInternedData(packet, &interned_data)->add_event_categories();
+    category->set_iid(category_iid);
+    category->set_name(category_group_name, strlen(category_group_name));
+  }
+  uint64_t name_iid = 0;
+  uint64_t arg_name_iids[TraceArguments::kMaxSize] = {};
+  if (!copied_names) {
+    name_iid = Intern(event.name(), &interned_event_names_, &is_new);
+    if (is_new) {
+      auto* name = GetInternedData(packet, &interned_data)->add_event_names();
+      name->set_iid(name_iid);
+      name->set_name(event.name(), strlen(event.name()));
+    }
+    for (size_t i = 0; i < num_args; ++i) {
+      arg_name_iids[i] =
+          Intern(event.arg_name(i), &interned_annotation_names_, &is_new);
+      if (is_new) {
+        auto* name = GetInternedData(packet, &interned_data)
+                         ->add_debug_annotation_names();
+        name->set_iid(arg_name_iids[i]);
+        name->set_name(event.arg_name(i), strlen(event.arg_name(i)));
+      }
+    }
+  }
+
+  TrackEvent* track_event = packet->set_track_event();
+  track_event->add_category_iids(category_iid);
+  if (copied_names)
+    track_event->set_name(event.name(), strlen(event.name()));
+  else
+    track_event->set_name_iid(name_iid);
+  track_event->set_track_uuid(track_uuid);
+  if (!event.thread_timestamp().is_null()) {
+    track_event->set_thread_time_absolute_us(
+        (event.thread_timestamp() - ThreadTicks()).InMicroseconds());
+  }
+  if (!event.thread_instruction_count().is_null()) {
+    track_event->set_thread_instruction_count_absolute(
+        event.thread_instruction_count().ToInternalValue());
+  }
+
+  for (size_t i = 0; i < num_args; ++i) {
+    DebugAnnotation* annotation = track_event->add_debug_annotations();
+    if (copied_names)
+      annotation->set_name(event.arg_name(i), strlen(event.arg_name(i)));
+    else
+      annotation->set_name_iid(arg_name_iids[i]);
+
+    if (argument_name_filter_predicate.is_null() ||
+        argument_name_filter_predicate.Run(event.arg_name(i))) {
+      SetAnnotationValue(event.arg_type(i), event.arg_value(i), annotation);
+    } else {
+      annotation->set_string_value(kStrippedArgument,
+                                   strlen(kStrippedArgument));
+    }
+  }
+  if (strip_args) {
+    DebugAnnotation* annotation = track_event->add_debug_annotations();
+    annotation->set_name(kStrippedArgument, strlen(kStrippedArgument));
+    annotation->set_bool_value(true);
+  }
+
+  SetLegacyEventFields(event, has_process_id, track_event->set_legacy_event());
+}
+
+uint64_t ProtoTraceWriter::GetTrackUuid(int process_id, int thread_id) {
+  const uint64_t uuid =
+      (static_cast<uint64_t>(static_cast<uint32_t>(process_id)) << 32) |
+      static_cast<uint32_t>(thread_id);
+  if (!track_uuids_.insert(uuid).second)
+    return uuid;
+
+  TrackDescriptor* track = NewPacket()->set_track_descriptor();
+  track->set_uuid(uuid);
+  if (thread_id == -1) {
+    track->set_process()->set_pid(process_id);
+  } else {
+    auto* thread = track->set_thread();
+    thread->set_pid(process_id);
+    thread->set_tid(thread_id);
+  }
+  return uuid;
+}
+
+TracePacket* ProtoTraceWriter::NewPacket() {
+  TracePacket* packet = trace_->add_packet();
+  packet->set_trusted_packet_sequence_id(kSequenceId);
+  if (!incremental_state_cleared_) {
+    packet->set_sequence_flags(TracePacket::SEQ_INCREMENTAL_STATE_CLEARED);
+    incremental_state_cleared_ = true;
+  } else {
+    packet->set_sequence_flags(TracePacket::SEQ_NEEDS_INCREMENTAL_STATE);
+  }
+  return packet;
+}
+
+uint64_t ProtoTraceWriter::Intern(
+    const void* name,
+    std::unordered_map<const void*, uint64_t>* interned_ids,
+    bool* is_new) {
+  // Ids start at 1, as 0 means "not set".
+  auto result = interned_ids->emplace(name, interned_ids->size() + 1);
+  *is_new = result.second;
+  return result.first->second;
+}
+
+void ProtoTraceWriter::WriteToFile() {
+  const std::string data = trace_.SerializeAsString();
+  trace_.Reset();
+  if (data.empty())
+    return;
+
+  const int size = checked_cast<int>(data.size());
+  ok_ = file_.WriteAtCurrentPos(data.data(), size) == size;
+  if (!ok_)
+    DLOG(ERROR) << "Failed to write the trace: " << File::GetLastFileError();
+}
+
+}  // namespace trace_event
+}  // namespace base
@@ -0,0 +1,96 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TRACE_EVENT_PROTO_TRACE_WRITER_H_
+#define BASE_TRACE_EVENT_PROTO_TRACE_WRITER_H_
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "base/base_export.h"
+#include "base/files/file.h"
+#include "base/trace_event/trace_event_impl.h"
+#include "third_party/perfetto/include/perfetto/protozero/scattered_heap_buffer.h"
+#include "third_party/perfetto/protos/perfetto/trace/trace.pbzero.h"
+
+namespace perfetto {
+namespace protos {
+namespace pbzero {
+class TracePacket;
+}  // namespace pbzero
+}  // namespace protos
+}  // namespace perfetto
+
+namespace base {
+namespace trace_event {
+
+class TraceBufferChunk;
+
+// Writes TraceEvents to a file in the Perfetto protobuf trace format, which
+// the Perfetto UI and trace processor read, as an alternative to the JSON
+// output of TraceLog::Flush().
+//
+// Events are encoded one TraceBufferChunk at a time and written to the file
+// right away, so the memory used doesn't grow with the size of the trace.
+// Event names, categories and argument names are interned: each string is
+// written once, and referred to by id afterwards.
+//
+// Not thread-safe.
+class BASE_EXPORT ProtoTraceWriter {
+ public:
+  // Arguments are filtered by |argument_filter_predicate| if set, as in the
+  // JSON output.
+  ProtoTraceWriter(File file,
+                   const ArgumentFilterPredicate& argument_filter_predicate);
+  ProtoTraceWriter(const ProtoTraceWriter&) = delete;
+  ProtoTraceWriter& operator=(const ProtoTraceWriter&) = delete;
+  ~ProtoTraceWriter();
+
+  // Writes the events of |chunk| to the file.
+  void WriteChunk(const TraceBufferChunk& chunk);
+
+  // Returns false if writing to the file failed. Events are dropped after a
+  // failure.
+  bool ok() const { return ok_; }
+
+ private:
+  void AddEvent(const TraceEvent& event);
+
+  // Returns the uuid of the track of the thread, or of the process for events
+  // from other processes, and writes its descriptor the first time.
+  uint64_t GetTrackUuid(int process_id, int thread_id);
+
+  // Adds a packet to |trace_|, on the sequence of the interned strings.
+  perfetto::protos::pbzero::TracePacket* NewPacket();
+
+  // Returns the id of |name| in |interned_ids|, and sets |*is_new| if it wasn't
+  // interned yet. Names are interned by address, as they are string literals
+  // unless copied.
+  uint64_t Intern(const void* name,
+                  std::unordered_map<const void*, uint64_t>* interned_ids,
+                  bool* is_new);
+
+  void WriteToFile();
+
+  File file_;
+  const ArgumentFilterPredicate argument_filter_predicate_;
+  bool ok_ = true;
+
+  // Holds the packets of the current chunk. Reset once written, which keeps
+  // its first slice allocated.
+  protozero::HeapBuffered<perfetto::protos::pbzero::Trace> trace_;
+  bool incremental_state_cleared_ = false;
+
+  std::unordered_map<const void*, uint64_t> interned_categories_;
+  std::unordered_map<const void*, uint64_t> interned_event_names_;
+  std::unordered_map<const void*, uint64_t> interned_annotation_names_;
+  std::unordered_set<uint64_t> track_uuids_;
+};
+
+}  // namespace trace_event
+}  // namespace base
+
+#endif  // BASE_TRACE_EVENT_PROTO_TRACE_WRITER_H_
@@ -9,6 +9,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <limits>
 #include <map>
@@ -20,6 +22,9 @@
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/containers/cxx20_erase_vector.h"
+#include "base/files/file.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/json/json_reader.h"
 #include "base/json/json_writer.h"
 #include "base/location.h"
@@ -46,6 +51,10 @@
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
+#if !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
+#include "third_party/perfetto/protos/perfetto/trace/trace.pb.h"
+#endif
+
 namespace base {
 namespace trace_event {
 
@@ -1486,6 +1495,212 @@ TEST_F(TraceEventTestFixture, DataCapturedManyThreads) {
   }
 }
 
+class TraceManyInstantEventsThread : public PlatformThread::Delegate {
+ public:
+  TraceManyInstantEventsThread(int thread_id,
+                               int num_events,
+                               WaitableEvent* exit_event)
+      : thread_id_(thread_id),
+        num_events_(num_events),
+        exit_event_(exit_event) {
+    CHECK(PlatformThread::Create(0, this, &handle_));
+  }
+
+  void WaitUntilEventsAdded() { task_complete_event_.Wait(); }
+  void Join() { PlatformThread::Join(handle_); }
+
+ private:
+  // PlatformThread::Delegate:
+  void ThreadMain() override {
+    TraceManyInstantEvents(thread_id_, num_events_, &task_complete_event_);
+    exit_event_->Wait();
+  }
+
+  const int thread_id_;
+  const int num_events_;
+  const raw_ptr<WaitableEvent> exit_event_;
+  WaitableEvent task_complete_event_;
+  PlatformThreadHandle handle_;
+};
+
+// Test that data sent from multiple threads without a message loop is
+// gathered, both from the threads which exited and from the running ones.
+TEST_F(TraceEventTestFixture, DataCapturedManyThreadsWithoutMessageLoop) {
+  BeginTrace();
+
+  const int num_threads = 4;
+  const int num_events = 4000;
+  WaitableEvent exit_events[2];
+  std::vector<std::unique_ptr<TraceManyInstantEventsThread>> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::make_unique<TraceManyInstantEventsThread>(
+        i, num_events, &exit_events[i % 2]));
+  }
+  for (auto& thread : threads)
+    thread->WaitUntilEventsAdded();
+
+  // Let half of the threads end before flush.
+  exit_events[0].Signal();
+  for (int i = 0; i < num_threads; i += 2)
+    threads[i]->Join();
+
+  EndTraceAndFlush();
+  ValidateInstantEventPresentOnEveryThread(trace_parsed_, num_threads,
+                                           num_events);
+
+  // Let the other half of the threads end after flush.
+  exit_events[1].Signal();
+  for (int i = 1; i < num_threads; i += 2)
+    threads[i]->Join();
+}
+
+#if !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
+// Test that FlushToFile() writes the events in the protobuf format, with
+// interned names.
+TEST_F(TraceEventTestFixture, FlushToFile) {
+  BeginTrace();
+  // More than one chunk of events.
+  const int num_events = 100;
+  for (int i = 0; i < num_events; i++) {
+    TRACE_EVENT_INSTANT1("test_all", "instant", TRACE_EVENT_SCOPE_THREAD, "i",
+                         i);
+  }
+  { TRACE_EVENT0("test_all", "complete"); }
+  const std::string copied_name = "copied";
+  TRACE_EVENT_COPY_INSTANT0("test_all", copied_name.c_str(),
+                            TRACE_EVENT_SCOPE_THREAD);
+  TraceLog::GetInstance()->SetDisabled();
+
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath path = temp_dir.GetPath().AppendASCII("trace.pb");
+  File file(path, File::FLAG_CREATE | File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+
+  WaitableEvent flush_complete_event;
+  TraceLog::GetInstance()->FlushToFile(
+      std::move(file),
+      BindRepeating(
+          [](WaitableEvent* flush_complete_event,
+             const scoped_refptr<RefCountedString>& events_str,
+             bool has_more_events) {
+            EXPECT_TRUE(events_str->data().empty());
+            EXPECT_FALSE(has_more_events);
+            flush_complete_event->Signal();
+          },
+          &flush_complete_event));
+  flush_complete_event.Wait();
+
+  std::string data;
+  ASSERT_TRUE(ReadFileToString(path, &data));
+  perfetto::protos::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(data));
+
+  std::map<uint64_t, std::string> event_names;
+  std::map<uint64_t, std::string> annotation_names;
+  int num_instant_events = 0;
+  int num_complete_events = 0;
+  int num_copied_events = 0;
+  for (const auto& packet : trace.packet()) {
+    if (packet.has_interned_data()) {
+      // Each name is interned once.
+      for (const auto& name : packet.interned_data().event_names())
+        EXPECT_TRUE(event_names.emplace(name.iid(), name.name()).second);
+      for (const auto& name : packet.interned_data().debug_annotation_names())
+        EXPECT_TRUE(annotation_names.emplace(name.iid(), name.name()).second);
+    }
+    if (!packet.has_track_event())
+      continue;
+
+    const auto& track_event = packet.track_event();
+    EXPECT_TRUE(track_event.has_track_uuid());
+    const char phase = static_cast<char>(track_event.legacy_event().phase());
+    if (!track_event.has_name_iid()) {
+      EXPECT_EQ(copied_name, track_event.name());
+      num_copied_events++;
+    } else if (event_names[track_event.name_iid()] == "instant") {
+      EXPECT_EQ(TRACE_EVENT_PHASE_INSTANT, phase);
+      ASSERT_EQ(1, track_event.debug_annotations_size());
+      const auto& annotation = track_event.debug_annotations(0);
+      EXPECT_EQ("i", annotation_names[annotation.name_iid()]);
+      EXPECT_EQ(num_instant_events, annotation.int_value());
+      num_instant_events++;
+    } else if (event_names[track_event.name_iid()] == "complete") {
+      EXPECT_EQ(TRACE_EVENT_PHASE_COMPLETE, phase);
+      EXPECT_TRUE(track_event.legacy_event().has_duration_us());
+      num_complete_events++;
+    }
+  }
+  EXPECT_EQ(num_events, num_instant_events);
+  EXPECT_EQ(1, num_complete_events);
+  EXPECT_EQ(1, num_copied_events);
+}
+#endif  // !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
+
+// Adds events from a thread without a message loop until tracing is disabled,
+// or until it added |max_events|.
+class TraceUntilDisabledThread : public PlatformThread::Delegate {
+ public:
+  TraceUntilDisabledThread(int thread_id, int max_events)
+      : thread_id_(thread_id), max_events_(max_events) {
+    CHECK(PlatformThread::Create(0, this, &handle_));
+  }
+
+  // Number of events added so far. These were added before the call.
+  int num_events_added() const {
+    return num_events_added_.load(std::memory_order_acquire);
+  }
+  void Join() { PlatformThread::Join(handle_); }
+
+ private:
+  // PlatformThread::Delegate:
+  void ThreadMain() override {
+    for (int i = 0; i < max_events_ && TraceLog::GetInstance()->IsEnabled();
+         i++) {
+      TRACE_EVENT_INSTANT2("test_all", "multi thread event",
+                           TRACE_EVENT_SCOPE_THREAD, "thread", thread_id_,
+                           "event", i);
+      num_events_added_.store(i + 1, std::memory_order_release);
+    }
+  }
+
+  const int thread_id_;
+  const int max_events_;
+  std::atomic<int> num_events_added_{0};
+  PlatformThreadHandle handle_;
+};
+
+// Test that flushing while threads without a message loop are adding events
+// doesn't lose the events that were already in their chunks.
+TEST_F(TraceEventTestFixture, FlushWhileThreadsWithoutMessageLoopWrite) {
+  const int num_threads = 4;
+  // Bounds the number of events, so that the trace buffer doesn't get full.
+  const int max_events = 10000;
+  for (int iteration = 0; iteration < 10; iteration++) {
+    Clear();
+    BeginTrace();
+    std::vector<std::unique_ptr<TraceUntilDisabledThread>> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.push_back(
+          std::make_unique<TraceUntilDisabledThread>(i, max_events));
+    }
+    // Flush while the threads are still adding events.
+    for (const auto& thread : threads) {
+      while (thread->num_events_added() < 100)
+        PlatformThread::YieldCurrentThread();
+    }
+    int num_events = max_events;
+    for (const auto& thread : threads)
+      num_events = std::min(num_events, thread->num_events_added());
+
+    EndTraceAndFlush();
+    for (const auto& thread : threads)
+      thread->Join();
+    ValidateInstantEventPresentOnEveryThread(trace_parsed_, num_threads,
+                                             num_events);
+  }
+}
+
 // Test that thread and process names show up in the trace
 TEST_F(TraceEventTestFixture, ThreadNames) {
   // Create threads before we enable tracing to make sure
@@ -14,6 +14,7 @@
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/containers/contains.h"
+#include "base/containers/cxx20_erase.h"
 #include "base/debug/leak_annotations.h"
 #include "base/location.h"
 #include "base/logging.h"
@@ -43,6 +44,7 @@
 #include "base/trace_event/memory_dump_manager.h"
 #include "base/trace_event/memory_dump_provider.h"
 #include "base/trace_event/process_memory_dump.h"
+#include "base/trace_event/proto_trace_writer.h"
 #include "base/trace_event/thread_instruction_count.h"
 #include "base/trace_event/trace_buffer.h"
 #include "base/trace_event/trace_event.h"
@@ -622,6 +624,170 @@ void TraceLog::ThreadLocalEventBuffer::FlushWhileLocked() {
   // find the generation mismatch and delete this buffer soon.
 }
 
+// Holds the chunk of a thread which has no ThreadLocalEventBuffer, i.e. which
+// has no message loop or blocks it. Events are added to the chunk without
+// locking: |lock_| is only taken to exchange full chunks with the trace buffer,
+// once per TraceBufferChunk::kTraceBufferChunkSize events.
+//
+// As such a thread cannot be asked to flush, FlushInternal() takes the chunk
+// from another thread instead, which |state_| synchronizes with the owning
+// thread: the owning thread holds kWriting while it adds or updates an event,
+// and FlushInternal() holds kFlushing while it returns the chunk. If the owning
+// thread is writing, FlushInternal() sets kFlushRequested instead, and waits
+// for the owning thread to return the chunk itself in EndWrite().
+class TraceLog::ThreadLocalChunk {
+ public:
+  explicit ThreadLocalChunk(TraceLog* trace_log) : trace_log_(trace_log) {}
+  ThreadLocalChunk(const ThreadLocalChunk&) = delete;
+  ThreadLocalChunk& operator=(const ThreadLocalChunk&) = delete;
+  ~ThreadLocalChunk() = default;
+
+  // Called on the owning thread before accessing the events of the chunk.
+  // Returns false if FlushInternal() is returning the chunk, in which case the
+  // event should be added to the thread shared chunk instead.
+  bool TryBeginWrite() {
+    int expected = kIdle;
+    return state_.compare_exchange_strong(expected, kWriting,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  // Called on the owning thread after a successful TryBeginWrite(), without
+  // holding |lock_|.
+  void EndWrite();
+
+  // Must be called between TryBeginWrite() and EndWrite().
+  TraceEvent* AddTraceEvent(TraceEventHandle* handle);
+
+  // Must be called between TryBeginWrite() and EndWrite().
+  TraceEvent* GetEventByHandle(TraceEventHandle handle) {
+    if (!chunk_ || handle.chunk_seq != chunk_->seq() ||
+        handle.chunk_index != chunk_index_) {
+      return nullptr;
+    }
+
+    return chunk_->GetEventAt(handle.event_index);
+  }
+
+  // Returns the chunk to the trace buffer, or asks the owning thread to do so
+  // if it is writing, in which case this returns true and the owning thread
+  // decrements |pending_thread_local_chunk_returns_| once it is done. Called
+  // on any thread.
+  bool FlushWhileLocked();
+
+  // ThreadLocalStorage destructor of TraceLog::thread_local_chunk_.
+  static void OnThreadExit(void* value);
+
+ private:
+  enum State {
+    kIdle,
+    kWriting,
+    kFlushRequested,
+    kFlushing,
+  };
+
+  void ReturnChunkWhileLocked();
+
+  const raw_ptr<TraceLog> trace_log_;
+  std::atomic<int> state_{kIdle};
+  std::unique_ptr<TraceBufferChunk> chunk_;
+  size_t chunk_index_ = 0;
+  int generation_ = 0;
+};
+
+void TraceLog::ThreadLocalChunk::EndWrite() {
+  int expected = kWriting;
+  if (state_.compare_exchange_strong(expected, kIdle, std::memory_order_release,
+                                     std::memory_order_relaxed)) {
+    return;
+  }
+
+  // FlushInternal() wanted the chunk while it was being written to, and waits
+  // for it.
+  DCHECK_EQ(kFlushRequested, expected);
+  AutoLock lock(trace_log_->lock_);
+  ReturnChunkWhileLocked();
+  state_.store(kIdle, std::memory_order_release);
+  DCHECK_GT(trace_log_->pending_thread_local_chunk_returns_, 0);
+  --trace_log_->pending_thread_local_chunk_returns_;
+}
+
+TraceEvent* TraceLog::ThreadLocalChunk::AddTraceEvent(
+    TraceEventHandle* handle) {
+  DCHECK_NE(kIdle, state_.load(std::memory_order_relaxed));
+
+  if (!chunk_ || chunk_->IsFull() ||
+      !trace_log_->CheckGeneration(generation_)) {
+    AutoLock lock(trace_log_->lock_);
+    ReturnChunkWhileLocked();
+    chunk_ = trace_log_->logged_events_->GetChunk(&chunk_index_);
+    generation_ = trace_log_->generation();
+    trace_log_->CheckIfBufferIsFullWhileLocked();
+  }
+  if (!chunk_)
+    return nullptr;
+
+  size_t event_index;
+  TraceEvent* trace_event = chunk_->AddTraceEvent(&event_index);
+  if (trace_event && handle)
+    MakeHandle(chunk_->seq(), chunk_index_, event_index, handle);
+
+  return trace_event;
+}
+
+bool TraceLog::ThreadLocalChunk::FlushWhileLocked() {
+  trace_log_->lock_.AssertAcquired();
+
+  int state = state_.load(std::memory_order_relaxed);
+  while (true) {
+    if (state == kIdle) {
+      if (state_.compare_exchange_weak(state, kFlushing,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        ReturnChunkWhileLocked();
+        state_.store(kIdle, std::memory_order_release);
+        return false;
+      }
+    } else {
+      // kFlushing and kFlushRequested are only set while a flush holds |lock_|
+      // or waits for the chunk to be returned.
+      DCHECK_EQ(kWriting, state);
+      if (state_.compare_exchange_weak(state, kFlushRequested,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+}
+
+// static
+void TraceLog::ThreadLocalChunk::OnThreadExit(void* value) {
+  ThreadLocalChunk* thread_local_chunk = static_cast<ThreadLocalChunk*>(value);
+  TraceLog* trace_log = thread_local_chunk->trace_log_;
+
+  // The owning thread is not writing, and FlushInternal() holds |lock_| while
+  // it flushes the chunk, so the chunk can be returned directly.
+  AutoLock lock(trace_log->lock_);
+  thread_local_chunk->ReturnChunkWhileLocked();
+  EraseIf(trace_log->thread_local_chunks_,
+          [thread_local_chunk](const std::unique_ptr<ThreadLocalChunk>& chunk) {
+            return chunk.get() == thread_local_chunk;
+          });
+}
+
+void TraceLog::ThreadLocalChunk::ReturnChunkWhileLocked() {
+  if (!chunk_)
+    return;
+
+  trace_log_->lock_.AssertAcquired();
+  if (trace_log_->CheckGeneration(generation_)) {
+    // Return the chunk to the buffer only if the generation matches.
+    trace_log_->logged_events_->ReturnChunk(chunk_index_, std::move(chunk_));
+  }
+  // Otherwise the chunk belongs to a trace buffer which was already flushed.
+  chunk_.reset();
+}
+
 void TraceLog::SetAddTraceEventOverrides(
     const AddTraceEventOverrideFunction& add_event_override,
     const OnFlushFunction& on_flush_override,
@@ -684,6 +850,7 @@ TraceLog::TraceLog(int generation)
       trace_options_(kInternalRecordUntilFull),
       trace_config_(TraceConfig()),
       thread_shared_chunk_index_(0),
+      thread_local_chunk_(&ThreadLocalChunk::OnThreadExit),
       generation_(generation),
       use_worker_thread_(false) {
   CategoryRegistry::Initialize();
@@ -722,7 +889,7 @@ void TraceLog::InitializeThreadLocalEventBufferIfSupported() {
   // - to know when the thread exits;
   // - to handle the final flush.
   // For a thread without a message loop or if the message loop may be blocked,
-  // the trace events will be added into the main buffer directly.
+  // the trace events will be added into a ThreadLocalChunk instead.
   if (thread_blocks_message_loop_.Get() || !CurrentThread::IsSet() ||
       !ThreadTaskRunnerHandle::IsSet()) {
     return;
@@ -740,6 +907,23 @@ void TraceLog::InitializeThreadLocalEventBufferIfSupported() {
   }
 }
 
+TraceLog::ThreadLocalChunk* TraceLog::GetOrCreateThreadLocalChunk() {
+  auto* thread_local_chunk =
+      static_cast<ThreadLocalChunk*>(thread_local_chunk_.Get());
+  if (thread_local_chunk)
+    return thread_local_chunk;
+
+  HEAP_PROFILER_SCOPED_IGNORE;
+  auto new_thread_local_chunk = std::make_unique<ThreadLocalChunk>(this);
+  thread_local_chunk = new_thread_local_chunk.get();
+  {
+    AutoLock lock(lock_);
+    thread_local_chunks_.push_back(std::move(new_thread_local_chunk));
+  }
+  thread_local_chunk_.Set(thread_local_chunk);
+  return thread_local_chunk;
+}
+
 bool TraceLog::OnMemoryDump(const MemoryDumpArgs& args,
                             ProcessMemoryDump* pmd) {
   // TODO(ssid): Use MemoryDumpArgs to create light dumps when requested
@@ -1370,17 +1554,27 @@ void TraceLog::CheckIfBufferIsFullWhileLocked() {
 // 4. If any thread hasn't finish its flush in time, finish the flush.
 void TraceLog::Flush(const TraceLog::OutputCallback& cb,
                      bool use_worker_thread) {
-  FlushInternal(cb, use_worker_thread, false);
+  FlushInternal(cb, use_worker_thread, false, File());
+}
+
+#if !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
+void TraceLog::FlushToFile(File file,
+                           const TraceLog::OutputCallback& cb,
+                           bool use_worker_thread) {
+  DCHECK(file.IsValid());
+  FlushInternal(cb, use_worker_thread, false, std::move(file));
 }
+#endif  // !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
 
 void TraceLog::CancelTracing(const OutputCallback& cb) {
   SetDisabled();
-  FlushInternal(cb, false, true);
+  FlushInternal(cb, false, true, File());
 }
 
 void TraceLog::FlushInternal(const TraceLog::OutputCallback& cb,
                              bool use_worker_thread,
-                             bool discard_events) {
+                             bool discard_events,
+                             File output_file) {
   use_worker_thread_ = use_worker_thread;
 
 #if BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY) && !BUILDFLAG(IS_NACL)
@@ -1451,12 +1645,26 @@ void TraceLog::FlushInternal(const TraceLog::OutputCallback& cb,
                              : nullptr;
     DCHECK(thread_task_runners_.empty() || flush_task_runner_);
     flush_output_callback_ = cb;
+    flush_output_file_ = std::move(output_file);
 
     if (thread_shared_chunk_) {
       logged_events_->ReturnChunk(thread_shared_chunk_index_,
                                   std::move(thread_shared_chunk_));
     }
 
+    // Threads without a message loop can't be asked to flush, so take their
+    // chunks here. A chunk to which an event is being added is returned by its
+    // thread once the event is written: wait for it, which takes as long as
+    // adding one event, so that FinishFlush() doesn't drop the chunk.
+    for (const auto& thread_local_chunk : thread_local_chunks_) {
+      if (thread_local_chunk->FlushWhileLocked())
+        ++pending_thread_local_chunk_returns_;
+    }
+    while (pending_thread_local_chunk_returns_) {
+      AutoUnlock unlock(lock_);
+      PlatformThread::YieldCurrentThread();
+    }
+
     for (const auto& it : thread_task_runners_)
       task_runners.push_back(it.second);
   }
@@ -1542,9 +1750,29 @@ void TraceLog::ConvertTraceEventsToTraceFormat(
   flush_output_callback.Run(json_events_str_ptr, false);
 }
 
+// Usually it runs on a different thread.
+void TraceLog::ConvertTraceEventsToProto(
+    std::unique_ptr<TraceBuffer> logged_events,
+    File output_file,
+    const OutputCallback& flush_output_callback,
+    const ArgumentFilterPredicate& argument_filter_predicate) {
+  HEAP_PROFILER_SCOPED_IGNORE;
+  ProtoTraceWriter writer(std::move(output_file), argument_filter_predicate);
+  while (const TraceBufferChunk* chunk = logged_events->NextChunk())
+    writer.WriteChunk(*chunk);
+  if (!writer.ok())
+    LOG(ERROR) << "Failed to write the trace events to the output file";
+
+  if (!flush_output_callback.is_null()) {
+    scoped_refptr<RefCountedString> empty_result = new RefCountedString;
+    flush_output_callback.Run(empty_result, false);
+  }
+}
+
 void TraceLog::FinishFlush(int generation, bool discard_events) {
   std::unique_ptr<TraceBuffer> previous_logged_events;
   OutputCallback flush_output_callback;
+  File output_file;
   ArgumentFilterPredicate argument_filter_predicate;
 
   if (!CheckGeneration(generation))
@@ -1560,6 +1788,7 @@ void TraceLog::FinishFlush(int generation, bool discard_events) {
     flush_task_runner_ = nullptr;
     flush_output_callback = flush_output_callback_;
     flush_output_callback_.Reset();
+    output_file = std::move(flush_output_file_);
 
     if (trace_options() & kInternalEnableArgumentFilter) {
       // If argument filtering is activated and there is no filtering predicate,
@@ -1581,20 +1810,24 @@ void TraceLog::FinishFlush(int generation, bool discard_events) {
     return;
   }
 
+  OnceClosure convert_task =
+      output_file.IsValid()
+          ? BindOnce(&TraceLog::ConvertTraceEventsToProto,
+                     std::move(previous_logged_events), std::move(output_file),
+                     flush_output_callback, argument_filter_predicate)
+          : BindOnce(&TraceLog::ConvertTraceEventsToTraceFormat,
+                     std::move(previous_logged_events), flush_output_callback,
+                     argument_filter_predicate);
+
   if (use_worker_thread_) {
-    base::ThreadPool::PostTask(
-        FROM_HERE,
-        {MayBlock(), TaskPriority::BEST_EFFORT,
-         TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
-        BindOnce(&TraceLog::ConvertTraceEventsToTraceFormat,
-                 std::move(previous_logged_events), flush_output_callback,
-                 argument_filter_predicate));
+    base::ThreadPool::PostTask(FROM_HERE,
+                               {MayBlock(), TaskPriority::BEST_EFFORT,
+                                TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+                               std::move(convert_task));
     return;
   }
 
-  ConvertTraceEventsToTraceFormat(std::move(previous_logged_events),
-                                  flush_output_callback,
-                                  argument_filter_predicate);
+  std::move(convert_task).Run();
 }
 
 // Run in each thread holding a local event buffer.
@@ -1902,37 +2135,54 @@ TraceEventHandle TraceLog::AddTraceEventWithThreadIdAndTimestamps(
   // filters indicates or category is not enabled for filtering.
   if ((*category_group_enabled & TraceCategory::ENABLED_FOR_RECORDING) &&
       !disabled_by_filters) {
-    OptionalAutoLock lock(&lock_);
-
-    TraceEvent* trace_event = nullptr;
-    if (thread_local_event_buffer) {
-      trace_event = thread_local_event_buffer->AddTraceEvent(&handle);
-    } else {
-      lock.EnsureAcquired();
-      trace_event = AddEventToThreadSharedChunkWhileLocked(&handle, true);
+    ThreadLocalChunk* thread_local_chunk = nullptr;
+    if (!thread_local_event_buffer) {
+      thread_local_chunk = GetOrCreateThreadLocalChunk();
+      if (!thread_local_chunk->TryBeginWrite())
+        thread_local_chunk = nullptr;
     }
 
-    // NO_THREAD_SAFETY_ANALYSIS: Conditional locking above.
-    if (trace_event) {
-      if (filtered_trace_event) {
-        *trace_event = std::move(*filtered_trace_event);
+    {
+      OptionalAutoLock lock(&lock_);
+
+      TraceEvent* trace_event = nullptr;
+      if (thread_local_event_buffer) {
+        trace_event = thread_local_event_buffer->AddTraceEvent(&handle);
+      } else if (thread_local_chunk) {
+        trace_event = thread_local_chunk->AddTraceEvent(&handle);
       } else {
-        trace_event->Reset(thread_id, offset_event_timestamp, thread_timestamp,
-                           thread_instruction_now, phase,
-                           category_group_enabled, name, scope, id, bind_id,
-                           args, flags);
+        // The chunk of the thread is being flushed.
+        lock.EnsureAcquired();
+        trace_event = AddEventToThreadSharedChunkWhileLocked(&handle, true);
       }
 
+      // NO_THREAD_SAFETY_ANALYSIS: Conditional locking above.
+      if (trace_event) {
+        if (filtered_trace_event) {
+          *trace_event = std::move(*filtered_trace_event);
+        } else {
+          trace_event->Reset(thread_id, offset_event_timestamp,
+                             thread_timestamp, thread_instruction_now, phase,
+                             category_group_enabled, name, scope, id, bind_id,
+                             args, flags);
+        }
+
 #if BUILDFLAG(IS_ANDROID)
-      trace_event->SendToATrace();
+        trace_event->SendToATrace();
 #endif
-    }
+      }
 
-    if (trace_options() & kInternalEchoToConsole) {
-      console_message = EventToConsoleMessage(
-          phase == TRACE_EVENT_PHASE_COMPLETE ? TRACE_EVENT_PHASE_BEGIN : phase,
-          timestamp, trace_event);
+      if (trace_options() & kInternalEchoToConsole) {
+        console_message = EventToConsoleMessage(
+            phase == TRACE_EVENT_PHASE_COMPLETE ? TRACE_EVENT_PHASE_BEGIN
+                                                : phase,
+            timestamp, trace_event);
+      }
     }
+
+    // Outside of |lock|, as this may take |lock_|.
+    if (thread_local_chunk)
+      thread_local_chunk->EndWrite();
   }
 
   if (!console_message.empty())
@@ -2077,22 +2327,38 @@ void TraceLog::UpdateTraceEventDurationExplicit(
 
   std::string console_message;
   if (category_group_enabled_local & TraceCategory::ENABLED_FOR_RECORDING) {
-    OptionalAutoLock lock(&lock_);
-
-    TraceEvent* trace_event = GetEventByHandleInternal(handle, &lock);
-    if (trace_event) {
-      DCHECK(trace_event->phase() == TRACE_EVENT_PHASE_COMPLETE);
-
-      trace_event->UpdateDuration(now, thread_now, thread_instruction_now);
+    // The event may still be in the chunk of the current thread.
+    auto* thread_local_chunk =
+        static_cast<ThreadLocalChunk*>(thread_local_chunk_.Get());
+    if (thread_local_chunk && !thread_local_chunk->TryBeginWrite())
+      thread_local_chunk = nullptr;
+
+    {
+      OptionalAutoLock lock(&lock_);
+
+      TraceEvent* trace_event = nullptr;
+      if (thread_local_chunk)
+        trace_event = thread_local_chunk->GetEventByHandle(handle);
+      if (!trace_event)
+        trace_event = GetEventByHandleInternal(handle, &lock);
+      if (trace_event) {
+        DCHECK(trace_event->phase() == TRACE_EVENT_PHASE_COMPLETE);
+
+        trace_event->UpdateDuration(now, thread_now, thread_instruction_now);
 #if BUILDFLAG(IS_ANDROID)
-      trace_event->SendToATrace();
+        trace_event->SendToATrace();
 #endif
-    }
+      }
 
-    if (trace_options() & kInternalEchoToConsole) {
-      console_message =
-          EventToConsoleMessage(TRACE_EVENT_PHASE_END, now, trace_event);
+      if (trace_options() & kInternalEchoToConsole) {
+        console_message =
+            EventToConsoleMessage(TRACE_EVENT_PHASE_END, now, trace_event);
+      }
     }
+
+    // Outside of |lock|, as this may take |lock_|.
+    if (thread_local_chunk)
+      thread_local_chunk->EndWrite();
   }
 
   if (!console_message.empty())
@@ -2194,6 +2460,14 @@ void TraceLog::AddMetadataEventsWhileLocked() {
 }
 
 TraceEvent* TraceLog::GetEventByHandle(TraceEventHandle handle) {
+  auto* thread_local_chunk =
+      static_cast<ThreadLocalChunk*>(thread_local_chunk_.Get());
+  if (thread_local_chunk && thread_local_chunk->TryBeginWrite()) {
+    TraceEvent* trace_event = thread_local_chunk->GetEventByHandle(handle);
+    thread_local_chunk->EndWrite();
+    if (trace_event)
+      return trace_event;
+  }
   return GetEventByHandleInternal(handle, nullptr);
 }
 
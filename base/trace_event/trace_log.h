@@ -17,12 +17,14 @@
 
 #include "base/base_export.h"
 #include "base/containers/stack.h"
+#include "base/files/file.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/no_destructor.h"
 #include "base/task/single_thread_task_runner.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_local.h"
+#include "base/threading/thread_local_storage.h"
 #include "base/time/time_override.h"
 #include "base/trace_event/category_registry.h"
 #include "base/trace_event/memory_dump_provider.h"
@@ -244,6 +246,17 @@ class BASE_EXPORT TraceLog :
                                    bool has_more_events)>;
   void Flush(const OutputCallback& cb, bool use_worker_thread = false);
 
+#if !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
+  // Like Flush(), but writes the events to |file| in the Perfetto protobuf
+  // trace format instead of converting them to JSON. The events are written
+  // one chunk at a time, so the memory used doesn't grow with the size of the
+  // trace. |cb| is called once with an empty string when all the events are
+  // written.
+  void FlushToFile(File file,
+                   const OutputCallback& cb,
+                   bool use_worker_thread = false);
+#endif  // !BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
+
   // Cancels tracing and discards collected data.
   void CancelTracing(const OutputCallback& cb);
 
@@ -501,6 +514,7 @@ class BASE_EXPORT TraceLog :
       const TraceConfig& config);
 
   class ThreadLocalEventBuffer;
+  class ThreadLocalChunk;
   class OptionalAutoLock;
   struct RegisteredAsyncObserver;
 
@@ -534,9 +548,13 @@ class BASE_EXPORT TraceLog :
   TraceEvent* GetEventByHandleInternal(TraceEventHandle handle,
                                        OptionalAutoLock* lock);
 
+  // Returns the ThreadLocalChunk of the current thread, creating it if needed.
+  ThreadLocalChunk* GetOrCreateThreadLocalChunk();
+
   void FlushInternal(const OutputCallback& cb,
                      bool use_worker_thread,
-                     bool discard_events);
+                     bool discard_events,
+                     File output_file);
 
 #if BUILDFLAG(USE_PERFETTO_CLIENT_LIBRARY)
   tracing::PerfettoPlatform* GetOrCreatePerfettoPlatform();
@@ -551,6 +569,11 @@ class BASE_EXPORT TraceLog :
       std::unique_ptr<TraceBuffer> logged_events,
       const TraceLog::OutputCallback& flush_output_callback,
       const ArgumentFilterPredicate& argument_filter_predicate);
+  static void ConvertTraceEventsToProto(
+      std::unique_ptr<TraceBuffer> logged_events,
+      File output_file,
+      const TraceLog::OutputCallback& flush_output_callback,
+      const ArgumentFilterPredicate& argument_filter_predicate);
   void FinishFlush(int generation, bool discard_events);
   void OnFlushTimeout(int generation, bool discard_events);
 
@@ -638,13 +661,25 @@ class BASE_EXPORT TraceLog :
   std::unordered_map<int, scoped_refptr<SingleThreadTaskRunner>>
       thread_task_runners_;
 
-  // For events which can't be added into the thread local buffer, e.g. events
-  // from threads without a message loop.
+  // For events which can't be added into the thread local buffer nor the
+  // thread local chunk, e.g. metadata events.
   std::unique_ptr<TraceBufferChunk> thread_shared_chunk_;
   size_t thread_shared_chunk_index_;
 
+  // For events from threads without a thread local buffer, e.g. threads without
+  // a message loop. Holds the ThreadLocalChunk of the current thread, which is
+  // destroyed when the thread exits.
+  ThreadLocalStorage::Slot thread_local_chunk_;
+  // All the ThreadLocalChunks, so that they can be flushed. Guarded by |lock_|.
+  std::vector<std::unique_ptr<ThreadLocalChunk>> thread_local_chunks_;
+  // Number of ThreadLocalChunks which FlushInternal() asked their thread to
+  // return, and waits for. Guarded by |lock_|.
+  int pending_thread_local_chunk_returns_ = 0;
+
   // Set when asynchronous Flush is in progress.
   OutputCallback flush_output_callback_;
+  // Set when the asynchronous Flush is a FlushToFile().
+  File flush_output_file_;
   scoped_refptr<SequencedTaskRunner> flush_task_runner_;
   ArgumentFilterPredicate argument_filter_predicate_;
   MetadataFilterPredicate metadata_filter_predicate_;
@@ -0,0 +1,101 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
+#include "base/trace_event/trace_log.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+namespace trace_event {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "TraceLog.";
+constexpr char kTimePerEvent[] = "time_per_event";
+
+constexpr int kEventsPerThread = 100000;
+
+// Adds trace events from a thread without a message loop, once all the
+// threads are started.
+class TracingThread : public SimpleThread {
+ public:
+  explicit TracingThread(WaitableEvent* start_event)
+      : SimpleThread("TracingThread"), start_event_(start_event) {}
+
+  TimeDelta elapsed() const { return elapsed_; }
+
+ private:
+  // SimpleThread:
+  void Run() override {
+    start_event_->Wait();
+    const TimeTicks start = TimeTicks::Now();
+    for (int i = 0; i < kEventsPerThread; i++)
+      TRACE_EVENT_INSTANT1("test", "event", TRACE_EVENT_SCOPE_THREAD, "i", i);
+    elapsed_ = TimeTicks::Now() - start;
+  }
+
+  const raw_ptr<WaitableEvent> start_event_;
+  TimeDelta elapsed_;
+};
+
+// Reports the average time a thread takes to add an event while |num_threads|
+// threads add events concurrently. It stays flat as long as the threads don't
+// contend on a lock, and there are enough cores.
+void MeasureTimePerEvent(int num_threads) {
+  TraceLog* trace_log = TraceLog::GetInstance();
+  // Continuous recording, so that the buffer doesn't get full.
+  trace_log->SetEnabled(TraceConfig("test", RECORD_CONTINUOUSLY),
+                        TraceLog::RECORDING_MODE);
+
+  WaitableEvent start_event;
+  std::vector<std::unique_ptr<TracingThread>> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::make_unique<TracingThread>(&start_event));
+    threads.back()->Start();
+  }
+  start_event.Signal();
+
+  TimeDelta total;
+  for (auto& thread : threads) {
+    thread->Join();
+    total += thread->elapsed();
+  }
+
+  trace_log->SetDisabled();
+  trace_log->CancelTracing(TraceLog::OutputCallback());
+
+  perf_test::PerfResultReporter reporter(
+      kMetricPrefix, NumberToString(num_threads) + "_threads");
+  reporter.RegisterImportantMetric(kTimePerEvent, "us");
+  reporter.AddResult(kTimePerEvent,
+                     total / (static_cast<int64_t>(num_threads) *
+                              kEventsPerThread));
+}
+
+}  // namespace
+
+TEST(TraceLogPerfTest, OneThread) {
+  MeasureTimePerEvent(1);
+}
+
+TEST(TraceLogPerfTest, FourThreads) {
+  MeasureTimePerEvent(4);
+}
+
+TEST(TraceLogPerfTest, SixteenThreads) {
+  MeasureTimePerEvent(16);
+}
+
+}  // namespace trace_event
+}  // namespace base
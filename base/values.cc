@@ -788,10 +788,13 @@ std::string Value::Dict::DebugString() const {
 
 Value::Dict::Dict(
     const flat_map<std::string, std::unique_ptr<Value>>& storage) {
-  storage_.reserve(storage.size());
-  for (const auto& [key, value] : storage) {
-    Set(key, value->Clone());
-  }
+  // `storage` is already sorted and unique, so build the copy in one go.
+  std::vector<std::pair<std::string, std::unique_ptr<Value>>> entries;
+  entries.reserve(storage.size());
+  for (const auto& [key, value] : storage)
+    entries.emplace_back(key, std::make_unique<Value>(value->Clone()));
+  storage_ = flat_map<std::string, std::unique_ptr<Value>>(sorted_unique,
+                                                           std::move(entries));
 }
 
 bool operator==(const Value::Dict& lhs, const Value::Dict& rhs) {
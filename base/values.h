@@ -8,11 +8,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <array>
 #include <initializer_list>
 #include <iosfwd>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -378,8 +381,31 @@ class BASE_EXPORT GSL_OWNER Value {
 
     ~Dict();
 
-    // TODO(dcheng): Probably need to allow construction from a pair of
-    // iterators for now due to the prevalence of DictStorage.
+    // Takes move iterators over `std::pair<std::string, Value>` entries and
+    // moves the entries into a new dictionary. Adding all entries at once sorts
+    // them once and sizes the storage exactly, instead of inserting them one
+    // by one. If several entries have the same key, the last one is kept, as
+    // if they had been added with Set() in order.
+    template <class IteratorType>
+    explicit Dict(std::move_iterator<IteratorType> first,
+                  std::move_iterator<IteratorType> last) {
+      std::vector<std::pair<std::string, std::unique_ptr<Value>>> entries;
+      if constexpr (std::is_base_of_v<
+                        std::forward_iterator_tag,
+                        typename std::iterator_traits<
+                            IteratorType>::iterator_category>) {
+        entries.reserve(static_cast<size_t>(std::distance(first, last)));
+      }
+      for (auto current = first; current != last; ++current) {
+        std::pair<std::string, Value> entry = *current;
+        entries.emplace_back(std::move(entry.first),
+                             std::make_unique<Value>(std::move(entry.second)));
+      }
+      // flat_map keeps the first of equal keys.
+      std::reverse(entries.begin(), entries.end());
+      storage_ =
+          flat_map<std::string, std::unique_ptr<Value>>(std::move(entries));
+    }
 
     // Returns true if there are no entries in this dictionary and false
     // otherwise.
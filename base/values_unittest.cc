@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
@@ -213,6 +214,22 @@ TEST(ValuesTest, ConstructDictFromStorage) {
   }
 }
 
+TEST(ValuesTest, ConstructDictFromMoveIterators) {
+  std::vector<std::pair<std::string, Value>> entries;
+  entries.emplace_back("foo", Value("bar"));
+  entries.emplace_back("baz", Value(Value::List()));
+  entries.emplace_back("foo", Value("qux"));
+
+  Value::Dict dict(std::make_move_iterator(entries.begin()),
+                   std::make_move_iterator(entries.end()));
+  ASSERT_EQ(2u, dict.size());
+  // The last entry with a given key wins, as with Set().
+  EXPECT_EQ("qux", *dict.FindString("foo"));
+  EXPECT_TRUE(dict.FindList("baz"));
+  // Entries are sorted.
+  EXPECT_EQ("baz", dict.begin()->first);
+}
+
 TEST(ValuesTest, ConstructList) {
   ListValue value;
   EXPECT_EQ(Value::Type::LIST, value.type());
@@ -2,9 +2,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "base/base_switches.h"
 #include "base/command_line.h"
+#include "base/message_loop/message_pump.h"
 #include "base/test/multiprocess_test.h"
 #include "base/test/perf_test_suite.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/test_io_thread.h"
 #include "mojo/core/embedder/embedder.h"
 #include "mojo/core/embedder/scoped_ipc_support.h"
@@ -15,6 +18,19 @@
 int main(int argc, char** argv) {
   base::PerfTestSuite test(argc, argv);
 
+  {
+    // The IO thread's message pump is created before any test, so the feature
+    // flags of the command line must be applied to it explicitly. This allows
+    // comparing IO message pumps, e.g. with --enable-features=MessagePumpEpoll.
+    const base::CommandLine* command_line =
+        base::CommandLine::ForCurrentProcess();
+    base::test::ScopedFeatureList feature_list;
+    feature_list.InitFromCommandLine(
+        command_line->GetSwitchValueASCII(switches::kEnableFeatures),
+        command_line->GetSwitchValueASCII(switches::kDisableFeatures));
+    base::MessagePump::InitializeFeatures();
+  }
+
   mojo::core::Init();
   base::TestIOThread test_io_thread(base::TestIOThread::kAutoStart);
   mojo::core::ScopedIPCSupport ipc_support(
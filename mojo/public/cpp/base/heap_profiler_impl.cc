@@ -0,0 +1,76 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/base/heap_profiler_impl.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/containers/span.h"
+#include "base/sampling_heap_profiler/sampling_heap_profiler.h"
+#include "base/task/thread_pool.h"
+#include "mojo/public/cpp/base/big_buffer.h"
+#include "mojo/public/cpp/bindings/self_owned_receiver.h"
+#include "mojo/public/cpp/system/data_pipe_utils.h"
+
+namespace mojo_base {
+
+namespace {
+
+// Writes |serialized_profile| to |pipe|, preceded by its size as a 32-bit
+// little-endian integer. Blocks until the reader has room for it.
+bool WriteToPipe(mojo::ScopedDataPipeProducerHandle* pipe,
+                 std::string serialized_profile) {
+  const uint32_t size = static_cast<uint32_t>(serialized_profile.size());
+  std::string message;
+  message.reserve(sizeof(size) + serialized_profile.size());
+  for (size_t i = 0; i < sizeof(size); ++i)
+    message.push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+  message.append(serialized_profile);
+  return mojo::BlockingCopyFromString(message, *pipe);
+}
+
+}  // namespace
+
+// static
+void HeapProfilerImpl::Create(
+    mojo::PendingReceiver<mojom::HeapProfiler> receiver) {
+  mojo::MakeSelfOwnedReceiver(std::make_unique<HeapProfilerImpl>(),
+                              std::move(receiver));
+}
+
+HeapProfilerImpl::HeapProfilerImpl() = default;
+
+HeapProfilerImpl::~HeapProfilerImpl() = default;
+
+void HeapProfilerImpl::GetProfile(GetProfileCallback callback) {
+  const std::string profile = base::HeapProfileExporter::SerializeSamples(
+      base::SamplingHeapProfiler::Get()->GetSamples(0), &module_cache_);
+  std::move(callback).Run(BigBuffer(base::as_bytes(base::make_span(profile))));
+}
+
+void HeapProfilerImpl::StreamProfiles(
+    base::TimeDelta interval,
+    mojo::ScopedDataPipeProducerHandle pipe) {
+  exporter_.Reset();
+  if (!interval.is_positive() || !pipe.is_valid())
+    return;
+  auto owned_pipe =
+      std::make_unique<mojo::ScopedDataPipeProducerHandle>(std::move(pipe));
+  base::HeapProfileExporter::Sink sink =
+      base::BindRepeating(&WriteToPipe, base::Owned(std::move(owned_pipe)));
+  // Writing to the pipe waits on a base::WaitableEvent.
+  exporter_ = base::SequenceBound<base::HeapProfileExporter>(
+      base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::WithBaseSyncPrimitives(),
+           base::TaskPriority::BEST_EFFORT}),
+      std::move(sink), interval);
+  exporter_.AsyncCall(&base::HeapProfileExporter::Start);
+}
+
+}  // namespace mojo_base
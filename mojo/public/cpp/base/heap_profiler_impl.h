@@ -0,0 +1,47 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BASE_HEAP_PROFILER_IMPL_H_
+#define MOJO_PUBLIC_CPP_BASE_HEAP_PROFILER_IMPL_H_
+
+#include "base/profiler/module_cache.h"
+#include "base/sampling_heap_profiler/heap_profile_exporter.h"
+#include "base/threading/sequence_bound.h"
+#include "base/time/time.h"
+#include "mojo/public/cpp/bindings/pending_receiver.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/mojom/base/heap_profiler.mojom.h"
+
+namespace mojo_base {
+
+// Implements mojom::HeapProfiler with base::SamplingHeapProfiler, so that a
+// process can expose its heap profile to another one, e.g. a browser or a
+// debugging tool.
+class HeapProfilerImpl : public mojom::HeapProfiler {
+ public:
+  // Binds a new HeapProfilerImpl, which lives as long as |receiver|.
+  static void Create(mojo::PendingReceiver<mojom::HeapProfiler> receiver);
+
+  HeapProfilerImpl();
+
+  HeapProfilerImpl(const HeapProfilerImpl&) = delete;
+  HeapProfilerImpl& operator=(const HeapProfilerImpl&) = delete;
+
+  ~HeapProfilerImpl() override;
+
+  // mojom::HeapProfiler:
+  void GetProfile(GetProfileCallback callback) override;
+  void StreamProfiles(base::TimeDelta interval,
+                      mojo::ScopedDataPipeProducerHandle pipe) override;
+
+ private:
+  base::ModuleCache module_cache_;
+
+  // Streams the profiles on a sequence which may block on the pipe.
+  base::SequenceBound<base::HeapProfileExporter> exporter_;
+};
+
+}  // namespace mojo_base
+
+#endif  // MOJO_PUBLIC_CPP_BASE_HEAP_PROFILER_IMPL_H_
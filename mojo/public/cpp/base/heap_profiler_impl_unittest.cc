@@ -0,0 +1,228 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/base/heap_profiler_impl.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/sampling_heap_profiler/poisson_allocation_sampler.h"
+#include "base/sampling_heap_profiler/sampling_heap_profiler.h"
+#include "base/strings/string_piece.h"
+#include "base/test/task_environment.h"
+#include "base/test/test_future.h"
+#include "base/time/time.h"
+#include "mojo/public/cpp/base/big_buffer.h"
+#include "mojo/public/cpp/bindings/remote.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/wait.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo_base {
+namespace heap_profiler_impl_unittest {
+
+namespace {
+
+constexpr size_t kAllocationSize = 10000;
+constexpr int kAllocationCount = 10;
+
+// The fields of a decoded protocol buffer message, by field number. Varints
+// are decoded to integers, length-delimited fields are kept as bytes.
+struct Message {
+  std::multimap<uint32_t, uint64_t> varints;
+  std::multimap<uint32_t, std::string> bytes;
+  // Whether the whole input was consumed by well-formed fields.
+  bool valid = true;
+
+  std::vector<std::string> Bytes(uint32_t field) const {
+    std::vector<std::string> result;
+    auto range = bytes.equal_range(field);
+    for (auto it = range.first; it != range.second; ++it)
+      result.push_back(it->second);
+    return result;
+  }
+};
+
+bool ReadVarint(base::StringPiece* input, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !input->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(input->front());
+    input->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// Decodes a message which only has varint and length-delimited fields, as the
+// pprof profiles do.
+Message Decode(base::StringPiece input) {
+  Message message;
+  while (!input.empty()) {
+    uint64_t tag;
+    uint64_t value;
+    if (!ReadVarint(&input, &tag) || !ReadVarint(&input, &value)) {
+      message.valid = false;
+      break;
+    }
+    const uint32_t field = static_cast<uint32_t>(tag >> 3);
+    if ((tag & 0x7) == 0) {
+      message.varints.emplace(field, value);
+    } else if ((tag & 0x7) == 2 && value <= input.size()) {
+      message.bytes.emplace(field, std::string(input.substr(0, value)));
+      input.remove_prefix(value);
+    } else {
+      message.valid = false;
+      break;
+    }
+  }
+  return message;
+}
+
+// Decodes a packed repeated varint field.
+std::vector<int64_t> DecodePacked(base::StringPiece input) {
+  std::vector<int64_t> values;
+  uint64_t value;
+  while (ReadVarint(&input, &value))
+    values.push_back(static_cast<int64_t>(value));
+  return values;
+}
+
+// Returns the largest in-use space of the samples of the serialized pprof
+// |profile|, or -1 if it does not parse.
+int64_t GetLargestSampledSpace(base::StringPiece profile) {
+  const Message decoded = Decode(profile);
+  // The sample types are {"inuse_objects", "count"}, {"inuse_space", "bytes"}.
+  if (!decoded.valid || decoded.Bytes(1).size() != 2u)
+    return -1;
+  int64_t largest_space = 0;
+  for (const std::string& sample : decoded.Bytes(2)) {
+    const Message message = Decode(sample);
+    const std::vector<std::string> values = message.Bytes(2);
+    if (!message.valid || values.size() != 1u)
+      return -1;
+    const std::vector<int64_t> counts_and_sizes = DecodePacked(values[0]);
+    if (counts_and_sizes.size() != 2u)
+      return -1;
+    largest_space = std::max(largest_space, counts_and_sizes[1]);
+  }
+  return largest_space;
+}
+
+// Reads |size| bytes from |pipe| into |data|, waiting for them.
+bool ReadFromPipe(const mojo::ScopedDataPipeConsumerHandle& pipe,
+                  size_t size,
+                  std::string* data) {
+  data->clear();
+  while (data->size() < size) {
+    char buffer[4096];
+    uint32_t num_bytes =
+        static_cast<uint32_t>(std::min(sizeof(buffer), size - data->size()));
+    const MojoResult result =
+        pipe->ReadData(buffer, &num_bytes, MOJO_READ_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_SHOULD_WAIT) {
+      if (mojo::Wait(pipe.get(), MOJO_HANDLE_SIGNAL_READABLE) !=
+          MOJO_RESULT_OK) {
+        return false;
+      }
+      continue;
+    }
+    if (result != MOJO_RESULT_OK)
+      return false;
+    data->append(buffer, num_bytes);
+  }
+  return true;
+}
+
+// Reads the next profile written by HeapProfilerImpl::StreamProfiles().
+bool ReadProfile(const mojo::ScopedDataPipeConsumerHandle& pipe,
+                 std::string* profile) {
+  std::string size_bytes;
+  if (!ReadFromPipe(pipe, sizeof(uint32_t), &size_bytes))
+    return false;
+  uint32_t size = 0;
+  for (size_t i = 0; i < sizeof(size); ++i) {
+    size |= static_cast<uint32_t>(static_cast<uint8_t>(size_bytes[i]))
+            << (8 * i);
+  }
+  return ReadFromPipe(pipe, size, profile);
+}
+
+}  // namespace
+
+class HeapProfilerImplTest : public testing::Test {
+ public:
+  void SetUp() override {
+    base::SamplingHeapProfiler::Init();
+    // Sample every allocation larger than the interval.
+    suppress_randomness_ = std::make_unique<
+        base::PoissonAllocationSampler::ScopedSuppressRandomnessForTesting>();
+    base::SamplingHeapProfiler::Get()->SetSamplingInterval(1024);
+    HeapProfilerImpl::Create(profiler_.BindNewPipeAndPassReceiver());
+  }
+
+  void TearDown() override {
+    profiler_.reset();
+    task_environment_.RunUntilIdle();
+  }
+
+  void Allocate() {
+    for (int i = 0; i < kAllocationCount; ++i)
+      allocations_.push_back(std::make_unique<char[]>(kAllocationSize));
+  }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  std::unique_ptr<
+      base::PoissonAllocationSampler::ScopedSuppressRandomnessForTesting>
+      suppress_randomness_;
+  mojo::Remote<mojom::HeapProfiler> profiler_;
+  std::vector<std::unique_ptr<char[]>> allocations_;
+};
+
+TEST_F(HeapProfilerImplTest, StreamProfiles) {
+  mojo::ScopedDataPipeProducerHandle producer;
+  mojo::ScopedDataPipeConsumerHandle consumer;
+  ASSERT_EQ(MOJO_RESULT_OK, mojo::CreateDataPipe(nullptr, producer, consumer));
+  profiler_->StreamProfiles(base::Milliseconds(10), std::move(producer));
+  // Let the exporter start its profiler session before allocating.
+  profiler_.FlushForTesting();
+  task_environment_.RunUntilIdle();
+  Allocate();
+
+  // Profiles are deltas: read until the allocations above show up.
+  int64_t largest_space = 0;
+  while (largest_space < static_cast<int64_t>(kAllocationSize)) {
+    std::string profile;
+    ASSERT_TRUE(ReadProfile(consumer, &profile));
+    largest_space = GetLargestSampledSpace(profile);
+    ASSERT_GE(largest_space, 0);
+  }
+
+  // Closing the pipe stops the stream, instead of blocking the exporter.
+  consumer.reset();
+}
+
+TEST_F(HeapProfilerImplTest, GetProfile) {
+  base::SamplingHeapProfiler::Get()->Start();
+  Allocate();
+
+  base::test::TestFuture<BigBuffer> profile;
+  profiler_->GetProfile(profile.GetCallback());
+  const BigBuffer& buffer = profile.Get();
+  EXPECT_GE(GetLargestSampledSpace(base::StringPiece(
+                reinterpret_cast<const char*>(buffer.data()), buffer.size())),
+            static_cast<int64_t>(kAllocationSize));
+
+  base::SamplingHeapProfiler::Get()->Stop();
+}
+
+}  // namespace heap_profiler_impl_unittest
+}  // namespace mojo_base
@@ -4,8 +4,11 @@
 
 #include "mojo/public/cpp/base/values_mojom_traits.h"
 
+#include <iterator>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "base/strings/string_piece.h"
 
@@ -17,13 +20,19 @@ bool StructTraits<
                              base::Value::Dict* out) {
   mojo::MapDataView<mojo::StringDataView, mojo_base::mojom::ValueDataView> view;
   data.GetStorageDataView(&view);
+  // Build the dictionary in one go rather than inserting entries one by one,
+  // which is quadratic for large dictionaries.
+  std::vector<std::pair<std::string, base::Value>> entries;
+  entries.reserve(view.size());
   for (size_t i = 0; i < view.size(); ++i) {
     base::StringPiece key;
     base::Value value;
     if (!view.keys().Read(i, &key) || !view.values().Read(i, &value))
       return false;
-    out->Set(key, std::move(value));
+    entries.emplace_back(std::string(key), std::move(value));
   }
+  *out = base::Value::Dict(std::make_move_iterator(entries.begin()),
+                           std::make_move_iterator(entries.end()));
   return true;
 }
 
@@ -32,6 +41,7 @@ bool StructTraits<mojo_base::mojom::ListValueDataView, base::Value::List>::Read(
     base::Value::List* out) {
   mojo::ArrayDataView<mojo_base::mojom::ValueDataView> view;
   data.GetStorageDataView(&view);
+  out->reserve(view.size());
   base::Value element;
   for (size_t i = 0; i < view.size(); ++i) {
     if (!view.Read(i, &element))